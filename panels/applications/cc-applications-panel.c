@@ -49,8 +49,6 @@
 #define APP_SCHEMA MASTER_SCHEMA ".application"
 #define APP_PREFIX "/org/gnome/desktop/notifications/application/"
 
-#define PORTAL_SNAP_PREFIX "snap."
-
 struct _CcApplicationsPanel
 {
   CcPanel          parent;
@@ -134,6 +132,7 @@ struct _CcApplicationsPanel
   CcInfoRow       *total;
   GtkButton       *clear_cache_button;
 
+  GCancellable    *usage_cancellable;
   guint64          app_size;
   guint64          cache_size;
   guint64          data_size;
@@ -801,9 +800,8 @@ add_static_permission_row (CcApplicationsPanel *self,
 static gboolean
 add_static_permissions (CcApplicationsPanel *self,
                         GAppInfo            *info,
-                        const gchar         *app_id)
+                        GKeyFile            *keyfile)
 {
-  g_autoptr(GKeyFile) keyfile = NULL;
   g_auto(GStrv) sockets = NULL;
   g_auto(GStrv) devices = NULL;
   g_auto(GStrv) shared = NULL;
@@ -812,11 +810,6 @@ add_static_permissions (CcApplicationsPanel *self,
   gint added = 0;
   g_autofree gchar *text = NULL;
 
-  if (app_id && !g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
-    keyfile = get_flatpak_metadata (app_id);
-  if (keyfile == NULL)
-    return FALSE;
-
   sockets = g_key_file_get_string_list (keyfile, "Context", "sockets", NULL, NULL);
   if (sockets && g_strv_contains ((const gchar * const*)sockets, "system-bus"))
     added += add_static_permission_row (self, _("System Bus"), _("Full access"));
@@ -1278,13 +1271,23 @@ set_cache_size (GObject      *source,
   update_total_size (self);
 }
 
+static void
+cache_size_progress (guint64  size,
+                     gpointer data)
+{
+  CcApplicationsPanel *self = data;
+  g_autofree gchar *formatted_size = g_format_size (size);
+
+  g_object_set (self->cache, "info", formatted_size, NULL);
+}
+
 static void
 update_cache_row (CcApplicationsPanel *self,
                   const gchar         *app_id)
 {
   g_autoptr(GFile) dir = get_flatpak_app_dir (app_id, "cache");
   g_object_set (self->cache, "info", "...", NULL);
-  file_size_async (dir, cc_panel_get_cancellable (CC_PANEL (self)), set_cache_size, self);
+  file_size_async (dir, self->usage_cancellable, cache_size_progress, self, set_cache_size, self);
 }
 
 static void
@@ -1311,6 +1314,16 @@ set_data_size (GObject      *source,
   update_total_size (self);
 }
 
+static void
+data_size_progress (guint64  size,
+                    gpointer data)
+{
+  CcApplicationsPanel *self = data;
+  g_autofree gchar *formatted_size = g_format_size (size);
+
+  g_object_set (self->data, "info", formatted_size, NULL);
+}
+
 static void
 update_data_row (CcApplicationsPanel *self,
                  const gchar          *app_id)
@@ -1318,7 +1331,7 @@ update_data_row (CcApplicationsPanel *self,
   g_autoptr(GFile) dir = get_flatpak_app_dir (app_id, "data");
 
   g_object_set (self->data, "info", "...", NULL);
-  file_size_async (dir, cc_panel_get_cancellable (CC_PANEL (self)), set_data_size, self);
+  file_size_async (dir, self->usage_cancellable, data_size_progress, self, set_data_size, self);
 }
 
 static void
@@ -1352,18 +1365,41 @@ clear_cache_cb (CcApplicationsPanel *self)
 }
 
 static void
-update_app_row (CcApplicationsPanel *self,
-                const gchar         *app_id)
+set_app_metadata (GObject      *source,
+                  GAsyncResult *res,
+                  gpointer      data)
 {
+  CcApplicationsPanel *self = data;
+  g_autoptr(GKeyFile) keyfile = NULL;
   g_autofree gchar *formatted_size = NULL;
+  g_autoptr(GError) error = NULL;
+  gboolean has_builtin = FALSE;
+  guint64 size;
+
+  if (!get_app_metadata_finish (res, &size, &keyfile, &error))
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to get app metadata: %s", error->message);
+      return;
+    }
+  self->app_size = size;
 
-  if (g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
-    self->app_size = get_snap_app_size (app_id + strlen (PORTAL_SNAP_PREFIX));
-  else
-    self->app_size = get_flatpak_app_size (app_id);
   formatted_size = g_format_size (self->app_size);
   g_object_set (self->app, "info", formatted_size, NULL);
+
   update_total_size (self);
+
+  if (keyfile != NULL && self->current_app_info != NULL)
+    has_builtin = add_static_permissions (self, self->current_app_info, keyfile);
+  gtk_widget_set_visible (GTK_WIDGET (self->builtin), has_builtin);
+}
+
+static void
+update_app_row (CcApplicationsPanel *self,
+                const gchar         *app_id)
+{
+  g_object_set (self->app, "info", "...", NULL);
+  get_app_metadata_async (app_id, self->usage_cancellable, set_app_metadata, self);
 }
 
 static void
@@ -1372,6 +1408,11 @@ update_app_sizes (CcApplicationsPanel *self,
 {
   gtk_widget_set_sensitive (GTK_WIDGET (self->clear_cache_button), FALSE);
 
+  /* Stop sizing the previously selected app */
+  g_cancellable_cancel (self->usage_cancellable);
+  g_clear_object (&self->usage_cancellable);
+  self->usage_cancellable = g_cancellable_new ();
+
   self->app_size = self->data_size = self->cache_size = 0;
 
   update_app_row (self, app_id);
@@ -1384,16 +1425,16 @@ update_usage_section (CcApplicationsPanel *self,
                       GAppInfo            *info)
 {
   g_autofree gchar *portal_app_id = get_portal_app_id (info);
-  gboolean has_builtin = FALSE;
+
+  /* Built-in permissions are added once the app metadata is loaded */
+  g_cancellable_cancel (self->usage_cancellable);
+  remove_static_permissions (self);
+  gtk_widget_set_visible (GTK_WIDGET (self->builtin), FALSE);
 
   if (portal_app_id != NULL)
     update_app_sizes (self, portal_app_id);
 
-  remove_static_permissions (self);
-  has_builtin = add_static_permissions (self, info, portal_app_id);
-  gtk_widget_set_visible (GTK_WIDGET (self->builtin), has_builtin);
-
-  gtk_widget_set_visible (GTK_WIDGET (self->usage_section), portal_app_id || has_builtin);
+  gtk_widget_set_visible (GTK_WIDGET (self->usage_section), portal_app_id != NULL);
 }
 
 /* --- panel setup --- */
@@ -1637,6 +1678,9 @@ cc_applications_panel_dispose (GObject *object)
 {
   CcApplicationsPanel *self = CC_APPLICATIONS_PANEL (object);
 
+  g_cancellable_cancel (self->usage_cancellable);
+  g_clear_object (&self->usage_cancellable);
+
   remove_all_handler_rows (self);
 #ifdef HAVE_SNAP
   remove_snap_permissions (self);
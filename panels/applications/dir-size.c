@@ -0,0 +1,478 @@
+/* dir-size.c
+ *
+ * Copyright 2026 The GNOME Settings authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#else
+#include <dirent.h>
+#endif
+
+#include "dir-size.h"
+
+/*
+ * Every worker walks a subtree depth-first using directory file
+ * descriptors, so entries are never looked up by full path. While some
+ * workers are idle, busy workers hand over one subdirectory per idle
+ * worker instead of descending into it, so large trees keep every worker
+ * busy. Handed over subtrees are queued as paths relative to the measured
+ * directory, so the queue doesn't hold any file descriptor open. Subtrees
+ * whose path is too long to be opened from the measured directory are
+ * always walked by the worker which found them.
+ */
+
+#ifndef PATH_MAX
+#define PATH_MAX 4096
+#endif
+
+#define MAX_THREADS 8
+#define MAX_DEPTH 64
+#define DIRENT_BUFFER_SIZE 32768
+#define PROGRESS_INTERVAL (100 * G_TIME_SPAN_MILLISECOND)
+#define IDLE_TIMEOUT (100 * G_TIME_SPAN_MILLISECOND)
+
+#ifdef __linux__
+struct linux_dirent64
+{
+  guint64        d_ino;
+  gint64         d_off;
+  unsigned short d_reclen;
+  unsigned char  d_type;
+  char           d_name[];
+};
+#endif
+
+typedef struct
+{
+  dev_t dev;
+  ino_t ino;
+} InodeKey;
+
+typedef struct
+{
+  GMutex               lock;
+  GCond                cond;
+
+  const gchar         *root_path;
+  int                  root_fd;
+  GQueue               shared;  /* relative paths waiting for a worker */
+  gint                 n_idle;  /* read without the lock */
+  guint                n_busy;
+  GHashTable          *inodes;  /* hardlinked files already counted */
+  guint64              total;
+  gint64               last_progress;
+  GError              *error;   /* first error, stops every worker */
+  gint                 failed;
+
+  GCancellable        *cancellable;
+  DirSizeProgressFunc  progress;
+  gpointer             progress_data;
+} DirSize;
+
+static guint
+inode_key_hash (gconstpointer key)
+{
+  const InodeKey *inode = key;
+
+  return (guint) ((guint64) inode->ino ^ ((guint64) inode->ino >> 32)) ^ (guint) inode->dev;
+}
+
+static gboolean
+inode_key_equal (gconstpointer a,
+                 gconstpointer b)
+{
+  const InodeKey *inode_a = a;
+  const InodeKey *inode_b = b;
+
+  return inode_a->dev == inode_b->dev && inode_a->ino == inode_b->ino;
+}
+
+/* Returns TRUE the first time a file with several links is seen */
+static gboolean
+add_inode (DirSize           *self,
+           const struct stat *st)
+{
+  InodeKey *key;
+  gboolean added;
+
+  key = g_new (InodeKey, 1);
+  key->dev = st->st_dev;
+  key->ino = st->st_ino;
+
+  g_mutex_lock (&self->lock);
+  added = g_hash_table_add (self->inodes, key);
+  g_mutex_unlock (&self->lock);
+
+  return added;
+}
+
+static void
+add_size (DirSize *self,
+          guint64  size)
+{
+  gboolean report = FALSE;
+  guint64 total;
+  gint64 now;
+
+  g_mutex_lock (&self->lock);
+
+  self->total += size;
+  total = self->total;
+
+  now = g_get_monotonic_time ();
+  if (self->progress != NULL && now - self->last_progress >= PROGRESS_INTERVAL)
+    {
+      self->last_progress = now;
+      report = TRUE;
+    }
+
+  g_mutex_unlock (&self->lock);
+
+  if (report)
+    self->progress (total, self->progress_data);
+}
+
+static gboolean
+is_stopped (DirSize *self)
+{
+  return g_atomic_int_get (&self->failed) || g_cancellable_is_cancelled (self->cancellable);
+}
+
+static void
+set_error_from_errno (DirSize     *self,
+                      const gchar *path,
+                      int          saved_errno)
+{
+  g_autofree gchar *full_path = g_build_filename (self->root_path, path, NULL);
+
+  g_mutex_lock (&self->lock);
+  if (self->error == NULL)
+    self->error = g_error_new (G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                               "Failed to open %s: %s", full_path, g_strerror (saved_errno));
+  g_atomic_int_set (&self->failed, TRUE);
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->lock);
+}
+
+/* Returns a directory fd, or -1. Subtrees which were removed or can't be
+ * read are left out of the total, other failures stop the whole walk. */
+static int
+open_subtree (DirSize     *self,
+              int          parent_fd,
+              const gchar *name,
+              const gchar *path)
+{
+  int fd;
+
+  fd = openat (parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0 && errno != ENOENT && errno != EACCES)
+    set_error_from_errno (self, path, errno);
+
+  return fd;
+}
+
+/* Queues @path if a worker is waiting for one, and takes ownership of it
+ * if so */
+static gboolean
+share_subtree (DirSize *self,
+               gchar   *path,
+               gboolean force)
+{
+  gboolean shared = FALSE;
+
+  if (!force && g_atomic_int_get (&self->n_idle) == 0)
+    return FALSE;
+
+  g_mutex_lock (&self->lock);
+  if (force || g_queue_get_length (&self->shared) < (guint) g_atomic_int_get (&self->n_idle))
+    {
+      g_queue_push_tail (&self->shared, path);
+      g_cond_signal (&self->cond);
+      shared = TRUE;
+    }
+  g_mutex_unlock (&self->lock);
+
+  return shared;
+}
+
+static guint64
+size_entry (DirSize     *self,
+            int          fd,
+            const gchar *name,
+            GPtrArray   *subdirs)
+{
+  struct stat st;
+
+  if (strcmp (name, ".") == 0 || strcmp (name, "..") == 0)
+    return 0;
+
+  if (fstatat (fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+    return 0;
+
+  if (S_ISDIR (st.st_mode))
+    g_ptr_array_add (subdirs, g_strdup (name));
+  else if (st.st_nlink > 1 && !add_inode (self, &st))
+    return 0;
+
+  return (guint64) st.st_blocks * 512;
+}
+
+static guint64
+size_entries (DirSize   *self,
+              int        fd,
+              GPtrArray *subdirs)
+{
+  guint64 size = 0;
+#ifdef __linux__
+  g_autofree gchar *buffer = g_malloc (DIRENT_BUFFER_SIZE);
+  glong n_read;
+
+  while ((n_read = syscall (SYS_getdents64, fd, buffer, DIRENT_BUFFER_SIZE)) > 0)
+    {
+      glong offset = 0;
+
+      while (offset < n_read)
+        {
+          struct linux_dirent64 *entry = (struct linux_dirent64 *) (buffer + offset);
+
+          size += size_entry (self, fd, entry->d_name, subdirs);
+          offset += entry->d_reclen;
+        }
+    }
+#else
+  struct dirent *entry;
+  DIR *dir;
+  int dir_fd;
+
+  dir_fd = dup (fd);
+  if (dir_fd < 0)
+    return 0;
+
+  dir = fdopendir (dir_fd);
+  if (dir == NULL)
+    {
+      close (dir_fd);
+      return 0;
+    }
+
+  while ((entry = readdir (dir)) != NULL)
+    size += size_entry (self, fd, entry->d_name, subdirs);
+
+  closedir (dir);
+#endif
+
+  return size;
+}
+
+/* Takes ownership of @fd, which is the directory at @path */
+static void
+size_subtree (DirSize     *self,
+              int          fd,
+              const gchar *path,
+              guint        depth)
+{
+  g_autoptr(GPtrArray) subdirs = NULL;
+  guint i;
+
+  if (is_stopped (self))
+    {
+      close (fd);
+      return;
+    }
+
+  subdirs = g_ptr_array_new_with_free_func (g_free);
+  add_size (self, size_entries (self, fd, subdirs));
+
+  for (i = 0; i < subdirs->len && !is_stopped (self); i++)
+    {
+      const gchar *name = g_ptr_array_index (subdirs, i);
+      g_autofree gchar *child_path = NULL;
+      int child;
+
+      child_path = g_build_filename (path, name, NULL);
+
+      /* Deep subtrees are always handed over, to bound the recursion,
+       * unless openat() would fail with ENAMETOOLONG on their path */
+      if (strlen (child_path) < PATH_MAX &&
+          share_subtree (self, child_path, depth >= MAX_DEPTH))
+        {
+          g_steal_pointer (&child_path);
+          continue;
+        }
+
+      child = open_subtree (self, fd, name, child_path);
+      if (child >= 0)
+        size_subtree (self, child, child_path, depth + 1);
+    }
+
+  close (fd);
+}
+
+static gpointer
+worker_func (gpointer data)
+{
+  DirSize *self = data;
+
+  g_mutex_lock (&self->lock);
+
+  while (!is_stopped (self))
+    {
+      if (!g_queue_is_empty (&self->shared))
+        {
+          g_autofree gchar *path = g_queue_pop_head (&self->shared);
+          int fd;
+
+          self->n_busy++;
+          g_mutex_unlock (&self->lock);
+
+          fd = open_subtree (self, self->root_fd, path, path);
+          if (fd >= 0)
+            size_subtree (self, fd, path, 0);
+
+          g_mutex_lock (&self->lock);
+          self->n_busy--;
+          continue;
+        }
+
+      /* Nothing left to share, and nobody who could share more */
+      if (self->n_busy == 0)
+        break;
+
+      /* The timeout lets idle workers notice cancellation */
+      g_atomic_int_inc (&self->n_idle);
+      g_cond_wait_until (&self->cond, &self->lock, g_get_monotonic_time () + IDLE_TIMEOUT);
+      g_atomic_int_add (&self->n_idle, -1);
+    }
+
+  g_cond_broadcast (&self->cond);
+  g_mutex_unlock (&self->lock);
+
+  return NULL;
+}
+
+/**
+ * dir_size_compute:
+ * @path: the directory to measure
+ * @cancellable: (nullable): a #GCancellable
+ * @progress: (nullable): called regularly with the size counted so far
+ * @progress_data: data for @progress
+ * @size: (out): return location for the size
+ * @error: return location for a #GError
+ *
+ * Computes the disk space used by @path, like `du -s` does: allocated
+ * blocks are counted rather than file sizes, and files with several hard
+ * links are counted once. Symbolic links are not followed. A missing
+ * directory has a size of 0, and so do subdirectories which can't be
+ * read or disappear while they are measured.
+ *
+ * This blocks until the whole tree has been walked, using several
+ * threads, so it should be called from a worker thread.
+ *
+ * Returns: %TRUE on success, %FALSE if cancelled or a directory can't be
+ *   opened
+ */
+gboolean
+dir_size_compute (const gchar         *path,
+                  GCancellable        *cancellable,
+                  DirSizeProgressFunc  progress,
+                  gpointer             progress_data,
+                  guint64             *size,
+                  GError             **error)
+{
+  g_autoptr(GPtrArray) threads = NULL;
+  struct stat st;
+  DirSize self = { 0, };
+  guint n_threads;
+  gboolean ret;
+  guint i;
+  int fd;
+
+  fd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    {
+      int saved_errno = errno;
+
+      if (saved_errno == ENOENT)
+        {
+          *size = 0;
+          return TRUE;
+        }
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to open %s: %s", path, g_strerror (saved_errno));
+      return FALSE;
+    }
+
+  g_mutex_init (&self.lock);
+  g_cond_init (&self.cond);
+  g_queue_init (&self.shared);
+  self.root_path = path;
+  self.root_fd = fd;
+  self.inodes = g_hash_table_new_full (inode_key_hash, inode_key_equal, g_free, NULL);
+  self.cancellable = cancellable;
+  self.progress = progress;
+  self.progress_data = progress_data;
+
+  if (fstat (fd, &st) == 0)
+    self.total = (guint64) st.st_blocks * 512;
+
+  g_queue_push_tail (&self.shared, g_strdup ("."));
+
+  n_threads = CLAMP (g_get_num_processors (), 1, MAX_THREADS);
+  threads = g_ptr_array_new ();
+  for (i = 1; i < n_threads; i++)
+    g_ptr_array_add (threads, g_thread_new ("dir-size", worker_func, &self));
+
+  worker_func (&self);
+
+  for (i = 0; i < threads->len; i++)
+    g_thread_join (g_ptr_array_index (threads, i));
+
+  /* Subtrees left over after cancellation or an error */
+  g_queue_clear_full (&self.shared, g_free);
+
+  if (self.error != NULL)
+    {
+      g_propagate_error (error, g_steal_pointer (&self.error));
+      ret = FALSE;
+    }
+  else
+    {
+      ret = !g_cancellable_set_error_if_cancelled (cancellable, error);
+      if (ret)
+        *size = self.total;
+    }
+
+  close (self.root_fd);
+
+  g_hash_table_unref (self.inodes);
+  g_cond_clear (&self.cond);
+  g_mutex_clear (&self.lock);
+
+  return ret;
+}
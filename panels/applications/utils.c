@@ -32,6 +32,7 @@
 
 #include <ftw.h>
 
+#include "dir-size.h"
 #include "utils.h"
 
 static gint
@@ -79,18 +80,62 @@ file_remove_finish (GFile        *file,
   return g_task_propagate_boolean (G_TASK (result), error);
 }
 
-static GPrivate size_key = G_PRIVATE_INIT (g_free);
+typedef struct
+{
+  GMutex               lock;
+  guint64              size;
+  gboolean             report_pending;
+  FileSizeProgressFunc progress;
+  gpointer             progress_data;
+} FileSizeData;
 
-static gint
-ftw_size_cb (const gchar       *path,
-             const struct stat *sb,
-             gint               typeflags,
-             struct FTW        *ftwbuf)
+static void
+file_size_data_free (FileSizeData *data)
 {
-  guint64 *size = (guint64*)g_private_get (&size_key);
-  if (typeflags == FTW_F)
-    *size += sb->st_size;
-  return 0;
+  g_mutex_clear (&data->lock);
+  g_free (data);
+}
+
+static gboolean
+report_progress_cb (gpointer user_data)
+{
+  GTask *task = user_data;
+  FileSizeData *data = g_task_get_task_data (task);
+  guint64 size;
+
+  g_mutex_lock (&data->lock);
+  size = data->size;
+  data->report_pending = FALSE;
+  g_mutex_unlock (&data->lock);
+
+  if (!g_task_get_completed (task) &&
+      !g_cancellable_is_cancelled (g_task_get_cancellable (task)))
+    data->progress (size, data->progress_data);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called from the sizing threads */
+static void
+file_size_progress_cb (guint64  size,
+                       gpointer user_data)
+{
+  GTask *task = user_data;
+  FileSizeData *data = g_task_get_task_data (task);
+  gboolean schedule;
+
+  g_mutex_lock (&data->lock);
+  data->size = MAX (data->size, size);
+  schedule = !data->report_pending;
+  data->report_pending = TRUE;
+  g_mutex_unlock (&data->lock);
+
+  if (schedule)
+    g_main_context_invoke_full (g_task_get_context (task),
+                                G_PRIORITY_DEFAULT,
+                                report_progress_cb,
+                                g_object_ref (task),
+                                g_object_unref);
 }
 
 static void
@@ -100,28 +145,45 @@ file_size_thread_func (GTask        *task,
                        GCancellable *cancellable)
 {
   GFile *file = source_object;
+  FileSizeData *data = task_data;
   g_autofree gchar *path = g_file_get_path (file);
+  g_autoptr(GError) error = NULL;
   guint64 *total;
 
-  g_private_replace (&size_key, g_new0 (guint64, 1));
-
-  nftw (path, ftw_size_cb, 20, FTW_DEPTH);
-
   total = g_new0 (guint64, 1);
-  *total = *(guint64*)g_private_get (&size_key);
 
-  if (g_task_set_return_on_cancel (task, FALSE))
-    g_task_return_pointer (task, total, g_free);
+  if (!dir_size_compute (path,
+                         cancellable,
+                         data->progress ? file_size_progress_cb : NULL,
+                         task,
+                         total,
+                         &error))
+    {
+      g_free (total);
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
+    }
+
+  g_task_return_pointer (task, total, g_free);
 }
 
 void
-file_size_async (GFile               *file,
-                 GCancellable        *cancellable,
-                 GAsyncReadyCallback  callback,
-                 gpointer             data)
+file_size_async (GFile                *file,
+                 GCancellable         *cancellable,
+                 FileSizeProgressFunc  progress,
+                 gpointer              progress_data,
+                 GAsyncReadyCallback   callback,
+                 gpointer              data)
 {
   g_autoptr(GTask) task = g_task_new (file, cancellable, callback, data);
-  g_task_set_return_on_cancel (task, TRUE);
+  FileSizeData *size_data;
+
+  size_data = g_new0 (FileSizeData, 1);
+  g_mutex_init (&size_data->lock);
+  size_data->progress = progress;
+  size_data->progress_data = progress_data;
+
+  g_task_set_task_data (task, size_data, (GDestroyNotify) file_size_data_free);
   g_task_run_in_thread (task, file_size_thread_func);
 }
 
@@ -254,6 +316,207 @@ get_snap_app_size (const gchar *snap_name)
 #endif
 }
 
+/* --- application metadata --- */
+
+#define APP_METADATA_CACHE_SIZE 64
+
+typedef struct
+{
+  gchar    *key;
+  guint64   size;
+  GKeyFile *metadata;
+} AppMetadata;
+
+G_LOCK_DEFINE_STATIC (app_metadata_cache);
+static GHashTable *app_metadata_cache = NULL; /* key -> GList link in app_metadata_lru */
+static GQueue app_metadata_lru = G_QUEUE_INIT; /* most recently used first */
+
+static GThreadPool *app_metadata_pool = NULL;
+
+static void
+app_metadata_clear (AppMetadata *data)
+{
+  g_free (data->key);
+  g_clear_pointer (&data->metadata, g_key_file_unref);
+}
+
+static void
+app_metadata_unref (AppMetadata *data)
+{
+  g_rc_box_release_full (data, (GDestroyNotify) app_metadata_clear);
+}
+
+/* The commit of the active deployment changes whenever the app is
+ * updated, so it is part of the cache key. */
+static gchar *
+get_deployment_commit (const gchar *app_id)
+{
+  g_autofree gchar *user_path = NULL;
+  g_autofree gchar *system_path = NULL;
+  gchar *commit;
+
+  if (g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
+    {
+      g_autofree gchar *path = NULL;
+
+      path = g_build_filename ("/snap", app_id + strlen (PORTAL_SNAP_PREFIX), "current", NULL);
+      return g_file_read_link (path, NULL);
+    }
+
+  user_path = g_build_filename (g_get_user_data_dir (), "flatpak", "app", app_id, "current", "active", NULL);
+  commit = g_file_read_link (user_path, NULL);
+  if (commit != NULL)
+    return commit;
+
+  system_path = g_build_filename ("/var/lib/flatpak", "app", app_id, "current", "active", NULL);
+  return g_file_read_link (system_path, NULL);
+}
+
+static gchar *
+get_app_metadata_key (const gchar *app_id)
+{
+  g_autofree gchar *commit = get_deployment_commit (app_id);
+
+  if (commit == NULL)
+    return NULL;
+
+  return g_strdup_printf ("%s@%s", app_id, commit);
+}
+
+static AppMetadata *
+app_metadata_cache_lookup (const gchar *key)
+{
+  AppMetadata *data = NULL;
+  GList *link;
+
+  G_LOCK (app_metadata_cache);
+
+  link = app_metadata_cache ? g_hash_table_lookup (app_metadata_cache, key) : NULL;
+  if (link != NULL)
+    {
+      g_queue_unlink (&app_metadata_lru, link);
+      g_queue_push_head_link (&app_metadata_lru, link);
+      data = g_rc_box_acquire (link->data);
+    }
+
+  G_UNLOCK (app_metadata_cache);
+
+  return data;
+}
+
+static void
+app_metadata_cache_insert (AppMetadata *data)
+{
+  G_LOCK (app_metadata_cache);
+
+  if (app_metadata_cache == NULL)
+    app_metadata_cache = g_hash_table_new (g_str_hash, g_str_equal);
+
+  if (!g_hash_table_contains (app_metadata_cache, data->key))
+    {
+      g_queue_push_head (&app_metadata_lru, g_rc_box_acquire (data));
+      g_hash_table_insert (app_metadata_cache, data->key, app_metadata_lru.head);
+    }
+
+  while (app_metadata_lru.length > APP_METADATA_CACHE_SIZE)
+    {
+      AppMetadata *oldest = g_queue_pop_tail (&app_metadata_lru);
+
+      g_hash_table_remove (app_metadata_cache, oldest->key);
+      app_metadata_unref (oldest);
+    }
+
+  G_UNLOCK (app_metadata_cache);
+}
+
+static void
+app_metadata_thread_func (gpointer data,
+                          gpointer user_data)
+{
+  g_autoptr(GTask) task = data;
+  const gchar *app_id = g_task_get_task_data (task);
+  AppMetadata *metadata;
+
+  /* Requests for apps the user already moved away from are skipped */
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  metadata = g_rc_box_new0 (AppMetadata);
+  metadata->key = get_app_metadata_key (app_id);
+
+  if (g_str_has_prefix (app_id, PORTAL_SNAP_PREFIX))
+    {
+      metadata->size = get_snap_app_size (app_id + strlen (PORTAL_SNAP_PREFIX));
+    }
+  else
+    {
+      metadata->size = get_flatpak_app_size (app_id);
+      metadata->metadata = get_flatpak_metadata (app_id);
+    }
+
+  if (metadata->key != NULL)
+    app_metadata_cache_insert (metadata);
+
+  g_task_return_pointer (task, metadata, (GDestroyNotify) app_metadata_unref);
+}
+
+void
+get_app_metadata_async (const gchar         *app_id,
+                        GCancellable        *cancellable,
+                        GAsyncReadyCallback  callback,
+                        gpointer             data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autofree gchar *key = NULL;
+  AppMetadata *metadata;
+
+  task = g_task_new (NULL, cancellable, callback, data);
+  g_task_set_source_tag (task, get_app_metadata_async);
+
+  key = get_app_metadata_key (app_id);
+  metadata = key ? app_metadata_cache_lookup (key) : NULL;
+  if (metadata != NULL)
+    {
+      g_task_return_pointer (task, metadata, (GDestroyNotify) app_metadata_unref);
+      return;
+    }
+
+  /* A single worker is enough, and keeps a burst of selections from
+   * spawning dozens of flatpak processes at once */
+  if (g_once_init_enter (&app_metadata_pool))
+    {
+      GThreadPool *pool = g_thread_pool_new (app_metadata_thread_func, NULL, 1, FALSE, NULL);
+      g_once_init_leave (&app_metadata_pool, pool);
+    }
+
+  g_task_set_task_data (task, g_strdup (app_id), g_free);
+  g_thread_pool_push (app_metadata_pool, g_steal_pointer (&task), NULL);
+}
+
+gboolean
+get_app_metadata_finish (GAsyncResult  *result,
+                         guint64       *size,
+                         GKeyFile     **metadata,
+                         GError       **error)
+{
+  AppMetadata *data;
+
+  g_return_val_if_fail (g_task_is_valid (result, NULL), FALSE);
+
+  data = g_task_propagate_pointer (G_TASK (result), error);
+  if (data == NULL)
+    return FALSE;
+
+  if (size != NULL)
+    *size = data->size;
+  if (metadata != NULL)
+    *metadata = data->metadata ? g_key_file_ref (data->metadata) : NULL;
+
+  app_metadata_unref (data);
+
+  return TRUE;
+}
+
 char *
 get_app_id (GAppInfo *info)
 {
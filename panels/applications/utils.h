@@ -25,6 +25,8 @@
 
 G_BEGIN_DECLS
 
+#define PORTAL_SNAP_PREFIX "snap."
+
 void      file_remove_async    (GFile               *file,
                                 GCancellable        *cancellable,
                                 GAsyncReadyCallback  callback,
@@ -34,8 +36,13 @@ gboolean  file_remove_finish   (GFile               *file,
                                 GAsyncResult        *result,
                                 GError             **error);
 
+typedef void (*FileSizeProgressFunc) (guint64  size,
+                                      gpointer user_data);
+
 void      file_size_async      (GFile               *file,
                                 GCancellable        *cancellable,
+                                FileSizeProgressFunc progress,
+                                gpointer             progress_data,
                                 GAsyncReadyCallback  callback,
                                 gpointer             data);
 
@@ -52,6 +59,16 @@ guint64   get_flatpak_app_size (const gchar         *app_id);
 
 guint64   get_snap_app_size    (const gchar         *snap_name);
 
+void      get_app_metadata_async  (const gchar         *app_id,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             data);
+
+gboolean  get_app_metadata_finish (GAsyncResult        *result,
+                                   guint64             *size,
+                                   GKeyFile           **metadata,
+                                   GError             **error);
+
 gchar*    get_app_id           (GAppInfo            *info);
 
 G_END_DECLS
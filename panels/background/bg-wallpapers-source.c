@@ -61,6 +61,14 @@ sort_func (gconstpointer a,
                  cc_background_item_get_name (item_b));
 }
 
+static int
+sort_func_indirect (gconstpointer a,
+                    gconstpointer b,
+                    gpointer      user_data)
+{
+  return sort_func (*(gpointer *) a, *(gpointer *) b, user_data);
+}
+
 static void
 load_wallpapers (gchar              *key,
                  CcBackgroundItem   *item,
@@ -77,6 +85,87 @@ load_wallpapers (gchar              *key,
   g_list_store_insert_sorted (store, item, sort_func, NULL);
 }
 
+static guint
+find_insert_position (GListModel       *model,
+                      CcBackgroundItem *item)
+{
+  guint low = 0;
+  guint high = g_list_model_get_n_items (model);
+
+  while (low < high)
+    {
+      g_autoptr(CcBackgroundItem) other = NULL;
+      guint mid = (low + high) / 2;
+
+      other = g_list_model_get_item (model, mid);
+      if (sort_func (other, item, NULL) <= 0)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  return low;
+}
+
+/* Inserts a whole batch into the sorted store with a single splice, so
+ * the store emits one items-changed signal per batch. Only the items
+ * already in the store between the first and the last new item are
+ * replaced, by themselves. */
+static void
+load_wallpapers_batch (BgWallpapersSource *source,
+                       GPtrArray          *items)
+{
+  GListStore *store = bg_source_get_liststore (BG_SOURCE (source));
+  g_autoptr(GPtrArray) batch = NULL;
+  g_autoptr(GPtrArray) merged = NULL;
+  guint first, last;
+  guint i, j;
+
+  batch = g_ptr_array_new ();
+  for (i = 0; i < items->len; i++)
+    {
+      CcBackgroundItem *item = g_ptr_array_index (items, i);
+      gboolean deleted;
+
+      g_object_get (G_OBJECT (item), "is-deleted", &deleted, NULL);
+      if (!deleted)
+        g_ptr_array_add (batch, item);
+    }
+
+  if (batch->len == 0)
+    return;
+
+  g_ptr_array_sort_with_data (batch, (GCompareDataFunc) sort_func_indirect, NULL);
+
+  first = find_insert_position (G_LIST_MODEL (store), g_ptr_array_index (batch, 0));
+  last = find_insert_position (G_LIST_MODEL (store), g_ptr_array_index (batch, batch->len - 1));
+
+  /* Merge the batch with the items in between, existing items first
+   * when they compare equal, like g_list_store_insert_sorted() does */
+  merged = g_ptr_array_new_full (batch->len + last - first, g_object_unref);
+  for (i = first, j = 0; i < last || j < batch->len; )
+    {
+      g_autoptr(CcBackgroundItem) other = NULL;
+
+      if (i < last)
+        other = g_list_model_get_item (G_LIST_MODEL (store), i);
+
+      if (other != NULL &&
+          (j == batch->len || sort_func (other, g_ptr_array_index (batch, j), NULL) <= 0))
+        {
+          g_ptr_array_add (merged, g_steal_pointer (&other));
+          i++;
+        }
+      else
+        {
+          g_ptr_array_add (merged, g_object_ref (g_ptr_array_index (batch, j)));
+          j++;
+        }
+    }
+
+  g_list_store_splice (store, first, last - first, merged->pdata, merged->len);
+}
+
 static void
 list_load_cb (GObject *source_object,
 	      GAsyncResult *res,
@@ -94,6 +183,13 @@ item_added (BgWallpapersSource *self,
   load_wallpapers (NULL, item, self);
 }
 
+static void
+items_added (BgWallpapersSource *self,
+             GPtrArray          *items)
+{
+  load_wallpapers_batch (self, items);
+}
+
 static void
 load_default_bg (BgWallpapersSource *self)
 {
@@ -124,6 +220,8 @@ bg_wallpapers_source_constructed (GObject *object)
 
   g_signal_connect_object (G_OBJECT (self->xml), "added",
                            G_CALLBACK (item_added), self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (G_OBJECT (self->xml), "added-batch",
+                           G_CALLBACK (items_added), self, G_CONNECT_SWAPPED);
 
   /* Try adding the default background first */
   load_default_bg (self);
@@ -21,15 +21,18 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <gtk/gtk.h>
 #include <gio/gio.h>
 #include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
 
 #include <gnome-bg/gnome-bg.h>
 #include <gdesktop-enums.h>
 
 #include "cc-background-item.h"
+#include "cc-util.h"
 #include "gdesktop-enums-types.h"
 
 typedef struct {
@@ -40,6 +43,13 @@ typedef struct {
         GdkPixbuf *thumbnail;
 } CachedThumbnail;
 
+typedef struct {
+        int         width;
+        int         height;
+        int         scale_factor;
+        GdkTexture *texture;
+} CachedTexture;
+
 struct _CcBackgroundItem
 {
         GObject          parent_instance;
@@ -70,8 +80,79 @@ struct _CcBackgroundItem
 
         CachedThumbnail cached_thumbnail;
         CachedThumbnail cached_thumbnail_dark;
+
+        CachedTexture   cached_texture;
+        CachedTexture   cached_texture_dark;
+
+        GPtrArray       *pending_thumbnails; /* GTask */
 };
 
+typedef struct {
+        GnomeBG                      *bg;
+        GnomeDesktopThumbnailFactory *thumbs;
+        GdkRectangle                  monitor_layout;
+        int                           width;
+        int                           height;
+        int                           scale_factor;
+        gboolean                      dark;
+
+        /* What the worker thread draws, without the GnomeBG */
+        char                         *filename;
+        GDesktopBackgroundStyle       placement;
+        GDesktopBackgroundShading     shading;
+        GdkRGBA                       pcolor;
+        GdkRGBA                       scolor;
+
+        /* Disk cache key, NULL if the thumbnail can't be cached */
+        char                         *cache_key;
+        gint64                        mtime;
+
+        /* Set by the worker thread */
+        int                           image_width;
+        int                           image_height;
+} ThumbnailJob;
+
+/* Decoding and scaling wallpapers is slow, so thumbnails requested with
+ * cc_background_item_get_thumbnail_async() are rendered by a small pool of
+ * worker threads, so that the item itself is only ever touched from the
+ * main thread.
+ *
+ * GnomeBG keeps a process-wide cache of the files it loaded, which isn't
+ * locked, so the workers never call into it. They decode images with
+ * GdkPixbuf and draw them the way GnomeBG would. Only files which aren't
+ * images, i.e. slideshows, are handed back to the main thread to be
+ * rendered with the job's GnomeBG.
+ *
+ * Rendered thumbnails are also stored on disk as raw pixel data, keyed by
+ * everything that affects rendering, including the modification time of
+ * the image. Those files are mapped back into memory and used as texture
+ * data directly, so that revisiting the panel doesn't decode any image.
+ * Each file also records its source image and modification time, so that
+ * thumbnails of images which were changed or removed are pruned once per
+ * session.
+ */
+#define MAX_THUMBNAIL_THREADS 4
+
+#define THUMBNAIL_CACHE_MAGIC   0x54424343 /* "CCBT" */
+#define THUMBNAIL_CACHE_VERSION 2
+
+/* Followed by the pixels, then by the source filename */
+typedef struct {
+        guint32 magic;
+        guint32 version;
+        guint32 width;
+        guint32 height;
+        guint32 stride;
+        guint32 format;
+        guint32 image_width;
+        guint32 image_height;
+        gint64  source_mtime;
+        guint32 source_length;
+        guint32 padding;
+} ThumbnailCacheHeader;
+
+static GThreadPool *thumbnail_pool = NULL;
+
 enum {
         PROP_0,
         PROP_NAME,
@@ -95,27 +176,20 @@ static void     cc_background_item_finalize       (GObject               *object
 G_DEFINE_TYPE (CcBackgroundItem, cc_background_item, G_TYPE_OBJECT)
 
 static void
-set_bg_properties (CcBackgroundItem *item)
+configure_bg (CcBackgroundItem *item,
+              GnomeBG          *bg,
+              const char       *uri)
 {
         GdkRGBA pcolor = { 0, 0, 0, 0 };
         GdkRGBA scolor = { 0, 0, 0, 0 };
 
-        if (item->uri) {
-		g_autoptr(GFile) file = NULL;
-		g_autofree gchar *filename = NULL;
-
-		file = g_file_new_for_commandline_arg (item->uri);
-		filename = g_file_get_path (file);
-		gnome_bg_set_filename (item->bg, filename);
-	}
-
-        if (item->uri_dark) {
+        if (uri) {
 		g_autoptr(GFile) file = NULL;
 		g_autofree gchar *filename = NULL;
 
-		file = g_file_new_for_commandline_arg (item->uri_dark);
+		file = g_file_new_for_commandline_arg (uri);
 		filename = g_file_get_path (file);
-		gnome_bg_set_filename (item->bg_dark, filename);
+		gnome_bg_set_filename (bg, filename);
 	}
 
         if (item->primary_color != NULL) {
@@ -125,10 +199,15 @@ set_bg_properties (CcBackgroundItem *item)
                 gdk_rgba_parse (&scolor, item->secondary_color);
         }
 
-        gnome_bg_set_rgba (item->bg, item->shading, &pcolor, &scolor);
-        gnome_bg_set_rgba (item->bg_dark, item->shading, &pcolor, &scolor);
-        gnome_bg_set_placement (item->bg, item->placement);
-        gnome_bg_set_placement (item->bg_dark, item->placement);
+        gnome_bg_set_rgba (bg, item->shading, &pcolor, &scolor);
+        gnome_bg_set_placement (bg, item->placement);
+}
+
+static void
+set_bg_properties (CcBackgroundItem *item)
+{
+        configure_bg (item, item->bg, item->uri);
+        configure_bg (item, item->bg_dark, item->uri_dark);
 }
 
 
@@ -190,6 +269,19 @@ render_at_size (GnomeBG *bg,
         return pixbuf;
 }
 
+static void
+get_monitor_layout (GdkRectangle *monitor_layout)
+{
+        g_autoptr(GdkMonitor) monitor = NULL;
+        GdkDisplay *display;
+        GListModel *monitors;
+
+        display = gdk_display_get_default ();
+        monitors = gdk_display_get_monitors (display);
+        monitor = g_list_model_get_item (monitors, 0);
+        gdk_monitor_get_geometry (monitor, monitor_layout);
+}
+
 GdkPixbuf *
 cc_background_item_get_frame_thumbnail (CcBackgroundItem             *item,
                                         GnomeDesktopThumbnailFactory *thumbs,
@@ -231,16 +323,9 @@ cc_background_item_get_frame_thumbnail (CcBackgroundItem             *item,
                  */
                 pixbuf = render_at_size (bg, width, height);
         } else {
-                g_autoptr(GdkMonitor) monitor = NULL;
-                GdkDisplay *display;
-                GListModel *monitors;
                 GdkRectangle monitor_layout;
 
-
-                display = gdk_display_get_default ();
-                monitors = gdk_display_get_monitors (display);
-                monitor = g_list_model_get_item (monitors, 0);
-                gdk_monitor_get_geometry (monitor, &monitor_layout);
+                get_monitor_layout (&monitor_layout);
 
                 if (frame >= 0) {
                         pixbuf = gnome_bg_create_frame_thumbnail (bg,
@@ -291,6 +376,586 @@ cc_background_item_get_thumbnail (CcBackgroundItem             *item,
         return cc_background_item_get_frame_thumbnail (item, thumbs, width, height, scale_factor, -1, FALSE, dark);
 }
 
+static void
+thumbnail_job_free (ThumbnailJob *job)
+{
+        g_clear_object (&job->bg);
+        g_clear_object (&job->thumbs);
+        g_free (job->filename);
+        g_free (job->cache_key);
+        g_free (job);
+}
+
+static char *
+get_thumbnail_cache_dir (void)
+{
+        return g_build_filename (g_get_user_cache_dir (),
+                                 "gnome-control-center",
+                                 "backgrounds",
+                                 NULL);
+}
+
+static char *
+get_thumbnail_cache_path (ThumbnailJob *job)
+{
+        g_autofree char *key = NULL;
+        g_autofree char *checksum = NULL;
+        g_autofree char *dir = NULL;
+        GStatBuf buf;
+
+        if (!job->cache_key || !job->filename || g_stat (job->filename, &buf) != 0)
+                return NULL;
+
+        job->mtime = buf.st_mtime;
+
+        key = g_strdup_printf ("%s\n%" G_GINT64_FORMAT "\n%d\n%d\n%d\n%d",
+                               job->cache_key,
+                               job->mtime,
+                               job->width,
+                               job->height,
+                               job->scale_factor,
+                               job->dark);
+        checksum = g_compute_checksum_for_string (G_CHECKSUM_SHA256, key, -1);
+        dir = get_thumbnail_cache_dir ();
+
+        return g_build_filename (dir, checksum, NULL);
+}
+
+/* Returns NULL if @bytes isn't a valid cached thumbnail */
+static const ThumbnailCacheHeader *
+get_thumbnail_cache_header (GBytes *bytes)
+{
+        const ThumbnailCacheHeader *header;
+        gsize size;
+
+        header = g_bytes_get_data (bytes, &size);
+
+        if (size < sizeof (ThumbnailCacheHeader) ||
+            header->magic != THUMBNAIL_CACHE_MAGIC ||
+            header->version != THUMBNAIL_CACHE_VERSION ||
+            (header->format != GDK_MEMORY_R8G8B8 && header->format != GDK_MEMORY_R8G8B8A8) ||
+            header->width == 0 || header->height == 0 ||
+            header->stride < header->width * (header->format == GDK_MEMORY_R8G8B8 ? 3 : 4) ||
+            size - sizeof (ThumbnailCacheHeader) != (gsize) header->stride * header->height + header->source_length)
+                return NULL;
+
+        return header;
+}
+
+static void
+prune_thumbnail_cache_thread (GTask        *task,
+                              gpointer      source_object,
+                              gpointer      task_data,
+                              GCancellable *cancellable)
+{
+        g_autofree char *dir_path = NULL;
+        g_autoptr(GDir) dir = NULL;
+        const char *name;
+
+        dir_path = get_thumbnail_cache_dir ();
+        dir = g_dir_open (dir_path, 0, NULL);
+        if (!dir)
+                return;
+
+        while ((name = g_dir_read_name (dir)) != NULL) {
+                g_autoptr(GMappedFile) mapped_file = NULL;
+                g_autoptr(GBytes) bytes = NULL;
+                g_autofree char *path = NULL;
+                g_autofree char *source = NULL;
+                const ThumbnailCacheHeader *header;
+                GStatBuf buf;
+
+                /* Skip the temporary files of thumbnails being written */
+                if (strlen (name) != 64)
+                        continue;
+
+                path = g_build_filename (dir_path, name, NULL);
+                mapped_file = g_mapped_file_new (path, FALSE, NULL);
+                if (!mapped_file)
+                        continue;
+
+                bytes = g_mapped_file_get_bytes (mapped_file);
+                header = get_thumbnail_cache_header (bytes);
+
+                if (header) {
+                        source = g_strndup ((const char *) g_bytes_get_data (bytes, NULL) +
+                                            g_bytes_get_size (bytes) - header->source_length,
+                                            header->source_length);
+
+                        if (g_stat (source, &buf) == 0 && (gint64) buf.st_mtime == header->source_mtime)
+                                continue;
+                }
+
+                g_debug ("Removing stale background thumbnail %s", path);
+                g_unlink (path);
+        }
+}
+
+static void
+prune_thumbnail_cache (void)
+{
+        g_autoptr(GTask) task = NULL;
+
+        task = g_task_new (NULL, NULL, NULL, NULL);
+        g_task_set_source_tag (task, prune_thumbnail_cache);
+        g_task_set_priority (task, G_PRIORITY_LOW);
+        g_task_run_in_thread (task, prune_thumbnail_cache_thread);
+}
+
+static GdkTexture *
+load_cached_thumbnail (ThumbnailJob *job,
+                       const char   *path)
+{
+        g_autoptr(GMappedFile) mapped_file = NULL;
+        g_autoptr(GBytes) pixels = NULL;
+        g_autoptr(GBytes) bytes = NULL;
+        const ThumbnailCacheHeader *header;
+
+        mapped_file = g_mapped_file_new (path, FALSE, NULL);
+        if (!mapped_file)
+                return NULL;
+
+        bytes = g_mapped_file_get_bytes (mapped_file);
+        header = get_thumbnail_cache_header (bytes);
+        if (!header)
+                return NULL;
+
+        job->image_width = header->image_width;
+        job->image_height = header->image_height;
+
+        pixels = g_bytes_new_from_bytes (bytes,
+                                         sizeof (ThumbnailCacheHeader),
+                                         (gsize) header->stride * header->height);
+
+        return gdk_memory_texture_new (header->width,
+                                       header->height,
+                                       header->format,
+                                       pixels,
+                                       header->stride);
+}
+
+static void
+save_cached_thumbnail (ThumbnailJob *job,
+                       const char   *path,
+                       GdkPixbuf    *pixbuf)
+{
+        g_autoptr(GError) error = NULL;
+        g_autofree guint8 *data = NULL;
+        ThumbnailCacheHeader header = { 0, };
+        gsize pixels_size;
+        gsize size;
+
+        header.magic = THUMBNAIL_CACHE_MAGIC;
+        header.version = THUMBNAIL_CACHE_VERSION;
+        header.width = gdk_pixbuf_get_width (pixbuf);
+        header.height = gdk_pixbuf_get_height (pixbuf);
+        header.stride = gdk_pixbuf_get_rowstride (pixbuf);
+        header.format = gdk_pixbuf_get_has_alpha (pixbuf) ? GDK_MEMORY_R8G8B8A8 : GDK_MEMORY_R8G8B8;
+        header.image_width = job->image_width;
+        header.image_height = job->image_height;
+        header.source_mtime = job->mtime;
+        header.source_length = strlen (job->filename);
+
+        /* The last row of a pixbuf isn't necessarily padded to the stride */
+        pixels_size = (gsize) header.stride * header.height;
+        size = sizeof (ThumbnailCacheHeader) + pixels_size + header.source_length;
+        data = g_malloc0 (size);
+        memcpy (data, &header, sizeof (ThumbnailCacheHeader));
+        memcpy (data + sizeof (ThumbnailCacheHeader),
+                gdk_pixbuf_read_pixels (pixbuf),
+                gdk_pixbuf_get_byte_length (pixbuf));
+        memcpy (data + sizeof (ThumbnailCacheHeader) + pixels_size,
+                job->filename,
+                header.source_length);
+
+        if (!cc_util_write_cache_file (path, data, size, &error))
+                g_debug ("Failed to cache thumbnail in %s: %s", path, error->message);
+}
+
+static GdkTexture *
+texture_new_for_pixbuf (GdkPixbuf *pixbuf)
+{
+        g_autoptr(GBytes) bytes = NULL;
+
+        bytes = gdk_pixbuf_read_pixel_bytes (pixbuf);
+
+        return gdk_memory_texture_new (gdk_pixbuf_get_width (pixbuf),
+                                       gdk_pixbuf_get_height (pixbuf),
+                                       gdk_pixbuf_get_has_alpha (pixbuf) ? GDK_MEMORY_R8G8B8A8 : GDK_MEMORY_R8G8B8,
+                                       bytes,
+                                       gdk_pixbuf_get_rowstride (pixbuf));
+}
+
+static guint8
+blend_channel (double from,
+               double to,
+               double position)
+{
+        return CLAMP ((from + (to - from) * position) * 0xff, 0, 0xff);
+}
+
+/* Same shading as GnomeBG's, on a pixbuf without alpha */
+static void
+draw_thumbnail_color (ThumbnailJob *job,
+                      GdkPixbuf    *dest)
+{
+        int width = gdk_pixbuf_get_width (dest);
+        int height = gdk_pixbuf_get_height (dest);
+        int rowstride = gdk_pixbuf_get_rowstride (dest);
+        guint8 *pixels = gdk_pixbuf_get_pixels (dest);
+        int x, y;
+
+        for (y = 0; y < height; y++) {
+                for (x = 0; x < width; x++) {
+                        guint8 *p = pixels + y * rowstride + x * 3;
+                        double position = 0.0;
+
+                        if (job->shading == G_DESKTOP_BACKGROUND_SHADING_VERTICAL && height > 1)
+                                position = (double) y / (height - 1);
+                        else if (job->shading == G_DESKTOP_BACKGROUND_SHADING_HORIZONTAL && width > 1)
+                                position = (double) x / (width - 1);
+
+                        p[0] = blend_channel (job->pcolor.red, job->scolor.red, position);
+                        p[1] = blend_channel (job->pcolor.green, job->scolor.green, position);
+                        p[2] = blend_channel (job->pcolor.blue, job->scolor.blue, position);
+                }
+        }
+}
+
+/* Where GnomeBG would draw an image of @image_width × @image_height pixels
+ * on the monitor, scaled down to the thumbnail */
+static void
+get_thumbnail_image_area (ThumbnailJob *job,
+                          int           image_width,
+                          int           image_height,
+                          GdkRectangle *area)
+{
+        double scale;
+
+        /* The thumbnail shows the whole monitor */
+        scale = (double) job->width / MAX (job->monitor_layout.width, 1);
+
+        switch (job->placement) {
+        case G_DESKTOP_BACKGROUND_STYLE_STRETCHED:
+                area->width = job->width;
+                area->height = job->height;
+                break;
+        case G_DESKTOP_BACKGROUND_STYLE_SCALED:
+                scale = MIN ((double) job->width / image_width, (double) job->height / image_height);
+                area->width = image_width * scale;
+                area->height = image_height * scale;
+                break;
+        case G_DESKTOP_BACKGROUND_STYLE_ZOOM:
+        case G_DESKTOP_BACKGROUND_STYLE_SPANNED:
+                scale = MAX ((double) job->width / image_width, (double) job->height / image_height);
+                area->width = image_width * scale;
+                area->height = image_height * scale;
+                break;
+        case G_DESKTOP_BACKGROUND_STYLE_WALLPAPER:
+        case G_DESKTOP_BACKGROUND_STYLE_CENTERED:
+        default:
+                area->width = image_width * scale;
+                area->height = image_height * scale;
+                break;
+        }
+
+        area->width = MAX (area->width, 1);
+        area->height = MAX (area->height, 1);
+
+        if (job->placement == G_DESKTOP_BACKGROUND_STYLE_WALLPAPER) {
+                area->x = 0;
+                area->y = 0;
+        } else {
+                area->x = (job->width - area->width) / 2;
+                area->y = (job->height - area->height) / 2;
+        }
+}
+
+static void
+draw_thumbnail_image (GdkPixbuf          *image,
+                      const GdkRectangle *area,
+                      GdkPixbuf          *dest)
+{
+        GdkRectangle dest_area = { 0, 0, gdk_pixbuf_get_width (dest), gdk_pixbuf_get_height (dest) };
+        GdkRectangle visible;
+
+        if (!gdk_rectangle_intersect (area, &dest_area, &visible))
+                return;
+
+        gdk_pixbuf_composite (image, dest,
+                              visible.x, visible.y,
+                              visible.width, visible.height,
+                              area->x, area->y,
+                              1.0, 1.0,
+                              GDK_INTERP_NEAREST,
+                              0xff);
+}
+
+/* Renders the thumbnail of a plain image without the GnomeBG. Returns
+ * %FALSE if the file isn't an image GdkPixbuf can load. */
+static gboolean
+render_thumbnail (ThumbnailJob  *job,
+                  GdkPixbuf    **out_pixbuf)
+{
+        g_autoptr(GdkPixbuf) pixbuf = NULL;
+        g_autoptr(GdkPixbuf) image = NULL;
+        GdkRectangle area;
+
+        job->image_width = 0;
+        job->image_height = 0;
+
+        if (job->filename &&
+            !gdk_pixbuf_get_file_info (job->filename, &job->image_width, &job->image_height) &&
+            g_file_test (job->filename, G_FILE_TEST_EXISTS))
+                return FALSE;
+
+        pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, job->width, job->height);
+        draw_thumbnail_color (job, pixbuf);
+
+        /* A missing image leaves only the colors, as with GnomeBG */
+        if (job->image_width > 0 && job->image_height > 0 &&
+            job->placement != G_DESKTOP_BACKGROUND_STYLE_NONE) {
+                get_thumbnail_image_area (job, job->image_width, job->image_height, &area);
+                image = gdk_pixbuf_new_from_file_at_scale (job->filename, area.width, area.height, FALSE, NULL);
+        }
+
+        if (image && job->placement == G_DESKTOP_BACKGROUND_STYLE_WALLPAPER) {
+                for (area.y = 0; area.y < job->height; area.y += area.height)
+                        for (area.x = 0; area.x < job->width; area.x += area.width)
+                                draw_thumbnail_image (image, &area, pixbuf);
+        } else if (image) {
+                draw_thumbnail_image (image, &area, pixbuf);
+        }
+
+        *out_pixbuf = g_steal_pointer (&pixbuf);
+        return TRUE;
+}
+
+/* Runs in the main thread, which is the only one to use GnomeBG */
+static gboolean
+render_thumbnail_with_bg_cb (gpointer user_data)
+{
+        GTask *task = user_data;
+        ThumbnailJob *job = g_task_get_task_data (task);
+        g_autoptr(GdkPixbuf) pixbuf = NULL;
+        g_autofree char *cache_path = NULL;
+
+        if (g_task_return_error_if_cancelled (task))
+                return G_SOURCE_REMOVE;
+
+        pixbuf = gnome_bg_create_thumbnail (job->bg,
+                                            job->thumbs,
+                                            &job->monitor_layout,
+                                            job->width,
+                                            job->height);
+
+        gnome_bg_get_image_size (job->bg,
+                                 job->thumbs,
+                                 job->width,
+                                 job->height,
+                                 &job->image_width,
+                                 &job->image_height);
+
+        cache_path = get_thumbnail_cache_path (job);
+        if (cache_path)
+                save_cached_thumbnail (job, cache_path, pixbuf);
+
+        g_task_return_pointer (task, texture_new_for_pixbuf (pixbuf), g_object_unref);
+
+        return G_SOURCE_REMOVE;
+}
+
+static void
+thumbnail_pool_func (gpointer data,
+                     gpointer user_data)
+{
+        g_autoptr(GTask) task = data;
+        ThumbnailJob *job = g_task_get_task_data (task);
+        g_autoptr(GdkPixbuf) pixbuf = NULL;
+        g_autofree char *cache_path = NULL;
+        GdkTexture *texture;
+
+        if (g_task_return_error_if_cancelled (task))
+                return;
+
+        cache_path = get_thumbnail_cache_path (job);
+
+        if (cache_path) {
+                texture = load_cached_thumbnail (job, cache_path);
+                if (texture) {
+                        g_task_return_pointer (task, texture, g_object_unref);
+                        return;
+                }
+        }
+
+        if (!render_thumbnail (job, &pixbuf)) {
+                g_main_context_invoke_full (g_task_get_context (task),
+                                            G_PRIORITY_DEFAULT,
+                                            render_thumbnail_with_bg_cb,
+                                            g_steal_pointer (&task),
+                                            g_object_unref);
+                return;
+        }
+
+        if (cache_path)
+                save_cached_thumbnail (job, cache_path, pixbuf);
+
+        g_task_return_pointer (task, texture_new_for_pixbuf (pixbuf), g_object_unref);
+}
+
+static GThreadPool *
+get_thumbnail_pool (void)
+{
+        if (g_once_init_enter (&thumbnail_pool)) {
+                GThreadPool *pool;
+
+                pool = g_thread_pool_new (thumbnail_pool_func,
+                                          NULL,
+                                          CLAMP (g_get_num_processors () / 2, 1, MAX_THUMBNAIL_THREADS),
+                                          FALSE,
+                                          NULL);
+                g_once_init_leave (&thumbnail_pool, pool);
+
+                prune_thumbnail_cache ();
+        }
+
+        return thumbnail_pool;
+}
+
+/**
+ * cc_background_item_get_thumbnail_async:
+ *
+ * Asynchronously creates a texture with the thumbnail of @item. The
+ * thumbnail is loaded from the disk cache or rendered in a worker thread,
+ * unless it is already cached in memory.
+ */
+void
+cc_background_item_get_thumbnail_async (CcBackgroundItem             *item,
+                                        GnomeDesktopThumbnailFactory *thumbs,
+                                        int                           width,
+                                        int                           height,
+                                        int                           scale_factor,
+                                        gboolean                      dark,
+                                        GCancellable                 *cancellable,
+                                        GAsyncReadyCallback           callback,
+                                        gpointer                      user_data)
+{
+        g_autoptr(GTask) task = NULL;
+        CachedTexture *cached;
+        ThumbnailJob *job;
+        const char *uri;
+
+	g_return_if_fail (CC_IS_BACKGROUND_ITEM (item));
+	g_return_if_fail (width > 0 && height > 0);
+
+        task = g_task_new (item, cancellable, callback, user_data);
+        g_task_set_source_tag (task, cc_background_item_get_thumbnail_async);
+
+        cached = dark ? &item->cached_texture_dark : &item->cached_texture;
+
+        if (cached->texture &&
+            cached->width == width &&
+            cached->height == height &&
+            cached->scale_factor == scale_factor) {
+                g_task_return_pointer (task, g_object_ref (cached->texture), g_object_unref);
+                return;
+        }
+
+        uri = dark ? item->uri_dark : item->uri;
+
+        job = g_new0 (ThumbnailJob, 1);
+        job->bg = gnome_bg_new ();
+        job->thumbs = g_object_ref (thumbs);
+        job->width = width;
+        job->height = height;
+        job->scale_factor = scale_factor;
+        job->dark = dark;
+        get_monitor_layout (&job->monitor_layout);
+        configure_bg (item, job->bg, uri);
+
+        job->placement = item->placement;
+        job->shading = item->shading;
+        if (item->primary_color != NULL)
+                gdk_rgba_parse (&job->pcolor, item->primary_color);
+        if (item->secondary_color != NULL)
+                gdk_rgba_parse (&job->scolor, item->secondary_color);
+        if (uri)
+                job->filename = g_strdup (gnome_bg_get_filename (job->bg));
+
+        /* Slideshows render their current slide, so they can't be cached */
+        if (uri && !gnome_bg_changes_with_time (job->bg)) {
+                job->cache_key = g_strdup_printf ("%s\n%s\n%s\n%d\n%d",
+                                                  uri,
+                                                  item->primary_color,
+                                                  item->secondary_color,
+                                                  item->shading,
+                                                  item->placement);
+        }
+
+        g_task_set_task_data (task, job, (GDestroyNotify) thumbnail_job_free);
+
+        if (!item->pending_thumbnails)
+                item->pending_thumbnails = g_ptr_array_new ();
+        g_ptr_array_add (item->pending_thumbnails, task);
+
+        g_thread_pool_push (get_thumbnail_pool (), g_steal_pointer (&task), NULL);
+}
+
+GdkTexture *
+cc_background_item_get_thumbnail_finish (CcBackgroundItem  *item,
+                                         GAsyncResult      *result,
+                                         GError           **error)
+{
+        g_autoptr(GdkTexture) texture = NULL;
+        CachedTexture *cached;
+        ThumbnailJob *job;
+
+	g_return_val_if_fail (CC_IS_BACKGROUND_ITEM (item), NULL);
+	g_return_val_if_fail (g_task_is_valid (result, item), NULL);
+
+        if (item->pending_thumbnails)
+                g_ptr_array_remove (item->pending_thumbnails, result);
+
+        texture = g_task_propagate_pointer (G_TASK (result), error);
+        job = g_task_get_task_data (G_TASK (result));
+
+        /* Textures cached in memory have no job */
+        if (!texture || !job)
+                return g_steal_pointer (&texture);
+
+        item->width = job->image_width;
+        item->height = job->image_height;
+        update_size (item);
+
+        cached = job->dark ? &item->cached_texture_dark : &item->cached_texture;
+        g_set_object (&cached->texture, texture);
+        cached->width = job->width;
+        cached->height = job->height;
+        cached->scale_factor = job->scale_factor;
+
+        return g_steal_pointer (&texture);
+}
+
+/**
+ * cc_background_item_prioritize_thumbnails:
+ *
+ * Moves the pending thumbnails of @item to the front of the rendering
+ * queue, e.g. because the item just became visible.
+ */
+void
+cc_background_item_prioritize_thumbnails (CcBackgroundItem *item)
+{
+        guint i;
+
+	g_return_if_fail (CC_IS_BACKGROUND_ITEM (item));
+
+        if (!item->pending_thumbnails || !thumbnail_pool)
+                return;
+
+        for (i = 0; i < item->pending_thumbnails->len; i++)
+                g_thread_pool_move_to_front (thumbnail_pool, g_ptr_array_index (item->pending_thumbnails, i));
+}
+
 static void
 update_info (CcBackgroundItem *item,
 	     GFileInfo        *_info)
@@ -864,6 +1529,9 @@ cc_background_item_finalize (GObject *object)
 
         g_clear_object (&item->cached_thumbnail.thumbnail);
         g_clear_object (&item->cached_thumbnail_dark.thumbnail);
+        g_clear_object (&item->cached_texture.texture);
+        g_clear_object (&item->cached_texture_dark.texture);
+        g_clear_pointer (&item->pending_thumbnails, g_ptr_array_unref);
         g_free (item->name);
         g_free (item->uri);
         g_free (item->primary_color);
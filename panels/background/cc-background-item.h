@@ -20,6 +20,7 @@
 #pragma once
 
 #include <glib-object.h>
+#include <gdk/gdk.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 #include <libgnome-desktop/gnome-desktop-thumbnail.h>
 #include <gdesktop-enums.h>
@@ -58,6 +59,19 @@ GdkPixbuf *        cc_background_item_get_thumbnail       (CcBackgroundItem
                                                            int                           height,
                                                            int                           scale_factor,
                                                            gboolean                      dark);
+void               cc_background_item_get_thumbnail_async (CcBackgroundItem             *item,
+                                                           GnomeDesktopThumbnailFactory *thumbs,
+                                                           int                           width,
+                                                           int                           height,
+                                                           int                           scale_factor,
+                                                           gboolean                      dark,
+                                                           GCancellable                 *cancellable,
+                                                           GAsyncReadyCallback           callback,
+                                                           gpointer                      user_data);
+GdkTexture *       cc_background_item_get_thumbnail_finish (CcBackgroundItem            *item,
+                                                            GAsyncResult                *result,
+                                                            GError                     **error);
+void               cc_background_item_prioritize_thumbnails (CcBackgroundItem           *item);
 GdkPixbuf *        cc_background_item_get_frame_thumbnail (CcBackgroundItem             *item,
                                                            GnomeDesktopThumbnailFactory *thumbs,
                                                            int                           width,
@@ -32,6 +32,9 @@ struct _CcBackgroundPaintable
 
   GdkPaintable     *texture;
   GdkPaintable     *dark_texture;
+
+  GCancellable     *cancellable;
+  gboolean          prioritized;
 };
 
 enum
@@ -53,40 +56,89 @@ G_DEFINE_TYPE_WITH_CODE (CcBackgroundPaintable, cc_background_paintable, G_TYPE_
                                                 cc_background_paintable_paintable_init))
 
 static void
-update_cache (CcBackgroundPaintable *self)
+thumbnail_ready (GObject      *source_object,
+                 GAsyncResult *result,
+                 gpointer      user_data,
+                 gboolean      dark)
+{
+  CcBackgroundPaintable *self;
+  g_autoptr(GdkTexture) texture = NULL;
+  g_autoptr(GError) error = NULL;
+
+  texture = cc_background_item_get_thumbnail_finish (CC_BACKGROUND_ITEM (source_object), result, &error);
+
+  if (!texture)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to create thumbnail: %s", error->message);
+      return;
+    }
+
+  self = CC_BACKGROUND_PAINTABLE (user_data);
+
+  if (dark)
+    g_set_object (&self->dark_texture, GDK_PAINTABLE (texture));
+  else
+    g_set_object (&self->texture, GDK_PAINTABLE (texture));
+
+  gdk_paintable_invalidate_size (GDK_PAINTABLE (self));
+  gdk_paintable_invalidate_contents (GDK_PAINTABLE (self));
+}
+
+static void
+on_thumbnail_ready_cb (GObject      *source_object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  thumbnail_ready (source_object, result, user_data, FALSE);
+}
+
+static void
+on_dark_thumbnail_ready_cb (GObject      *source_object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+  thumbnail_ready (source_object, result, user_data, TRUE);
+}
+
+static void
+request_thumbnail (CcBackgroundPaintable *self,
+                   gboolean               dark)
 {
-  g_autoptr (GdkPixbuf) pixbuf = NULL;
   GnomeDesktopThumbnailFactory *factory;
   int width, height;
 
-  g_clear_object (&self->texture);
-  g_clear_object (&self->dark_texture);
-
   factory = bg_source_get_thumbnail_factory (self->source);
   width = bg_source_get_thumbnail_width (self->source);
   height = bg_source_get_thumbnail_height (self->source);
 
-  pixbuf = cc_background_item_get_thumbnail (self->item,
-                                             factory,
-                                             width,
-                                             height,
-                                             self->scale_factor,
-                                             FALSE);
+  cc_background_item_get_thumbnail_async (self->item,
+                                          factory,
+                                          width,
+                                          height,
+                                          self->scale_factor,
+                                          dark,
+                                          self->cancellable,
+                                          dark ? on_dark_thumbnail_ready_cb : on_thumbnail_ready_cb,
+                                          self);
+}
+
+static void
+update_cache (CcBackgroundPaintable *self)
+{
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
+
+  g_clear_object (&self->texture);
+  g_clear_object (&self->dark_texture);
+
+  self->cancellable = g_cancellable_new ();
+  self->prioritized = FALSE;
 
-  self->texture = GDK_PAINTABLE (gdk_texture_new_for_pixbuf (pixbuf));
+  request_thumbnail (self, FALSE);
 
   if (cc_background_item_has_dark_version (self->item))
-    {
-      g_autoptr (GdkPixbuf) dark_pixbuf = NULL;
-
-      dark_pixbuf = cc_background_item_get_thumbnail (self->item,
-                                                      factory,
-                                                      width,
-                                                      height,
-                                                      self->scale_factor,
-                                                      TRUE);
-      self->dark_texture = GDK_PAINTABLE (gdk_texture_new_for_pixbuf (dark_pixbuf));
-    }
+    request_thumbnail (self, TRUE);
 
   gdk_paintable_invalidate_size (GDK_PAINTABLE (self));
 }
@@ -96,6 +148,8 @@ cc_background_paintable_dispose (GObject *object)
 {
   CcBackgroundPaintable *self = CC_BACKGROUND_PAINTABLE (object);
 
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
   g_clear_object (&self->item);
   g_clear_object (&self->source);
   g_clear_object (&self->texture);
@@ -240,9 +294,27 @@ cc_background_paintable_snapshot (GdkPaintable *paintable,
                                   double        height)
 {
   CcBackgroundPaintable *self = CC_BACKGROUND_PAINTABLE (paintable);
+  gboolean has_dark_version;
   gboolean is_rtl;
 
-  if (!self->dark_texture)
+  has_dark_version = cc_background_item_has_dark_version (self->item);
+
+  /* Only visible paintables are drawn, so render their thumbnails first */
+  if (!self->texture || (has_dark_version && !self->dark_texture))
+    {
+      if (!self->prioritized)
+        {
+          cc_background_item_prioritize_thumbnails (self->item);
+          self->prioritized = TRUE;
+        }
+
+      gtk_snapshot_append_color (GTK_SNAPSHOT (snapshot),
+                                 &(GdkRGBA) { 0.5, 0.5, 0.5, 0.2 },
+                                 &GRAPHENE_RECT_INIT (0.0f, 0.0f, width, height));
+      return;
+    }
+
+  if (!has_dark_version)
     {
       gdk_paintable_snapshot (self->texture, snapshot, width, height);
       return;
@@ -267,11 +339,15 @@ cc_background_paintable_snapshot (GdkPaintable *paintable,
   gtk_snapshot_pop (GTK_SNAPSHOT (snapshot));
 }
 
+/* Until the thumbnail is ready, use the size it's going to have */
 static int
 cc_background_paintable_get_intrinsic_width (GdkPaintable *paintable)
 {
   CcBackgroundPaintable *self = CC_BACKGROUND_PAINTABLE (paintable);
 
+  if (!self->texture)
+    return bg_source_get_thumbnail_width (self->source) / self->scale_factor;
+
   return gdk_paintable_get_intrinsic_width (self->texture) / self->scale_factor;
 }
 
@@ -280,6 +356,9 @@ cc_background_paintable_get_intrinsic_height (GdkPaintable *paintable)
 {
   CcBackgroundPaintable *self = CC_BACKGROUND_PAINTABLE (paintable);
 
+  if (!self->texture)
+    return bg_source_get_thumbnail_height (self->source) / self->scale_factor;
+
   return gdk_paintable_get_intrinsic_height (self->texture) / self->scale_factor;
 }
 
@@ -288,6 +367,10 @@ cc_background_paintable_get_intrinsic_aspect_ratio (GdkPaintable *paintable)
 {
   CcBackgroundPaintable *self = CC_BACKGROUND_PAINTABLE (paintable);
 
+  if (!self->texture)
+    return (double) bg_source_get_thumbnail_width (self->source) /
+           bg_source_get_thumbnail_height (self->source);
+
   return gdk_paintable_get_intrinsic_aspect_ratio (self->texture);
 }
 
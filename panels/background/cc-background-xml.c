@@ -20,6 +20,7 @@
  */
 
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #include <libxml/parser.h>
 #include <gdesktop-enums.h>
@@ -28,14 +29,18 @@
 #include "cc-background-item.h"
 #include "cc-background-xml.h"
 
-/* The number of items we signal as "added" before
+/* The maximum number of items we signal as "added-batch" before
  * returning to the main loop */
-#define NUM_ITEMS_PER_BATCH 1
+#define NUM_ITEMS_PER_BATCH 64
+
+/* The maximum number of threads parsing XML files */
+#define MAX_PARSER_THREADS 4
 
 struct _CcBackgroundXml
 {
   GObject      parent_instance;
 
+  GMutex       wp_hash_lock;
   GHashTable  *wp_hash;
   GAsyncQueue *item_added_queue;
   guint        item_added_id;
@@ -44,9 +49,40 @@ struct _CcBackgroundXml
 
 enum {
 	ADDED,
+	ADDED_BATCH,
 	LAST_SIGNAL
 };
 
+/* What a <wallpaper> element describes. Each CcBackgroundXml creates its
+ * own CcBackgroundItem from it, since items are modified by their users. */
+typedef struct {
+	char                      *id;
+	char                      *name;
+	char                      *uri;
+	char                      *uri_dark;
+	char                      *primary_color;
+	char                      *secondary_color;
+	char                      *source_url;
+	char                      *source_xml;
+	GDesktopBackgroundStyle    placement;
+	GDesktopBackgroundShading  shading;
+	CcBackgroundItemFlags      flags;
+	gboolean                   is_deleted;
+} ParsedItem;
+
+/* Parsed files and directory listings are shared by every CcBackgroundXml
+ * in the process, and reused for as long as the modification time of the
+ * file or directory doesn't change. They are never modified once parsed.
+ */
+typedef struct {
+	gint64     mtime;
+	GPtrArray *contents;
+} MemoEntry;
+
+G_LOCK_DEFINE_STATIC (memo);
+static GHashTable *file_memo = NULL; /* filename -> MemoEntry of ParsedItem */
+static GHashTable *dir_memo = NULL;  /* path -> MemoEntry of filenames */
+
 static guint signals[LAST_SIGNAL] = { 0 };
 
 G_DEFINE_TYPE (CcBackgroundXml, cc_background_xml, G_TYPE_OBJECT)
@@ -110,21 +146,27 @@ enum_string_to_value (GType type,
 static gboolean
 idle_emit (CcBackgroundXml *xml)
 {
+	g_autoptr(GPtrArray) batch = NULL;
 	gint i;
 
+	batch = g_ptr_array_new_with_free_func (g_object_unref);
+
 	g_async_queue_lock (xml->item_added_queue);
 
 	for (i = 0; i < NUM_ITEMS_PER_BATCH; i++) {
-		g_autoptr(GObject) item = NULL;
+		GObject *item;
 
 		item = g_async_queue_try_pop_unlocked (xml->item_added_queue);
 		if (item == NULL)
 			break;
-		g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, item);
+		g_ptr_array_add (batch, item);
 	}
 
 	g_async_queue_unlock (xml->item_added_queue);
 
+	if (batch->len > 0)
+		g_signal_emit (G_OBJECT (xml), signals[ADDED_BATCH], 0, batch);
+
         if (g_async_queue_length (xml->item_added_queue) > 0) {
                 return TRUE;
         } else {
@@ -144,27 +186,129 @@ emit_added_in_idle (CcBackgroundXml *xml,
 	g_async_queue_unlock (xml->item_added_queue);
 }
 
+static void
+parsed_item_free (ParsedItem *parsed)
+{
+	g_free (parsed->id);
+	g_free (parsed->name);
+	g_free (parsed->uri);
+	g_free (parsed->uri_dark);
+	g_free (parsed->primary_color);
+	g_free (parsed->secondary_color);
+	g_free (parsed->source_url);
+	g_free (parsed->source_xml);
+	g_free (parsed);
+}
+
+static CcBackgroundItem *
+parsed_item_create_item (ParsedItem *parsed)
+{
+	CcBackgroundItem *item;
+
+	item = cc_background_item_new (NULL);
+	g_object_set (G_OBJECT (item),
+		      "name", parsed->name,
+		      "uri", parsed->uri,
+		      "uri-dark", parsed->uri_dark,
+		      "placement", parsed->placement,
+		      "shading", parsed->shading,
+		      "is-deleted", parsed->is_deleted,
+		      "source-xml", parsed->source_xml,
+		      "flags", parsed->flags,
+		      NULL);
+
+	if (parsed->primary_color != NULL)
+		g_object_set (G_OBJECT (item), "primary-color", parsed->primary_color, NULL);
+	if (parsed->secondary_color != NULL)
+		g_object_set (G_OBJECT (item), "secondary-color", parsed->secondary_color, NULL);
+	if (parsed->source_url != NULL)
+		g_object_set (G_OBJECT (item),
+			      "source-url", parsed->source_url,
+			      "needs-download", FALSE,
+			      NULL);
+
+	return item;
+}
+
+static void
+memo_entry_free (MemoEntry *entry)
+{
+	g_ptr_array_unref (entry->contents);
+	g_free (entry);
+}
+
+static gint64
+get_mtime (const gchar *path)
+{
+	GStatBuf buf;
+
+	if (g_stat (path, &buf) != 0)
+		return -1;
+
+	return buf.st_mtime;
+}
+
+static GPtrArray *
+memo_lookup (GHashTable **memo,
+	     const gchar *path,
+	     gint64       mtime)
+{
+	GPtrArray *contents = NULL;
+	MemoEntry *entry;
+
+	G_LOCK (memo);
+
+	entry = *memo ? g_hash_table_lookup (*memo, path) : NULL;
+	if (entry && entry->mtime == mtime)
+		contents = g_ptr_array_ref (entry->contents);
+
+	G_UNLOCK (memo);
+
+	return contents;
+}
+
+static void
+memo_insert (GHashTable **memo,
+	     const gchar *path,
+	     gint64       mtime,
+	     GPtrArray   *contents)
+{
+	MemoEntry *entry;
+
+	entry = g_new0 (MemoEntry, 1);
+	entry->mtime = mtime;
+	entry->contents = g_ptr_array_ref (contents);
+
+	G_LOCK (memo);
+
+	if (*memo == NULL)
+		*memo = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) memo_entry_free);
+	g_hash_table_insert (*memo, g_strdup (path), entry);
+
+	G_UNLOCK (memo);
+}
+
 #define NONE "(none)"
 #define UNSET_FLAG(flag) G_STMT_START{ (flags&=~(flag)); }G_STMT_END
 #define SET_FLAG(flag) G_STMT_START{ (flags|=flag); }G_STMT_END
 
-static gboolean
-cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
-				     const gchar     *filename,
-				     gboolean         in_thread)
+/* This doesn't touch any CcBackgroundXml, and is safe to call from any thread */
+static GPtrArray *
+parse_xml_file (const gchar *filename)
 {
   xmlDoc * wplist;
   xmlNode * root, * list, * wpa;
   xmlChar * nodelang;
   const gchar * const * syslangs;
+  GPtrArray *parsed_items;
   gint i;
-  gboolean retval;
+
+  parsed_items = g_ptr_array_new_with_free_func ((GDestroyNotify) parsed_item_free);
 
   wplist = xmlParseFile (filename);
-  retval = FALSE;
 
   if (!wplist)
-    return retval;
+    return parsed_items;
 
   syslangs = g_get_language_names ();
 
@@ -172,19 +316,17 @@ cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
 
   for (list = root->children; list != NULL; list = list->next) {
     if (!strcmp ((gchar *)list->name, "wallpaper")) {
-      g_autoptr(CcBackgroundItem) item = NULL;
       CcBackgroundItemFlags flags;
       g_autofree gchar *uri = NULL;
       g_autofree gchar *cname = NULL;
-      g_autofree gchar *id = NULL;
+      ParsedItem *parsed;
 
       flags = 0;
-      item = cc_background_item_new (NULL);
-
-      g_object_set (G_OBJECT (item),
-		    "is-deleted", cc_background_xml_get_bool (list, "deleted"),
-		    "source-xml", filename,
-		    NULL);
+      parsed = g_new0 (ParsedItem, 1);
+      parsed->placement = G_DESKTOP_BACKGROUND_STYLE_SCALED;
+      parsed->shading = G_DESKTOP_BACKGROUND_SHADING_SOLID;
+      parsed->is_deleted = cc_background_xml_get_bool (list, "deleted");
+      parsed->source_xml = g_strdup (filename);
 
       for (wpa = list->children; wpa != NULL; wpa = wpa->next) {
 	if (wpa->type == XML_COMMENT_NODE) {
@@ -192,61 +334,54 @@ cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
 	} else if (!strcmp ((gchar *)wpa->name, "filename")) {
 	  if (wpa->last != NULL && wpa->last->content != NULL) {
 	    gchar *content = g_strstrip ((gchar *)wpa->last->content);
-	    g_autofree gchar *bg_uri = NULL;
+
+	    g_clear_pointer (&parsed->uri, g_free);
 
 	    /* FIXME same rubbish as in other parts of the code */
-	    if (strcmp (content, NONE) == 0) {
-	      bg_uri = NULL;
-	    } else {
+	    if (strcmp (content, NONE) != 0) {
 	      g_autoptr(GFile) file = NULL;
 	      g_autofree gchar *dirname = NULL;
 
 	      dirname = g_path_get_dirname (filename);
 	      file = g_file_new_for_commandline_arg_and_cwd (content, dirname);
-	      bg_uri = g_file_get_uri (file);
+	      parsed->uri = g_file_get_uri (file);
 	    }
 	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_URI);
-	    g_object_set (G_OBJECT (item), "uri", bg_uri, NULL);
 	  } else {
 	    break;
 	  }
 	} else if (!strcmp ((gchar *)wpa->name, "filename-dark")) {
 	  if (wpa->last != NULL && wpa->last->content != NULL) {
 	    gchar *content = g_strstrip ((gchar *)wpa->last->content);
-	    g_autofree gchar *bg_uri = NULL;
+
+	    g_clear_pointer (&parsed->uri_dark, g_free);
 
 	    /* FIXME same rubbish as in other parts of the code */
-	    if (strcmp (content, NONE) == 0) {
-	      bg_uri = NULL;
-	    } else {
+	    if (strcmp (content, NONE) != 0) {
 	      g_autoptr(GFile) file = NULL;
 	      g_autofree gchar *dirname = NULL;
 
 	      dirname = g_path_get_dirname (filename);
 	      file = g_file_new_for_commandline_arg_and_cwd (content, dirname);
-	      bg_uri = g_file_get_uri (file);
+	      parsed->uri_dark = g_file_get_uri (file);
 	    }
 	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_URI_DARK);
-	    g_object_set (G_OBJECT (item), "uri-dark", bg_uri, NULL);
 	  } else {
 	    break;
 	  }
 	} else if (!strcmp ((gchar *)wpa->name, "name")) {
 	  if (wpa->last != NULL && wpa->last->content != NULL) {
-	    g_autofree gchar *name = NULL;
 	    nodelang = xmlNodeGetLang (wpa->last);
 
-	    g_object_get (G_OBJECT (item), "name", &name, NULL);
-
-	    if (name == NULL && nodelang == NULL) {
+	    if (parsed->name == NULL && nodelang == NULL) {
 	       g_free (cname);
 	       cname = g_strdup (g_strstrip ((gchar *)wpa->last->content));
-	       g_object_set (G_OBJECT (item), "name", cname, NULL);
-            } else {
+	       parsed->name = g_strdup (cname);
+            } else if (nodelang != NULL) {
 	       for (i = 0; syslangs[i] != NULL; i++) {
 	         if (!strcmp (syslangs[i], (gchar *)nodelang)) {
-		   g_object_set (G_OBJECT (item), "name",
-				 g_strstrip ((gchar *)wpa->last->content), NULL);
+		   g_free (parsed->name);
+		   parsed->name = g_strdup (g_strstrip ((gchar *)wpa->last->content));
 	           break;
 	         }
 	       }
@@ -258,36 +393,32 @@ cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
 	  }
 	} else if (!strcmp ((gchar *)wpa->name, "options")) {
 	  if (wpa->last != NULL) {
-	    g_object_set (G_OBJECT (item), "placement",
-			  enum_string_to_value (G_DESKTOP_TYPE_DESKTOP_BACKGROUND_STYLE,
-						g_strstrip ((gchar *)wpa->last->content)), NULL);
+	    parsed->placement = enum_string_to_value (G_DESKTOP_TYPE_DESKTOP_BACKGROUND_STYLE,
+						      g_strstrip ((gchar *)wpa->last->content));
 	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_PLACEMENT);
 	  }
 	} else if (!strcmp ((gchar *)wpa->name, "shade_type")) {
 	  if (wpa->last != NULL) {
-	    g_object_set (G_OBJECT (item), "shading",
-			  enum_string_to_value (G_DESKTOP_TYPE_DESKTOP_BACKGROUND_SHADING,
-						g_strstrip ((gchar *)wpa->last->content)), NULL);
+	    parsed->shading = enum_string_to_value (G_DESKTOP_TYPE_DESKTOP_BACKGROUND_SHADING,
+						    g_strstrip ((gchar *)wpa->last->content));
 	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_SHADING);
 	  }
 	} else if (!strcmp ((gchar *)wpa->name, "pcolor")) {
 	  if (wpa->last != NULL) {
-	    g_object_set (G_OBJECT (item), "primary-color",
-			  g_strstrip ((gchar *)wpa->last->content), NULL);
+	    g_free (parsed->primary_color);
+	    parsed->primary_color = g_strdup (g_strstrip ((gchar *)wpa->last->content));
 	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_PCOLOR);
 	  }
 	} else if (!strcmp ((gchar *)wpa->name, "scolor")) {
 	  if (wpa->last != NULL) {
-	    g_object_set (G_OBJECT (item), "secondary-color",
-			  g_strstrip ((gchar *)wpa->last->content), NULL);
+	    g_free (parsed->secondary_color);
+	    parsed->secondary_color = g_strdup (g_strstrip ((gchar *)wpa->last->content));
 	    SET_FLAG(CC_BACKGROUND_ITEM_HAS_SCOLOR);
 	  }
 	} else if (!strcmp ((gchar *)wpa->name, "source_url")) {
 	   if (wpa->last != NULL) {
-             g_object_set (G_OBJECT (item),
-			   "source-url", g_strstrip ((gchar *)wpa->last->content),
-			   "needs-download", FALSE,
-			   NULL);
+	     g_free (parsed->source_url);
+	     parsed->source_url = g_strdup (g_strstrip ((gchar *)wpa->last->content));
 	   }
 	} else if (!strcmp ((gchar *)wpa->name, "text")) {
 	  /* Do nothing here, libxml2 is being weird */
@@ -297,50 +428,96 @@ cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
       }
 
       /* Check whether the target file exists */
-      {
-        const char *uri;
-
-	uri = cc_background_item_get_uri (item);
-	if (uri != NULL)
-	  {
-            g_autoptr(GFile) file = NULL;
-
-            file = g_file_new_for_uri (uri);
-	    if (g_file_query_exists (file, NULL) == FALSE)
-	      {
-	        g_clear_pointer (&cname, g_free);
-	        g_clear_object (&item);
-	        continue;
-	      }
-	  }
-      }
+      if (parsed->uri != NULL)
+	{
+          g_autoptr(GFile) file = NULL;
+
+          file = g_file_new_for_uri (parsed->uri);
+	  if (g_file_query_exists (file, NULL) == FALSE)
+	    {
+	      parsed_item_free (parsed);
+	      continue;
+	    }
+	}
 
       /* FIXME, this is a broken way of doing,
        * need to use proper code here */
       uri = g_filename_to_uri (filename, NULL, NULL);
-      id = g_strdup_printf ("%s#%s", uri, cname);
-
-      /* Make sure we don't already have this one and that filename exists */
-      if (g_hash_table_lookup (xml->wp_hash, id) != NULL) {
-	continue;
-      }
+      parsed->id = g_strdup_printf ("%s#%s", uri, cname);
+      parsed->flags = flags;
 
-      g_object_set (G_OBJECT (item), "flags", flags, NULL);
-      g_hash_table_insert (xml->wp_hash,
-                           g_strdup (id),
-                           g_object_ref (item));
-      if (in_thread)
-        emit_added_in_idle (xml, g_object_ref (G_OBJECT (item)));
-      else
-        g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, item);
-      retval = TRUE;
+      g_ptr_array_add (parsed_items, parsed);
     }
   }
   xmlFreeDoc (wplist);
 
+  return parsed_items;
+}
+
+static GPtrArray *
+parse_xml_file_memoized (const gchar *filename)
+{
+  GPtrArray *parsed_items;
+  gint64 mtime;
+
+  mtime = get_mtime (filename);
+
+  parsed_items = memo_lookup (&file_memo, filename, mtime);
+  if (parsed_items)
+    return parsed_items;
+
+  parsed_items = parse_xml_file (filename);
+  memo_insert (&file_memo, filename, mtime, parsed_items);
+
+  return parsed_items;
+}
+
+static gboolean
+add_parsed_items (CcBackgroundXml *xml,
+		  GPtrArray       *parsed_items,
+		  gboolean         in_thread)
+{
+  gboolean retval = FALSE;
+  guint i;
+
+  for (i = 0; i < parsed_items->len; i++) {
+    ParsedItem *parsed = g_ptr_array_index (parsed_items, i);
+    g_autoptr(CcBackgroundItem) item = NULL;
+
+    /* Make sure we don't already have this one */
+    g_mutex_lock (&xml->wp_hash_lock);
+    if (g_hash_table_lookup (xml->wp_hash, parsed->id) != NULL) {
+      g_mutex_unlock (&xml->wp_hash_lock);
+      continue;
+    }
+
+    item = parsed_item_create_item (parsed);
+    g_hash_table_insert (xml->wp_hash,
+                         g_strdup (parsed->id),
+                         g_object_ref (item));
+    g_mutex_unlock (&xml->wp_hash_lock);
+
+    if (in_thread)
+      emit_added_in_idle (xml, g_object_ref (G_OBJECT (item)));
+    else
+      g_signal_emit (G_OBJECT (xml), signals[ADDED], 0, item);
+    retval = TRUE;
+  }
+
   return retval;
 }
 
+static gboolean
+cc_background_xml_load_xml_internal (CcBackgroundXml *xml,
+				     const gchar     *filename)
+{
+  g_autoptr(GPtrArray) parsed_items = NULL;
+
+  parsed_items = parse_xml_file (filename);
+
+  return add_parsed_items (xml, parsed_items, FALSE);
+}
+
 static void
 gnome_wp_file_changed (GFileMonitor *monitor,
 		       GFile *file,
@@ -354,7 +531,7 @@ gnome_wp_file_changed (GFileMonitor *monitor,
   case G_FILE_MONITOR_EVENT_CHANGED:
   case G_FILE_MONITOR_EVENT_CREATED:
     filename = g_file_get_path (file);
-    cc_background_xml_load_xml_internal (data, filename, FALSE);
+    cc_background_xml_load_xml_internal (data, filename);
     break;
   default:
     break;
@@ -388,18 +565,20 @@ cc_background_xml_add_monitor (GFile      *directory,
   data->monitors = g_slist_prepend (data->monitors, monitor);
 }
 
-static void
-cc_background_xml_load_from_dir (const gchar      *path,
-				 CcBackgroundXml  *data,
-				 gboolean          in_thread)
+static GPtrArray *
+list_xml_files (const gchar *path)
 {
   g_autoptr(GFile) directory = NULL;
   g_autoptr(GFileEnumerator) enumerator = NULL;
   g_autoptr(GError) error = NULL;
+  GPtrArray *filenames;
+  gint64 mtime;
 
-  if (!g_file_test (path, G_FILE_TEST_IS_DIR)) {
-    return;
-  }
+  mtime = get_mtime (path);
+
+  filenames = memo_lookup (&dir_memo, path, mtime);
+  if (filenames)
+    return filenames;
 
   directory = g_file_new_for_path (path);
   enumerator = g_file_enumerate_children (directory,
@@ -409,40 +588,97 @@ cc_background_xml_load_from_dir (const gchar      *path,
                                           &error);
   if (error != NULL) {
     g_warning ("Unable to check directory %s: %s", path, error->message);
-    return;
+    return NULL;
   }
 
+  filenames = g_ptr_array_new_with_free_func (g_free);
+
   while (TRUE) {
     g_autoptr(GFileInfo) info = NULL;
-    const gchar *filename;
-    g_autofree gchar *fullpath = NULL;
 
     info = g_file_enumerator_next_file (enumerator, NULL, NULL);
-    if (info == NULL) {
-        g_file_enumerator_close (enumerator, NULL, NULL);
-        cc_background_xml_add_monitor (directory, data);
-        return;
-    }
+    if (info == NULL)
+      break;
+
+    g_ptr_array_add (filenames, g_build_filename (path, g_file_info_get_name (info), NULL));
+  }
+
+  g_file_enumerator_close (enumerator, NULL, NULL);
 
-    filename = g_file_info_get_name (info);
-    fullpath = g_build_filename (path, filename, NULL);
+  memo_insert (&dir_memo, path, mtime, filenames);
+
+  return filenames;
+}
+
+static void
+cc_background_xml_load_from_dir (const gchar      *path,
+				 CcBackgroundXml  *data,
+				 GPtrArray        *filenames)
+{
+  g_autoptr(GFile) directory = NULL;
+  g_autoptr(GPtrArray) dir_filenames = NULL;
+  guint i;
 
-    cc_background_xml_load_xml_internal (data, fullpath, in_thread);
+  if (!g_file_test (path, G_FILE_TEST_IS_DIR)) {
+    return;
   }
+
+  dir_filenames = list_xml_files (path);
+  if (dir_filenames == NULL)
+    return;
+
+  for (i = 0; i < dir_filenames->len; i++)
+    g_ptr_array_add (filenames, g_strdup (g_ptr_array_index (dir_filenames, i)));
+
+  directory = g_file_new_for_path (path);
+  cc_background_xml_add_monitor (directory, data);
+}
+
+/* Files are parsed in parallel, but their items are added in the order
+ * the files were listed, so that the user's wallpapers keep precedence
+ * over the system ones.
+ */
+typedef struct {
+  GMutex      mutex;
+  GCond       cond;
+  GPtrArray  *filenames;
+  GPtrArray **results;
+} ParseContext;
+
+static void
+parse_file_func (gpointer data,
+                 gpointer user_data)
+{
+  ParseContext *ctx = user_data;
+  guint index = GPOINTER_TO_UINT (data) - 1;
+  GPtrArray *parsed_items;
+
+  parsed_items = parse_xml_file_memoized (g_ptr_array_index (ctx->filenames, index));
+
+  g_mutex_lock (&ctx->mutex);
+  ctx->results[index] = parsed_items;
+  g_cond_broadcast (&ctx->cond);
+  g_mutex_unlock (&ctx->mutex);
 }
 
 static void
 cc_background_xml_load_list (CcBackgroundXml *data,
-			     gboolean         in_thread)
+			     GCancellable    *cancellable)
 {
   const char * const *system_data_dirs;
   g_autofree gchar *datadir = NULL;
-  gint i;
+  g_autoptr(GPtrArray) filenames = NULL;
+  GThreadPool *pool;
+  ParseContext ctx;
+  guint n_threads;
+  guint i;
+
+  filenames = g_ptr_array_new_with_free_func (g_free);
 
   datadir = g_build_filename (g_get_user_data_dir (),
                               "gnome-background-properties",
                               NULL);
-  cc_background_xml_load_from_dir (datadir, data, in_thread);
+  cc_background_xml_load_from_dir (datadir, data, filenames);
 
   system_data_dirs = g_get_system_data_dirs ();
   for (i = 0; system_data_dirs[i]; i++) {
@@ -450,8 +686,47 @@ cc_background_xml_load_list (CcBackgroundXml *data,
     sdatadir = g_build_filename (system_data_dirs[i],
                                 "gnome-background-properties",
 				NULL);
-    cc_background_xml_load_from_dir (sdatadir, data, in_thread);
+    cc_background_xml_load_from_dir (sdatadir, data, filenames);
   }
+
+  if (filenames->len == 0)
+    return;
+
+  g_mutex_init (&ctx.mutex);
+  g_cond_init (&ctx.cond);
+  ctx.filenames = filenames;
+  ctx.results = g_new0 (GPtrArray *, filenames->len);
+
+  n_threads = CLAMP (g_get_num_processors (), 1, MAX_PARSER_THREADS);
+  n_threads = MIN (n_threads, filenames->len);
+  pool = g_thread_pool_new (parse_file_func, &ctx, n_threads, FALSE, NULL);
+
+  for (i = 0; i < filenames->len; i++)
+    g_thread_pool_push (pool, GUINT_TO_POINTER (i + 1), NULL);
+
+  for (i = 0; i < filenames->len; i++) {
+    g_autoptr(GPtrArray) parsed_items = NULL;
+
+    if (g_cancellable_is_cancelled (cancellable))
+      break;
+
+    g_mutex_lock (&ctx.mutex);
+    while (ctx.results[i] == NULL)
+      g_cond_wait (&ctx.cond, &ctx.mutex);
+    parsed_items = g_steal_pointer (&ctx.results[i]);
+    g_mutex_unlock (&ctx.mutex);
+
+    add_parsed_items (data, parsed_items, TRUE);
+  }
+
+  /* Drop the files not parsed yet if we got cancelled */
+  g_thread_pool_free (pool, TRUE, TRUE);
+
+  for (i = 0; i < filenames->len; i++)
+    g_clear_pointer (&ctx.results[i], g_ptr_array_unref);
+  g_free (ctx.results);
+  g_cond_clear (&ctx.cond);
+  g_mutex_clear (&ctx.mutex);
 }
 
 gboolean
@@ -471,7 +746,7 @@ load_list_thread (GTask *task,
 		  GCancellable *cancellable)
 {
 	CcBackgroundXml *xml = CC_BACKGROUND_XML (source_object);
-	cc_background_xml_load_list (xml, TRUE);
+	cc_background_xml_load_list (xml, cancellable);
 	g_task_return_boolean (task, TRUE);
 }
 
@@ -485,6 +760,9 @@ cc_background_xml_load_list_async (CcBackgroundXml *xml,
 
 	g_return_if_fail (CC_IS_BACKGROUND_XML (xml));
 
+	/* libxml2 needs to be initialized before parsing from several threads */
+	xmlInitParser ();
+
 	task = g_task_new (xml, cancellable, callback, user_data);
 	g_task_run_in_thread (task, load_list_thread);
 }
@@ -498,7 +776,7 @@ cc_background_xml_load_xml (CcBackgroundXml *xml,
 	if (g_file_test (filename, G_FILE_TEST_IS_REGULAR) == FALSE)
 		return FALSE;
 
-	return cc_background_xml_load_xml_internal (xml, filename, FALSE);
+	return cc_background_xml_load_xml_internal (xml, filename);
 }
 
 static void
@@ -627,6 +905,7 @@ cc_background_xml_finalize (GObject *object)
         g_slist_free_full (xml->monitors, g_object_unref);
 
 	g_clear_pointer (&xml->wp_hash, g_hash_table_destroy);
+	g_mutex_clear (&xml->wp_hash_lock);
 	if (xml->item_added_id != 0) {
 		g_source_remove (xml->item_added_id);
 		xml->item_added_id = 0;
@@ -650,11 +929,22 @@ cc_background_xml_class_init (CcBackgroundXmlClass *klass)
 				       NULL, NULL,
 				       g_cclosure_marshal_VOID__OBJECT,
 				       G_TYPE_NONE, 1, CC_TYPE_BACKGROUND_ITEM);
+
+	/* Emitted with a GPtrArray of CcBackgroundItem when the items
+	 * were found by cc_background_xml_load_list_async() */
+	signals[ADDED_BATCH] = g_signal_new ("added-batch",
+					     G_OBJECT_CLASS_TYPE (object_class),
+					     G_SIGNAL_RUN_LAST,
+					     0,
+					     NULL, NULL,
+					     g_cclosure_marshal_VOID__BOXED,
+					     G_TYPE_NONE, 1, G_TYPE_PTR_ARRAY);
 }
 
 static void
 cc_background_xml_init (CcBackgroundXml *xml)
 {
+        g_mutex_init (&xml->wp_hash_lock);
         xml->wp_hash = g_hash_table_new_full (g_str_hash,
                                               g_str_equal,
                                               (GDestroyNotify) g_free,
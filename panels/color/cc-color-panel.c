@@ -32,12 +32,14 @@
 #include "cc-color-common.h"
 #include "cc-color-device.h"
 #include "cc-color-profile.h"
+#include "cc-color-profile-catalogue.h"
 
 struct _CcColorPanel
 {
   CcPanel        parent_instance;
 
   CdClient      *client;
+  CcColorProfileCatalogue *catalogue;
   CdDevice      *current_device;
   GPtrArray     *devices;
   GPtrArray     *sensors;
@@ -744,15 +746,42 @@ gcm_prefs_profile_exists_in_array (GPtrArray *array, CdProfile *profile)
   return FALSE;
 }
 
+static void
+gcm_prefs_add_profile_suitable_for_device (CcColorPanel *prefs,
+                                           CdProfile *profile,
+                                           GPtrArray *profiles)
+{
+  GtkTreeIter iter;
+
+  /* don't add any of the already added profiles */
+  if (profiles != NULL)
+    {
+      if (gcm_prefs_profile_exists_in_array (profiles, profile))
+        return;
+    }
+
+  /* only add correct types */
+  if (!gcm_prefs_is_profile_suitable_for_device (profile,
+                                                 prefs->current_device))
+    return;
+
+#if CD_CHECK_VERSION(0,1,13)
+  /* ignore profiles from other user accounts */
+  if (!cd_profile_has_access (profile))
+    return;
+#endif
+
+  /* add */
+  gcm_prefs_combobox_add_profile (prefs,
+                                  profile,
+                                  &iter);
+}
+
 static void
 gcm_prefs_add_profiles_suitable_for_devices (CcColorPanel *prefs,
                                              GPtrArray *profiles)
 {
-  CdProfile *profile_tmp;
-  gboolean ret;
-  g_autoptr(GError) error = NULL;
   g_autoptr(GPtrArray) profile_array = NULL;
-  GtkTreeIter iter;
   guint i;
 
   gtk_list_store_clear (GTK_LIST_STORE (prefs->liststore_assign));
@@ -766,55 +795,52 @@ gcm_prefs_add_profiles_suitable_for_devices (CcColorPanel *prefs,
 
   gtk_widget_hide (prefs->label_assign_warning);
 
-  /* get profiles */
-  profile_array = cd_client_get_profiles_sync (prefs->client,
-                                               cc_panel_get_cancellable (CC_PANEL (prefs)),
-                                               &error);
-  if (profile_array == NULL)
-    {
-      g_warning ("failed to get profiles: %s",
-           error->message);
-      return;
-    }
-
-  /* add profiles of the right kind */
+  /* add the profiles connected so far, the others are added as they
+   * become available */
+  profile_array = cc_color_profile_catalogue_get_profiles (prefs->catalogue);
   for (i = 0; i < profile_array->len; i++)
     {
-      profile_tmp = g_ptr_array_index (profile_array, i);
+      gcm_prefs_add_profile_suitable_for_device (prefs,
+                                                 g_ptr_array_index (profile_array, i),
+                                                 profiles);
+    }
+}
 
-      /* get properties */
-      ret = cd_profile_connect_sync (profile_tmp,
-                                     cc_panel_get_cancellable (CC_PANEL (prefs)),
-                                     &error);
-      if (!ret)
-        {
-          g_warning ("failed to get profile: %s", error->message);
-          return;
-        }
+static void
+gcm_prefs_catalogue_profile_added_cb (CcColorPanel *prefs,
+                                      CdProfile *profile)
+{
+  g_autoptr(GPtrArray) profiles = NULL;
 
-      /* don't add any of the already added profiles */
-      if (profiles != NULL)
-        {
-          if (gcm_prefs_profile_exists_in_array (profiles, profile_tmp))
-            continue;
-        }
+  if (!gtk_widget_get_visible (prefs->dialog_assign) || prefs->current_device == NULL)
+    return;
 
-      /* only add correct types */
-      ret = gcm_prefs_is_profile_suitable_for_device (profile_tmp,
-                                                      prefs->current_device);
-      if (!ret)
-        continue;
+  profiles = cd_device_get_profiles (prefs->current_device);
+  gcm_prefs_add_profile_suitable_for_device (prefs, profile, profiles);
+}
 
-#if CD_CHECK_VERSION(0,1,13)
-      /* ignore profiles from other user accounts */
-      if (!cd_profile_has_access (profile_tmp))
-        continue;
-#endif
+static void
+gcm_prefs_catalogue_profile_removed_cb (CcColorPanel *prefs,
+                                        CdProfile *profile)
+{
+  GtkTreeModel *model = prefs->liststore_assign;
+  GtkTreeIter iter;
+  gboolean valid;
 
-      /* add */
-      gcm_prefs_combobox_add_profile (prefs,
-                                      profile_tmp,
-                                      &iter);
+  valid = gtk_tree_model_get_iter_first (model, &iter);
+  while (valid)
+    {
+      g_autoptr(CdProfile) profile_tmp = NULL;
+
+      gtk_tree_model_get (model, &iter,
+                          GCM_PREFS_COMBO_COLUMN_PROFILE, &profile_tmp,
+                          -1);
+      if (profile_tmp != NULL &&
+          g_strcmp0 (cd_profile_get_object_path (profile_tmp),
+                     cd_profile_get_object_path (profile)) == 0)
+        valid = gtk_list_store_remove (GTK_LIST_STORE (model), &iter);
+      else
+        valid = gtk_tree_model_iter_next (model, &iter);
     }
 }
 
@@ -1361,25 +1387,63 @@ gcm_prefs_client_sensor_changed_cb (CdClient *client,
   gcm_prefs_set_calibrate_button_sensitivity (prefs);
 }
 
+static gboolean gcm_prefs_find_profile_by_object_path (GPtrArray *profiles,
+                                                       const gchar *object_path);
+
+typedef struct
+{
+  CcColorPanel *prefs;
+  CdDevice     *device;
+} AddDeviceProfileData;
+
 static void
-gcm_prefs_add_device_profile (CcColorPanel *prefs,
+add_device_profile_data_free (AddDeviceProfileData *data)
+{
+  g_object_unref (data->device);
+  g_free (data);
+}
+
+static gboolean
+gcm_prefs_has_profile_widget (CcColorPanel *prefs,
                               CdDevice *device,
-                              CdProfile *profile,
-                              gboolean is_default)
+                              CdProfile *profile)
 {
-  gboolean ret;
-  g_autoptr(GError) error = NULL;
-  GtkWidget *widget;
+  GtkWidget *child;
 
-  /* get properties */
-  ret = cd_profile_connect_sync (profile,
-                                 cc_panel_get_cancellable (CC_PANEL (prefs)),
-                                 &error);
-  if (!ret)
+  for (child = gtk_widget_get_first_child (GTK_WIDGET (prefs->list_box));
+       child != NULL;
+       child = gtk_widget_get_next_sibling (child))
     {
-      g_warning ("failed to get profile: %s", error->message);
-      return;
+      if (!CC_IS_COLOR_PROFILE (child))
+        continue;
+      if (g_strcmp0 (cd_device_get_object_path (cc_color_profile_get_device (CC_COLOR_PROFILE (child))),
+                     cd_device_get_object_path (device)) != 0)
+        continue;
+      if (g_strcmp0 (cd_profile_get_object_path (cc_color_profile_get_profile (CC_COLOR_PROFILE (child))),
+                     cd_profile_get_object_path (profile)) == 0)
+        return TRUE;
     }
+  return FALSE;
+}
+
+static void
+gcm_prefs_add_device_profile_widget (CcColorPanel *prefs,
+                                     CdDevice *device,
+                                     CdProfile *profile)
+{
+  g_autoptr(GPtrArray) profiles = NULL;
+  CdProfile *default_profile = NULL;
+  GtkWidget *widget;
+
+  /* the device or its profiles may have changed while connecting */
+  if (!g_ptr_array_find (prefs->devices, device, NULL))
+    return;
+  profiles = cd_device_get_profiles (device);
+  if (profiles == NULL ||
+      !gcm_prefs_find_profile_by_object_path (profiles, cd_profile_get_object_path (profile)))
+    return;
+  if (gcm_prefs_has_profile_widget (prefs, device, profile))
+    return;
 
   /* ignore profiles from other user accounts */
   if (!cd_profile_has_access (profile))
@@ -1398,10 +1462,70 @@ gcm_prefs_add_device_profile (CcColorPanel *prefs,
       return;
     }
 
+  /* the first profile is the default */
+  if (profiles->len > 0)
+    default_profile = g_ptr_array_index (profiles, 0);
+
   /* add to listbox */
-  widget = cc_color_profile_new (device, profile, is_default);
+  widget = cc_color_profile_new (device, profile,
+                                 default_profile != NULL &&
+                                 g_strcmp0 (cd_profile_get_object_path (default_profile),
+                                            cd_profile_get_object_path (profile)) == 0);
   gtk_list_box_append (prefs->list_box, widget);
   gtk_size_group_add_widget (prefs->list_box_size, widget);
+  gtk_list_box_invalidate_sort (prefs->list_box);
+}
+
+static void
+gcm_prefs_connect_device_profile_cb (GObject *object,
+                                     GAsyncResult *res,
+                                     gpointer user_data)
+{
+  AddDeviceProfileData *data = user_data;
+  g_autoptr(CdProfile) profile = NULL;
+  g_autoptr(GError) error = NULL;
+
+  profile = cc_color_profile_catalogue_connect_profile_finish (CC_COLOR_PROFILE_CATALOGUE (object),
+                                                               res,
+                                                               &error);
+  if (profile == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED) &&
+          !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+        g_warning ("failed to get profile: %s", error->message);
+      add_device_profile_data_free (data);
+      return;
+    }
+
+  gcm_prefs_add_device_profile_widget (data->prefs, data->device, profile);
+  add_device_profile_data_free (data);
+}
+
+static void
+gcm_prefs_add_device_profile (CcColorPanel *prefs,
+                              CdDevice *device,
+                              CdProfile *profile)
+{
+  AddDeviceProfileData *data;
+  CdProfile *connected;
+
+  /* get properties, from the catalogue if it has them already */
+  connected = cc_color_profile_catalogue_lookup (prefs->catalogue,
+                                                 cd_profile_get_object_path (profile));
+  if (connected != NULL)
+    {
+      gcm_prefs_add_device_profile_widget (prefs, device, connected);
+      return;
+    }
+
+  data = g_new0 (AddDeviceProfileData, 1);
+  data->prefs = prefs;
+  data->device = g_object_ref (device);
+  cc_color_profile_catalogue_connect_profile (prefs->catalogue,
+                                              profile,
+                                              cc_panel_get_cancellable (CC_PANEL (prefs)),
+                                              gcm_prefs_connect_device_profile_cb,
+                                              data);
 }
 
 static void
@@ -1418,7 +1542,7 @@ gcm_prefs_add_device_profiles (CcColorPanel *prefs, CdDevice *device)
   for (i = 0; i < profiles->len; i++)
     {
       profile_tmp = g_ptr_array_index (profiles, i);
-      gcm_prefs_add_device_profile (prefs, device, profile_tmp, i == 0);
+      gcm_prefs_add_device_profile (prefs, device, profile_tmp);
     }
 }
 
@@ -1527,7 +1651,7 @@ next:
                                                   cd_device_get_object_path (device),
                                                   cd_profile_get_object_path (profile_tmp));
       if (!ret)
-        gcm_prefs_add_device_profile (prefs, device, profile_tmp, i == 0);
+        gcm_prefs_add_device_profile (prefs, device, profile_tmp);
     }
 
   /* resort */
@@ -1794,6 +1918,9 @@ gcm_prefs_connect_cb (GObject *object,
   /* set calibrate button sensitivity */
   gcm_prefs_sensor_coldplug (prefs);
 
+  /* connect to the profiles in the background */
+  cc_color_profile_catalogue_load (prefs->catalogue);
+
   /* get devices */
   cd_client_get_devices (prefs->client,
                          cc_panel_get_cancellable (CC_PANEL (prefs)),
@@ -1867,6 +1994,7 @@ cc_color_panel_dispose (GObject *object)
 
   g_clear_object (&prefs->settings);
   g_clear_object (&prefs->settings_colord);
+  g_clear_object (&prefs->catalogue);
   g_clear_object (&prefs->client);
   g_clear_object (&prefs->current_device);
   g_clear_pointer (&prefs->devices, g_ptr_array_unref);
@@ -2164,6 +2292,13 @@ cc_color_panel_init (CcColorPanel *prefs)
   g_signal_connect_object (prefs->client, "device-removed",
                            G_CALLBACK (gcm_prefs_device_removed_cb), prefs, 0);
 
+  /* keep the profiles connected for the assign dialog */
+  prefs->catalogue = cc_color_profile_catalogue_new (prefs->client);
+  g_signal_connect_object (prefs->catalogue, "profile-added",
+                           G_CALLBACK (gcm_prefs_catalogue_profile_added_cb), prefs, G_CONNECT_SWAPPED);
+  g_signal_connect_object (prefs->catalogue, "profile-removed",
+                           G_CALLBACK (gcm_prefs_catalogue_profile_removed_cb), prefs, G_CONNECT_SWAPPED);
+
   /* use a listbox for the main UI */
   gtk_list_box_set_filter_func (prefs->list_box,
                                 cc_color_panel_filter_func,
@@ -0,0 +1,419 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright (C) 2026 The GNOME Settings authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include "cc-color-profile-catalogue.h"
+
+/*
+ * Keeps every profile known to colord connected, so that their properties
+ * (kind, colorspace, title, metadata...) can be read without a round trip.
+ * Profiles are connected concurrently, and the catalogue follows the
+ * profiles colord adds and removes.
+ */
+
+struct _CcColorProfileCatalogue
+{
+  GObject       parent_instance;
+
+  CdClient     *client;
+  GCancellable *cancellable;
+
+  /* object path → connected CdProfile */
+  GHashTable   *profiles;
+  /* object path → PendingProfile */
+  GHashTable   *pending;
+};
+
+/* A profile being connected, and the GTasks waiting for it. A profile
+ * removed and added again while connecting is another CdProfile, so the
+ * instance tells which connection the entry belongs to. */
+typedef struct
+{
+  CdProfile *profile;
+  GPtrArray *tasks;
+} PendingProfile;
+
+G_DEFINE_TYPE (CcColorProfileCatalogue, cc_color_profile_catalogue, G_TYPE_OBJECT)
+
+enum {
+  SIGNAL_PROFILE_ADDED,
+  SIGNAL_PROFILE_REMOVED,
+  SIGNAL_LAST
+};
+
+static guint signals[SIGNAL_LAST] = { 0 };
+
+static void
+pending_profile_free (PendingProfile *pending)
+{
+  g_object_unref (pending->profile);
+  g_ptr_array_unref (pending->tasks);
+  g_free (pending);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (PendingProfile, pending_profile_free)
+
+static void
+fail_tasks (GPtrArray    *tasks,
+            const GError *error)
+{
+  guint i;
+
+  for (i = 0; i < tasks->len; i++)
+    g_task_return_error (g_ptr_array_index (tasks, i), g_error_copy (error));
+}
+
+static void
+profile_connect_cb (GObject      *object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+  GWeakRef *weak_self = user_data;
+  g_autoptr(CcColorProfileCatalogue) self = g_weak_ref_get (weak_self);
+  CdProfile *profile = CD_PROFILE (object);
+  g_autoptr(PendingProfile) pending = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *object_path = NULL;
+  PendingProfile *entry;
+  guint i;
+
+  g_weak_ref_clear (weak_self);
+  g_free (weak_self);
+
+  cd_profile_connect_finish (profile, res, &error);
+
+  /* The catalogue is gone, and so are the tasks, which hold a reference
+   * on it */
+  if (self == NULL)
+    return;
+
+  /* Removed while connecting, the waiting tasks were already told. The
+   * profile may have been added again since, then the entry is not ours. */
+  entry = g_hash_table_lookup (self->pending, cd_profile_get_object_path (profile));
+  if (entry == NULL || entry->profile != profile)
+    return;
+
+  g_hash_table_steal_extended (self->pending,
+                               cd_profile_get_object_path (profile),
+                               (gpointer *) &object_path,
+                               (gpointer *) &pending);
+
+  if (error != NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("failed to get profile: %s", error->message);
+      fail_tasks (pending->tasks, error);
+      return;
+    }
+
+  g_hash_table_insert (self->profiles, g_steal_pointer (&object_path), g_object_ref (profile));
+  g_signal_emit (self, signals[SIGNAL_PROFILE_ADDED], 0, profile);
+
+  for (i = 0; i < pending->tasks->len; i++)
+    g_task_return_pointer (g_ptr_array_index (pending->tasks, i), g_object_ref (profile), g_object_unref);
+}
+
+/* Returns the tasks waiting for @profile, connecting it if needed */
+static GPtrArray *
+ensure_connecting (CcColorProfileCatalogue *self,
+                   CdProfile               *profile)
+{
+  const gchar *object_path = cd_profile_get_object_path (profile);
+  PendingProfile *pending;
+  GWeakRef *weak_self;
+
+  pending = g_hash_table_lookup (self->pending, object_path);
+  if (pending != NULL)
+    return pending->tasks;
+
+  pending = g_new0 (PendingProfile, 1);
+  pending->profile = g_object_ref (profile);
+  pending->tasks = g_ptr_array_new_with_free_func (g_object_unref);
+  g_hash_table_insert (self->pending, g_strdup (object_path), pending);
+
+  /* Not a strong reference, so that disposing the catalogue cancels the
+   * connections instead of waiting for them */
+  weak_self = g_new0 (GWeakRef, 1);
+  g_weak_ref_init (weak_self, self);
+
+  cd_profile_connect (profile,
+                      self->cancellable,
+                      profile_connect_cb,
+                      weak_self);
+
+  return pending->tasks;
+}
+
+static void
+add_profile (CcColorProfileCatalogue *self,
+             CdProfile               *profile)
+{
+  if (g_hash_table_contains (self->profiles, cd_profile_get_object_path (profile)))
+    return;
+
+  ensure_connecting (self, profile);
+}
+
+static void
+on_profile_added_cb (CcColorProfileCatalogue *self,
+                     CdProfile               *profile)
+{
+  add_profile (self, profile);
+}
+
+static void
+on_profile_removed_cb (CcColorProfileCatalogue *self,
+                       CdProfile               *profile)
+{
+  const gchar *object_path = cd_profile_get_object_path (profile);
+  g_autoptr(CdProfile) removed = NULL;
+  g_autoptr(PendingProfile) pending = NULL;
+  g_autofree gchar *pending_path = NULL;
+  g_autofree gchar *profile_path = NULL;
+
+  if (g_hash_table_steal_extended (self->pending, object_path,
+                                   (gpointer *) &pending_path,
+                                   (gpointer *) &pending))
+    {
+      g_autoptr(GError) error = NULL;
+
+      error = g_error_new (G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                           "Profile %s was removed", object_path);
+      fail_tasks (pending->tasks, error);
+    }
+
+  if (!g_hash_table_steal_extended (self->profiles, object_path,
+                                    (gpointer *) &profile_path,
+                                    (gpointer *) &removed))
+    return;
+
+  g_signal_emit (self, signals[SIGNAL_PROFILE_REMOVED], 0, removed);
+}
+
+static void
+get_profiles_cb (GObject      *object,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+  CcColorProfileCatalogue *self;
+  g_autoptr(GPtrArray) profiles = NULL;
+  g_autoptr(GError) error = NULL;
+  guint i;
+
+  profiles = cd_client_get_profiles_finish (CD_CLIENT (object), res, &error);
+  if (profiles == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("failed to get profiles: %s", error->message);
+      return;
+    }
+
+  self = CC_COLOR_PROFILE_CATALOGUE (user_data);
+
+  for (i = 0; i < profiles->len; i++)
+    add_profile (self, g_ptr_array_index (profiles, i));
+}
+
+static void
+cc_color_profile_catalogue_dispose (GObject *object)
+{
+  CcColorProfileCatalogue *self = CC_COLOR_PROFILE_CATALOGUE (object);
+
+  g_cancellable_cancel (self->cancellable);
+
+  if (self->client != NULL)
+    g_signal_handlers_disconnect_by_data (self->client, self);
+  g_clear_object (&self->client);
+
+  G_OBJECT_CLASS (cc_color_profile_catalogue_parent_class)->dispose (object);
+}
+
+static void
+cc_color_profile_catalogue_finalize (GObject *object)
+{
+  CcColorProfileCatalogue *self = CC_COLOR_PROFILE_CATALOGUE (object);
+
+  g_clear_object (&self->cancellable);
+  g_clear_pointer (&self->profiles, g_hash_table_unref);
+  g_clear_pointer (&self->pending, g_hash_table_unref);
+
+  G_OBJECT_CLASS (cc_color_profile_catalogue_parent_class)->finalize (object);
+}
+
+static void
+cc_color_profile_catalogue_class_init (CcColorProfileCatalogueClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->dispose = cc_color_profile_catalogue_dispose;
+  object_class->finalize = cc_color_profile_catalogue_finalize;
+
+  signals[SIGNAL_PROFILE_ADDED] =
+    g_signal_new ("profile-added",
+                  G_TYPE_FROM_CLASS (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, CD_TYPE_PROFILE);
+
+  signals[SIGNAL_PROFILE_REMOVED] =
+    g_signal_new ("profile-removed",
+                  G_TYPE_FROM_CLASS (object_class),
+                  G_SIGNAL_RUN_LAST,
+                  0,
+                  NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, CD_TYPE_PROFILE);
+}
+
+static void
+cc_color_profile_catalogue_init (CcColorProfileCatalogue *self)
+{
+  self->cancellable = g_cancellable_new ();
+  self->profiles = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+  self->pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) pending_profile_free);
+}
+
+CcColorProfileCatalogue *
+cc_color_profile_catalogue_new (CdClient *client)
+{
+  CcColorProfileCatalogue *self;
+
+  g_return_val_if_fail (CD_IS_CLIENT (client), NULL);
+
+  self = g_object_new (CC_TYPE_COLOR_PROFILE_CATALOGUE, NULL);
+  self->client = g_object_ref (client);
+
+  g_signal_connect_object (client, "profile-added",
+                           G_CALLBACK (on_profile_added_cb), self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (client, "profile-removed",
+                           G_CALLBACK (on_profile_removed_cb), self, G_CONNECT_SWAPPED);
+
+  return self;
+}
+
+/**
+ * cc_color_profile_catalogue_load:
+ * @catalogue: a #CcColorProfileCatalogue
+ *
+ * Starts connecting to every profile known to colord. The client must be
+ * connected already. #CcColorProfileCatalogue::profile-added is emitted
+ * as each profile becomes available.
+ */
+void
+cc_color_profile_catalogue_load (CcColorProfileCatalogue *self)
+{
+  g_return_if_fail (CC_IS_COLOR_PROFILE_CATALOGUE (self));
+
+  cd_client_get_profiles (self->client,
+                          self->cancellable,
+                          get_profiles_cb,
+                          self);
+}
+
+/**
+ * cc_color_profile_catalogue_get_profiles:
+ * @catalogue: a #CcColorProfileCatalogue
+ *
+ * Returns: (transfer container): the profiles connected so far
+ */
+GPtrArray *
+cc_color_profile_catalogue_get_profiles (CcColorProfileCatalogue *self)
+{
+  GPtrArray *profiles;
+  GHashTableIter iter;
+  gpointer value;
+
+  g_return_val_if_fail (CC_IS_COLOR_PROFILE_CATALOGUE (self), NULL);
+
+  profiles = g_ptr_array_new_full (g_hash_table_size (self->profiles), g_object_unref);
+
+  g_hash_table_iter_init (&iter, self->profiles);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    g_ptr_array_add (profiles, g_object_ref (value));
+
+  return profiles;
+}
+
+/**
+ * cc_color_profile_catalogue_lookup:
+ * @catalogue: a #CcColorProfileCatalogue
+ * @object_path: the object path of a profile
+ *
+ * Returns: (transfer none) (nullable): the connected profile at @object_path
+ */
+CdProfile *
+cc_color_profile_catalogue_lookup (CcColorProfileCatalogue *self,
+                                   const gchar             *object_path)
+{
+  g_return_val_if_fail (CC_IS_COLOR_PROFILE_CATALOGUE (self), NULL);
+
+  return g_hash_table_lookup (self->profiles, object_path);
+}
+
+/**
+ * cc_color_profile_catalogue_connect_profile:
+ * @catalogue: a #CcColorProfileCatalogue
+ * @profile: a #CdProfile, connected or not
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: the callback to call when the profile is connected
+ * @user_data: data for @callback
+ *
+ * Gets a connected profile for the same object path as @profile, from
+ * the catalogue if it's there already, or by connecting to it.
+ */
+void
+cc_color_profile_catalogue_connect_profile (CcColorProfileCatalogue *self,
+                                            CdProfile               *profile,
+                                            GCancellable            *cancellable,
+                                            GAsyncReadyCallback      callback,
+                                            gpointer                 user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  CdProfile *connected;
+
+  g_return_if_fail (CC_IS_COLOR_PROFILE_CATALOGUE (self));
+  g_return_if_fail (CD_IS_PROFILE (profile));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_color_profile_catalogue_connect_profile);
+
+  connected = g_hash_table_lookup (self->profiles, cd_profile_get_object_path (profile));
+  if (connected != NULL)
+    {
+      g_task_return_pointer (task, g_object_ref (connected), g_object_unref);
+      return;
+    }
+
+  g_ptr_array_add (ensure_connecting (self, profile), g_steal_pointer (&task));
+}
+
+CdProfile *
+cc_color_profile_catalogue_connect_profile_finish (CcColorProfileCatalogue  *self,
+                                                   GAsyncResult             *res,
+                                                   GError                  **error)
+{
+  g_return_val_if_fail (CC_IS_COLOR_PROFILE_CATALOGUE (self), NULL);
+  g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+  g_return_val_if_fail (g_task_get_source_tag (G_TASK (res)) == cc_color_profile_catalogue_connect_profile, NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
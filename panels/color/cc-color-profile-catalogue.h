@@ -0,0 +1,46 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright (C) 2026 The GNOME Settings authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+#include <colord.h>
+
+G_BEGIN_DECLS
+
+#define CC_TYPE_COLOR_PROFILE_CATALOGUE (cc_color_profile_catalogue_get_type ())
+G_DECLARE_FINAL_TYPE (CcColorProfileCatalogue, cc_color_profile_catalogue, CC, COLOR_PROFILE_CATALOGUE, GObject)
+
+CcColorProfileCatalogue *cc_color_profile_catalogue_new                  (CdClient                 *client);
+void                     cc_color_profile_catalogue_load                 (CcColorProfileCatalogue  *catalogue);
+GPtrArray               *cc_color_profile_catalogue_get_profiles         (CcColorProfileCatalogue  *catalogue);
+CdProfile               *cc_color_profile_catalogue_lookup               (CcColorProfileCatalogue  *catalogue,
+                                                                          const gchar              *object_path);
+void                     cc_color_profile_catalogue_connect_profile      (CcColorProfileCatalogue  *catalogue,
+                                                                          CdProfile                *profile,
+                                                                          GCancellable             *cancellable,
+                                                                          GAsyncReadyCallback       callback,
+                                                                          gpointer                  user_data);
+CdProfile               *cc_color_profile_catalogue_connect_profile_finish (CcColorProfileCatalogue  *catalogue,
+                                                                          GAsyncResult             *res,
+                                                                          GError                  **error);
+
+G_END_DECLS
@@ -25,6 +25,7 @@
 
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <gtk/gtk.h>
 
 #include <fontconfig/fontconfig.h>
@@ -33,6 +34,7 @@
 #include <libgnome-desktop/gnome-languages.h>
 
 #include "cc-common-language.h"
+#include "cc-util.h"
 #include "shell/cc-object-storage.h"
 
 static char *get_lang_for_user_object_path (const char *path);
@@ -84,58 +86,216 @@ cc_common_language_get_iter_for_language (GtkTreeModel *model,
   return iter_for_language (model, lang, iter, FALSE);
 }
 
-gboolean
-cc_common_language_has_font (const gchar *locale)
+/*
+ * Rather than listing the fonts for every language asked about, the
+ * languages covered by all the installed fonts are collected once. The
+ * result is kept on disk, along with the modification times of the
+ * fontconfig configuration files, font directories and cache
+ * directories it was computed from.
+ */
+
+#define LANGUAGE_COVERAGE_CACHE_VERSION 1
+#define LANGUAGE_COVERAGE_CACHE_TYPE "(uia(sx)as)"
+
+G_LOCK_DEFINE_STATIC (language_coverage);
+static FcLangSet *language_coverage = NULL;
+
+static gchar *
+get_language_coverage_cache_filename (void)
 {
-        const FcCharSet  *charset;
-        FcPattern        *pattern;
-        FcObjectSet      *object_set;
-        FcFontSet        *font_set;
-        g_autofree gchar *language_code = NULL;
-        gboolean          is_displayable;
+        return g_build_filename (g_get_user_cache_dir (), "gnome-control-center", "language-coverage.cache", NULL);
+}
 
-        is_displayable = FALSE;
-        pattern = NULL;
-        object_set = NULL;
-        font_set = NULL;
+static void
+add_language_coverage_stamps (GVariantBuilder *builder,
+                              FcStrList       *paths)
+{
+        FcChar8 *path;
 
-        if (!gnome_parse_locale (locale, &language_code, NULL, NULL, NULL))
-                return FALSE;
+        if (paths == NULL)
+                return;
 
-        charset = FcLangGetCharSet ((FcChar8 *) language_code);
-        if (!charset) {
-                /* fontconfig does not know about this language */
-                is_displayable = TRUE;
+        while ((path = FcStrListNext (paths)) != NULL) {
+                GStatBuf buf;
+                gint64   mtime = -1;
+
+                if (g_stat ((const gchar *) path, &buf) == 0)
+                        mtime = buf.st_mtime;
+
+                g_variant_builder_add (builder, "(sx)", (const gchar *) path, mtime);
         }
-        else {
-                /* see if any fonts support rendering it */
-                pattern = FcPatternBuild (NULL, FC_LANG, FcTypeString, language_code, NULL);
 
-                if (pattern == NULL)
-                        goto done;
+        FcStrListDone (paths);
+}
 
-                object_set = FcObjectSetCreate ();
+static GVariant *
+get_language_coverage_stamps (void)
+{
+        FcConfig        *config = FcConfigGetCurrent ();
+        GVariantBuilder  builder;
+
+        g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sx)"));
+        add_language_coverage_stamps (&builder, FcConfigGetConfigFiles (config));
+        add_language_coverage_stamps (&builder, FcConfigGetFontDirs (config));
+        add_language_coverage_stamps (&builder, FcConfigGetCacheDirs (config));
+
+        return g_variant_builder_end (&builder);
+}
 
-                if (object_set == NULL)
-                        goto done;
+static FcLangSet *
+load_language_coverage (GVariant *stamps)
+{
+        g_autofree gchar *filename = NULL;
+        g_autoptr(GMappedFile) mapped_file = NULL;
+        g_autoptr(GBytes) bytes = NULL;
+        g_autoptr(GVariant) cache = NULL;
+        g_autoptr(GVariant) cached_stamps = NULL;
+        g_autofree const gchar **languages = NULL;
+        FcLangSet *coverage;
+        guint32 version;
+        gint32 fc_version;
+        guint i;
+
+        filename = get_language_coverage_cache_filename ();
+        mapped_file = g_mapped_file_new (filename, FALSE, NULL);
+        if (mapped_file == NULL)
+                return NULL;
+
+        bytes = g_mapped_file_get_bytes (mapped_file);
+        cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (LANGUAGE_COVERAGE_CACHE_TYPE), bytes, FALSE));
+
+        g_variant_get (cache, "(ui@a(sx)^a&s)", &version, &fc_version, &cached_stamps, &languages);
+        if (version != LANGUAGE_COVERAGE_CACHE_VERSION ||
+            fc_version != FcGetVersion () ||
+            !g_variant_equal (cached_stamps, stamps))
+                return NULL;
+
+        coverage = FcLangSetCreate ();
+        for (i = 0; languages[i] != NULL; i++)
+                FcLangSetAdd (coverage, (const FcChar8 *) languages[i]);
+
+        return coverage;
+}
 
-                font_set = FcFontList (NULL, pattern, object_set);
+static void
+save_language_coverage (FcLangSet *coverage,
+                        GVariant  *stamps)
+{
+        g_autofree gchar *filename = NULL;
+        g_autoptr(GVariant) cache = NULL;
+        g_autoptr(GError) error = NULL;
+        GVariantBuilder languages;
+        FcStrSet *language_set;
+        FcStrList *list;
+        FcChar8 *language;
+
+        g_variant_builder_init (&languages, G_VARIANT_TYPE ("as"));
+
+        language_set = FcLangSetGetLangs (coverage);
+        list = FcStrListCreate (language_set);
+        while ((language = FcStrListNext (list)) != NULL)
+                g_variant_builder_add (&languages, "s", (const gchar *) language);
+        FcStrListDone (list);
+        FcStrSetDestroy (language_set);
+
+        cache = g_variant_ref_sink (g_variant_new ("(ui@a(sx)as)",
+                                                   LANGUAGE_COVERAGE_CACHE_VERSION,
+                                                   FcGetVersion (),
+                                                   stamps,
+                                                   &languages));
+
+        filename = get_language_coverage_cache_filename ();
+
+        if (!cc_util_write_cache_file (filename,
+                                       g_variant_get_data (cache),
+                                       g_variant_get_size (cache),
+                                       &error))
+                g_debug ("Could not write the language coverage cache: %s", error->message);
+}
 
-                if (font_set == NULL)
-                        goto done;
+/* Makes one pass over all the fonts, collecting their languages */
+static FcLangSet *
+compute_language_coverage (void)
+{
+        FcLangSet   *coverage;
+        FcPattern   *pattern;
+        FcObjectSet *object_set;
+        FcFontSet   *font_set;
+        gint         i;
 
-                is_displayable = (font_set->nfont > 0);
+        coverage = FcLangSetCreate ();
+
+        pattern = FcPatternCreate ();
+        object_set = FcObjectSetBuild (FC_LANG, NULL);
+        font_set = FcFontList (NULL, pattern, object_set);
+
+        for (i = 0; font_set != NULL && i < font_set->nfont; i++) {
+                FcLangSet *font_languages;
+                FcLangSet *merged;
+
+                if (FcPatternGetLangSet (font_set->fonts[i], FC_LANG, 0, &font_languages) != FcResultMatch)
+                        continue;
+
+                merged = FcLangSetUnion (coverage, font_languages);
+                if (merged == NULL)
+                        continue;
+
+                FcLangSetDestroy (coverage);
+                coverage = merged;
         }
 
- done:
         if (font_set != NULL)
                 FcFontSetDestroy (font_set);
+        FcObjectSetDestroy (object_set);
+        FcPatternDestroy (pattern);
+
+        return coverage;
+}
+
+/* Called with the lock held */
+static FcLangSet *
+get_language_coverage (void)
+{
+        g_autoptr(GVariant) stamps = NULL;
+
+        if (language_coverage != NULL)
+                return language_coverage;
+
+        stamps = g_variant_ref_sink (get_language_coverage_stamps ());
+
+        language_coverage = load_language_coverage (stamps);
+        if (language_coverage == NULL) {
+                language_coverage = compute_language_coverage ();
+                save_language_coverage (language_coverage, stamps);
+        }
+
+        return language_coverage;
+}
+
+gboolean
+cc_common_language_has_font (const gchar *locale)
+{
+        g_autofree gchar *language_code = NULL;
+        FcLangSet        *language;
+        gboolean          is_displayable;
+
+        if (!gnome_parse_locale (locale, &language_code, NULL, NULL, NULL))
+                return FALSE;
+
+        /* fontconfig does not know about this language */
+        if (!FcLangGetCharSet ((FcChar8 *) language_code))
+                return TRUE;
+
+        /* see if any fonts support rendering it, the same way
+         * listing the fonts for the language would */
+        language = FcLangSetCreate ();
+        FcLangSetAdd (language, (FcChar8 *) language_code);
 
-        if (object_set != NULL)
-                FcObjectSetDestroy (object_set);
+        G_LOCK (language_coverage);
+        is_displayable = FcLangSetContains (get_language_coverage (), language);
+        G_UNLOCK (language_coverage);
 
-        if (pattern != NULL)
-                FcPatternDestroy (pattern);
+        FcLangSetDestroy (language);
 
         return is_displayable;
 }
@@ -0,0 +1,583 @@
+/* cc-search-index.c
+ *
+ * Copyright 2026 The GNOME Settings authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#define G_LOG_DOMAIN "cc-search-index"
+
+#include <string.h>
+
+#include "cc-search-index.h"
+
+/*
+ * The index maps every byte n-gram (up to GRAM_SIZE bytes long) of the
+ * casefolded and unaccented texts of the documents, e.g. the panels, to
+ * the sorted list of documents containing it. Searching for a term
+ * intersects the posting lists of its n-grams, and only the surviving
+ * candidates are checked against the stored texts. Since all texts are
+ * normalized when added, queries only need to normalize the search terms
+ * themselves.
+ */
+
+#define GRAM_SIZE 3
+
+typedef struct
+{
+  gchar  *id;
+  gchar  *name;
+  gchar  *description;
+  GStrv   keywords;
+  GStrv   description_words;
+} Document;
+
+struct _CcSearchIndex
+{
+  GObject     parent;
+
+  GPtrArray  *documents;      /* Document, indexed by document number */
+  GHashTable *id_to_document; /* id -> document number + 1 */
+  GHashTable *grams;          /* gram -> GArray of document numbers */
+};
+
+G_DEFINE_TYPE (CcSearchIndex, cc_search_index, G_TYPE_OBJECT)
+
+static void
+document_free (Document *doc)
+{
+  g_free (doc->id);
+  g_free (doc->name);
+  g_free (doc->description);
+  g_strfreev (doc->keywords);
+  g_strfreev (doc->description_words);
+  g_free (doc);
+}
+
+static void
+add_gram (CcSearchIndex *self,
+          const gchar   *text,
+          gsize          length,
+          guint          doc_number)
+{
+  g_autofree gchar *gram = NULL;
+  GArray *postings;
+
+  gram = g_strndup (text, length);
+  postings = g_hash_table_lookup (self->grams, gram);
+
+  if (!postings)
+    {
+      postings = g_array_new (FALSE, FALSE, sizeof (guint));
+      g_hash_table_insert (self->grams, g_steal_pointer (&gram), postings);
+    }
+
+  /* Documents are added in increasing order, so this keeps the posting
+   * list sorted and free of duplicates.
+   */
+  if (postings->len == 0 || g_array_index (postings, guint, postings->len - 1) != doc_number)
+    g_array_append_val (postings, doc_number);
+}
+
+static void
+index_text (CcSearchIndex *self,
+            const gchar   *text,
+            guint          doc_number)
+{
+  gsize length;
+  gsize i, n;
+
+  if (!text)
+    return;
+
+  length = strlen (text);
+
+  for (i = 0; i < length; i++)
+    {
+      for (n = 1; n <= GRAM_SIZE && i + n <= length; n++)
+        add_gram (self, text + i, n, doc_number);
+    }
+}
+
+static GArray *
+intersect_postings (GArray *a,
+                    GArray *b)
+{
+  GArray *result;
+  guint i, j;
+
+  result = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  i = j = 0;
+  while (i < a->len && j < b->len)
+    {
+      guint a_value = g_array_index (a, guint, i);
+      guint b_value = g_array_index (b, guint, j);
+
+      if (a_value == b_value)
+        {
+          g_array_append_val (result, a_value);
+          i++;
+          j++;
+        }
+      else if (a_value < b_value)
+        {
+          i++;
+        }
+      else
+        {
+          j++;
+        }
+    }
+
+  return result;
+}
+
+/* Returns the documents that may contain @term, or NULL if @term is
+ * empty and therefore matches every document.
+ */
+static GArray *
+get_candidates (CcSearchIndex *self,
+                const gchar   *term)
+{
+  GArray *candidates = NULL;
+  gsize length;
+  gsize i;
+
+  length = strlen (term);
+  if (length == 0)
+    return NULL;
+
+  for (i = 0; i + MIN (length, GRAM_SIZE) <= length; i++)
+    {
+      g_autofree gchar *gram = NULL;
+      GArray *postings;
+      GArray *intersection;
+
+      gram = g_strndup (term + i, MIN (length, GRAM_SIZE));
+      postings = g_hash_table_lookup (self->grams, gram);
+
+      if (!postings)
+        {
+          g_clear_pointer (&candidates, g_array_unref);
+          return g_array_new (FALSE, FALSE, sizeof (guint));
+        }
+
+      if (!candidates)
+        {
+          candidates = g_array_copy (postings);
+          continue;
+        }
+
+      intersection = intersect_postings (candidates, postings);
+      g_array_unref (candidates);
+      candidates = intersection;
+
+      if (candidates->len == 0)
+        break;
+    }
+
+  return candidates;
+}
+
+static gboolean
+document_matches (Document    *doc,
+                  const gchar *term)
+{
+  guint i;
+
+  if (strstr (doc->name, term) != NULL)
+    return TRUE;
+
+  if (doc->description && strstr (doc->description, term) != NULL)
+    return TRUE;
+
+  for (i = 0; doc->keywords[i]; i++)
+    {
+      if (g_str_has_prefix (doc->keywords[i], term))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gint
+count_matches (GStrv                words,
+               const gchar * const *terms)
+{
+  gint i, j, c;
+
+  c = 0;
+
+  for (i = 0; terms[i]; i++)
+    for (j = 0; words[j]; j++)
+      if (strstr (words[j], terms[i]))
+        c += 1;
+
+  return c;
+}
+
+/* The sort keys of a matching document, computed once per search so that
+ * sorting doesn't need to match the terms again on every comparison.
+ */
+typedef struct
+{
+  Document *doc;
+  gint      keyword_matches;
+  gint      description_matches;
+  gsize     n_terms;
+  gssize    name_distances[];
+} RankedDocument;
+
+static RankedDocument *
+ranked_document_new (Document            *doc,
+                     const gchar * const *terms,
+                     gsize                n_terms)
+{
+  RankedDocument *ranked;
+  gsize i;
+
+  ranked = g_malloc (sizeof (RankedDocument) + n_terms * sizeof (gssize));
+  ranked->doc = doc;
+  ranked->n_terms = n_terms;
+  ranked->keyword_matches = count_matches (doc->keywords, terms);
+  ranked->description_matches = count_matches (doc->description_words, terms);
+
+  for (i = 0; i < n_terms; i++)
+    {
+      const gchar *match = strstr (doc->name, terms[i]);
+
+      ranked->name_distances[i] = match ? match - doc->name : G_MAXSSIZE;
+    }
+
+  return ranked;
+}
+
+/* Ranks documents matching the name first, earlier matches first, then
+ * by the number of matching keywords and description words, and finally
+ * alphabetically.
+ */
+static gint
+compare_ranked_documents (gconstpointer a,
+                          gconstpointer b)
+{
+  RankedDocument *a_ranked = *((RankedDocument **) a);
+  RankedDocument *b_ranked = *((RankedDocument **) b);
+  gsize i;
+
+  for (i = 0; i < a_ranked->n_terms; i++)
+    {
+      gssize a_distance = a_ranked->name_distances[i];
+      gssize b_distance = b_ranked->name_distances[i];
+
+      if (a_distance != b_distance)
+        return a_distance < b_distance ? -1 : 1;
+    }
+
+  if (a_ranked->keyword_matches != b_ranked->keyword_matches)
+    return b_ranked->keyword_matches - a_ranked->keyword_matches;
+
+  if (a_ranked->description_matches != b_ranked->description_matches)
+    return b_ranked->description_matches - a_ranked->description_matches;
+
+  return g_strcmp0 (a_ranked->doc->name, b_ranked->doc->name);
+}
+
+/* Empty terms match everything, and would only skew the ranking */
+static GPtrArray *
+get_non_empty_terms (const gchar * const *terms)
+{
+  GPtrArray *non_empty_terms;
+  guint i;
+
+  non_empty_terms = g_ptr_array_new ();
+  for (i = 0; terms[i]; i++)
+    {
+      if (*terms[i] != '\0')
+        g_ptr_array_add (non_empty_terms, (gpointer) terms[i]);
+    }
+  g_ptr_array_add (non_empty_terms, NULL);
+
+  return non_empty_terms;
+}
+
+static gboolean
+document_matches_all (Document  *doc,
+                      GPtrArray *terms)
+{
+  guint i;
+
+  for (i = 0; i < terms->len - 1; i++)
+    {
+      if (!document_matches (doc, g_ptr_array_index (terms, i)))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Consumes @ranked, and returns the ids of the documents in order */
+static GPtrArray *
+sort_results (GPtrArray *ranked)
+{
+  GPtrArray *results;
+  guint i;
+
+  g_ptr_array_sort (ranked, compare_ranked_documents);
+
+  results = g_ptr_array_sized_new (ranked->len);
+  for (i = 0; i < ranked->len; i++)
+    g_ptr_array_add (results, ((RankedDocument *) g_ptr_array_index (ranked, i))->doc->id);
+
+  g_ptr_array_unref (ranked);
+
+  return results;
+}
+
+static void
+cc_search_index_finalize (GObject *object)
+{
+  CcSearchIndex *self = (CcSearchIndex *)object;
+
+  g_clear_pointer (&self->documents, g_ptr_array_unref);
+  g_clear_pointer (&self->id_to_document, g_hash_table_destroy);
+  g_clear_pointer (&self->grams, g_hash_table_destroy);
+
+  G_OBJECT_CLASS (cc_search_index_parent_class)->finalize (object);
+}
+
+static void
+cc_search_index_class_init (CcSearchIndexClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_search_index_finalize;
+}
+
+static void
+cc_search_index_init (CcSearchIndex *self)
+{
+  self->documents = g_ptr_array_new_with_free_func ((GDestroyNotify) document_free);
+  self->id_to_document = g_hash_table_new (g_str_hash, g_str_equal);
+  self->grams = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_array_unref);
+}
+
+CcSearchIndex *
+cc_search_index_new (void)
+{
+  return g_object_new (CC_TYPE_SEARCH_INDEX, NULL);
+}
+
+/**
+ * cc_search_index_add:
+ * @self: a #CcSearchIndex
+ * @id: the document id
+ * @casefolded_name: the normalized name
+ * @casefolded_description: (nullable): the normalized description
+ * @casefolded_keywords: (nullable): the normalized keywords
+ *
+ * Adds a document, e.g. a panel, to the index. The texts must have been
+ * normalized with cc_util_normalize_casefold_and_unaccent().
+ */
+void
+cc_search_index_add (CcSearchIndex       *self,
+                     const gchar         *id,
+                     const gchar         *casefolded_name,
+                     const gchar         *casefolded_description,
+                     const gchar * const *casefolded_keywords)
+{
+  Document *doc;
+  guint doc_number;
+  guint i;
+
+  g_return_if_fail (CC_IS_SEARCH_INDEX (self));
+  g_return_if_fail (id != NULL);
+
+  if (g_hash_table_contains (self->id_to_document, id))
+    {
+      g_warning ("Document %s is already indexed", id);
+      return;
+    }
+
+  doc = g_new0 (Document, 1);
+  doc->id = g_strdup (id);
+  doc->name = g_strstrip (g_strdup (casefolded_name ? casefolded_name : ""));
+  doc->description = casefolded_description ? g_strstrip (g_strdup (casefolded_description)) : NULL;
+  doc->keywords = casefolded_keywords ? g_strdupv ((GStrv) casefolded_keywords) : g_new0 (gchar *, 1);
+  doc->description_words = doc->description ? g_strsplit (doc->description, " ", -1) : g_new0 (gchar *, 1);
+
+  doc_number = self->documents->len;
+  g_ptr_array_add (self->documents, doc);
+  g_hash_table_insert (self->id_to_document, doc->id, GUINT_TO_POINTER (doc_number + 1));
+
+  index_text (self, doc->name, doc_number);
+  index_text (self, doc->description, doc_number);
+  for (i = 0; doc->keywords[i]; i++)
+    index_text (self, doc->keywords[i], doc_number);
+}
+
+/**
+ * cc_search_index_matches:
+ * @self: a #CcSearchIndex
+ * @id: the document id
+ * @term: a normalized search term
+ *
+ * Checks whether @term is contained in the name or the description of
+ * the document, or is a prefix of one of its keywords.
+ *
+ * Returns: whether the document matches @term
+ */
+gboolean
+cc_search_index_matches (CcSearchIndex *self,
+                         const gchar   *id,
+                         const gchar   *term)
+{
+  gpointer doc_number;
+
+  g_return_val_if_fail (CC_IS_SEARCH_INDEX (self), FALSE);
+  g_return_val_if_fail (term != NULL, FALSE);
+
+  doc_number = g_hash_table_lookup (self->id_to_document, id);
+  if (!doc_number)
+    return FALSE;
+
+  return document_matches (g_ptr_array_index (self->documents, GPOINTER_TO_UINT (doc_number) - 1), term);
+}
+
+/**
+ * cc_search_index_search:
+ * @self: a #CcSearchIndex
+ * @terms: a %NULL-terminated array of normalized search terms
+ *
+ * Finds the documents matching all of @terms, as cc_search_index_matches()
+ * does, sorted by relevance.
+ *
+ * Returns: (transfer container): the ids of the matching documents. The
+ * strings are owned by @self.
+ */
+GPtrArray *
+cc_search_index_search (CcSearchIndex       *self,
+                        const gchar * const *terms)
+{
+  g_autoptr(GPtrArray) non_empty_terms = NULL;
+  g_autoptr(GArray) candidates = NULL;
+  const gchar * const *search_terms;
+  GPtrArray *ranked;
+  gsize n_terms;
+  guint i;
+
+  g_return_val_if_fail (CC_IS_SEARCH_INDEX (self), NULL);
+  g_return_val_if_fail (terms != NULL, NULL);
+
+  non_empty_terms = get_non_empty_terms (terms);
+  search_terms = (const gchar * const *) non_empty_terms->pdata;
+  n_terms = non_empty_terms->len - 1;
+
+  for (i = 0; i < n_terms; i++)
+    {
+      g_autoptr(GArray) term_candidates = NULL;
+
+      term_candidates = get_candidates (self, search_terms[i]);
+
+      if (!candidates)
+        {
+          candidates = g_steal_pointer (&term_candidates);
+        }
+      else
+        {
+          GArray *intersection = intersect_postings (candidates, term_candidates);
+
+          g_array_unref (candidates);
+          candidates = intersection;
+        }
+
+      if (candidates->len == 0)
+        break;
+    }
+
+  ranked = g_ptr_array_new_with_free_func (g_free);
+
+  if (!candidates)
+    {
+      for (i = 0; i < self->documents->len; i++)
+        g_ptr_array_add (ranked, ranked_document_new (g_ptr_array_index (self->documents, i), search_terms, n_terms));
+    }
+  else
+    {
+      for (i = 0; i < candidates->len; i++)
+        {
+          Document *doc = g_ptr_array_index (self->documents, g_array_index (candidates, guint, i));
+
+          if (document_matches_all (doc, non_empty_terms))
+            g_ptr_array_add (ranked, ranked_document_new (doc, search_terms, n_terms));
+        }
+    }
+
+  return sort_results (ranked);
+}
+
+/**
+ * cc_search_index_search_within:
+ * @self: a #CcSearchIndex
+ * @ids: a %NULL-terminated array of document ids
+ * @terms: a %NULL-terminated array of normalized search terms
+ *
+ * Like cc_search_index_search(), but only considers the documents in @ids.
+ * This is meant to refine the results of a previous search when the
+ * search terms are extended, in which case only the previous results
+ * can match.
+ *
+ * Returns: (transfer container): the ids of the matching documents. The
+ * strings are owned by @self.
+ */
+GPtrArray *
+cc_search_index_search_within (CcSearchIndex       *self,
+                               const gchar * const *ids,
+                               const gchar * const *terms)
+{
+  g_autoptr(GPtrArray) non_empty_terms = NULL;
+  const gchar * const *search_terms;
+  GPtrArray *ranked;
+  gsize n_terms;
+  guint i;
+
+  g_return_val_if_fail (CC_IS_SEARCH_INDEX (self), NULL);
+  g_return_val_if_fail (ids != NULL, NULL);
+  g_return_val_if_fail (terms != NULL, NULL);
+
+  non_empty_terms = get_non_empty_terms (terms);
+  search_terms = (const gchar * const *) non_empty_terms->pdata;
+  n_terms = non_empty_terms->len - 1;
+
+  ranked = g_ptr_array_new_with_free_func (g_free);
+
+  for (i = 0; ids[i]; i++)
+    {
+      gpointer doc_number;
+      Document *doc;
+
+      doc_number = g_hash_table_lookup (self->id_to_document, ids[i]);
+      if (!doc_number)
+        continue;
+
+      doc = g_ptr_array_index (self->documents, GPOINTER_TO_UINT (doc_number) - 1);
+
+      if (document_matches_all (doc, non_empty_terms))
+        g_ptr_array_add (ranked, ranked_document_new (doc, search_terms, n_terms));
+    }
+
+  return sort_results (ranked);
+}
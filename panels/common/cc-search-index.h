@@ -0,0 +1,49 @@
+/* cc-search-index.h
+ *
+ * Copyright 2026 The GNOME Settings authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define CC_TYPE_SEARCH_INDEX (cc_search_index_get_type())
+G_DECLARE_FINAL_TYPE (CcSearchIndex, cc_search_index, CC, SEARCH_INDEX, GObject)
+
+CcSearchIndex *cc_search_index_new           (void);
+
+void           cc_search_index_add           (CcSearchIndex       *self,
+                                              const gchar         *id,
+                                              const gchar         *casefolded_name,
+                                              const gchar         *casefolded_description,
+                                              const gchar * const *casefolded_keywords);
+
+gboolean       cc_search_index_matches       (CcSearchIndex       *self,
+                                              const gchar         *id,
+                                              const gchar         *term);
+
+GPtrArray     *cc_search_index_search        (CcSearchIndex       *self,
+                                              const gchar * const *terms);
+
+GPtrArray     *cc_search_index_search_within (CcSearchIndex       *self,
+                                              const gchar * const *ids,
+                                              const gchar * const *terms);
+
+G_END_DECLS
@@ -212,6 +212,39 @@ cc_util_time_to_string_text (gint64 msecs)
     }
 }
 
+/**
+ * cc_util_write_cache_file:
+ * @filename: path of the cache file
+ * @contents: the data to write
+ * @length: length of @contents
+ * @error: return location for a #GError
+ *
+ * Atomically replaces @filename with @contents, creating its parent
+ * directories if needed. Meant for caches in the user cache directory.
+ *
+ * Returns: %TRUE on success
+ */
+gboolean
+cc_util_write_cache_file (const char  *filename,
+                          const void  *contents,
+                          gsize        length,
+                          GError     **error)
+{
+  g_autofree gchar *dirname = NULL;
+
+  dirname = g_path_get_dirname (filename);
+  if (g_mkdir_with_parents (dirname, 0700) != 0)
+    {
+      int saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to create %s: %s", dirname, g_strerror (saved_errno));
+      return FALSE;
+    }
+
+  return g_file_set_contents (filename, contents, length, error);
+}
+
 // Endless specific utility functions
 
 #define EOS_IMAGE_VERSION_XATTR "user.eos-image-version"
@@ -51,6 +51,7 @@ struct _CcTimezoneMap
   GdkTexture *pin;
 
   TzDB *tzdb;
+  TzIndex *tz_index;
   TzLocation *location;
 
   gchar *bubble_text;
@@ -96,6 +97,7 @@ cc_timezone_map_finalize (GObject *object)
 {
   CcTimezoneMap *self = CC_TIMEZONE_MAP (object);
 
+  g_clear_pointer (&self->tz_index, tz_index_free);
   g_clear_pointer (&self->tzdb, tz_db_free);
 
   G_OBJECT_CLASS (cc_timezone_map_parent_class)->finalize (object);
@@ -190,6 +192,16 @@ convert_latitude_to_y (gdouble latitude, gdouble map_height)
   return y;
 }
 
+static void
+project_location (TzLocation *location,
+                  gdouble    *x,
+                  gdouble    *y)
+{
+  /* Both conversions scale linearly with the size of the map */
+  *x = convert_longitude_to_x (location->longitude, 1);
+  *y = convert_latitude_to_y (location->latitude, 1.0);
+}
+
 static void
 draw_text_bubble (CcTimezoneMap *map,
                   GtkSnapshot   *snapshot,
@@ -366,29 +378,12 @@ cc_timezone_map_class_init (CcTimezoneMapClass *klass)
 }
 
 
-static gint
-sort_locations (TzLocation *a,
-                TzLocation *b)
-{
-  if (a->dist > b->dist)
-    return 1;
-
-  if (a->dist < b->dist)
-    return -1;
-
-  return 0;
-}
-
 static void
 set_location (CcTimezoneMap *map,
               TzLocation    *location)
 {
-  g_autoptr(TzInfo) info = NULL;
-
   map->location = location;
 
-  info = tz_info_from_location (map->location);
-
   gtk_widget_queue_draw (GTK_WIDGET (map));
 
   g_signal_emit (map, signals[LOCATION_CHANGED], 0, map->location);
@@ -401,39 +396,20 @@ map_clicked_cb (GtkGestureClick *self,
                 gdouble          y,
                 CcTimezoneMap   *map)
 {
-  const GPtrArray *array;
+  TzLocation *location;
   gint width, height;
-  GList *distances = NULL;
-  gint i;
-
-  /* work out the coordinates */
 
-  array = tz_get_locations (map->tzdb);
+  if (!map->tz_index)
+    return FALSE;
 
   width = gtk_widget_get_width (GTK_WIDGET (map));
   height = gtk_widget_get_height (GTK_WIDGET (map));
 
-  for (i = 0; i < array->len; i++)
-    {
-      gdouble pointx, pointy, dx, dy;
-      TzLocation *loc = array->pdata[i];
-
-      pointx = convert_longitude_to_x (loc->longitude, width);
-      pointy = convert_latitude_to_y (loc->latitude, height);
-
-      dx = pointx - x;
-      dy = pointy - y;
-
-      loc->dist = dx * dx + dy * dy;
-      distances = g_list_prepend (distances, loc);
-
-    }
-  distances = g_list_sort (distances, (GCompareFunc) sort_locations);
-
-
-  set_location (map, (TzLocation*) distances->data);
+  location = tz_index_get_nearest (map->tz_index, x, y, width, height);
+  if (!location)
+    return FALSE;
 
-  g_list_free (distances);
+  set_location (map, location);
 
   return TRUE;
 }
@@ -469,6 +445,8 @@ cc_timezone_map_init (CcTimezoneMap *map)
     }
 
   map->tzdb = tz_load_db ();
+  if (map->tzdb)
+    map->tz_index = tz_index_new (tz_get_locations (map->tzdb), project_location);
 
   click_gesture = gtk_gesture_click_new ();
   g_signal_connect (click_gesture, "pressed", G_CALLBACK (map_clicked_cb), map);
@@ -23,6 +23,7 @@
 
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
@@ -32,6 +33,7 @@
 #include <ctype.h>
 #include "tz.h"
 #include "cc-datetime-resources.h"
+#include "cc-util.h"
 
 
 /* Forward declarations for private functions */
@@ -41,6 +43,9 @@ static int compare_country_names (const void *a, const void *b);
 static void sort_locations_by_country (GPtrArray *locations);
 static gchar * tz_data_file_get (void);
 static void load_backward_tz (TzDB *tz_db);
+static GPtrArray *load_locations (const gchar *tz_data_file);
+static GPtrArray *load_locations_from_cache (const gchar *tz_data_file);
+static void save_locations_cache (const gchar *tz_data_file, GPtrArray *locations);
 
 /* ---------------- *
  * Public interface *
@@ -49,78 +54,27 @@ TzDB *
 tz_load_db (void)
 {
 	g_autofree gchar *tz_data_file = NULL;
+	GPtrArray *locations;
 	TzDB *tz_db;
-	FILE *tzfile;
-	char buf[4096];
 
 	tz_data_file = tz_data_file_get ();
 	if (!tz_data_file) {
 		g_warning ("Could not get the TimeZone data file name");
 		return NULL;
 	}
-	tzfile = fopen (tz_data_file, "r");
-	if (!tzfile) {
-		g_warning ("Could not open *%s*\n", tz_data_file);
-		return NULL;
-	}
-
-	tz_db = g_new0 (TzDB, 1);
-	tz_db->locations = g_ptr_array_new ();
-
-	while (fgets (buf, sizeof(buf), tzfile))
-	{
-		g_auto(GStrv) tmpstrarr = NULL;
-		g_autofree gchar *latstr = NULL;
-		g_autofree gchar *lngstr = NULL;
-		gchar *p;
-		TzLocation *loc;
-
-		if (*buf == '#') continue;
-
-		g_strchomp(buf);
-		tmpstrarr = g_strsplit(buf,"\t", 6);
-		
-		latstr = g_strdup (tmpstrarr[1]);
-		p = latstr + 1;
-		while (*p != '-' && *p != '+') p++;
-		lngstr = g_strdup (p);
-		*p = '\0';
-		
-		loc = g_new0 (TzLocation, 1);
-		loc->country = g_strdup (tmpstrarr[0]);
-		loc->zone = g_strdup (tmpstrarr[2]);
-		loc->latitude  = convert_pos (latstr, 2);
-		loc->longitude = convert_pos (lngstr, 3);
-		
-#ifdef __sun
-		if (tmpstrarr[3] && *tmpstrarr[3] == '-' && tmpstrarr[4])
-			loc->comment = g_strdup (tmpstrarr[4]);
 
-		if (tmpstrarr[3] && *tmpstrarr[3] != '-' && !islower(loc->zone)) {
-			TzLocation *locgrp;
+	locations = load_locations_from_cache (tz_data_file);
+	if (!locations) {
+		locations = load_locations (tz_data_file);
+		if (!locations)
+			return NULL;
 
-			/* duplicate entry */
-			locgrp = g_new0 (TzLocation, 1);
-			locgrp->country = g_strdup (tmpstrarr[0]);
-			locgrp->zone = g_strdup (tmpstrarr[3]);
-			locgrp->latitude  = convert_pos (latstr, 2);
-			locgrp->longitude = convert_pos (lngstr, 3);
-			locgrp->comment = (tmpstrarr[4]) ? g_strdup (tmpstrarr[4]) : NULL;
+		save_locations_cache (tz_data_file, locations);
+	}
 
-			g_ptr_array_add (tz_db->locations, (gpointer) locgrp);
-		}
-#else
-		loc->comment = (tmpstrarr[3]) ? g_strdup(tmpstrarr[3]) : NULL;
-#endif
+	tz_db = g_new0 (TzDB, 1);
+	tz_db->locations = locations;
 
-		g_ptr_array_add (tz_db->locations, (gpointer) loc);
-	}
-	
-	fclose (tzfile);
-	
-	/* now sort by country */
-	sort_locations_by_country (tz_db->locations);
-	
 	/* Load up the hashtable of backward links */
 	load_backward_tz (tz_db);
 
@@ -227,39 +181,62 @@ tz_location_get_base_utc_offset (TzLocation *loc)
 TzInfo *
 tz_info_from_location (TzLocation *loc)
 {
+	return tz_info_from_location_at (loc, g_get_real_time () / G_USEC_PER_SEC);
+}
+
+/* The parsed zoneinfo files, by zone name. GTimeZone reads TZif files
+ * itself and is immutable, so the zones can be shared by every thread. */
+G_LOCK_DEFINE_STATIC (time_zones);
+static GHashTable *time_zones = NULL;
+
+static GTimeZone *
+get_time_zone (const gchar *zone)
+{
+	GTimeZone *tz;
+
+	G_LOCK (time_zones);
+
+	if (!time_zones)
+		time_zones = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, (GDestroyNotify) g_time_zone_unref);
+
+	tz = g_hash_table_lookup (time_zones, zone);
+	if (!tz) {
+		tz = g_time_zone_new_identifier (zone);
+		/* Unknown zones behave like UTC, as with TZ */
+		if (!tz)
+			tz = g_time_zone_new_utc ();
+
+		g_hash_table_insert (time_zones, g_strdup (zone), tz);
+	}
+
+	g_time_zone_ref (tz);
+
+	G_UNLOCK (time_zones);
+
+	return tz;
+}
+
+/* Returns the offset, abbreviation and daylight saving time of @loc at
+ * @when, in seconds since the Epoch. Unlike localtime(), this does not
+ * touch the process environment, so it can be used from any thread. */
+TzInfo *
+tz_info_from_location_at (TzLocation *loc, gint64 when)
+{
+	g_autoptr(GTimeZone) tz = NULL;
 	TzInfo *tzinfo;
-	time_t curtime;
-	struct tm *curzone;
-	g_autofree gchar *tz_env_value = NULL;
-	
+	gint interval;
+
 	g_return_val_if_fail (loc != NULL, NULL);
 	g_return_val_if_fail (loc->zone != NULL, NULL);
-	
-	tz_env_value = g_strdup (getenv ("TZ"));
-	setenv ("TZ", loc->zone, 1);
-	
-#if 0
-	tzset ();
-#endif
-	tzinfo = g_new0 (TzInfo, 1);
 
-	curtime = time (NULL);
-	curzone = localtime (&curtime);
+	tz = get_time_zone (loc->zone);
+	interval = g_time_zone_find_interval (tz, G_TIME_TYPE_UNIVERSAL, when);
 
-#ifndef __sun
-	tzinfo->tzname = g_strdup (curzone->tm_zone);
-	tzinfo->utc_offset = curzone->tm_gmtoff;
-#else
-	tzinfo->tzname = NULL;
-	tzinfo->utc_offset = 0;
-#endif
-
-	tzinfo->daylight = curzone->tm_isdst;
-
-	if (tz_env_value)
-		setenv ("TZ", tz_env_value, 1);
-	else
-		unsetenv ("TZ");
+	tzinfo = g_new0 (TzInfo, 1);
+	tzinfo->tzname = g_strdup (g_time_zone_get_abbreviation (tz, interval));
+	tzinfo->utc_offset = g_time_zone_get_offset (tz, interval);
+	tzinfo->daylight = g_time_zone_is_dst (tz, interval);
 
 	return tzinfo;
 }
@@ -364,6 +341,146 @@ tz_info_get_clean_name (TzDB *tz_db,
 	return g_strdup (ret);
 }
 
+/* The index is a k-d tree stored in an array: every subarray holds its
+ * median point in the middle, splitting the rest alternately along the x
+ * and the y axis. */
+typedef struct
+{
+	gdouble x;
+	gdouble y;
+	TzLocation *location;
+} TzIndexNode;
+
+struct _TzIndex
+{
+	TzIndexNode *nodes;
+	guint n_nodes;
+};
+
+static int
+compare_nodes_x (const void *a, const void *b)
+{
+	const TzIndexNode *na = a;
+	const TzIndexNode *nb = b;
+
+	return (na->x > nb->x) - (na->x < nb->x);
+}
+
+static int
+compare_nodes_y (const void *a, const void *b)
+{
+	const TzIndexNode *na = a;
+	const TzIndexNode *nb = b;
+
+	return (na->y > nb->y) - (na->y < nb->y);
+}
+
+static void
+tz_index_build (TzIndexNode *nodes, guint n_nodes, guint depth)
+{
+	guint mid;
+
+	if (n_nodes <= 1)
+		return;
+
+	qsort (nodes, n_nodes, sizeof (TzIndexNode),
+	       depth % 2 == 0 ? compare_nodes_x : compare_nodes_y);
+
+	mid = n_nodes / 2;
+	tz_index_build (nodes, mid, depth + 1);
+	tz_index_build (nodes + mid + 1, n_nodes - mid - 1, depth + 1);
+}
+
+TzIndex *
+tz_index_new (GPtrArray *locations, TzProjectionFunc project)
+{
+	TzIndex *index;
+	guint i;
+
+	index = g_new0 (TzIndex, 1);
+	index->n_nodes = locations->len;
+	index->nodes = g_new (TzIndexNode, locations->len);
+
+	for (i = 0; i < locations->len; i++) {
+		TzLocation *loc = locations->pdata[i];
+
+		index->nodes[i].location = loc;
+		project (loc, &index->nodes[i].x, &index->nodes[i].y);
+	}
+
+	tz_index_build (index->nodes, index->n_nodes, 0);
+
+	return index;
+}
+
+void
+tz_index_free (TzIndex *index)
+{
+	g_free (index->nodes);
+	g_free (index);
+}
+
+static void
+tz_index_search (const TzIndexNode *nodes, guint n_nodes, guint depth,
+		 gdouble x, gdouble y, gdouble width, gdouble height,
+		 const TzIndexNode **best, gdouble *best_dist)
+{
+	const TzIndexNode *node;
+	gdouble dx, dy, dist, split;
+	guint mid;
+
+	if (n_nodes == 0)
+		return;
+
+	mid = n_nodes / 2;
+	node = &nodes[mid];
+
+	dx = (node->x - x) * width;
+	dy = (node->y - y) * height;
+	dist = dx * dx + dy * dy;
+
+	if (dist < *best_dist) {
+		*best = node;
+		*best_dist = dist;
+	}
+
+	/* Search the side of the split the point is on first, and the
+	 * other one only if it can hold a closer location */
+	split = depth % 2 == 0 ? dx : dy;
+
+	if (split > 0) {
+		tz_index_search (nodes, mid, depth + 1, x, y, width, height, best, best_dist);
+		if (split * split < *best_dist)
+			tz_index_search (node + 1, n_nodes - mid - 1, depth + 1, x, y, width, height, best, best_dist);
+	} else {
+		tz_index_search (node + 1, n_nodes - mid - 1, depth + 1, x, y, width, height, best, best_dist);
+		if (split * split < *best_dist)
+			tz_index_search (nodes, mid, depth + 1, x, y, width, height, best, best_dist);
+	}
+}
+
+/* Returns the location closest to the point (@x, @y) of a map of size
+ * @width x @height, on which the projection function of @index maps
+ * locations to the unit square. */
+TzLocation *
+tz_index_get_nearest (TzIndex *index, gdouble x, gdouble y,
+		      gdouble width, gdouble height)
+{
+	const TzIndexNode *best = NULL;
+	gdouble best_dist = G_MAXDOUBLE;
+
+	g_return_val_if_fail (index != NULL, NULL);
+
+	if (width <= 0 || height <= 0)
+		return NULL;
+
+	tz_index_search (index->nodes, index->n_nodes, 0,
+			 x / width, y / height, width, height,
+			 &best, &best_dist);
+
+	return best ? best->location : NULL;
+}
+
 /* ----------------- *
  * Private functions *
  * ----------------- */
@@ -378,6 +495,180 @@ tz_data_file_get (void)
 	return file;
 }
 
+static GPtrArray *
+load_locations (const gchar *tz_data_file)
+{
+	GPtrArray *locations;
+	FILE *tzfile;
+	char buf[4096];
+
+	tzfile = fopen (tz_data_file, "r");
+	if (!tzfile) {
+		g_warning ("Could not open *%s*\n", tz_data_file);
+		return NULL;
+	}
+
+	locations = g_ptr_array_new ();
+
+	while (fgets (buf, sizeof(buf), tzfile))
+	{
+		g_auto(GStrv) tmpstrarr = NULL;
+		g_autofree gchar *latstr = NULL;
+		g_autofree gchar *lngstr = NULL;
+		gchar *p;
+		TzLocation *loc;
+
+		if (*buf == '#') continue;
+
+		g_strchomp(buf);
+		tmpstrarr = g_strsplit(buf,"\t", 6);
+		
+		latstr = g_strdup (tmpstrarr[1]);
+		p = latstr + 1;
+		while (*p != '-' && *p != '+') p++;
+		lngstr = g_strdup (p);
+		*p = '\0';
+		
+		loc = g_new0 (TzLocation, 1);
+		loc->country = g_strdup (tmpstrarr[0]);
+		loc->zone = g_strdup (tmpstrarr[2]);
+		loc->latitude  = convert_pos (latstr, 2);
+		loc->longitude = convert_pos (lngstr, 3);
+		
+#ifdef __sun
+		if (tmpstrarr[3] && *tmpstrarr[3] == '-' && tmpstrarr[4])
+			loc->comment = g_strdup (tmpstrarr[4]);
+
+		if (tmpstrarr[3] && *tmpstrarr[3] != '-' && !islower(loc->zone)) {
+			TzLocation *locgrp;
+
+			/* duplicate entry */
+			locgrp = g_new0 (TzLocation, 1);
+			locgrp->country = g_strdup (tmpstrarr[0]);
+			locgrp->zone = g_strdup (tmpstrarr[3]);
+			locgrp->latitude  = convert_pos (latstr, 2);
+			locgrp->longitude = convert_pos (lngstr, 3);
+			locgrp->comment = (tmpstrarr[4]) ? g_strdup (tmpstrarr[4]) : NULL;
+
+			g_ptr_array_add (locations, (gpointer) locgrp);
+		}
+#else
+		loc->comment = (tmpstrarr[3]) ? g_strdup(tmpstrarr[3]) : NULL;
+#endif
+
+		g_ptr_array_add (locations, (gpointer) loc);
+	}
+	
+	fclose (tzfile);
+	
+	/* now sort by country */
+	sort_locations_by_country (locations);
+
+	return locations;
+}
+
+/* The parsed and sorted zone.tab is kept in the user's cache directory
+ * and used as long as zone.tab keeps the same modification time and
+ * size. */
+#define TZ_CACHE_VERSION 1
+#define TZ_CACHE_TYPE "(uxta(sddsms))"
+
+static gchar *
+tz_cache_file_get (void)
+{
+	return g_build_filename (g_get_user_cache_dir (), "gnome-control-center", "timezones.cache", NULL);
+}
+
+static GPtrArray *
+load_locations_from_cache (const gchar *tz_data_file)
+{
+	g_autofree gchar *cache_file = NULL;
+	g_autoptr(GMappedFile) mapped_file = NULL;
+	g_autoptr(GBytes) bytes = NULL;
+	g_autoptr(GVariant) cache = NULL;
+	g_autoptr(GVariant) entries = NULL;
+	GPtrArray *locations;
+	GStatBuf buf;
+	guint32 version;
+	gint64 mtime;
+	guint64 size;
+	gsize n_entries, i;
+
+	if (g_stat (tz_data_file, &buf) != 0)
+		return NULL;
+
+	cache_file = tz_cache_file_get ();
+	mapped_file = g_mapped_file_new (cache_file, FALSE, NULL);
+	if (!mapped_file)
+		return NULL;
+
+	bytes = g_mapped_file_get_bytes (mapped_file);
+	cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (TZ_CACHE_TYPE), bytes, FALSE));
+
+	g_variant_get (cache, "(uxt@a(sddsms))", &version, &mtime, &size, &entries);
+	if (version != TZ_CACHE_VERSION || mtime != buf.st_mtime || size != (guint64) buf.st_size)
+		return NULL;
+
+	n_entries = g_variant_n_children (entries);
+	locations = g_ptr_array_sized_new (n_entries);
+
+	for (i = 0; i < n_entries; i++) {
+		TzLocation *loc;
+
+		loc = g_new0 (TzLocation, 1);
+		g_variant_get_child (entries, i, "(sddsms)",
+				     &loc->country,
+				     &loc->latitude,
+				     &loc->longitude,
+				     &loc->zone,
+				     &loc->comment);
+
+		g_ptr_array_add (locations, loc);
+	}
+
+	return locations;
+}
+
+static void
+save_locations_cache (const gchar *tz_data_file, GPtrArray *locations)
+{
+	g_autofree gchar *cache_file = NULL;
+	g_autoptr(GVariant) cache = NULL;
+	g_autoptr(GError) error = NULL;
+	GVariantBuilder builder;
+	GStatBuf buf;
+	guint i;
+
+	if (g_stat (tz_data_file, &buf) != 0)
+		return;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sddsms)"));
+	for (i = 0; i < locations->len; i++) {
+		TzLocation *loc = locations->pdata[i];
+
+		g_variant_builder_add (&builder, "(sddsms)",
+				       loc->country,
+				       loc->latitude,
+				       loc->longitude,
+				       loc->zone,
+				       loc->comment);
+	}
+
+	cache = g_variant_ref_sink (g_variant_new ("(uxt@a(sddsms))",
+						   TZ_CACHE_VERSION,
+						   (gint64) buf.st_mtime,
+						   (guint64) buf.st_size,
+						   g_variant_builder_end (&builder)));
+
+	cache_file = tz_cache_file_get ();
+
+	if (!cc_util_write_cache_file (cache_file,
+				       g_variant_get_data (cache),
+				       g_variant_get_size (cache),
+				       &error))
+		g_debug ("Could not write the timezone cache: %s", error->message);
+}
+
 static float
 convert_pos (gchar *pos, int digits)
 {
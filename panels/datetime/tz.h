@@ -36,6 +36,7 @@ G_BEGIN_DECLS
 typedef struct _TzDB TzDB;
 typedef struct _TzLocation TzLocation;
 typedef struct _TzInfo TzInfo;
+typedef struct _TzIndex TzIndex;
 
 
 struct _TzDB
@@ -51,8 +52,6 @@ struct _TzLocation
 	gdouble longitude;
 	gchar *zone;
 	gchar *comment;
-
-	gdouble dist; /* distance to clicked point for comparison */
 };
 
 /* see the glibc info page information on time zone information */
@@ -81,10 +80,23 @@ gchar     *tz_location_get_comment    (TzLocation *loc);
 glong      tz_location_get_base_utc_offset (TzLocation *loc);
 gint       tz_location_set_locally    (TzLocation *loc);
 TzInfo    *tz_info_from_location      (TzLocation *loc);
+TzInfo    *tz_info_from_location_at   (TzLocation *loc,
+				       gint64 when);
 void       tz_info_free               (TzInfo *tz_info);
 
+/* Maps a location to the unit square of a map */
+typedef void (*TzProjectionFunc) (TzLocation *loc, gdouble *x, gdouble *y);
+
+TzIndex    *tz_index_new              (GPtrArray *locations,
+				       TzProjectionFunc project);
+void        tz_index_free             (TzIndex *index);
+TzLocation *tz_index_get_nearest      (TzIndex *index,
+				       gdouble x, gdouble y,
+				       gdouble width, gdouble height);
+
 
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (TzDB, tz_db_free)
 G_DEFINE_AUTOPTR_CLEANUP_FUNC (TzInfo, tz_info_free)
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (TzIndex, tz_index_free)
 
 G_END_DECLS
@@ -40,6 +40,17 @@ struct _CcDisplayArrangement
   gdouble           drag_anchor_y;
 
   guint             major_snap_distance;
+
+  /* Outputs the selected output may snap to, while dragging */
+  struct _SnapTargets *snap_targets;
+
+  /* Latest pointer position, applied on the next frame while dragging */
+  guint             motion_tick_id;
+  gdouble           motion_x;
+  gdouble           motion_y;
+
+  /* Number labels, by number */
+  GHashTable       *labels;
 };
 
 typedef struct _CcDisplayArrangement CcDisplayArrangement;
@@ -68,6 +79,37 @@ typedef struct {
   SnapDirection      snapped;
 } SnapData;
 
+typedef struct {
+  gint               x1;
+  gint               y1;
+  gint               x2;
+  gint               y2;
+} SnapTarget;
+
+typedef enum {
+  SNAP_EDGE_LEFT,
+  SNAP_EDGE_RIGHT,
+  SNAP_EDGE_TOP,
+  SNAP_EDGE_BOTTOM,
+  N_SNAP_EDGES
+} SnapEdgeType;
+
+typedef struct {
+  gint               pos;
+  guint              target;
+} SnapEdge;
+
+typedef struct _SnapTargets {
+  GArray            *targets;
+  /* Edges of the targets sorted by position, if indexed */
+  GArray            *edges[N_SNAP_EDGES];
+} SnapTargets;
+
+typedef struct {
+  PangoLayout       *layout;
+  PangoRectangle     extents;
+} Label;
+
 #define MARGIN_PX  0
 #define MARGIN_MON  0.66
 #define MAJOR_SNAP_DISTANCE 25
@@ -317,28 +359,164 @@ maybe_update_snap (SnapData       *snap_data,
     }
 }
 
+static gint
+compare_snap_edges (gconstpointer a,
+                    gconstpointer b)
+{
+  const SnapEdge *edge_a = a;
+  const SnapEdge *edge_b = b;
+
+  return (edge_a->pos > edge_b->pos) - (edge_a->pos < edge_b->pos);
+}
+
 static void
-find_best_snapping (CcDisplayConfig   *config,
-                    CcDisplayMonitor  *snap_output,
-                    SnapData          *snap_data)
+snap_targets_free (SnapTargets *targets)
 {
+  guint i;
+
+  g_array_unref (targets->targets);
+  for (i = 0; i < N_SNAP_EDGES; i++)
+    g_clear_pointer (&targets->edges[i], g_array_unref);
+
+  g_free (targets);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (SnapTargets, snap_targets_free)
+
+/* The other outputs don't move while @snap_output is being placed, so
+ * their geometry is only looked up once. With @index_edges, their edges
+ * are also sorted so that only the nearby ones need to be considered. */
+static SnapTargets *
+snap_targets_new (CcDisplayConfig  *config,
+                  CcDisplayMonitor *snap_output,
+                  gboolean          index_edges)
+{
+  SnapTargets *targets;
   GList *outputs, *l;
-  gint x1, y1, x2, y2;
-  gint w, h;
+  guint i;
+
+  targets = g_new0 (SnapTargets, 1);
+  targets->targets = g_array_new (FALSE, FALSE, sizeof (SnapTarget));
+
+  outputs = cc_display_config_get_monitors (config);
+  for (l = outputs; l; l = l->next)
+    {
+      CcDisplayMonitor *output = l->data;
+      SnapTarget target;
+      gint w, h;
+
+      if (output == snap_output)
+        continue;
+
+      if (!cc_display_monitor_is_useful (output))
+        continue;
+
+      get_scaled_geometry (config, output, &target.x1, &target.y1, &w, &h);
+      target.x2 = target.x1 + w;
+      target.y2 = target.y1 + h;
+
+      g_array_append_val (targets->targets, target);
+    }
+
+  if (!index_edges)
+    return targets;
+
+  for (i = 0; i < N_SNAP_EDGES; i++)
+    targets->edges[i] = g_array_sized_new (FALSE, FALSE, sizeof (SnapEdge), targets->targets->len);
+
+  for (i = 0; i < targets->targets->len; i++)
+    {
+      SnapTarget *target = &g_array_index (targets->targets, SnapTarget, i);
+      SnapEdge left = { target->x1, i };
+      SnapEdge right = { target->x2, i };
+      SnapEdge top = { target->y1, i };
+      SnapEdge bottom = { target->y2, i };
+
+      g_array_append_val (targets->edges[SNAP_EDGE_LEFT], left);
+      g_array_append_val (targets->edges[SNAP_EDGE_RIGHT], right);
+      g_array_append_val (targets->edges[SNAP_EDGE_TOP], top);
+      g_array_append_val (targets->edges[SNAP_EDGE_BOTTOM], bottom);
+    }
+
+  for (i = 0; i < N_SNAP_EDGES; i++)
+    g_array_sort (targets->edges[i], compare_snap_edges);
+
+  return targets;
+}
+
+/* Flags the targets with an edge at most @distance away from @pos */
+static void
+mark_snap_candidates (GArray   *edges,
+                      gint      pos,
+                      gint      distance,
+                      gboolean *candidates)
+{
+  guint low = 0, high = edges->len;
+  guint i;
+
+  while (low < high)
+    {
+      guint mid = (low + high) / 2;
+
+      if (g_array_index (edges, SnapEdge, mid).pos < pos - distance)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+
+  for (i = low; i < edges->len; i++)
+    {
+      const SnapEdge *edge = &g_array_index (edges, SnapEdge, i);
+
+      if (edge->pos > pos + distance)
+        break;
+
+      candidates[edge->target] = TRUE;
+    }
+}
+
+static void
+find_best_snapping (SnapTargets       *targets,
+                    gint               x1,
+                    gint               y1,
+                    gint               w,
+                    gint               h,
+                    SnapData          *snap_data)
+{
+  g_autofree gboolean *candidates = NULL;
+  gint x2, y2;
+  guint i;
 
   g_assert (snap_data != NULL);
 
-  get_scaled_geometry (config, snap_output, &x1, &y1, &w, &h);
   x2 = x1 + w;
   y2 = y1 + h;
 
+  /* Every snap is measured on its major axis against the major snapping
+   * distance first, and major axis positions are always next to an edge
+   * of the target, so targets without any edge in reach can be skipped. */
+  if (snap_data->major_snap_distance != G_MAXUINT &&
+      snap_data->to_widget.xx != 0 && snap_data->to_widget.yy != 0 &&
+      targets->edges[0] != NULL)
+    {
+      gint distance_x, distance_y;
+
+      distance_x = ceil (snap_data->major_snap_distance / fabs (snap_data->to_widget.xx));
+      distance_y = ceil (snap_data->major_snap_distance / fabs (snap_data->to_widget.yy));
+
+      candidates = g_new0 (gboolean, targets->targets->len);
+      mark_snap_candidates (targets->edges[SNAP_EDGE_LEFT], x2, distance_x, candidates);
+      mark_snap_candidates (targets->edges[SNAP_EDGE_RIGHT], x1, distance_x, candidates);
+      mark_snap_candidates (targets->edges[SNAP_EDGE_TOP], y2, distance_y, candidates);
+      mark_snap_candidates (targets->edges[SNAP_EDGE_BOTTOM], y1, distance_y, candidates);
+    }
+
 #define OVERLAP(_s1, _s2, _t1, _t2) ((_s1) <= (_t2) && (_t1) <= (_s2))
 
-  outputs = cc_display_config_get_monitors (config);
-  for (l = outputs; l; l = l->next)
+  for (i = 0; i < targets->targets->len; i++)
     {
-      CcDisplayMonitor *output = l->data;
-      gint _x1, _y1, _x2, _y2, _h, _w;
+      const SnapTarget *target = &g_array_index (targets->targets, SnapTarget, i);
+      gint _x1, _y1, _x2, _y2;
       gint bottom_snap_pos;
       gint top_snap_pos;
       gint left_snap_pos;
@@ -346,15 +524,13 @@ find_best_snapping (CcDisplayConfig   *config,
       gdouble dist_x, dist_y;
       gdouble tmp;
 
-      if (output == snap_output)
-        continue;
-
-      if (!cc_display_monitor_is_useful (output))
+      if (candidates != NULL && !candidates[i])
         continue;
 
-      get_scaled_geometry (config, output, &_x1, &_y1, &_w, &_h);
-      _x2 = _x1 + _w;
-      _y2 = _y1 + _h;
+      _x1 = target->x1;
+      _y1 = target->y1;
+      _x2 = target->x2;
+      _y2 = target->y2;
 
       top_snap_pos = _y1 - h;
       bottom_snap_pos = _y2;
@@ -506,6 +682,35 @@ on_output_changed_cb (CcDisplayArrangement *self,
   gtk_widget_queue_draw (GTK_WIDGET (self));
 }
 
+static void
+label_free (Label *label)
+{
+  g_object_unref (label->layout);
+  g_free (label);
+}
+
+static Label *
+get_label (CcDisplayArrangement *self,
+           gint                  num)
+{
+  g_autofree gchar *number_str = NULL;
+  Label *label;
+
+  label = g_hash_table_lookup (self->labels, GINT_TO_POINTER (num));
+  if (label)
+    return label;
+
+  number_str = g_strdup_printf ("%d", num);
+
+  label = g_new0 (Label, 1);
+  label->layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), number_str);
+  pango_layout_get_extents (label->layout, NULL, &label->extents);
+
+  g_hash_table_insert (self->labels, GINT_TO_POINTER (num), label);
+
+  return label;
+}
+
 static void
 cc_display_arrangement_draw (GtkDrawingArea *drawing_area,
                              cairo_t        *cr,
@@ -586,8 +791,7 @@ cc_display_arrangement_draw (GtkDrawingArea *drawing_area,
 
       if (num > 0)
         {
-          PangoLayout *layout;
-          g_autofree gchar *number_str = NULL;
+          Label *label;
           PangoRectangle extents;
           GdkRGBA color;
           gdouble text_width, text_padding;
@@ -600,9 +804,8 @@ cc_display_arrangement_draw (GtkDrawingArea *drawing_area,
 
           cairo_translate (cr, w / 2, h / 2);
 
-          number_str = g_strdup_printf ("%d", num);
-          layout = gtk_widget_create_pango_layout (GTK_WIDGET (self), number_str);
-          pango_layout_get_extents (layout, NULL, &extents);
+          label = get_label (self, num);
+          extents = label->extents;
 
           h = (extents.height - extents.y) / PANGO_SCALE;
           text_width = (extents.width - extents.x) / PANGO_SCALE;
@@ -629,8 +832,7 @@ cc_display_arrangement_draw (GtkDrawingArea *drawing_area,
           gtk_style_context_get_color (context, &color);
           gdk_cairo_set_source_rgba (cr, &color);
 
-          gtk_render_layout (context, cr, 0, 0, layout);
-          g_object_unref (layout);
+          gtk_render_layout (context, cr, 0, 0, label->layout);
         }
 
       gtk_style_context_restore (context);
@@ -638,6 +840,59 @@ cc_display_arrangement_draw (GtkDrawingArea *drawing_area,
     }
 }
 
+static void
+drag_selected_output (CcDisplayArrangement *self,
+                      gdouble               x,
+                      gdouble               y)
+{
+  gdouble event_x, event_y;
+  gint mon_x, mon_y;
+  gint w, h;
+  SnapData snap_data;
+
+  g_assert (self->selected_output);
+  g_assert (self->snap_targets);
+
+  event_x = x;
+  event_y = y;
+
+  cairo_matrix_transform_point (&self->to_actual, &event_x, &event_y);
+
+  mon_x = round (event_x - self->drag_anchor_x);
+  mon_y = round (event_y - self->drag_anchor_y);
+
+  /* The monitor is now at the location as if there was no snapping whatsoever. */
+  snap_data.snapped = SNAP_DIR_NONE;
+  snap_data.mon_x = mon_x;
+  snap_data.mon_y = mon_y;
+  snap_data.dist_x = 0;
+  snap_data.dist_y = 0;
+  snap_data.to_widget = self->to_widget;
+  snap_data.major_snap_distance = self->major_snap_distance;
+
+  cc_display_monitor_set_position (self->selected_output, mon_x, mon_y);
+
+  get_scaled_geometry (self->config, self->selected_output, &mon_x, &mon_y, &w, &h);
+  find_best_snapping (self->snap_targets, mon_x, mon_y, w, h, &snap_data);
+
+  cc_display_monitor_set_position (self->selected_output, snap_data.mon_x, snap_data.mon_y);
+}
+
+static gboolean
+on_motion_tick_cb (GtkWidget     *widget,
+                   GdkFrameClock *frame_clock,
+                   gpointer       user_data)
+{
+  CcDisplayArrangement *self = CC_DISPLAY_ARRANGEMENT (widget);
+
+  self->motion_tick_id = 0;
+
+  if (self->drag_active)
+    drag_selected_output (self, self->motion_x, self->motion_y);
+
+  return G_SOURCE_REMOVE;
+}
+
 static gboolean
 on_click_gesture_pressed_cb (GtkGestureClick      *click_gesture,
                              gint                  n_press,
@@ -671,6 +926,7 @@ on_click_gesture_pressed_cb (GtkGestureClick      *click_gesture,
       self->drag_active = TRUE;
       self->drag_anchor_x = event_x - mon_x;
       self->drag_anchor_y = event_y - mon_y;
+      self->snap_targets = snap_targets_new (self->config, output, TRUE);
     }
 
   return TRUE;
@@ -691,7 +947,16 @@ on_click_gesture_released_cb (GtkGestureClick      *click_gesture,
   if (!self->drag_active)
     return FALSE;
 
+  /* Don't lose the last motion before the drag ends */
+  if (self->motion_tick_id != 0)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->motion_tick_id);
+      self->motion_tick_id = 0;
+      drag_selected_output (self, self->motion_x, self->motion_y);
+    }
+
   self->drag_active = FALSE;
+  g_clear_pointer (&self->snap_targets, snap_targets_free);
 
   output = cc_display_arrangement_find_monitor_at (self, x, y);
   gtk_widget_set_cursor_from_name (GTK_WIDGET (self),
@@ -711,10 +976,6 @@ on_motion_controller_motion_cb (GtkEventControllerMotion *motion_controller,
                                 gdouble                   y,
                                 CcDisplayArrangement     *self)
 {
-  gdouble event_x, event_y;
-  gint mon_x, mon_y;
-  SnapData snap_data;
-
   if (!self->config)
     return FALSE;
 
@@ -736,30 +997,15 @@ on_motion_controller_motion_cb (GtkEventControllerMotion *motion_controller,
       return FALSE;
     }
 
-  g_assert (self->selected_output);
-
-  event_x = x;
-  event_y = y;
+  /* Pointers may report motion much more often than the widget is drawn,
+   * so only the latest position is snapped, once per frame. */
+  self->motion_x = x;
+  self->motion_y = y;
 
-  cairo_matrix_transform_point (&self->to_actual, &event_x, &event_y);
-
-  mon_x = round (event_x - self->drag_anchor_x);
-  mon_y = round (event_y - self->drag_anchor_y);
-
-  /* The monitor is now at the location as if there was no snapping whatsoever. */
-  snap_data.snapped = SNAP_DIR_NONE;
-  snap_data.mon_x = mon_x;
-  snap_data.mon_y = mon_y;
-  snap_data.dist_x = 0;
-  snap_data.dist_y = 0;
-  snap_data.to_widget = self->to_widget;
-  snap_data.major_snap_distance = self->major_snap_distance;
-
-  cc_display_monitor_set_position (self->selected_output, mon_x, mon_y);
-
-  find_best_snapping (self->config, self->selected_output, &snap_data);
-
-  cc_display_monitor_set_position (self->selected_output, snap_data.mon_x, snap_data.mon_y);
+  if (self->motion_tick_id == 0)
+    self->motion_tick_id = gtk_widget_add_tick_callback (GTK_WIDGET (self),
+                                                         on_motion_tick_cb,
+                                                         NULL, NULL);
 
   return TRUE;
 }
@@ -816,19 +1062,36 @@ cc_display_arrangement_finalize (GObject *object)
   CcDisplayArrangement *self = CC_DISPLAY_ARRANGEMENT (object);
 
   g_clear_object (&self->config);
+  g_clear_pointer (&self->snap_targets, snap_targets_free);
+  g_clear_pointer (&self->labels, g_hash_table_destroy);
 
   G_OBJECT_CLASS (cc_display_arrangement_parent_class)->finalize (object);
 }
 
+static void
+cc_display_arrangement_css_changed (GtkWidget         *widget,
+                                    GtkCssStyleChange *change)
+{
+  CcDisplayArrangement *self = CC_DISPLAY_ARRANGEMENT (widget);
+
+  GTK_WIDGET_CLASS (cc_display_arrangement_parent_class)->css_changed (widget, change);
+
+  /* The font may have changed */
+  g_hash_table_remove_all (self->labels);
+}
+
 static void
 cc_display_arrangement_class_init (CcDisplayArrangementClass *klass)
 {
   GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
   gobject_class->finalize = cc_display_arrangement_finalize;
   gobject_class->get_property = cc_display_arrangement_get_property;
   gobject_class->set_property = cc_display_arrangement_set_property;
 
+  widget_class->css_changed = cc_display_arrangement_css_changed;
+
   props[PROP_CONFIG] = g_param_spec_object ("config", "Display Config",
                                             "The display configuration to work with",
                                             CC_TYPE_DISPLAY_CONFIG,
@@ -849,7 +1112,7 @@ cc_display_arrangement_class_init (CcDisplayArrangementClass *klass)
                 0, NULL, NULL, NULL,
                 G_TYPE_NONE, 0);
 
-  gtk_widget_class_set_css_name (GTK_WIDGET_CLASS (klass), "display-arrangement");
+  gtk_widget_class_set_css_name (widget_class, "display-arrangement");
 }
 
 static void
@@ -873,6 +1136,7 @@ cc_display_arrangement_init (CcDisplayArrangement *self)
                                   NULL);
 
   self->major_snap_distance = MAJOR_SNAP_DISTANCE;
+  self->labels = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) label_free);
 }
 
 CcDisplayArrangement*
@@ -908,6 +1172,12 @@ cc_display_arrangement_set_config (CcDisplayArrangement *self,
   g_clear_object (&self->config);
 
   self->drag_active = FALSE;
+  g_clear_pointer (&self->snap_targets, snap_targets_free);
+  if (self->motion_tick_id != 0)
+    {
+      gtk_widget_remove_tick_callback (GTK_WIDGET (self), self->motion_tick_id);
+      self->motion_tick_id = 0;
+    }
 
   /* Listen to all the signals */
   if (config)
@@ -953,6 +1223,7 @@ void
 cc_display_config_snap_output (CcDisplayConfig  *config,
                                CcDisplayMonitor *output)
 {
+  g_autoptr(SnapTargets) targets = NULL;
   SnapData snap_data;
   gint x, y, w, h;
 
@@ -963,6 +1234,7 @@ cc_display_config_snap_output (CcDisplayConfig  *config,
     return;
 
   get_scaled_geometry (config, output, &x, &y, &w, &h);
+  targets = snap_targets_new (config, output, FALSE);
 
   snap_data.snapped = SNAP_DIR_NONE;
   snap_data.mon_x = x;
@@ -972,7 +1244,7 @@ cc_display_config_snap_output (CcDisplayConfig  *config,
   cairo_matrix_init_identity (&snap_data.to_widget);
   snap_data.major_snap_distance = G_MAXUINT;
 
-  find_best_snapping (config, output, &snap_data);
+  find_best_snapping (targets, x, y, w, h, &snap_data);
 
   cc_display_monitor_set_position (output, snap_data.mon_x, snap_data.mon_y);
 }
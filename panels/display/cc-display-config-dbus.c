@@ -55,6 +55,11 @@ struct _CcDisplayModeDBus
   double preferred_scale;
   GArray *supported_scales;
   guint32 flags;
+
+  /* Supported scales as filtered while cloning, and the active monitors
+   * they were filtered for */
+  GArray *clone_scales;
+  guint64 clone_scales_key;
 };
 
 G_DEFINE_TYPE (CcDisplayModeDBus,
@@ -168,7 +173,8 @@ cc_display_mode_dbus_finalize (GObject *object)
   CcDisplayModeDBus *self = CC_DISPLAY_MODE_DBUS (object);
 
   g_free (self->id);
-  g_array_free (self->supported_scales, TRUE);
+  g_array_unref (self->supported_scales);
+  g_clear_pointer (&self->clone_scales, g_array_unref);
 
   G_OBJECT_CLASS (cc_display_mode_dbus_parent_class)->finalize (object);
 }
@@ -998,6 +1004,9 @@ struct _CcDisplayConfigDBus
   CcDisplayMonitorDBus *primary;
 
   GHashTable *logical_monitors;
+
+  /* Verdicts of Mutter on the apply parameters already verified */
+  GHashTable *verdicts;
 };
 
 G_DEFINE_TYPE (CcDisplayConfigDBus,
@@ -1092,6 +1101,30 @@ build_apply_parameters (CcDisplayConfigDBus *self,
                         g_variant_builder_end (&props_builder));
 }
 
+static guint
+apply_parameters_hash (gconstpointer key)
+{
+  GVariant *parameters = (GVariant *) key;
+  const guchar *data;
+  gsize size, i;
+  guint hash = 5381;
+
+  data = g_variant_get_data (parameters);
+  size = g_variant_get_size (parameters);
+  for (i = 0; i < size; i++)
+    hash = (hash << 5) + hash + data[i];
+
+  return hash;
+}
+
+static GVariant *
+build_verify_parameters (CcDisplayConfigDBus *self)
+{
+  cc_display_config_dbus_ensure_non_offset_coords (self);
+
+  return g_variant_ref_sink (build_apply_parameters (self, CC_DISPLAY_CONFIG_METHOD_VERIFY));
+}
+
 static gboolean
 config_apply (CcDisplayConfigDBus *self,
               CcDisplayConfigMethod method,
@@ -1111,21 +1144,107 @@ config_apply (CcDisplayConfigDBus *self,
   return retval != NULL;
 }
 
+/* Mutter rejects configurations it can't apply with InvalidArgs. Other
+ * errors, like a stale serial or a lost connection, say nothing about the
+ * configuration itself, so they aren't cached. */
+static void
+cache_verdict (CcDisplayConfigDBus *self,
+               GVariant            *parameters,
+               const GError        *error)
+{
+  if (error != NULL && !g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_INVALID_ARGS))
+    return;
+
+  g_hash_table_insert (self->verdicts, g_variant_ref (parameters),
+                       GINT_TO_POINTER (error == NULL));
+}
+
 static gboolean
 cc_display_config_dbus_is_applicable (CcDisplayConfig *pself)
 {
   CcDisplayConfigDBus *self = CC_DISPLAY_CONFIG_DBUS (pself);
+  g_autoptr(GVariant) parameters = NULL;
+  g_autoptr(GVariant) retval = NULL;
   g_autoptr(GError) error = NULL;
+  gpointer verdict;
+
+  parameters = build_verify_parameters (self);
+  if (g_hash_table_lookup_extended (self->verdicts, parameters, NULL, &verdict))
+    return GPOINTER_TO_INT (verdict);
+
+  retval = g_dbus_proxy_call_sync (self->proxy,
+                                   "ApplyMonitorsConfig",
+                                   parameters,
+                                   G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                                   -1,
+                                   NULL,
+                                   &error);
+  if (retval == NULL)
+    g_warning ("Config not applicable: %s", error->message);
+
+  cache_verdict (self, parameters, error);
 
-  if (!config_apply (self, CC_DISPLAY_CONFIG_METHOD_VERIFY, &error))
+  return retval != NULL;
+}
+
+static void
+verify_cb (GObject      *source,
+           GAsyncResult *res,
+           gpointer      user_data)
+{
+  g_autoptr(GTask) task = G_TASK (user_data);
+  CcDisplayConfigDBus *self = g_task_get_source_object (task);
+  GVariant *parameters = g_task_get_task_data (task);
+  g_autoptr(GVariant) retval = NULL;
+  g_autoptr(GError) error = NULL;
+
+  retval = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
-      g_warning ("Config not applicable: %s", error->message);
-      return FALSE;
+      g_task_return_error (task, g_steal_pointer (&error));
+      return;
     }
-  else
+
+  if (retval == NULL)
+    g_warning ("Config not applicable: %s", error->message);
+
+  cache_verdict (self, parameters, error);
+
+  g_task_return_boolean (task, retval != NULL);
+}
+
+static void
+cc_display_config_dbus_is_applicable_async (CcDisplayConfig     *pself,
+                                            GCancellable        *cancellable,
+                                            GAsyncReadyCallback  callback,
+                                            gpointer             user_data)
+{
+  CcDisplayConfigDBus *self = CC_DISPLAY_CONFIG_DBUS (pself);
+  g_autoptr(GVariant) parameters = NULL;
+  g_autoptr(GTask) task = NULL;
+  gpointer verdict;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_display_config_dbus_is_applicable_async);
+
+  /* Going back to an arrangement that was already tried is common */
+  parameters = build_verify_parameters (self);
+  if (g_hash_table_lookup_extended (self->verdicts, parameters, NULL, &verdict))
     {
-      return TRUE;
+      g_task_return_boolean (task, GPOINTER_TO_INT (verdict));
+      return;
     }
+
+  g_task_set_task_data (task, g_variant_ref (parameters), (GDestroyNotify) g_variant_unref);
+
+  g_dbus_proxy_call (self->proxy,
+                     "ApplyMonitorsConfig",
+                     parameters,
+                     G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                     -1,
+                     cancellable,
+                     verify_cb,
+                     g_steal_pointer (&task));
 }
 
 static CcDisplayMonitorDBus *
@@ -1283,13 +1402,11 @@ cc_display_config_dbus_set_cloning (CcDisplayConfig *pself,
 }
 
 static gboolean
-mode_supports_scale (CcDisplayMode *mode,
-                     double         scale)
+scales_contain (GArray *scales,
+                double  scale)
 {
-  g_autoptr(GArray) scales = NULL;
   int i;
 
-  scales = cc_display_mode_get_supported_scales (mode);
   for (i = 0; i < scales->len; i++)
     {
       if (G_APPROX_VALUE (scale, g_array_index (scales, double, i),
@@ -1318,7 +1435,7 @@ remove_unsupported_scales (CcDisplayMode *mode,
 
       scale = g_array_index (supported_scales, double, i);
 
-      if (mode_supports_scale (mode, scale))
+      if (scales_contain (mode_scales, scale))
         {
           i++;
           continue;
@@ -1328,46 +1445,53 @@ remove_unsupported_scales (CcDisplayMode *mode,
     }
 }
 
-static gboolean
-monitor_has_compatible_clone_mode (CcDisplayMonitorDBus *monitor,
-                                   CcDisplayModeDBus    *mode,
-                                   GArray               *supported_scales)
+/* Clone modes only need to agree on the resolution and on interlacing */
+static guint64
+clone_mode_key (CcDisplayModeDBus *mode)
 {
+  return ((guint64) (guint32) mode->width << 32) |
+         ((guint64) (guint32) mode->height << 1) |
+         !!(mode->flags & MODE_INTERLACED);
+}
+
+/* Maps the clone mode keys of @monitor to its first mode with that key */
+static GHashTable *
+index_clone_modes (CcDisplayMonitorDBus *monitor)
+{
+  GHashTable *index;
   GList *l;
 
+  index = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+
   for (l = monitor->modes; l; l = l->next)
     {
-      CcDisplayModeDBus *other_mode = l->data;
-
-      if (other_mode->width != mode->width ||
-          other_mode->height != mode->height)
-        continue;
-
-      if ((other_mode->flags & MODE_INTERLACED) !=
-          (mode->flags & MODE_INTERLACED))
-        continue;
-
-      remove_unsupported_scales (CC_DISPLAY_MODE (other_mode), supported_scales);
+      CcDisplayModeDBus *mode = l->data;
+      guint64 key = clone_mode_key (mode);
 
-      return TRUE;
+      if (!g_hash_table_contains (index, &key))
+        g_hash_table_insert (index, g_memdup2 (&key, sizeof (key)), mode);
     }
 
-  return FALSE;
+  return index;
 }
 
 static gboolean
-monitors_has_compatible_clone_mode (CcDisplayConfigDBus *self,
-                                    CcDisplayModeDBus   *mode,
-                                    GArray              *supported_scales)
+monitors_has_compatible_clone_mode (GPtrArray         *indexes,
+                                    CcDisplayModeDBus *mode,
+                                    GArray            *supported_scales)
 {
-  GList *l;
+  guint64 key = clone_mode_key (mode);
+  guint i;
 
-  for (l = self->monitors; l; l = l->next)
+  for (i = 0; i < indexes->len; i++)
     {
-      CcDisplayMonitorDBus *monitor = l->data;
+      CcDisplayModeDBus *other_mode;
 
-      if (!monitor_has_compatible_clone_mode (monitor, mode, supported_scales))
+      other_mode = g_hash_table_lookup (g_ptr_array_index (indexes, i), &key);
+      if (!other_mode)
         return FALSE;
+
+      remove_unsupported_scales (CC_DISPLAY_MODE (other_mode), supported_scales);
     }
 
   return TRUE;
@@ -1397,6 +1521,7 @@ cc_display_config_dbus_generate_cloning_modes (CcDisplayConfig *pself)
   GList *l;
   GList *clone_modes = NULL;
   CcDisplayModeDBus *best_mode = NULL;
+  g_autoptr(GPtrArray) indexes = NULL;
 
   for (l = self->monitors; l; l = l->next)
     {
@@ -1412,31 +1537,38 @@ cc_display_config_dbus_generate_cloning_modes (CcDisplayConfig *pself)
   if (!base_monitor)
     return NULL;
 
+  indexes = g_ptr_array_new_with_free_func ((GDestroyNotify) g_hash_table_unref);
+  for (l = self->monitors; l; l = l->next)
+    g_ptr_array_add (indexes, index_clone_modes (l->data));
+
   for (l = base_monitor->modes; l; l = l->next)
     {
       CcDisplayModeDBus *mode = l->data;
       CcDisplayModeDBus *virtual_mode;
+      g_autoptr (GArray) mode_scales = NULL;
       g_autoptr (GArray) supported_scales = NULL;
 
-      supported_scales =
-        cc_display_mode_get_supported_scales (CC_DISPLAY_MODE (mode));
+      /* The mode's own scales may be shared, so narrow down a copy */
+      mode_scales = cc_display_mode_get_supported_scales (CC_DISPLAY_MODE (mode));
+      supported_scales = g_array_copy (mode_scales);
 
-      if (!monitors_has_compatible_clone_mode (self, mode, supported_scales))
+      if (!monitors_has_compatible_clone_mode (indexes, mode, supported_scales))
         continue;
 
       virtual_mode = cc_display_mode_dbus_new_virtual (mode->width,
                                                        mode->height,
                                                        mode->preferred_scale,
                                                        supported_scales);
-      clone_modes = g_list_append (clone_modes, virtual_mode);
+      clone_modes = g_list_prepend (clone_modes, virtual_mode);
 
       if (!best_mode || is_mode_better (virtual_mode, best_mode))
         best_mode = virtual_mode;
     }
 
-  best_mode->flags |= MODE_PREFERRED;
+  if (best_mode)
+    best_mode->flags |= MODE_PREFERRED;
 
-  return clone_modes;
+  return g_list_reverse (clone_modes);
 }
 
 static gboolean
@@ -1448,6 +1580,46 @@ cc_display_config_dbus_apply (CcDisplayConfig *pself,
   return config_apply (self, CC_DISPLAY_CONFIG_METHOD_PERSISTENT, error);
 }
 
+static void
+apply_cb (GObject      *source,
+          GAsyncResult *res,
+          gpointer      user_data)
+{
+  g_autoptr(GTask) task = G_TASK (user_data);
+  g_autoptr(GVariant) retval = NULL;
+  g_autoptr(GError) error = NULL;
+
+  retval = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+  if (retval == NULL)
+    g_task_return_error (task, g_steal_pointer (&error));
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
+static void
+cc_display_config_dbus_apply_async (CcDisplayConfig     *pself,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data)
+{
+  CcDisplayConfigDBus *self = CC_DISPLAY_CONFIG_DBUS (pself);
+  g_autoptr(GTask) task = NULL;
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_display_config_dbus_apply_async);
+
+  cc_display_config_dbus_ensure_non_offset_coords (self);
+
+  g_dbus_proxy_call (self->proxy,
+                     "ApplyMonitorsConfig",
+                     build_apply_parameters (self, CC_DISPLAY_CONFIG_METHOD_PERSISTENT),
+                     G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                     -1,
+                     cancellable,
+                     apply_cb,
+                     g_steal_pointer (&task));
+}
+
 static gboolean
 cc_display_config_dbus_is_layout_logical (CcDisplayConfig *pself)
 {
@@ -1503,6 +1675,34 @@ is_scale_allowed_by_active_monitors (CcDisplayConfigDBus *self,
   return TRUE;
 }
 
+/* One bit per active monitor, or 0 when there are too many to tell apart */
+static guint64
+active_monitors_key (CcDisplayConfigDBus *self)
+{
+  guint64 key = 1;
+  guint i = 1;
+  GList *l;
+
+  for (l = self->monitors; l; l = l->next, i++)
+    {
+      if (i >= 64)
+        return 0;
+
+      if (cc_display_monitor_is_active (CC_DISPLAY_MONITOR (l->data)))
+        key |= G_GUINT64_CONSTANT (1) << i;
+    }
+
+  return key;
+}
+
+static void
+invalidate_clone_scales (CcDisplayModeDBus *self)
+{
+  g_clear_pointer (&self->clone_scales, g_array_unref);
+  self->clone_scales_key = 0;
+}
+
+/* The returned array is shared and must not be modified */
 static GArray *
 cc_display_mode_dbus_get_supported_scales (CcDisplayMode *pself)
 {
@@ -1511,9 +1711,15 @@ cc_display_mode_dbus_get_supported_scales (CcDisplayMode *pself)
 
   if (cc_display_config_is_cloning (config))
     {
-      GArray *scales = g_array_copy (self->supported_scales);
+      g_autoptr(GArray) scales = NULL;
+      guint64 key;
       int i;
 
+      key = active_monitors_key (self->monitor->config);
+      if (key != 0 && key == self->clone_scales_key)
+        return g_array_ref (self->clone_scales);
+
+      scales = g_array_copy (self->supported_scales);
       for (i = scales->len - 1; i >= 0; i--)
         {
           double scale = g_array_index (scales, double, i);
@@ -1523,6 +1729,13 @@ cc_display_mode_dbus_get_supported_scales (CcDisplayMode *pself)
             g_array_remove_index (scales, i);
         }
 
+      if (key != 0)
+        {
+          g_clear_pointer (&self->clone_scales, g_array_unref);
+          self->clone_scales = g_array_ref (scales);
+          self->clone_scales_key = key;
+        }
+
       return g_steal_pointer (&scales);
     }
 
@@ -1569,6 +1782,7 @@ filter_out_invalid_scaled_modes (CcDisplayConfigDBus *self)
                   !is_scaled_mode_allowed (self, mode, scale))
                 {
                   g_array_remove_index (mode->supported_scales, i);
+                  invalidate_clone_scales (mode);
                 }
             }
         }
@@ -1623,6 +1837,10 @@ cc_display_config_dbus_init (CcDisplayConfigDBus *self)
   self->global_scale_required = FALSE;
   self->layout_mode = CC_DISPLAY_LAYOUT_MODE_LOGICAL;
   self->logical_monitors = g_hash_table_new (NULL, NULL);
+  self->verdicts = g_hash_table_new_full (apply_parameters_hash,
+                                          g_variant_equal,
+                                          (GDestroyNotify) g_variant_unref,
+                                          NULL);
 }
 
 static void
@@ -1912,6 +2130,7 @@ cc_display_config_dbus_finalize (GObject *object)
 
   g_clear_list (&self->monitors, g_object_unref);
   g_clear_pointer (&self->logical_monitors, g_hash_table_destroy);
+  g_clear_pointer (&self->verdicts, g_hash_table_destroy);
 
   G_OBJECT_CLASS (cc_display_config_dbus_parent_class)->finalize (object);
 }
@@ -1931,8 +2150,10 @@ cc_display_config_dbus_class_init (CcDisplayConfigDBusClass *klass)
 
   parent_class->get_monitors = cc_display_config_dbus_get_monitors;
   parent_class->is_applicable = cc_display_config_dbus_is_applicable;
+  parent_class->is_applicable_async = cc_display_config_dbus_is_applicable_async;
   parent_class->equal = cc_display_config_dbus_equal;
   parent_class->apply = cc_display_config_dbus_apply;
+  parent_class->apply_async = cc_display_config_dbus_apply_async;
   parent_class->is_cloning = cc_display_config_dbus_is_cloning;
   parent_class->set_cloning = cc_display_config_dbus_set_cloning;
   parent_class->generate_cloning_modes = cc_display_config_dbus_generate_cloning_modes;
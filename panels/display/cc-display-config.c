@@ -565,6 +565,27 @@ cc_display_config_is_applicable (CcDisplayConfig *self)
   return CC_DISPLAY_CONFIG_GET_CLASS (self)->is_applicable (self);
 }
 
+/* Verifying asks the compositor, and a verdict may take a while */
+void
+cc_display_config_is_applicable_async (CcDisplayConfig     *self,
+                                       GCancellable        *cancellable,
+                                       GAsyncReadyCallback  callback,
+                                       gpointer             user_data)
+{
+  g_return_if_fail (CC_IS_DISPLAY_CONFIG (self));
+  CC_DISPLAY_CONFIG_GET_CLASS (self)->is_applicable_async (self, cancellable, callback, user_data);
+}
+
+gboolean
+cc_display_config_is_applicable_finish (CcDisplayConfig  *self,
+                                        GAsyncResult     *result,
+                                        GError          **error)
+{
+  g_return_val_if_fail (CC_IS_DISPLAY_CONFIG (self), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 void
 cc_display_config_set_mode_on_all_outputs (CcDisplayConfig *config,
                                            CcDisplayMode   *clone_mode)
@@ -610,6 +631,26 @@ cc_display_config_apply (CcDisplayConfig *self,
   return CC_DISPLAY_CONFIG_GET_CLASS (self)->apply (self, error);
 }
 
+void
+cc_display_config_apply_async (CcDisplayConfig     *self,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  g_return_if_fail (CC_IS_DISPLAY_CONFIG (self));
+  CC_DISPLAY_CONFIG_GET_CLASS (self)->apply_async (self, cancellable, callback, user_data);
+}
+
+gboolean
+cc_display_config_apply_finish (CcDisplayConfig  *self,
+                                GAsyncResult     *result,
+                                GError          **error)
+{
+  g_return_val_if_fail (CC_IS_DISPLAY_CONFIG (self), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 gboolean
 cc_display_config_is_cloning (CcDisplayConfig *self)
 {
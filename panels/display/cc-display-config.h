@@ -19,7 +19,7 @@
 
 #pragma once
 
-#include <glib-object.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -158,10 +158,18 @@ struct _CcDisplayConfigClass
 
   GList*   (*get_monitors)      (CcDisplayConfig  *self);
   gboolean (*is_applicable)     (CcDisplayConfig  *self);
+  void     (*is_applicable_async) (CcDisplayConfig     *self,
+                                   GCancellable        *cancellable,
+                                   GAsyncReadyCallback  callback,
+                                   gpointer             user_data);
   gboolean (*equal)             (CcDisplayConfig  *self,
                                  CcDisplayConfig  *other);
   gboolean (*apply)             (CcDisplayConfig  *self,
                                 GError           **error);
+  void     (*apply_async)       (CcDisplayConfig     *self,
+                                 GCancellable        *cancellable,
+                                 GAsyncReadyCallback  callback,
+                                 gpointer             user_data);
   gboolean (*is_cloning)        (CcDisplayConfig  *self);
   void     (*set_cloning)       (CcDisplayConfig  *self,
                                  gboolean          clone);
@@ -181,10 +189,24 @@ GList*            cc_display_config_get_monitors            (CcDisplayConfig
 GList*            cc_display_config_get_ui_sorted_monitors  (CcDisplayConfig    *config);
 int               cc_display_config_count_useful_monitors   (CcDisplayConfig    *config);
 gboolean          cc_display_config_is_applicable           (CcDisplayConfig    *config);
+void              cc_display_config_is_applicable_async     (CcDisplayConfig    *config,
+                                                             GCancellable       *cancellable,
+                                                             GAsyncReadyCallback callback,
+                                                             gpointer            user_data);
+gboolean          cc_display_config_is_applicable_finish    (CcDisplayConfig    *config,
+                                                             GAsyncResult       *result,
+                                                             GError            **error);
 gboolean          cc_display_config_equal                   (CcDisplayConfig    *config,
                                                              CcDisplayConfig    *other);
 gboolean          cc_display_config_apply                   (CcDisplayConfig    *config,
                                                              GError            **error);
+void              cc_display_config_apply_async             (CcDisplayConfig    *config,
+                                                             GCancellable       *cancellable,
+                                                             GAsyncReadyCallback callback,
+                                                             gpointer            user_data);
+gboolean          cc_display_config_apply_finish            (CcDisplayConfig    *config,
+                                                             GAsyncResult       *result,
+                                                             GError            **error);
 gboolean          cc_display_config_is_cloning              (CcDisplayConfig    *config);
 void              cc_display_config_set_cloning             (CcDisplayConfig    *config,
                                                              gboolean            clone);
@@ -47,6 +47,9 @@
 #define SECTION_PADDING 32
 #define HEADING_PADDING 12
 
+/* Edits come in bursts while dragging, only verify once they settle */
+#define VERIFY_TIMEOUT 150 /* ms */
+
 #define DISPLAY_SCHEMA   "org.gnome.settings-daemon.plugins.color"
 
 typedef enum {
@@ -86,6 +89,9 @@ struct _CcDisplayPanel
   GtkWidget      *cancel_button;
   AdwWindowTitle *apply_titlebar_title_widget;
 
+  guint           verify_id;
+  GCancellable   *verify_cancellable;
+
   GListStore     *primary_display_list;
   GList          *monitor_rows;
 
@@ -395,9 +401,18 @@ dialog_toplevel_is_active_changed (CcDisplayPanel *self)
   ensure_monitor_labels (self);
 }
 
+static void
+cancel_verification (CcDisplayPanel *self)
+{
+  g_clear_handle_id (&self->verify_id, g_source_remove);
+  g_cancellable_cancel (self->verify_cancellable);
+  g_clear_object (&self->verify_cancellable);
+}
+
 static void
 reset_titlebar (CcDisplayPanel *self)
 {
+  cancel_verification (self);
   gtk_event_controller_set_propagation_phase (GTK_EVENT_CONTROLLER (self->toplevel_shortcuts),
                                               GTK_PHASE_NONE);
   gtk_widget_hide (self->apply_titlebar);
@@ -928,6 +943,7 @@ show_apply_titlebar (CcDisplayPanel *panel, gboolean is_applicable)
     {
       adw_window_title_set_title (panel->apply_titlebar_title_widget,
                                   _("Apply Changes?"));
+      adw_window_title_set_subtitle (panel->apply_titlebar_title_widget, NULL);
     }
   else
     {
@@ -941,6 +957,39 @@ show_apply_titlebar (CcDisplayPanel *panel, gboolean is_applicable)
                                               GTK_PHASE_BUBBLE);
 }
 
+static void
+on_config_verified_cb (GObject      *source,
+                       GAsyncResult *res,
+                       gpointer      user_data)
+{
+  CcDisplayPanel *self;
+  g_autoptr(GError) error = NULL;
+  gboolean is_applicable;
+
+  is_applicable = cc_display_config_is_applicable_finish (CC_DISPLAY_CONFIG (source), res, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  self = CC_DISPLAY_PANEL (user_data);
+  show_apply_titlebar (self, is_applicable);
+}
+
+static gboolean
+verify_current_config_cb (gpointer user_data)
+{
+  CcDisplayPanel *self = CC_DISPLAY_PANEL (user_data);
+
+  self->verify_id = 0;
+
+  self->verify_cancellable = g_cancellable_new ();
+  cc_display_config_is_applicable_async (self->current_config,
+                                         self->verify_cancellable,
+                                         on_config_verified_cb,
+                                         self);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 update_apply_button (CcDisplayPanel *panel)
 {
@@ -959,17 +1008,33 @@ update_apply_button (CcDisplayPanel *panel)
                                           applied_config);
 
   if (config_equal)
-    reset_titlebar (panel);
-  else
-    show_apply_titlebar (panel, cc_display_config_is_applicable (panel->current_config));
+    {
+      reset_titlebar (panel);
+      return;
+    }
+
+  /* Keep the titlebar up, but only allow applying once verified. */
+  cancel_verification (panel);
+  if (!gtk_widget_get_visible (panel->apply_titlebar))
+    show_apply_titlebar (panel, TRUE);
+  gtk_widget_set_sensitive (panel->apply_button, FALSE);
+
+  panel->verify_id = g_timeout_add (VERIFY_TIMEOUT, verify_current_config_cb, panel);
 }
 
 static void
-apply_current_configuration (CcDisplayPanel *self)
+on_config_applied_cb (GObject      *source,
+                      GAsyncResult *res,
+                      gpointer      user_data)
 {
+  CcDisplayPanel *self;
   g_autoptr(GError) error = NULL;
 
-  cc_display_config_apply (self->current_config, &error);
+  cc_display_config_apply_finish (CC_DISPLAY_CONFIG (source), res, &error);
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  self = CC_DISPLAY_PANEL (user_data);
 
   /* re-read the configuration */
   on_screen_changed (self);
@@ -980,6 +1045,18 @@ apply_current_configuration (CcDisplayPanel *self)
   adw_leaflet_set_visible_child_name (self->leaflet, "displays");
 }
 
+static void
+apply_current_configuration (CcDisplayPanel *self)
+{
+  cancel_verification (self);
+  gtk_widget_set_sensitive (self->apply_button, FALSE);
+
+  cc_display_config_apply_async (self->current_config,
+                                 cc_panel_get_cancellable (CC_PANEL (self)),
+                                 on_config_applied_cb,
+                                 self);
+}
+
 static void
 mapped_cb (CcDisplayPanel *panel)
 {
@@ -0,0 +1,921 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright 2026 The GNOME Settings authors
+ * Copyright (C) 2010 Red Hat, Inc
+ * Copyright (C) 2008 William Jon McCann <jmccann@redhat.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <config.h>
+
+#include "cc-hardware-info.h"
+#include "info-cleanup.h"
+
+#include <glib/gi18n.h>
+#include <gio/gio.h>
+
+#include <glibtop/mem.h>
+#include <glibtop/sysinfo.h>
+#include <udisks/udisks.h>
+#include <gudev/gudev.h>
+
+/*
+ * The hardware inventory is gathered once per session, since none of it
+ * changes while the session runs, except for the graphics cards handled
+ * by switcheroo-control and the drives seen by UDisks. The slow lookups
+ * run concurrently in worker threads, the D-Bus ones asynchronously, and
+ * each property is notified as soon as it is known. Until then, it is
+ * %NULL.
+ */
+
+enum
+{
+  PROP_0,
+  PROP_HARDWARE_MODEL,
+  PROP_MEMORY,
+  PROP_PROCESSOR,
+  PROP_GRAPHICS,
+  PROP_DISK,
+  PROP_VIRTUALIZATION,
+  N_PROPS
+};
+
+struct _CcHardwareInfo
+{
+  GObject       parent_instance;
+
+  GDBusProxy   *hostnamed_proxy;
+  GDBusProxy   *switcheroo_proxy;
+  UDisksClient *udisks_client;
+
+  gchar        *hardware_model;
+  gchar        *memory;
+  gchar        *processor;
+  gchar        *graphics;
+  gchar        *disk;
+  gchar        *virtualization;
+
+  /* Results of outdated lookups are dropped */
+  guint         lookup_serials[N_PROPS];
+};
+
+G_DEFINE_TYPE (CcHardwareInfo, cc_hardware_info, G_TYPE_OBJECT)
+
+static GParamSpec *props[N_PROPS] = { NULL, };
+
+typedef struct
+{
+  guint prop_id;
+  guint serial;
+} Lookup;
+
+static gchar **
+get_field (CcHardwareInfo *self,
+           guint           prop_id)
+{
+  switch (prop_id)
+    {
+    case PROP_HARDWARE_MODEL:
+      return &self->hardware_model;
+    case PROP_MEMORY:
+      return &self->memory;
+    case PROP_PROCESSOR:
+      return &self->processor;
+    case PROP_GRAPHICS:
+      return &self->graphics;
+    case PROP_DISK:
+      return &self->disk;
+    case PROP_VIRTUALIZATION:
+      return &self->virtualization;
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+static void
+set_field (CcHardwareInfo *self,
+           guint           prop_id,
+           const gchar    *value)
+{
+  gchar **field = get_field (self, prop_id);
+
+  if (g_strcmp0 (*field, value) == 0)
+    return;
+
+  g_free (*field);
+  *field = g_strdup (value);
+
+  g_object_notify_by_pspec (G_OBJECT (self), props[prop_id]);
+}
+
+static gboolean
+property_changed (GVariant            *changed_properties,
+                  const gchar * const *invalidated_properties,
+                  const gchar         *name)
+{
+  g_autoptr(GVariant) value = NULL;
+
+  value = g_variant_lookup_value (changed_properties, name, NULL);
+
+  return value != NULL || g_strv_contains (invalidated_properties, name);
+}
+
+static char *
+get_renderer_from_session (void)
+{
+  g_autoptr(GDBusProxy) session_proxy = NULL;
+  g_autoptr(GVariant) renderer_variant = NULL;
+  char *renderer;
+  g_autoptr(GError) error = NULL;
+
+  session_proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
+                                                 G_DBUS_PROXY_FLAGS_NONE,
+                                                 NULL,
+                                                 "org.gnome.SessionManager",
+                                                 "/org/gnome/SessionManager",
+                                                 "org.gnome.SessionManager",
+                                                 NULL, &error);
+  if (error != NULL)
+    {
+      g_warning ("Unable to connect to create a proxy for org.gnome.SessionManager: %s",
+                 error->message);
+      return NULL;
+    }
+
+  renderer_variant = g_dbus_proxy_get_cached_property (session_proxy, "Renderer");
+
+  if (!renderer_variant)
+    {
+      g_warning ("Unable to retrieve org.gnome.SessionManager.Renderer property");
+      return NULL;
+    }
+
+  renderer = info_cleanup (g_variant_get_string (renderer_variant, NULL));
+
+  return renderer;
+}
+
+/* @env is an array of strings with each pair of strings being the
+ * key followed by the value */
+static char *
+get_renderer_from_helper (const char **env)
+{
+  int status;
+  char *argv[] = { LIBEXECDIR "/gnome-control-center-print-renderer", NULL };
+  g_auto(GStrv) envp = NULL;
+  g_autofree char *renderer = NULL;
+  g_autoptr(GError) error = NULL;
+
+  g_debug ("About to launch '%s'", argv[0]);
+
+  if (env != NULL)
+    {
+      guint i;
+      g_debug ("With environment:");
+      envp = g_get_environ ();
+      for (i = 0; env != NULL && env[i] != NULL; i = i + 2)
+        {
+          g_debug ("  %s = %s", env[i], env[i+1]);
+          envp = g_environ_setenv (envp, env[i], env[i+1], TRUE);
+        }
+    }
+  else
+    {
+      g_debug ("No additional environment variables");
+    }
+
+  if (!g_spawn_sync (NULL, (char **) argv, envp, 0, NULL, NULL, &renderer, NULL, &status, &error))
+    {
+      g_debug ("Failed to get GPU: %s", error->message);
+      return NULL;
+    }
+
+  if (!g_spawn_check_wait_status (status, NULL))
+    return NULL;
+
+  if (renderer == NULL || *renderer == '\0')
+    return NULL;
+
+  return info_cleanup (renderer);
+}
+
+typedef struct {
+  char *name;
+  gboolean is_default;
+} GpuData;
+
+static int
+gpu_data_sort (gconstpointer a, gconstpointer b)
+{
+  GpuData *gpu_a = (GpuData *) a;
+  GpuData *gpu_b = (GpuData *) b;
+
+  if (gpu_a->is_default)
+    return 1;
+  if (gpu_b->is_default)
+    return -1;
+  return 0;
+}
+
+static void
+gpu_data_free (GpuData *data)
+{
+  g_free (data->name);
+  g_free (data);
+}
+
+static char *
+get_renderer_from_switcheroo (void)
+{
+  g_autoptr(GDBusProxy) switcheroo_proxy = NULL;
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GError) error = NULL;
+  GString *renderers_string;
+  guint i, num_children;
+  GSList *renderers, *l;
+
+  switcheroo_proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SYSTEM,
+                                                    G_DBUS_PROXY_FLAGS_NONE,
+                                                    NULL,
+                                                    "net.hadess.SwitcherooControl",
+                                                    "/net/hadess/SwitcherooControl",
+                                                    "net.hadess.SwitcherooControl",
+                                                    NULL, &error);
+  if (switcheroo_proxy == NULL)
+    {
+      g_debug ("Unable to connect to create a proxy for net.hadess.SwitcherooControl: %s",
+               error->message);
+      return NULL;
+    }
+
+  variant = g_dbus_proxy_get_cached_property (switcheroo_proxy, "GPUs");
+
+  if (!variant)
+    {
+      g_debug ("Unable to retrieve net.hadess.SwitcherooControl.GPUs property, the daemon is likely not running");
+      return NULL;
+    }
+
+  renderers_string = g_string_new (NULL);
+  num_children = g_variant_n_children (variant);
+  renderers = NULL;
+  for (i = 0; i < num_children; i++)
+    {
+      g_autoptr(GVariant) gpu;
+      g_autoptr(GVariant) name = NULL;
+      g_autoptr(GVariant) env = NULL;
+      g_autoptr(GVariant) default_variant = NULL;
+      const char *name_s;
+      g_autofree const char **env_s = NULL;
+      gsize env_len;
+      g_autofree char *renderer = NULL;
+      GpuData *gpu_data;
+
+      gpu = g_variant_get_child_value (variant, i);
+      if (!gpu ||
+          !g_variant_is_of_type (gpu, G_VARIANT_TYPE ("a{s*}")))
+        continue;
+
+      name = g_variant_lookup_value (gpu, "Name", NULL);
+      env = g_variant_lookup_value (gpu, "Environment", NULL);
+      if (!name || !env)
+        continue;
+      name_s = g_variant_get_string (name, NULL);
+      g_debug ("Getting renderer from helper for GPU '%s'", name_s);
+      env_s = g_variant_get_strv (env, &env_len);
+      if (env_s != NULL && env_len % 2 != 0)
+        {
+          g_autofree char *debug = NULL;
+          debug = g_strjoinv ("\n", (char **) env_s);
+          g_warning ("Invalid environment returned from switcheroo:\n%s", debug);
+          g_clear_pointer (&env_s, g_free);
+        }
+
+      renderer = get_renderer_from_helper (env_s);
+      default_variant = g_variant_lookup_value (gpu, "Default", NULL);
+
+      /* We could give up if we don't have a renderer, but that
+       * might just mean gnome-session isn't installed. We fall back
+       * to the device name in udev instead, which is better than nothing */
+
+      gpu_data = g_new0 (GpuData, 1);
+      gpu_data->name = g_strdup (renderer ? renderer : name_s);
+      gpu_data->is_default = default_variant ? g_variant_get_boolean (default_variant) : FALSE;
+      renderers = g_slist_prepend (renderers, gpu_data);
+    }
+
+  renderers = g_slist_sort (renderers, gpu_data_sort);
+  for (l = renderers; l != NULL; l = l->next)
+    {
+      GpuData *data = l->data;
+      if (renderers_string->len > 0)
+        g_string_append (renderers_string, " / ");
+      g_string_append (renderers_string, data->name);
+    }
+  g_slist_free_full (renderers, (GDestroyNotify) gpu_data_free);
+
+  if (renderers_string->len == 0)
+    {
+      g_string_free (renderers_string, TRUE);
+      return NULL;
+    }
+
+  return g_string_free (renderers_string, FALSE);
+}
+
+static gchar *
+get_graphics_hardware_string (void)
+{
+  g_autofree char *discrete_renderer = NULL;
+  g_autofree char *renderer = NULL;
+
+  renderer = get_renderer_from_switcheroo ();
+  if (!renderer)
+    renderer = get_renderer_from_session ();
+  if (!renderer)
+    renderer = get_renderer_from_helper (NULL);
+  if (!renderer)
+    return g_strdup (_("Unknown"));
+  return g_strdup (renderer);
+}
+
+static char *
+get_cpu_info (const glibtop_sysinfo *info)
+{
+  g_autoptr(GHashTable) counts = NULL;
+  g_autoptr(GString) cpu = NULL;
+  GHashTableIter iter;
+  gpointer       key, value;
+  int            i;
+  int            j;
+
+  counts = g_hash_table_new (g_str_hash, g_str_equal);
+
+  /* count duplicates */
+  for (i = 0; i != info->ncpu; ++i)
+    {
+      const char * const keys[] = { "model name", "cpu", "Processor" };
+      char *model;
+      int  *count;
+
+      model = NULL;
+
+      for (j = 0; model == NULL && j != G_N_ELEMENTS (keys); ++j)
+        {
+          model = g_hash_table_lookup (info->cpuinfo[i].values,
+                                       keys[j]);
+        }
+
+      if (model == NULL)
+          continue;
+
+      count = g_hash_table_lookup (counts, model);
+      if (count == NULL)
+        g_hash_table_insert (counts, model, GINT_TO_POINTER (1));
+      else
+        g_hash_table_replace (counts, model, GINT_TO_POINTER (GPOINTER_TO_INT (count) + 1));
+    }
+
+  cpu = g_string_new (NULL);
+  g_hash_table_iter_init (&iter, counts);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      g_autofree char *cleanedup = NULL;
+      int count;
+
+      count = GPOINTER_TO_INT (value);
+      cleanedup = info_cleanup ((const char *) key);
+      if (cpu->len != 0)
+        g_string_append_printf (cpu, " ");
+      if (count > 1)
+        g_string_append_printf (cpu, "%s \303\227 %d", cleanedup, count);
+      else
+        g_string_append_printf (cpu, "%s", cleanedup);
+    }
+
+  return g_strdup (cpu->str);
+}
+
+/* libgtop isn't thread-safe, and the lookups run in separate threads */
+G_LOCK_DEFINE_STATIC (libgtop);
+
+static guint64
+get_ram_size_libgtop (void)
+{
+  glibtop_mem mem;
+
+  G_LOCK (libgtop);
+  glibtop_get_mem (&mem);
+  G_UNLOCK (libgtop);
+
+  return mem.total;
+}
+
+static guint64
+get_ram_size_dmi (void)
+{
+  g_autoptr(GUdevClient) client = NULL;
+  g_autoptr(GUdevDevice) dmi = NULL;
+  const gchar * const subsystems[] = {"dmi", NULL };
+  guint64 ram_total = 0;
+  guint64 num_ram;
+  guint i;
+
+  client = g_udev_client_new (subsystems);
+  dmi = g_udev_client_query_by_sysfs_path (client, "/sys/devices/virtual/dmi/id");
+  if (!dmi)
+    return 0;
+  num_ram = g_udev_device_get_property_as_uint64 (dmi, "MEMORY_ARRAY_NUM_DEVICES");
+  for (i = 0; i < num_ram ; i++) {
+    g_autofree char *prop = NULL;
+
+    prop = g_strdup_printf ("MEMORY_DEVICE_%d_SIZE", i);
+    ram_total += g_udev_device_get_property_as_uint64 (dmi, prop);
+  }
+  return ram_total;
+}
+
+static gchar *
+lookup_graphics (void)
+{
+  return get_graphics_hardware_string ();
+}
+
+static gchar *
+lookup_processor (void)
+{
+  gchar *cpu;
+
+  /* The sysinfo is a static buffer of libgtop's */
+  G_LOCK (libgtop);
+  cpu = get_cpu_info (glibtop_get_sysinfo ());
+  G_UNLOCK (libgtop);
+
+  return cpu;
+}
+
+static gchar *
+lookup_memory (void)
+{
+  guint64 ram_size;
+
+  ram_size = get_ram_size_dmi ();
+  if (ram_size == 0)
+    ram_size = get_ram_size_libgtop ();
+
+  return g_format_size_full (ram_size, G_FORMAT_SIZE_IEC_UNITS);
+}
+
+static void
+lookup_thread (GTask        *task,
+               gpointer      source_object,
+               gpointer      task_data,
+               GCancellable *cancellable)
+{
+  Lookup *lookup = task_data;
+  gchar *value;
+
+  switch (lookup->prop_id)
+    {
+    case PROP_GRAPHICS:
+      value = lookup_graphics ();
+      break;
+    case PROP_PROCESSOR:
+      value = lookup_processor ();
+      break;
+    case PROP_MEMORY:
+      value = lookup_memory ();
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  g_task_return_pointer (task, value, g_free);
+}
+
+static void
+lookup_done_cb (GObject      *object,
+                GAsyncResult *result,
+                gpointer      user_data)
+{
+  Lookup *lookup = g_task_get_task_data (G_TASK (result));
+  g_autofree gchar *value = NULL;
+
+  value = g_task_propagate_pointer (G_TASK (result), NULL);
+
+  if (lookup->serial == CC_HARDWARE_INFO (object)->lookup_serials[lookup->prop_id])
+    set_field (CC_HARDWARE_INFO (object), lookup->prop_id, value);
+}
+
+static void
+start_lookup (CcHardwareInfo *self,
+              guint           prop_id)
+{
+  g_autoptr(GTask) task = NULL;
+  Lookup *lookup;
+
+  lookup = g_new0 (Lookup, 1);
+  lookup->prop_id = prop_id;
+  lookup->serial = ++self->lookup_serials[prop_id];
+
+  task = g_task_new (self, NULL, lookup_done_cb, NULL);
+  g_task_set_source_tag (task, start_lookup);
+  g_task_set_task_data (task, lookup, g_free);
+  g_task_run_in_thread (task, lookup_thread);
+}
+
+static void
+update_hardware_model (CcHardwareInfo *self)
+{
+  g_autoptr(GVariant) vendor_variant = NULL;
+  g_autoptr(GVariant) model_variant = NULL;
+  g_autofree gchar *vendor_model = NULL;
+  const char *vendor_string, *model_string;
+
+  vendor_variant = g_dbus_proxy_get_cached_property (self->hostnamed_proxy, "HardwareVendor");
+  model_variant = g_dbus_proxy_get_cached_property (self->hostnamed_proxy, "HardwareModel");
+
+  if (!vendor_variant || !model_variant)
+    {
+      g_debug ("Unable to retrieve org.freedesktop.hostname1.HardwareVendor and HardwareModel properties");
+      set_field (self, PROP_HARDWARE_MODEL, NULL);
+      return;
+    }
+
+  vendor_string = g_variant_get_string (vendor_variant, NULL);
+  model_string = g_variant_get_string (model_variant, NULL);
+
+  if (vendor_string && g_strcmp0 (vendor_string, "") != 0)
+    vendor_model = g_strdup_printf ("%s %s", vendor_string, model_string);
+
+  set_field (self, PROP_HARDWARE_MODEL, vendor_model);
+}
+
+static void
+on_hostnamed_properties_changed_cb (CcHardwareInfo      *self,
+                                    GVariant            *changed_properties,
+                                    const gchar * const *invalidated_properties)
+{
+  if (property_changed (changed_properties, invalidated_properties, "HardwareVendor") ||
+      property_changed (changed_properties, invalidated_properties, "HardwareModel"))
+    update_hardware_model (self);
+}
+
+static void
+hostnamed_proxy_ready_cb (GObject      *source,
+                          GAsyncResult *result,
+                          gpointer      user_data)
+{
+  CcHardwareInfo *self = CC_HARDWARE_INFO (user_data);
+  g_autoptr(GError) error = NULL;
+
+  self->hostnamed_proxy = g_dbus_proxy_new_for_bus_finish (result, &error);
+  if (self->hostnamed_proxy == NULL)
+    {
+      g_debug ("Couldn't get hostnamed to start, bailing: %s", error->message);
+      return;
+    }
+
+  g_signal_connect_object (self->hostnamed_proxy,
+                           "g-properties-changed",
+                           G_CALLBACK (on_hostnamed_properties_changed_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+
+  update_hardware_model (self);
+}
+
+static void
+on_switcheroo_properties_changed_cb (CcHardwareInfo      *self,
+                                     GVariant            *changed_properties,
+                                     const gchar * const *invalidated_properties)
+{
+  if (property_changed (changed_properties, invalidated_properties, "GPUs"))
+    start_lookup (self, PROP_GRAPHICS);
+}
+
+static void
+switcheroo_proxy_ready_cb (GObject      *source,
+                           GAsyncResult *result,
+                           gpointer      user_data)
+{
+  CcHardwareInfo *self = CC_HARDWARE_INFO (user_data);
+  g_autoptr(GError) error = NULL;
+
+  self->switcheroo_proxy = g_dbus_proxy_new_for_bus_finish (result, &error);
+  if (self->switcheroo_proxy == NULL)
+    {
+      g_debug ("Unable to connect to create a proxy for net.hadess.SwitcherooControl: %s",
+               error->message);
+      return;
+    }
+
+  /* The GPUs were already looked up, this is only to notice changes */
+  g_signal_connect_object (self->switcheroo_proxy,
+                           "g-properties-changed",
+                           G_CALLBACK (on_switcheroo_properties_changed_cb),
+                           self,
+                           G_CONNECT_SWAPPED);
+}
+
+static void
+update_disk (CcHardwareInfo *self)
+{
+  GDBusObjectManager *manager;
+  g_autolist(GDBusObject) objects = NULL;
+  GList *l;
+  guint64 total_size;
+
+  total_size = 0;
+
+  manager = udisks_client_get_object_manager (self->udisks_client);
+  objects = g_dbus_object_manager_get_objects (manager);
+
+  for (l = objects; l != NULL; l = l->next)
+    {
+      UDisksDrive *drive;
+      drive = udisks_object_peek_drive (UDISKS_OBJECT (l->data));
+
+      /* Skip removable devices */
+      if (drive == NULL ||
+          udisks_drive_get_removable (drive) ||
+          udisks_drive_get_ejectable (drive))
+        {
+          continue;
+        }
+
+      total_size += udisks_drive_get_size (drive);
+    }
+
+  if (total_size > 0)
+    {
+      g_autofree gchar *size = g_format_size (total_size);
+      set_field (self, PROP_DISK, size);
+    }
+  else
+    {
+      set_field (self, PROP_DISK, _("Unknown"));
+    }
+}
+
+static void
+udisks_client_ready_cb (GObject      *source,
+                        GAsyncResult *result,
+                        gpointer      user_data)
+{
+  CcHardwareInfo *self = CC_HARDWARE_INFO (user_data);
+  GDBusObjectManager *manager;
+  g_autoptr(GError) error = NULL;
+
+  self->udisks_client = udisks_client_new_finish (result, &error);
+  if (self->udisks_client == NULL)
+    {
+      g_warning ("Unable to get UDisks client: %s. Disk information will not be available.",
+                 error->message);
+      set_field (self, PROP_DISK, _("Unknown"));
+      return;
+    }
+
+  /* Drives only show up or go away, their size doesn't change */
+  manager = udisks_client_get_object_manager (self->udisks_client);
+  g_signal_connect_object (manager, "object-added", G_CALLBACK (update_disk), self, G_CONNECT_SWAPPED);
+  g_signal_connect_object (manager, "object-removed", G_CALLBACK (update_disk), self, G_CONNECT_SWAPPED);
+
+  update_disk (self);
+}
+
+static void
+virtualization_ready_cb (GObject      *source,
+                         GAsyncResult *result,
+                         gpointer      user_data)
+{
+  CcHardwareInfo *self = CC_HARDWARE_INFO (user_data);
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(GVariant) inner = NULL;
+  g_autoptr(GError) error = NULL;
+
+  variant = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source), result, &error);
+  if (variant == NULL)
+    {
+      g_debug ("Failed to get property '%s': %s", "Virtualization", error->message);
+      return;
+    }
+
+  g_variant_get (variant, "(v)", &inner);
+  set_field (self, PROP_VIRTUALIZATION, g_variant_get_string (inner, NULL));
+}
+
+static void
+system_bus_ready_cb (GObject      *source,
+                     GAsyncResult *result,
+                     gpointer      user_data)
+{
+  CcHardwareInfo *self = CC_HARDWARE_INFO (user_data);
+  g_autoptr(GDBusConnection) connection = NULL;
+  g_autoptr(GError) error = NULL;
+
+  connection = g_bus_get_finish (result, &error);
+  if (connection == NULL)
+    {
+      g_debug ("systemd not available, bailing: %s", error->message);
+      return;
+    }
+
+  g_dbus_connection_call (connection,
+                          "org.freedesktop.systemd1",
+                          "/org/freedesktop/systemd1",
+                          "org.freedesktop.DBus.Properties",
+                          "Get",
+                          g_variant_new ("(ss)", "org.freedesktop.systemd1.Manager", "Virtualization"),
+                          G_VARIANT_TYPE ("(v)"),
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          NULL,
+                          virtualization_ready_cb,
+                          self);
+}
+
+static void
+cc_hardware_info_finalize (GObject *object)
+{
+  CcHardwareInfo *self = CC_HARDWARE_INFO (object);
+
+  g_clear_object (&self->hostnamed_proxy);
+  g_clear_object (&self->switcheroo_proxy);
+  g_clear_object (&self->udisks_client);
+  g_clear_pointer (&self->hardware_model, g_free);
+  g_clear_pointer (&self->memory, g_free);
+  g_clear_pointer (&self->processor, g_free);
+  g_clear_pointer (&self->graphics, g_free);
+  g_clear_pointer (&self->disk, g_free);
+  g_clear_pointer (&self->virtualization, g_free);
+
+  G_OBJECT_CLASS (cc_hardware_info_parent_class)->finalize (object);
+}
+
+static void
+cc_hardware_info_get_property (GObject    *object,
+                               guint       prop_id,
+                               GValue     *value,
+                               GParamSpec *pspec)
+{
+  CcHardwareInfo *self = CC_HARDWARE_INFO (object);
+
+  switch (prop_id)
+    {
+    case PROP_HARDWARE_MODEL:
+    case PROP_MEMORY:
+    case PROP_PROCESSOR:
+    case PROP_GRAPHICS:
+    case PROP_DISK:
+    case PROP_VIRTUALIZATION:
+      g_value_set_string (value, *get_field (self, prop_id));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+    }
+}
+
+static void
+cc_hardware_info_class_init (CcHardwareInfoClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_hardware_info_finalize;
+  object_class->get_property = cc_hardware_info_get_property;
+
+  props[PROP_HARDWARE_MODEL] =
+    g_param_spec_string ("hardware-model", NULL, NULL, NULL,
+                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  props[PROP_MEMORY] =
+    g_param_spec_string ("memory", NULL, NULL, NULL,
+                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  props[PROP_PROCESSOR] =
+    g_param_spec_string ("processor", NULL, NULL, NULL,
+                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  props[PROP_GRAPHICS] =
+    g_param_spec_string ("graphics", NULL, NULL, NULL,
+                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  props[PROP_DISK] =
+    g_param_spec_string ("disk", NULL, NULL, NULL,
+                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+  props[PROP_VIRTUALIZATION] =
+    g_param_spec_string ("virtualization", NULL, NULL, NULL,
+                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, N_PROPS, props);
+}
+
+static void
+cc_hardware_info_init (CcHardwareInfo *self)
+{
+  start_lookup (self, PROP_GRAPHICS);
+  start_lookup (self, PROP_PROCESSOR);
+  start_lookup (self, PROP_MEMORY);
+
+  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
+                            G_DBUS_PROXY_FLAGS_NONE,
+                            NULL,
+                            "org.freedesktop.hostname1",
+                            "/org/freedesktop/hostname1",
+                            "org.freedesktop.hostname1",
+                            NULL,
+                            hostnamed_proxy_ready_cb,
+                            self);
+
+  g_dbus_proxy_new_for_bus (G_BUS_TYPE_SYSTEM,
+                            G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START,
+                            NULL,
+                            "net.hadess.SwitcherooControl",
+                            "/net/hadess/SwitcherooControl",
+                            "net.hadess.SwitcherooControl",
+                            NULL,
+                            switcheroo_proxy_ready_cb,
+                            self);
+
+  udisks_client_new (NULL, udisks_client_ready_cb, self);
+
+  g_bus_get (G_BUS_TYPE_SYSTEM, NULL, system_bus_ready_cb, self);
+}
+
+/**
+ * cc_hardware_info_get_default:
+ *
+ * Gets the hardware inventory of the session, starting to gather it the
+ * first time.
+ *
+ * Returns: (transfer none): the #CcHardwareInfo
+ */
+CcHardwareInfo *
+cc_hardware_info_get_default (void)
+{
+  static CcHardwareInfo *default_info = NULL;
+
+  /* Lives for the whole session, so callbacks never outlive it */
+  if (default_info == NULL)
+    default_info = g_object_new (CC_TYPE_HARDWARE_INFO, NULL);
+
+  return default_info;
+}
+
+const gchar *
+cc_hardware_info_get_hardware_model (CcHardwareInfo *self)
+{
+  g_return_val_if_fail (CC_IS_HARDWARE_INFO (self), NULL);
+
+  return self->hardware_model;
+}
+
+const gchar *
+cc_hardware_info_get_memory (CcHardwareInfo *self)
+{
+  g_return_val_if_fail (CC_IS_HARDWARE_INFO (self), NULL);
+
+  return self->memory;
+}
+
+const gchar *
+cc_hardware_info_get_processor (CcHardwareInfo *self)
+{
+  g_return_val_if_fail (CC_IS_HARDWARE_INFO (self), NULL);
+
+  return self->processor;
+}
+
+const gchar *
+cc_hardware_info_get_graphics (CcHardwareInfo *self)
+{
+  g_return_val_if_fail (CC_IS_HARDWARE_INFO (self), NULL);
+
+  return self->graphics;
+}
+
+const gchar *
+cc_hardware_info_get_disk (CcHardwareInfo *self)
+{
+  g_return_val_if_fail (CC_IS_HARDWARE_INFO (self), NULL);
+
+  return self->disk;
+}
+
+/* The systemd id of the virtualization technology, empty if none */
+const gchar *
+cc_hardware_info_get_virtualization (CcHardwareInfo *self)
+{
+  g_return_val_if_fail (CC_IS_HARDWARE_INFO (self), NULL);
+
+  return self->virtualization;
+}
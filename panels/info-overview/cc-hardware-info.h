@@ -0,0 +1,43 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright 2026 The GNOME Settings authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define CC_TYPE_HARDWARE_INFO (cc_hardware_info_get_type ())
+G_DECLARE_FINAL_TYPE (CcHardwareInfo, cc_hardware_info, CC, HARDWARE_INFO, GObject)
+
+CcHardwareInfo *cc_hardware_info_get_default        (void);
+
+const gchar    *cc_hardware_info_get_hardware_model (CcHardwareInfo *self);
+
+const gchar    *cc_hardware_info_get_memory         (CcHardwareInfo *self);
+
+const gchar    *cc_hardware_info_get_processor      (CcHardwareInfo *self);
+
+const gchar    *cc_hardware_info_get_graphics       (CcHardwareInfo *self);
+
+const gchar    *cc_hardware_info_get_disk           (CcHardwareInfo *self);
+
+const gchar    *cc_hardware_info_get_virtualization (CcHardwareInfo *self);
+
+G_END_DECLS
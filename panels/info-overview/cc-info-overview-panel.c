@@ -22,11 +22,11 @@
 
 #include <config.h>
 
+#include "cc-hardware-info.h"
 #include "cc-hostname-entry.h"
 #include "shell/cc-object-storage.h"
 
 #include "cc-info-overview-resources.h"
-#include "info-cleanup.h"
 #include "cc-util.h"
 
 #include <glib.h>
@@ -37,10 +37,6 @@
 
 #include <glibtop/fsusage.h>
 #include <glibtop/mountlist.h>
-#include <glibtop/mem.h>
-#include <glibtop/sysinfo.h>
-#include <udisks/udisks.h>
-#include <gudev/gudev.h>
 
 #include <gdk/gdk.h>
 
@@ -76,6 +72,8 @@ struct _CcInfoOverviewPanel
   AdwActionRow    *software_updates_row;
   CcListRow       *virtualization_row;
   CcListRow       *windowing_system_row;
+
+  CcHardwareInfo  *hardware_info;
 };
 
 G_DEFINE_TYPE (CcInfoOverviewPanel, cc_info_overview_panel, CC_TYPE_PANEL)
@@ -92,225 +90,6 @@ on_attribution_label_link (GtkLinkButton       *link_button,
   return cc_util_show_endless_terms_of_use (toplevel);
 }
 
-static char *
-get_renderer_from_session (void)
-{
-  g_autoptr(GDBusProxy) session_proxy = NULL;
-  g_autoptr(GVariant) renderer_variant = NULL;
-  char *renderer;
-  g_autoptr(GError) error = NULL;
-
-  session_proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SESSION,
-                                                 G_DBUS_PROXY_FLAGS_NONE,
-                                                 NULL,
-                                                 "org.gnome.SessionManager",
-                                                 "/org/gnome/SessionManager",
-                                                 "org.gnome.SessionManager",
-                                                 NULL, &error);
-  if (error != NULL)
-    {
-      g_warning ("Unable to connect to create a proxy for org.gnome.SessionManager: %s",
-                 error->message);
-      return NULL;
-    }
-
-  renderer_variant = g_dbus_proxy_get_cached_property (session_proxy, "Renderer");
-
-  if (!renderer_variant)
-    {
-      g_warning ("Unable to retrieve org.gnome.SessionManager.Renderer property");
-      return NULL;
-    }
-
-  renderer = info_cleanup (g_variant_get_string (renderer_variant, NULL));
-
-  return renderer;
-}
-
-/* @env is an array of strings with each pair of strings being the
- * key followed by the value */
-static char *
-get_renderer_from_helper (const char **env)
-{
-  int status;
-  char *argv[] = { LIBEXECDIR "/gnome-control-center-print-renderer", NULL };
-  g_auto(GStrv) envp = NULL;
-  g_autofree char *renderer = NULL;
-  g_autoptr(GError) error = NULL;
-
-  g_debug ("About to launch '%s'", argv[0]);
-
-  if (env != NULL)
-    {
-      guint i;
-      g_debug ("With environment:");
-      envp = g_get_environ ();
-      for (i = 0; env != NULL && env[i] != NULL; i = i + 2)
-        {
-          g_debug ("  %s = %s", env[i], env[i+1]);
-          envp = g_environ_setenv (envp, env[i], env[i+1], TRUE);
-        }
-    }
-  else
-    {
-      g_debug ("No additional environment variables");
-    }
-
-  if (!g_spawn_sync (NULL, (char **) argv, envp, 0, NULL, NULL, &renderer, NULL, &status, &error))
-    {
-      g_debug ("Failed to get GPU: %s", error->message);
-      return NULL;
-    }
-
-  if (!g_spawn_check_wait_status (status, NULL))
-    return NULL;
-
-  if (renderer == NULL || *renderer == '\0')
-    return NULL;
-
-  return info_cleanup (renderer);
-}
-
-typedef struct {
-  char *name;
-  gboolean is_default;
-} GpuData;
-
-static int
-gpu_data_sort (gconstpointer a, gconstpointer b)
-{
-  GpuData *gpu_a = (GpuData *) a;
-  GpuData *gpu_b = (GpuData *) b;
-
-  if (gpu_a->is_default)
-    return 1;
-  if (gpu_b->is_default)
-    return -1;
-  return 0;
-}
-
-static void
-gpu_data_free (GpuData *data)
-{
-  g_free (data->name);
-  g_free (data);
-}
-
-static char *
-get_renderer_from_switcheroo (void)
-{
-  g_autoptr(GDBusProxy) switcheroo_proxy = NULL;
-  g_autoptr(GVariant) variant = NULL;
-  g_autoptr(GError) error = NULL;
-  GString *renderers_string;
-  guint i, num_children;
-  GSList *renderers, *l;
-
-  switcheroo_proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SYSTEM,
-                                                    G_DBUS_PROXY_FLAGS_NONE,
-                                                    NULL,
-                                                    "net.hadess.SwitcherooControl",
-                                                    "/net/hadess/SwitcherooControl",
-                                                    "net.hadess.SwitcherooControl",
-                                                    NULL, &error);
-  if (switcheroo_proxy == NULL)
-    {
-      g_debug ("Unable to connect to create a proxy for net.hadess.SwitcherooControl: %s",
-               error->message);
-      return NULL;
-    }
-
-  variant = g_dbus_proxy_get_cached_property (switcheroo_proxy, "GPUs");
-
-  if (!variant)
-    {
-      g_debug ("Unable to retrieve net.hadess.SwitcherooControl.GPUs property, the daemon is likely not running");
-      return NULL;
-    }
-
-  renderers_string = g_string_new (NULL);
-  num_children = g_variant_n_children (variant);
-  renderers = NULL;
-  for (i = 0; i < num_children; i++)
-    {
-      g_autoptr(GVariant) gpu;
-      g_autoptr(GVariant) name = NULL;
-      g_autoptr(GVariant) env = NULL;
-      g_autoptr(GVariant) default_variant = NULL;
-      const char *name_s;
-      g_autofree const char **env_s = NULL;
-      gsize env_len;
-      g_autofree char *renderer = NULL;
-      GpuData *gpu_data;
-
-      gpu = g_variant_get_child_value (variant, i);
-      if (!gpu ||
-          !g_variant_is_of_type (gpu, G_VARIANT_TYPE ("a{s*}")))
-        continue;
-
-      name = g_variant_lookup_value (gpu, "Name", NULL);
-      env = g_variant_lookup_value (gpu, "Environment", NULL);
-      if (!name || !env)
-        continue;
-      name_s = g_variant_get_string (name, NULL);
-      g_debug ("Getting renderer from helper for GPU '%s'", name_s);
-      env_s = g_variant_get_strv (env, &env_len);
-      if (env_s != NULL && env_len % 2 != 0)
-        {
-          g_autofree char *debug = NULL;
-          debug = g_strjoinv ("\n", (char **) env_s);
-          g_warning ("Invalid environment returned from switcheroo:\n%s", debug);
-          g_clear_pointer (&env_s, g_free);
-        }
-
-      renderer = get_renderer_from_helper (env_s);
-      default_variant = g_variant_lookup_value (gpu, "Default", NULL);
-
-      /* We could give up if we don't have a renderer, but that
-       * might just mean gnome-session isn't installed. We fall back
-       * to the device name in udev instead, which is better than nothing */
-
-      gpu_data = g_new0 (GpuData, 1);
-      gpu_data->name = g_strdup (renderer ? renderer : name_s);
-      gpu_data->is_default = default_variant ? g_variant_get_boolean (default_variant) : FALSE;
-      renderers = g_slist_prepend (renderers, gpu_data);
-    }
-
-  renderers = g_slist_sort (renderers, gpu_data_sort);
-  for (l = renderers; l != NULL; l = l->next)
-    {
-      GpuData *data = l->data;
-      if (renderers_string->len > 0)
-        g_string_append (renderers_string, " / ");
-      g_string_append (renderers_string, data->name);
-    }
-  g_slist_free_full (renderers, (GDestroyNotify) gpu_data_free);
-
-  if (renderers_string->len == 0)
-    {
-      g_string_free (renderers_string, TRUE);
-      return NULL;
-    }
-
-  return g_string_free (renderers_string, FALSE);
-}
-
-static gchar *
-get_graphics_hardware_string (void)
-{
-  g_autofree char *discrete_renderer = NULL;
-  g_autofree char *renderer = NULL;
-
-  renderer = get_renderer_from_switcheroo ();
-  if (!renderer)
-    renderer = get_renderer_from_session ();
-  if (!renderer)
-    renderer = get_renderer_from_helper (NULL);
-  if (!renderer)
-    return g_strdup (_("Unknown"));
-  return g_strdup (renderer);
-}
-
 static char *
 get_os_name (void)
 {
@@ -351,165 +130,6 @@ get_os_type (void)
     return g_strdup_printf (_("32-bit"));
 }
 
-static void
-get_primary_disc_info (CcInfoOverviewPanel *self)
-{
-  g_autoptr(UDisksClient) client = NULL;
-  GDBusObjectManager *manager;
-  g_autolist(GDBusObject) objects = NULL;
-  GList *l;
-  guint64 total_size;
-  g_autoptr(GError) error = NULL;
-
-  total_size = 0;
-
-  client = udisks_client_new_sync (NULL, &error);
-  if (client == NULL)
-    {
-      g_warning ("Unable to get UDisks client: %s. Disk information will not be available.",
-                 error->message);
-      cc_list_row_set_secondary_label (self->disk_row,  _("Unknown"));
-      return;
-    }
-
-  manager = udisks_client_get_object_manager (client);
-  objects = g_dbus_object_manager_get_objects (manager);
-
-  for (l = objects; l != NULL; l = l->next)
-    {
-      UDisksDrive *drive;
-      drive = udisks_object_peek_drive (UDISKS_OBJECT (l->data));
-
-      /* Skip removable devices */
-      if (drive == NULL ||
-          udisks_drive_get_removable (drive) ||
-          udisks_drive_get_ejectable (drive))
-        {
-          continue;
-        }
-
-      total_size += udisks_drive_get_size (drive);
-    }
-
-  if (total_size > 0)
-    {
-      g_autofree gchar *size = g_format_size (total_size);
-      cc_list_row_set_secondary_label (self->disk_row, size);
-    }
-  else
-    {
-      cc_list_row_set_secondary_label (self->disk_row,  _("Unknown"));
-    }
-}
-
-static void
-get_hardware_model (CcInfoOverviewPanel *self)
-{
-  g_autoptr(GDBusProxy) hostnamed_proxy = NULL;
-  g_autoptr(GVariant) vendor_variant = NULL;
-  g_autoptr(GVariant) model_variant = NULL;
-  const char *vendor_string, *model_string;
-  g_autoptr(GError) error = NULL;
-
-  hostnamed_proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SYSTEM,
-                                                   G_DBUS_PROXY_FLAGS_NONE,
-                                                   NULL,
-                                                   "org.freedesktop.hostname1",
-                                                   "/org/freedesktop/hostname1",
-                                                   "org.freedesktop.hostname1",
-                                                   NULL,
-                                                   &error);
-  if (hostnamed_proxy == NULL)
-    {
-      g_debug ("Couldn't get hostnamed to start, bailing: %s", error->message);
-      return;
-    }
-
-  vendor_variant = g_dbus_proxy_get_cached_property (hostnamed_proxy, "HardwareVendor");
-  if (!vendor_variant)
-    {
-      g_debug ("Unable to retrieve org.freedesktop.hostname1.HardwareVendor property");
-      return;
-    }
-
-  model_variant = g_dbus_proxy_get_cached_property (hostnamed_proxy, "HardwareModel");
-  if (!model_variant)
-    {
-      g_debug ("Unable to retrieve org.freedesktop.hostname1.HardwareModel property");
-      return;
-    }
-
-  vendor_string = g_variant_get_string (vendor_variant, NULL),
-  model_string = g_variant_get_string (model_variant, NULL);
-
-  if (vendor_string && g_strcmp0 (vendor_string, "") != 0)
-    {
-      g_autofree gchar *vendor_model = NULL;
-
-      vendor_model = g_strdup_printf ("%s %s", vendor_string, model_string);
-
-      cc_list_row_set_secondary_label (self->hardware_model_row, vendor_model);
-      gtk_widget_set_visible (GTK_WIDGET (self->hardware_model_row), TRUE);
-    }
-}
-
-static char *
-get_cpu_info (const glibtop_sysinfo *info)
-{
-  g_autoptr(GHashTable) counts = NULL;
-  g_autoptr(GString) cpu = NULL;
-  GHashTableIter iter;
-  gpointer       key, value;
-  int            i;
-  int            j;
-
-  counts = g_hash_table_new (g_str_hash, g_str_equal);
-
-  /* count duplicates */
-  for (i = 0; i != info->ncpu; ++i)
-    {
-      const char * const keys[] = { "model name", "cpu", "Processor" };
-      char *model;
-      int  *count;
-
-      model = NULL;
-
-      for (j = 0; model == NULL && j != G_N_ELEMENTS (keys); ++j)
-        {
-          model = g_hash_table_lookup (info->cpuinfo[i].values,
-                                       keys[j]);
-        }
-
-      if (model == NULL)
-          continue;
-
-      count = g_hash_table_lookup (counts, model);
-      if (count == NULL)
-        g_hash_table_insert (counts, model, GINT_TO_POINTER (1));
-      else
-        g_hash_table_replace (counts, model, GINT_TO_POINTER (GPOINTER_TO_INT (count) + 1));
-    }
-
-  cpu = g_string_new (NULL);
-  g_hash_table_iter_init (&iter, counts);
-  while (g_hash_table_iter_next (&iter, &key, &value))
-    {
-      g_autofree char *cleanedup = NULL;
-      int count;
-
-      count = GPOINTER_TO_INT (value);
-      cleanedup = info_cleanup ((const char *) key);
-      if (cpu->len != 0)
-        g_string_append_printf (cpu, " ");
-      if (count > 1)
-        g_string_append_printf (cpu, "%s \303\227 %d", cleanedup, count);
-      else
-        g_string_append_printf (cpu, "%s", cleanedup);
-    }
-
-  return g_strdup (cpu->str);
-}
-
 static struct {
   const char *id;
   const char *display;
@@ -556,48 +176,6 @@ set_virtualization_label (CcInfoOverviewPanel *self,
   cc_list_row_set_secondary_label (self->virtualization_row, display_name ? display_name : virt);
 }
 
-static void
-info_overview_panel_setup_virt (CcInfoOverviewPanel *self)
-{
-  g_autoptr(GError) error = NULL;
-  g_autoptr(GDBusProxy) systemd_proxy = NULL;
-  g_autoptr(GVariant) variant = NULL;
-  GVariant *inner;
-
-  systemd_proxy = g_dbus_proxy_new_for_bus_sync (G_BUS_TYPE_SYSTEM,
-                                                 G_DBUS_PROXY_FLAGS_NONE,
-                                                 NULL,
-                                                 "org.freedesktop.systemd1",
-                                                 "/org/freedesktop/systemd1",
-                                                 "org.freedesktop.systemd1",
-                                                 NULL,
-                                                 &error);
-
-  if (systemd_proxy == NULL)
-    {
-      g_debug ("systemd not available, bailing: %s", error->message);
-      set_virtualization_label (self, NULL);
-      return;
-    }
-
-  variant = g_dbus_proxy_call_sync (systemd_proxy,
-                                    "org.freedesktop.DBus.Properties.Get",
-                                    g_variant_new ("(ss)", "org.freedesktop.systemd1.Manager", "Virtualization"),
-                                    G_DBUS_CALL_FLAGS_NONE,
-                                    -1,
-                                    NULL,
-                                    &error);
-  if (variant == NULL)
-    {
-      g_debug ("Failed to get property '%s': %s", "Virtualization", error->message);
-      set_virtualization_label (self, NULL);
-      return;
-    }
-
-  g_variant_get (variant, "(v)", &inner);
-  set_virtualization_label (self, g_variant_get_string (inner, NULL));
-}
-
 static const char *
 get_windowing_system (void)
 {
@@ -616,39 +194,6 @@ get_windowing_system (void)
   return C_("Windowing system (Wayland, X11, or Unknown)", "Unknown");
 }
 
-static guint64
-get_ram_size_libgtop (void)
-{
-  glibtop_mem mem;
-
-  glibtop_get_mem (&mem);
-  return mem.total;
-}
-
-static guint64
-get_ram_size_dmi (void)
-{
-  g_autoptr(GUdevClient) client = NULL;
-  g_autoptr(GUdevDevice) dmi = NULL;
-  const gchar * const subsystems[] = {"dmi", NULL };
-  guint64 ram_total = 0;
-  guint64 num_ram;
-  guint i;
-
-  client = g_udev_client_new (subsystems);
-  dmi = g_udev_client_query_by_sysfs_path (client, "/sys/devices/virtual/dmi/id");
-  if (!dmi)
-    return 0;
-  num_ram = g_udev_device_get_property_as_uint64 (dmi, "MEMORY_ARRAY_NUM_DEVICES");
-  for (i = 0; i < num_ram ; i++) {
-    g_autofree char *prop = NULL;
-
-    prop = g_strdup_printf ("MEMORY_DEVICE_%d_SIZE", i);
-    ram_total += g_udev_device_get_property_as_uint64 (dmi, prop);
-  }
-  return ram_total;
-}
-
 static char *
 get_gnome_version (GDBusProxy *proxy)
 {
@@ -699,18 +244,45 @@ shell_proxy_ready (GObject             *source,
     }
 }
 
+static void
+update_hardware_info (CcInfoOverviewPanel *self)
+{
+  const gchar *hardware_model;
+  const gchar *memory;
+  const gchar *processor;
+  const gchar *graphics;
+  const gchar *disk;
+
+  hardware_model = cc_hardware_info_get_hardware_model (self->hardware_info);
+  if (hardware_model != NULL)
+    cc_list_row_set_secondary_label (self->hardware_model_row, hardware_model);
+  gtk_widget_set_visible (GTK_WIDGET (self->hardware_model_row), hardware_model != NULL);
+
+  memory = cc_hardware_info_get_memory (self->hardware_info);
+  if (memory != NULL)
+    cc_list_row_set_secondary_label (self->memory_row, memory);
+
+  processor = cc_hardware_info_get_processor (self->hardware_info);
+  if (processor != NULL)
+    cc_list_row_set_secondary_markup (self->processor_row, processor);
+
+  graphics = cc_hardware_info_get_graphics (self->hardware_info);
+  if (graphics != NULL)
+    cc_list_row_set_secondary_markup (self->graphics_row, graphics);
+
+  disk = cc_hardware_info_get_disk (self->hardware_info);
+  if (disk != NULL)
+    cc_list_row_set_secondary_label (self->disk_row, disk);
+
+  set_virtualization_label (self, cc_hardware_info_get_virtualization (self->hardware_info));
+}
+
 static void
 info_overview_panel_setup_overview (CcInfoOverviewPanel *self)
 {
-  g_autofree gchar *gnome_version = NULL;
-  guint64 ram_size;
-  const glibtop_sysinfo *info;
-  g_autofree char *memory_text = NULL;
-  g_autofree char *cpu_text = NULL;
   g_autofree char *os_type_text = NULL;
   g_autofree char *os_name_text = NULL;
   g_autofree char *os_build_text = NULL;
-  g_autofree gchar *graphics_hardware_string = NULL;
 
   cc_object_storage_create_dbus_proxy (G_BUS_TYPE_SESSION,
                                        G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS |
@@ -722,23 +294,14 @@ info_overview_panel_setup_overview (CcInfoOverviewPanel *self)
                                        (GAsyncReadyCallback) shell_proxy_ready,
                                        self);
 
-  get_hardware_model (self);
-
-  ram_size = get_ram_size_dmi ();
-  if (ram_size == 0)
-    ram_size = get_ram_size_libgtop ();
-  memory_text = g_format_size_full (ram_size, G_FORMAT_SIZE_IEC_UNITS);
-  cc_list_row_set_secondary_label (self->memory_row, memory_text);
-
-  info = glibtop_get_sysinfo ();
-
-  cpu_text = get_cpu_info (info);
-  cc_list_row_set_secondary_markup (self->processor_row, cpu_text);
-
-  graphics_hardware_string = get_graphics_hardware_string ();
-  cc_list_row_set_secondary_markup (self->graphics_row, graphics_hardware_string);
-
-  get_primary_disc_info (self);
+  /* Gathered in the background once per session, and filled in as it comes */
+  self->hardware_info = g_object_ref (cc_hardware_info_get_default ());
+  g_signal_connect_object (self->hardware_info,
+                           "notify",
+                           G_CALLBACK (update_hardware_info),
+                           self,
+                           G_CONNECT_SWAPPED);
+  update_hardware_info (self);
 
   os_name_text = get_os_name ();
   cc_list_row_set_secondary_label (self->os_name_row, os_name_text);
@@ -943,11 +506,24 @@ setup_os_logo (CcInfoOverviewPanel *panel)
 #endif
 }
 
+static void
+cc_info_overview_panel_dispose (GObject *object)
+{
+  CcInfoOverviewPanel *self = CC_INFO_OVERVIEW_PANEL (object);
+
+  g_clear_object (&self->hardware_info);
+
+  G_OBJECT_CLASS (cc_info_overview_panel_parent_class)->dispose (object);
+}
+
 static void
 cc_info_overview_panel_class_init (CcInfoOverviewPanelClass *klass)
 {
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
 
+  object_class->dispose = cc_info_overview_panel_dispose;
+
   gtk_widget_class_set_template_from_resource (widget_class, "/org/gnome/control-center/info-overview/cc-info-overview-panel.ui");
 
   gtk_widget_class_bind_template_child (widget_class, CcInfoOverviewPanel, device_name_entry);
@@ -992,7 +568,6 @@ cc_info_overview_panel_init (CcInfoOverviewPanel *self)
     gtk_widget_hide (GTK_WIDGET (self->software_updates_row));
 
   info_overview_panel_setup_overview (self);
-  info_overview_panel_setup_virt (self);
 
   style_manager = adw_style_manager_get_default ();
   g_signal_connect_swapped (style_manager, "notify::dark", G_CALLBACK (setup_os_logo), self);
@@ -29,24 +29,67 @@ typedef struct
   char *replacement;
 } ReplaceStrings;
 
+static const ReplaceStrings rs[] = {
+  { "Mesa DRI ", ""},
+  { "[(]R[)]", "\302\256"},
+  { "[(](tm|TM)[)]", "\342\204\242"},
+  { "(ATI|EPYC|AMD FX|Radeon|Ryzen|Threadripper|GeForce RTX) ", "\\1\342\204\242 "},
+  { "Gallium \\d+\\.\\d+ on (.*)", "\\1"},
+  { " CPU| Processor| \\S+-Core| @ \\d+\\.\\d+GHz", ""},
+  { " x86|/MMX|/SSE2|/PCIe", ""},
+  { " [(][^)]*(DRM|MESA|LLVM)[^)]*[)]?", ""},
+  { "Graphics Controller", "Graphics"},
+  { ".*llvmpipe.*", "Software Rendering"},
+};
+
+typedef struct
+{
+  GRegex *rules[G_N_ELEMENTS (rs)];
+  GRegex *whitespace;
+} Patterns;
+
+static GRegex *
+compile_pattern (const char         *pattern,
+                 GRegexCompileFlags  flags)
+{
+  g_autoptr(GError) error = NULL;
+  GRegex *re;
+
+  re = g_regex_new (pattern, flags | G_REGEX_OPTIMIZE, 0, &error);
+  if (re == NULL)
+    g_warning ("Error building regex: %s", error->message);
+
+  return re;
+}
+
+/* Compiled once, GRegex can then be used from any thread */
+static const Patterns *
+get_patterns (void)
+{
+  static Patterns *patterns = NULL;
+
+  if (g_once_init_enter (&patterns))
+    {
+      Patterns *p = g_new0 (Patterns, 1);
+      int i;
+
+      for (i = 0; i < G_N_ELEMENTS (rs); i++)
+        p->rules[i] = compile_pattern (rs[i].regex, 0);
+      p->whitespace = compile_pattern ("[ \t\n\r]+", G_REGEX_MULTILINE);
+
+      g_once_init_leave (&patterns, p);
+    }
+
+  return patterns;
+}
+
 static char *
 prettify_info (const char *info)
 {
+  const Patterns *patterns = get_patterns ();
   g_autofree char *escaped = NULL;
   g_autofree gchar *pretty = NULL;
   int   i;
-  static const ReplaceStrings rs[] = {
-    { "Mesa DRI ", ""},
-    { "[(]R[)]", "\302\256"},
-    { "[(](tm|TM)[)]", "\342\204\242"},
-    { "(ATI|EPYC|AMD FX|Radeon|Ryzen|Threadripper|GeForce RTX) ", "\\1\342\204\242 "},
-    { "Gallium \\d+\\.\\d+ on (.*)", "\\1"},
-    { " CPU| Processor| \\S+-Core| @ \\d+\\.\\d+GHz", ""},
-    { " x86|/MMX|/SSE2|/PCIe", ""},
-    { " [(][^)]*(DRM|MESA|LLVM)[^)]*[)]?", ""},
-    { "Graphics Controller", "Graphics"},
-    { ".*llvmpipe.*", "Software Rendering"},
-  };
 
   if (*info == '\0')
     return NULL;
@@ -57,17 +100,12 @@ prettify_info (const char *info)
   for (i = 0; i < G_N_ELEMENTS (rs); i++)
     {
       g_autoptr(GError) error = NULL;
-      g_autoptr(GRegex) re = NULL;
       g_autofree gchar *new = NULL;
 
-      re = g_regex_new (rs[i].regex, 0, 0, &error);
-      if (re == NULL)
-        {
-          g_warning ("Error building regex: %s", error->message);
-          continue;
-        }
+      if (patterns->rules[i] == NULL)
+        continue;
 
-      new = g_regex_replace (re,
+      new = g_regex_replace (patterns->rules[i],
                              pretty,
                              -1,
                              0,
@@ -91,20 +129,17 @@ prettify_info (const char *info)
 static char *
 remove_duplicate_whitespace (const char *old)
 {
+  const Patterns *patterns = get_patterns ();
   g_autofree gchar *new = NULL;
-  g_autoptr(GRegex) re = NULL;
   g_autoptr(GError) error = NULL;
 
   if (old == NULL)
     return NULL;
 
-  re = g_regex_new ("[ \t\n\r]+", G_REGEX_MULTILINE, 0, &error);
-  if (re == NULL)
-    {
-      g_warning ("Error building regex: %s", error->message);
-      return g_strdup (old);
-    }
-  new = g_regex_replace (re,
+  if (patterns->whitespace == NULL)
+    return g_strdup (old);
+
+  new = g_regex_replace (patterns->whitespace,
                          old,
                          -1,
                          0,
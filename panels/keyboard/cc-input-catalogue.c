@@ -0,0 +1,574 @@
+/* cc-input-catalogue.c
+ *
+ * Copyright 2026 The GNOME Settings authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <config.h>
+
+#include <glib/gi18n.h>
+
+#define GNOME_DESKTOP_USE_UNSTABLE_API
+#include <libgnome-desktop/gnome-languages.h>
+#include <libgnome-desktop/gnome-xkb-info.h>
+
+#include "cc-search-index.h"
+#include "cc-util.h"
+#include "cc-input-catalogue.h"
+
+/*
+ * The catalogue holds every locale offered by the input chooser together
+ * with the keyboard layouts associated with it. Building it means walking
+ * all the system locales and querying the XKB rules for each, so it is
+ * done once per session in a worker thread and shared by every chooser.
+ *
+ * All the names are normalized when the catalogue is built, and added to
+ * a CcSearchIndex so that a search only checks the names sharing its
+ * n-grams.
+ *
+ * Untranslated names can only be looked up by switching the locale of the
+ * whole process, so they are looked up on the main thread before the
+ * worker starts.
+ */
+
+#define INPUT_SOURCE_TYPE_XKB "xkb"
+
+typedef struct
+{
+  const gchar            *text;    /* normalized, owned by the locale or layout */
+  CcInputCatalogueLocale *locale;
+  CcInputCatalogueLayout *layout;
+} IndexedText;
+
+struct _CcInputCatalogue
+{
+  GObject        parent_instance;
+
+  GPtrArray     *locales;  /* CcInputCatalogueLocale, the "Other" one last */
+  GHashTable    *layouts;  /* id -> CcInputCatalogueLayout */
+  GArray        *texts;    /* IndexedText, indexed by text number */
+  CcSearchIndex *index;    /* of the texts, with their number as id */
+};
+
+typedef struct
+{
+  GStrv       locale_ids;
+  GHashTable *untranslated_names; /* simple locale id -> untranslated name */
+} BuildData;
+
+G_DEFINE_TYPE (CcInputCatalogue, cc_input_catalogue, G_TYPE_OBJECT)
+
+G_LOCK_DEFINE_STATIC (catalogue);
+static CcInputCatalogue *catalogue = NULL;
+static GPtrArray *pending_tasks = NULL;
+
+static void
+layout_free (CcInputCatalogueLayout *layout)
+{
+  g_free (layout->id);
+  g_free (layout->name);
+  g_free (layout->unaccented_name);
+  g_ptr_array_unref (layout->locales);
+  g_free (layout);
+}
+
+static void
+locale_free (CcInputCatalogueLocale *locale)
+{
+  g_free (locale->id);
+  g_free (locale->name);
+  g_free (locale->unaccented_name);
+  g_free (locale->untranslated_name);
+  g_free (locale->language);
+  g_free (locale->default_type);
+  g_free (locale->default_id);
+  g_ptr_array_unref (locale->layouts);
+  g_free (locale);
+}
+
+static void
+index_text (CcInputCatalogue       *self,
+            const gchar            *text,
+            CcInputCatalogueLocale *locale,
+            CcInputCatalogueLayout *layout)
+{
+  IndexedText indexed = { text, locale, layout };
+  g_autofree gchar *id = NULL;
+
+  if (*text == '\0')
+    return;
+
+  id = g_strdup_printf ("%u", self->texts->len);
+  cc_search_index_add (self->index, id, text, NULL, NULL);
+
+  g_array_append_val (self->texts, indexed);
+}
+
+/* The locale id shared by the variants of a locale, e.g. en_US.UTF-8 for
+ * en_US.ISO-8859-1 */
+static gchar *
+get_simple_locale (const gchar  *locale_id,
+                   gchar       **lang_code,
+                   gchar       **country_code)
+{
+  if (!gnome_parse_locale (locale_id, lang_code, country_code, NULL, NULL))
+    return NULL;
+
+  if (*country_code != NULL)
+    return g_strdup_printf ("%s_%s.UTF-8", *lang_code, *country_code);
+  else
+    return g_strdup_printf ("%s.UTF-8", *lang_code);
+}
+
+static void
+add_layouts (CcInputCatalogue       *self,
+             CcInputCatalogueLocale *locale,
+             GList                  *ids,
+             const gchar            *default_id)
+{
+  GList *l;
+
+  for (l = ids; l; l = l->next)
+    {
+      CcInputCatalogueLayout *layout;
+
+      /* The default input source is listed separately */
+      if (g_strcmp0 (l->data, default_id) == 0)
+        continue;
+
+      layout = g_hash_table_lookup (self->layouts, l->data);
+      if (!layout)
+        continue;
+
+      /* Layouts for both the language and the country of a locale */
+      if (layout->locales->len > 0 &&
+          g_ptr_array_index (layout->locales, layout->locales->len - 1) == locale)
+        continue;
+
+      g_ptr_array_add (locale->layouts, layout);
+      g_ptr_array_add (layout->locales, locale);
+    }
+}
+
+static void
+add_locale (CcInputCatalogue *self,
+            GnomeXkbInfo     *xkb_info,
+            GHashTable       *seen,
+            GHashTable       *untranslated_names,
+            const gchar      *locale_id)
+{
+  CcInputCatalogueLocale *locale;
+  g_autofree gchar *lang_code = NULL;
+  g_autofree gchar *country_code = NULL;
+  g_autofree gchar *simple_locale = NULL;
+  g_autoptr(GList) language_layouts = NULL;
+  const gchar *untranslated_name;
+  const gchar *type = NULL;
+  const gchar *id = NULL;
+
+  simple_locale = get_simple_locale (locale_id, &lang_code, &country_code);
+  if (!simple_locale || g_hash_table_contains (seen, simple_locale))
+    return;
+
+  locale = g_new0 (CcInputCatalogueLocale, 1);
+  locale->id = g_strdup (simple_locale);
+  locale->name = gnome_get_language_from_locale (simple_locale, NULL);
+  locale->unaccented_name = cc_util_normalize_casefold_and_unaccent (locale->name);
+  untranslated_name = g_hash_table_lookup (untranslated_names, simple_locale);
+  locale->untranslated_name = cc_util_normalize_casefold_and_unaccent (untranslated_name ? untranslated_name : "");
+  locale->language = gnome_get_language_from_code (lang_code, NULL);
+  locale->layouts = g_ptr_array_new ();
+
+  g_ptr_array_add (self->locales, locale);
+  g_hash_table_add (seen, locale->id);
+
+  if (gnome_get_input_source_from_locale (simple_locale, &type, &id))
+    {
+      locale->default_type = g_strdup (type);
+      locale->default_id = g_strdup (id);
+
+      if (g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
+        {
+          CcInputCatalogueLayout *layout = g_hash_table_lookup (self->layouts, id);
+
+          if (layout)
+            g_ptr_array_add (layout->locales, locale);
+        }
+      else
+        {
+          id = NULL;
+        }
+    }
+
+  language_layouts = gnome_xkb_info_get_layouts_for_language (xkb_info, lang_code);
+  add_layouts (self, locale, language_layouts, id);
+
+  if (country_code != NULL)
+    {
+      g_autoptr(GList) country_layouts = gnome_xkb_info_get_layouts_for_country (xkb_info, country_code);
+      add_layouts (self, locale, country_layouts, id);
+    }
+}
+
+static CcInputCatalogue *
+build_catalogue (GStrv       locale_ids,
+                 GHashTable *untranslated_names)
+{
+  g_autoptr(CcInputCatalogue) self = NULL;
+  GnomeXkbInfo *xkb_info;
+  g_autoptr(GHashTable) seen = NULL;
+  g_autoptr(GList) all_layouts = NULL;
+  CcInputCatalogueLocale *other;
+  GList *l;
+  guint i;
+
+  self = g_object_new (CC_TYPE_INPUT_CATALOGUE, NULL);
+  xkb_info = gnome_xkb_info_new ();
+
+  all_layouts = gnome_xkb_info_get_all_layouts (xkb_info);
+  for (l = all_layouts; l; l = l->next)
+    {
+      CcInputCatalogueLayout *layout;
+      const gchar *display_name = NULL;
+
+      if (!gnome_xkb_info_get_layout_info (xkb_info, l->data, &display_name, NULL, NULL, NULL))
+        continue;
+
+      layout = g_new0 (CcInputCatalogueLayout, 1);
+      layout->id = g_strdup (l->data);
+      layout->name = g_strdup (display_name);
+      layout->unaccented_name = cc_util_normalize_casefold_and_unaccent (display_name);
+      layout->locales = g_ptr_array_new ();
+      g_hash_table_insert (self->layouts, layout->id, layout);
+    }
+
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
+  for (i = 0; locale_ids[i]; i++)
+    add_locale (self, xkb_info, seen, untranslated_names, locale_ids[i]);
+
+  /* Add a "Other" locale to hold the remaining input sources */
+  other = g_new0 (CcInputCatalogueLocale, 1);
+  other->id = g_strdup ("");
+  other->name = g_strdup (C_("Input Source", "Other"));
+  other->unaccented_name = g_strdup ("");
+  other->untranslated_name = g_strdup ("");
+  other->layouts = g_ptr_array_new ();
+  g_ptr_array_add (self->locales, other);
+
+  for (l = all_layouts; l; l = l->next)
+    {
+      CcInputCatalogueLayout *layout = g_hash_table_lookup (self->layouts, l->data);
+
+      if (layout && layout->locales->len == 0)
+        {
+          g_ptr_array_add (other->layouts, layout);
+          g_ptr_array_add (layout->locales, other);
+        }
+    }
+
+  for (i = 0; i < self->locales->len; i++)
+    {
+      CcInputCatalogueLocale *locale = g_ptr_array_index (self->locales, i);
+
+      index_text (self, locale->unaccented_name, locale, NULL);
+      if (!g_str_equal (locale->untranslated_name, locale->unaccented_name))
+        index_text (self, locale->untranslated_name, locale, NULL);
+    }
+
+  for (l = all_layouts; l; l = l->next)
+    {
+      CcInputCatalogueLayout *layout = g_hash_table_lookup (self->layouts, l->data);
+
+      if (layout)
+        index_text (self, layout->unaccented_name, NULL, layout);
+    }
+
+  g_object_unref (xkb_info);
+
+  return g_steal_pointer (&self);
+}
+
+static void
+build_data_free (BuildData *data)
+{
+  g_strfreev (data->locale_ids);
+  g_hash_table_unref (data->untranslated_names);
+  g_free (data);
+}
+
+static void
+build_catalogue_thread (GTask        *task,
+                        gpointer      source_object,
+                        gpointer      task_data,
+                        GCancellable *cancellable)
+{
+  BuildData *data = task_data;
+
+  g_task_return_pointer (task,
+                         build_catalogue (data->locale_ids, data->untranslated_names),
+                         g_object_unref);
+}
+
+static void
+on_catalogue_built_cb (GObject      *object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  g_autoptr(CcInputCatalogue) self = NULL;
+  g_autoptr(GPtrArray) tasks = NULL;
+  guint i;
+
+  self = g_task_propagate_pointer (G_TASK (result), NULL);
+
+  G_LOCK (catalogue);
+  catalogue = g_object_ref (self);
+  tasks = g_steal_pointer (&pending_tasks);
+  G_UNLOCK (catalogue);
+
+  for (i = 0; i < tasks->len; i++)
+    {
+      GTask *task = g_ptr_array_index (tasks, i);
+
+      if (!g_task_return_error_if_cancelled (task))
+        g_task_return_pointer (task, g_object_ref (self), g_object_unref);
+    }
+}
+
+static void
+cc_input_catalogue_finalize (GObject *object)
+{
+  CcInputCatalogue *self = CC_INPUT_CATALOGUE (object);
+
+  g_clear_pointer (&self->texts, g_array_unref);
+  g_clear_object (&self->index);
+  g_clear_pointer (&self->locales, g_ptr_array_unref);
+  g_clear_pointer (&self->layouts, g_hash_table_destroy);
+
+  G_OBJECT_CLASS (cc_input_catalogue_parent_class)->finalize (object);
+}
+
+static void
+cc_input_catalogue_class_init (CcInputCatalogueClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = cc_input_catalogue_finalize;
+}
+
+static void
+cc_input_catalogue_init (CcInputCatalogue *self)
+{
+  self->locales = g_ptr_array_new_with_free_func ((GDestroyNotify) locale_free);
+  self->layouts = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) layout_free);
+  self->texts = g_array_new (FALSE, FALSE, sizeof (IndexedText));
+  self->index = cc_search_index_new ();
+}
+
+/**
+ * cc_input_catalogue_get_async:
+ * @cancellable: (nullable): a #GCancellable
+ * @callback: (nullable): a #GAsyncReadyCallback
+ * @user_data: data for @callback
+ *
+ * Gets the session's input source catalogue, building it in a worker
+ * thread the first time. Must be called from the main thread.
+ */
+void
+cc_input_catalogue_get_async (GCancellable        *cancellable,
+                              GAsyncReadyCallback  callback,
+                              gpointer             user_data)
+{
+  g_autoptr(GTask) task = NULL;
+  g_autoptr(GTask) build_task = NULL;
+  g_autofree gchar *language = NULL;
+  const gchar *type, *id;
+  BuildData *data;
+  guint i;
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, cc_input_catalogue_get_async);
+
+  G_LOCK (catalogue);
+
+  if (catalogue)
+    {
+      g_task_return_pointer (task, g_object_ref (catalogue), g_object_unref);
+      G_UNLOCK (catalogue);
+      return;
+    }
+
+  if (pending_tasks)
+    {
+      g_ptr_array_add (pending_tasks, g_steal_pointer (&task));
+      G_UNLOCK (catalogue);
+      return;
+    }
+
+  pending_tasks = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (pending_tasks, g_steal_pointer (&task));
+
+  G_UNLOCK (catalogue);
+
+  /* The gnome-languages tables are loaded lazily and without locking, so
+   * load them here before the worker thread reads them.
+   */
+  data = g_new0 (BuildData, 1);
+  data->locale_ids = gnome_get_all_locales ();
+  language = gnome_get_language_from_locale ("en_US.UTF-8", NULL);
+  gnome_get_input_source_from_locale ("en_US.UTF-8", &type, &id);
+
+  data->untranslated_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  for (i = 0; data->locale_ids[i]; i++)
+    {
+      g_autofree gchar *lang_code = NULL;
+      g_autofree gchar *country_code = NULL;
+      g_autofree gchar *simple_locale = NULL;
+      gchar *untranslated_name;
+
+      simple_locale = get_simple_locale (data->locale_ids[i], &lang_code, &country_code);
+      if (!simple_locale || g_hash_table_contains (data->untranslated_names, simple_locale))
+        continue;
+
+      untranslated_name = gnome_get_language_from_locale (simple_locale, "C");
+      g_hash_table_insert (data->untranslated_names, g_steal_pointer (&simple_locale), untranslated_name);
+    }
+
+  /* Not cancellable, since other callers may be waiting for it too */
+  build_task = g_task_new (NULL, NULL, on_catalogue_built_cb, NULL);
+  g_task_set_source_tag (build_task, cc_input_catalogue_get_async);
+  g_task_set_task_data (build_task, data, (GDestroyNotify) build_data_free);
+  g_task_run_in_thread (build_task, build_catalogue_thread);
+}
+
+/**
+ * cc_input_catalogue_get_finish:
+ * @result: a #GAsyncResult
+ * @error: return location for a #GError
+ *
+ * Finishes an operation started with cc_input_catalogue_get_async().
+ *
+ * Returns: (transfer full): the catalogue, or %NULL if cancelled
+ */
+CcInputCatalogue *
+cc_input_catalogue_get_finish (GAsyncResult  *result,
+                               GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * cc_input_catalogue_peek:
+ *
+ * Returns: (transfer none) (nullable): the catalogue, if it was already built
+ */
+CcInputCatalogue *
+cc_input_catalogue_peek (void)
+{
+  CcInputCatalogue *self;
+
+  G_LOCK (catalogue);
+  self = catalogue;
+  G_UNLOCK (catalogue);
+
+  return self;
+}
+
+/**
+ * cc_input_catalogue_get_locales:
+ * @self: a #CcInputCatalogue
+ *
+ * Returns: (transfer none) (element-type CcInputCatalogueLocale): the locales
+ */
+GPtrArray *
+cc_input_catalogue_get_locales (CcInputCatalogue *self)
+{
+  g_return_val_if_fail (CC_IS_INPUT_CATALOGUE (self), NULL);
+
+  return self->locales;
+}
+
+/**
+ * cc_input_catalogue_get_layout:
+ * @self: a #CcInputCatalogue
+ * @id: an XKB layout id
+ *
+ * Returns: (transfer none) (nullable): the layout with @id
+ */
+CcInputCatalogueLayout *
+cc_input_catalogue_get_layout (CcInputCatalogue *self,
+                               const gchar      *id)
+{
+  g_return_val_if_fail (CC_IS_INPUT_CATALOGUE (self), NULL);
+
+  return g_hash_table_lookup (self->layouts, id);
+}
+
+/**
+ * cc_input_catalogue_search:
+ * @self: a #CcInputCatalogue
+ * @words: the words to search, normalized with
+ *   cc_util_normalize_casefold_and_unaccent()
+ * @locale_ids: a set of strings to add the matching locale ids to
+ * @layout_ids: a set of strings to add the matching layout ids to
+ *
+ * Finds the locales and layouts with a name containing all of @words.
+ * Locales offering a matching layout match too. Empty words are ignored,
+ * and nothing matches if all of them are empty.
+ *
+ * The strings added to the sets belong to @self.
+ */
+void
+cc_input_catalogue_search (CcInputCatalogue    *self,
+                           const gchar * const *words,
+                           GHashTable          *locale_ids,
+                           GHashTable          *layout_ids)
+{
+  g_autoptr(GPtrArray) results = NULL;
+  gboolean all_empty = TRUE;
+  guint i, j;
+
+  g_return_if_fail (CC_IS_INPUT_CATALOGUE (self));
+  g_return_if_fail (words != NULL);
+
+  /* The search index would match everything */
+  for (i = 0; words[i] && all_empty; i++)
+    all_empty = *words[i] == '\0';
+
+  if (all_empty)
+    return;
+
+  results = cc_search_index_search (self->index, words);
+
+  for (i = 0; i < results->len; i++)
+    {
+      guint64 text_number = g_ascii_strtoull (g_ptr_array_index (results, i), NULL, 10);
+      IndexedText *indexed = &g_array_index (self->texts, IndexedText, text_number);
+
+      if (indexed->locale)
+        g_hash_table_add (locale_ids, indexed->locale->id);
+
+      if (indexed->layout)
+        {
+          g_hash_table_add (layout_ids, indexed->layout->id);
+
+          for (j = 0; j < indexed->layout->locales->len; j++)
+            g_hash_table_add (locale_ids, ((CcInputCatalogueLocale *) g_ptr_array_index (indexed->layout->locales, j))->id);
+        }
+    }
+}
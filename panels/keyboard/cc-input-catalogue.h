@@ -0,0 +1,69 @@
+/* cc-input-catalogue.h
+ *
+ * Copyright 2026 The GNOME Settings authors
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  gchar     *id;
+  gchar     *name;
+  gchar     *unaccented_name;
+  GPtrArray *locales;            /* CcInputCatalogueLocale offering the layout */
+} CcInputCatalogueLayout;
+
+typedef struct
+{
+  gchar     *id;                 /* "" for the locale holding all other layouts */
+  gchar     *name;
+  gchar     *unaccented_name;
+  gchar     *untranslated_name;  /* normalized */
+  gchar     *language;           /* translated name of the language */
+  gchar     *default_type;       /* (nullable) type of the default input source */
+  gchar     *default_id;         /* (nullable) id of the default input source */
+  GPtrArray *layouts;            /* CcInputCatalogueLayout, without the default one */
+} CcInputCatalogueLocale;
+
+#define CC_TYPE_INPUT_CATALOGUE (cc_input_catalogue_get_type ())
+G_DECLARE_FINAL_TYPE (CcInputCatalogue, cc_input_catalogue, CC, INPUT_CATALOGUE, GObject)
+
+void                    cc_input_catalogue_get_async  (GCancellable         *cancellable,
+                                                       GAsyncReadyCallback   callback,
+                                                       gpointer              user_data);
+
+CcInputCatalogue       *cc_input_catalogue_get_finish (GAsyncResult         *result,
+                                                       GError              **error);
+
+CcInputCatalogue       *cc_input_catalogue_peek       (void);
+
+GPtrArray              *cc_input_catalogue_get_locales (CcInputCatalogue    *self);
+
+CcInputCatalogueLayout *cc_input_catalogue_get_layout (CcInputCatalogue     *self,
+                                                       const gchar          *id);
+
+void                    cc_input_catalogue_search     (CcInputCatalogue     *self,
+                                                       const gchar * const  *words,
+                                                       GHashTable           *locale_ids,
+                                                       GHashTable           *layout_ids);
+
+G_END_DECLS
@@ -24,6 +24,7 @@
 
 #include "cc-common-language.h"
 #include "cc-util.h"
+#include "cc-input-catalogue.h"
 #include "cc-input-chooser.h"
 #include "cc-input-source-ibus.h"
 #include "cc-input-source-xkb.h"
@@ -66,12 +67,22 @@ struct _CcInputChooser
 
   GnomeXkbInfo      *xkb_info;
   GHashTable        *ibus_engines;
+  CcInputCatalogue  *catalogue;
+  GCancellable      *cancellable;
   GHashTable        *locales;
   GHashTable        *locales_by_language;
+  GHashTable        *engine_names;      /* engine id -> normalized name */
+  GHashTable        *engine_locales;    /* engine id -> GPtrArray of LocaleInfo */
   gboolean           showing_extra;
   guint              filter_timeout_id;
   gchar            **filter_words;
 
+  /* Results of the current filter, as sets of ids */
+  GHashTable        *named_locales;
+  GHashTable        *matching_locales;
+  GHashTable        *matching_layouts;
+  GHashTable        *matching_engines;
+
   gboolean           is_login;
 };
 
@@ -79,31 +90,35 @@ G_DEFINE_TYPE (CcInputChooser, cc_input_chooser, GTK_TYPE_DIALOG)
 
 typedef struct
 {
-  gchar *id;
-  gchar *name;
-  gchar *unaccented_name;
-  gchar *untranslated_name;
+  CcInputCatalogueLocale *entry;
+  const gchar *default_type;
+  const gchar *default_id;
+  GPtrArray *engine_ids;
   GtkListBoxRow *default_input_source_row;
   GtkListBoxRow *locale_row;
   GtkListBoxRow *back_row;
+  /* Input source rows are only created when the locale is first shown */
   GHashTable *layout_rows_by_id;
   GHashTable *engine_rows_by_id;
 } LocaleInfo;
 
+static void
+clear_input_source_rows (LocaleInfo *info)
+{
+  g_clear_object (&info->default_input_source_row);
+  g_clear_pointer (&info->layout_rows_by_id, g_hash_table_destroy);
+  g_clear_pointer (&info->engine_rows_by_id, g_hash_table_destroy);
+}
+
 static void
 locale_info_free (gpointer data)
 {
   LocaleInfo *info = data;
 
-  g_free (info->id);
-  g_free (info->name);
-  g_free (info->unaccented_name);
-  g_free (info->untranslated_name);
-  g_clear_object (&info->default_input_source_row);
+  clear_input_source_rows (info);
   g_clear_object (&info->locale_row);
   g_clear_object (&info->back_row);
-  g_hash_table_destroy (info->layout_rows_by_id);
-  g_hash_table_destroy (info->engine_rows_by_id);
+  g_ptr_array_unref (info->engine_ids);
   g_free (info);
 }
 
@@ -222,19 +237,20 @@ input_source_row_new (CcInputChooser *self,
 
   if (g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
     {
-      const gchar *display_name;
+      CcInputCatalogueLayout *layout;
 
-      gnome_xkb_info_get_layout_info (self->xkb_info, id, &display_name, NULL, NULL, NULL);
+      layout = cc_input_catalogue_get_layout (self->catalogue, id);
+      if (!layout)
+        return NULL;
 
       row = gtk_list_box_row_new ();
-      widget = padded_label_new (display_name,
+      widget = padded_label_new (layout->name,
                                  ROW_LABEL_POSITION_START,
                                  ROW_TRAVEL_DIRECTION_NONE,
                                  FALSE);
       gtk_list_box_row_set_child (GTK_LIST_BOX_ROW (row), widget);
-      g_object_set_data (G_OBJECT (row), "name", (gpointer) display_name);
-      g_object_set_data_full (G_OBJECT (row), "unaccented-name",
-                              cc_util_normalize_casefold_and_unaccent (display_name), g_free);
+      g_object_set_data (G_OBJECT (row), "name", layout->name);
+      id = layout->id;
     }
   else if (g_str_equal (type, INPUT_SOURCE_TYPE_IBUS))
     {
@@ -256,8 +272,6 @@ input_source_row_new (CcInputChooser *self,
       gtk_box_append (GTK_BOX (widget), image);
 
       g_object_set_data_full (G_OBJECT (row), "name", display_name, g_free);
-      g_object_set_data_full (G_OBJECT (row), "unaccented-name",
-                              cc_util_normalize_casefold_and_unaccent (display_name), g_free);
 #else
       widget = NULL;
 #endif  /* HAVE_IBUS */
@@ -283,6 +297,74 @@ remove_all_rows (GtkListBox *listbox)
     gtk_list_box_remove (listbox, child);
 }
 
+static void
+add_default_row (CcInputChooser *self,
+                 LocaleInfo     *info,
+                 const gchar    *type,
+                 const gchar    *id)
+{
+  info->default_input_source_row = input_source_row_new (self, type, id);
+  if (info->default_input_source_row)
+    {
+      gtk_widget_show (GTK_WIDGET (info->default_input_source_row));
+      g_object_ref_sink (GTK_WIDGET (info->default_input_source_row));
+      g_object_set_data (G_OBJECT (info->default_input_source_row), "default", GINT_TO_POINTER (TRUE));
+      g_object_set_data (G_OBJECT (info->default_input_source_row), "locale-info", info);
+    }
+}
+
+static void
+add_row (CcInputChooser *self,
+         LocaleInfo     *info,
+         const gchar    *type,
+         const gchar    *id)
+{
+  GHashTable *table;
+  GtkListBoxRow *row;
+
+  if (g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
+    table = info->layout_rows_by_id;
+  else
+    table = info->engine_rows_by_id;
+
+  row = input_source_row_new (self, type, id);
+  if (row)
+    {
+      gtk_widget_show (GTK_WIDGET (row));
+      g_object_set_data (G_OBJECT (row), "locale-info", info);
+      g_hash_table_replace (table, g_object_get_data (G_OBJECT (row), "id"), g_object_ref_sink (row));
+    }
+}
+
+static void
+ensure_input_source_rows (CcInputChooser *self,
+                          LocaleInfo     *info)
+{
+  guint i;
+
+  if (info->layout_rows_by_id)
+    return;
+
+  /* We don't own these ids */
+  info->layout_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   NULL, g_object_unref);
+  info->engine_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   NULL, g_object_unref);
+
+  if (info->default_id)
+    add_default_row (self, info, info->default_type, info->default_id);
+
+  for (i = 0; i < info->entry->layouts->len; i++)
+    {
+      CcInputCatalogueLayout *layout = g_ptr_array_index (info->entry->layouts, i);
+
+      add_row (self, info, INPUT_SOURCE_TYPE_XKB, layout->id);
+    }
+
+  for (i = 0; i < info->engine_ids->len; i++)
+    add_row (self, info, INPUT_SOURCE_TYPE_IBUS, g_ptr_array_index (info->engine_ids, i));
+}
+
 static void
 add_input_source_rows_for_locale (CcInputChooser *self,
                                   LocaleInfo     *info)
@@ -291,6 +373,8 @@ add_input_source_rows_for_locale (CcInputChooser *self,
   GHashTableIter iter;
   const gchar *id;
 
+  ensure_input_source_rows (self, info);
+
   if (info->default_input_source_row)
     gtk_list_box_append (self->input_sources_listbox, GTK_WIDGET (info->default_input_source_row));
 
@@ -311,7 +395,7 @@ show_input_sources_for_locale (CcInputChooser *self,
 
   if (!info->back_row)
     {
-      info->back_row = g_object_ref_sink (back_row_new (info->name));
+      info->back_row = g_object_ref_sink (back_row_new (info->entry->name));
       gtk_widget_show (GTK_WIDGET (info->back_row));
       g_object_set_data (G_OBJECT (info->back_row), "back", GINT_TO_POINTER (TRUE));
       g_object_set_data (G_OBJECT (info->back_row), "locale-info", info);
@@ -350,23 +434,24 @@ show_locale_rows (CcInputChooser *self)
   if (!self->showing_extra)
     initial = cc_common_language_get_initial_languages ();
 
+  /* The locales are added once the catalogue is ready */
   g_hash_table_iter_init (&iter, self->locales);
   while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &info))
     {
-      if (!info->default_input_source_row &&
-          !g_hash_table_size (info->layout_rows_by_id) &&
-          !g_hash_table_size (info->engine_rows_by_id))
+      if (!info->default_id &&
+          !info->entry->layouts->len &&
+          !info->engine_ids->len)
         continue;
 
       if (!info->locale_row)
         {
-          info->locale_row = g_object_ref_sink (locale_row_new (info->name));
+          info->locale_row = g_object_ref_sink (locale_row_new (info->entry->name));
           gtk_widget_show (GTK_WIDGET (info->locale_row));
           g_object_set_data (G_OBJECT (info->locale_row), "locale-info", info);
 
           if (!self->showing_extra &&
-              !g_hash_table_contains (initial, info->id) &&
-              !is_current_locale (info->id))
+              !g_hash_table_contains (initial, info->entry->id) &&
+              !is_current_locale (info->entry->id))
             g_object_set_data (G_OBJECT (info->locale_row), "is-extra", GINT_TO_POINTER (TRUE));
         }
       gtk_list_box_append (self->input_sources_listbox, GTK_WIDGET (info->locale_row));
@@ -407,12 +492,12 @@ list_sort (GtkListBoxRow *a,
   ib = g_object_get_data (G_OBJECT (b), "locale-info");
 
   /* The "Other" locale always goes at the end */
-  if (!ia->id[0] && ib->id[0])
+  if (!ia->entry->id[0] && ib->entry->id[0])
     return 1;
-  else if (ia->id[0] && !ib->id[0])
+  else if (ia->entry->id[0] && !ib->entry->id[0])
     return -1;
 
-  retval = g_strcmp0 (ia->name, ib->name);
+  retval = g_strcmp0 (ia->entry->name, ib->entry->name);
   if (retval)
     return retval;
 
@@ -450,35 +535,6 @@ match_all (gchar       **words,
   return TRUE;
 }
 
-static gboolean
-match_default_source_in_table (gchar         **words,
-                               GtkListBoxRow  *row)
-{
-  const gchar *source_name;
-  source_name = g_object_get_data (G_OBJECT (row), "unaccented-name");
-  if (source_name && match_all (words, source_name))
-    return TRUE;
-  return FALSE;
-}
-
-static gboolean
-match_source_in_table (gchar      **words,
-                       GHashTable  *table)
-{
-  GHashTableIter iter;
-  gpointer row;
-  const gchar *source_name;
-
-  g_hash_table_iter_init (&iter, table);
-  while (g_hash_table_iter_next (&iter, NULL, &row))
-    {
-      source_name = g_object_get_data (G_OBJECT (row), "unaccented-name");
-      if (source_name && match_all (words, source_name))
-        return TRUE;
-    }
-  return FALSE;
-}
-
 static gboolean
 list_filter (GtkListBoxRow *row,
              gpointer       user_data)
@@ -486,7 +542,8 @@ list_filter (GtkListBoxRow *row,
   CcInputChooser *self = user_data;
   LocaleInfo *info;
   gboolean is_extra;
-  const gchar *source_name;
+  const gchar *type;
+  const gchar *id;
 
   if (row == self->more_row)
     return !self->showing_extra;
@@ -496,7 +553,7 @@ list_filter (GtkListBoxRow *row,
   if (!self->showing_extra && is_extra)
     return FALSE;
 
-  if (!self->filter_words)
+  if (!self->filter_words || !self->filter_words[0])
     return TRUE;
 
   info = g_object_get_data (G_OBJECT (row), "locale-info");
@@ -504,32 +561,80 @@ list_filter (GtkListBoxRow *row,
   if (row == info->back_row)
     return TRUE;
 
-  if (match_all (self->filter_words, info->unaccented_name))
+  if (g_hash_table_contains (self->named_locales, info->entry->id))
     return TRUE;
 
-  if (match_all (self->filter_words, info->untranslated_name))
-    return TRUE;
+  type = g_object_get_data (G_OBJECT (row), "type");
+  id = g_object_get_data (G_OBJECT (row), "id");
 
-  source_name = g_object_get_data (G_OBJECT (row), "unaccented-name");
-  if (source_name)
-    {
-      if (match_all (self->filter_words, source_name))
-        return TRUE;
-    }
+  if (!id)
+    return g_hash_table_contains (self->matching_locales, info->entry->id);
+  else if (g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
+    return g_hash_table_contains (self->matching_layouts, id);
   else
+    return g_hash_table_contains (self->matching_engines, id);
+}
+
+/* Matches the filter words against the catalogue once, so that filtering
+ * every row only takes a few lookups.
+ */
+static void
+update_matches (CcInputChooser *self)
+{
+  GHashTableIter iter;
+  const gchar *id;
+  const gchar *name;
+  guint i;
+
+  g_hash_table_remove_all (self->named_locales);
+  g_hash_table_remove_all (self->matching_locales);
+  g_hash_table_remove_all (self->matching_layouts);
+  g_hash_table_remove_all (self->matching_engines);
+
+  if (!self->catalogue || !self->filter_words[0])
+    return;
+
+  cc_input_catalogue_search (self->catalogue,
+                             (const gchar * const *) self->filter_words,
+                             self->named_locales,
+                             self->matching_layouts);
+
+  g_hash_table_iter_init (&iter, self->named_locales);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &id, NULL))
+    g_hash_table_add (self->matching_locales, (gpointer) id);
+
+  g_hash_table_iter_init (&iter, self->matching_layouts);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &id, NULL))
     {
-      if (info->default_input_source_row &&
-          match_default_source_in_table (self->filter_words, info->default_input_source_row))
+      CcInputCatalogueLayout *layout = cc_input_catalogue_get_layout (self->catalogue, id);
+
+      for (i = 0; i < layout->locales->len; i++)
         {
-          return TRUE;
+          CcInputCatalogueLocale *locale = g_ptr_array_index (layout->locales, i);
+
+          g_hash_table_add (self->matching_locales, locale->id);
         }
-      if (match_source_in_table (self->filter_words, info->layout_rows_by_id))
-        return TRUE;
-      if (match_source_in_table (self->filter_words, info->engine_rows_by_id))
-        return TRUE;
     }
 
-  return FALSE;
+  /* There are few enough engines to match them all */
+  g_hash_table_iter_init (&iter, self->engine_names);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &id, (gpointer *) &name))
+    {
+      GPtrArray *owners;
+
+      if (!match_all (self->filter_words, name))
+        continue;
+
+      g_hash_table_add (self->matching_engines, (gpointer) id);
+
+      owners = g_hash_table_lookup (self->engine_locales, id);
+      for (i = 0; i < owners->len; i++)
+        {
+          LocaleInfo *info = g_ptr_array_index (owners, i);
+
+          g_hash_table_add (self->matching_locales, info->entry->id);
+        }
+    }
 }
 
 static gboolean
@@ -562,6 +667,9 @@ do_filter (CcInputChooser *self)
   previous_words = self->filter_words;
   self->filter_words = g_strsplit_set (g_strstrip (filter_contents), " ", 0);
 
+  if (previous_words == NULL || strvs_differ (self->filter_words, previous_words))
+    update_matches (self);
+
   if (!self->filter_words[0])
     {
       gtk_list_box_invalidate_filter (self->input_sources_listbox);
@@ -646,99 +754,41 @@ on_input_sources_listbox_selected_rows_changed_cb (CcInputChooser *self)
   gtk_widget_set_sensitive (GTK_WIDGET (self->add_button), sensitive);
 }
 
+#ifdef HAVE_IBUS
 static void
-add_default_row (CcInputChooser *self,
-                 LocaleInfo     *info,
-                 const gchar    *type,
-                 const gchar    *id)
+add_engine (CcInputChooser *self,
+            LocaleInfo     *info,
+            const gchar    *engine_id)
 {
-  info->default_input_source_row = input_source_row_new (self, type, id);
-  if (info->default_input_source_row)
+  GPtrArray *owners;
+
+  if (g_strcmp0 (info->entry->default_type, INPUT_SOURCE_TYPE_IBUS) == 0 &&
+      g_strcmp0 (info->entry->default_id, engine_id) == 0 &&
+      info->default_id == NULL)
     {
-      gtk_widget_show (GTK_WIDGET (info->default_input_source_row));
-      g_object_ref_sink (GTK_WIDGET (info->default_input_source_row));
-      g_object_set_data (G_OBJECT (info->default_input_source_row), "default", GINT_TO_POINTER (TRUE));
-      g_object_set_data (G_OBJECT (info->default_input_source_row), "locale-info", info);
+      info->default_type = INPUT_SOURCE_TYPE_IBUS;
+      info->default_id = engine_id;
     }
-}
-
-static void
-add_rows_to_table (CcInputChooser *self,
-                   LocaleInfo     *info,
-                   GList          *list,
-                   const gchar    *type,
-                   const gchar    *default_id)
-{
-  GHashTable *table;
-  GtkListBoxRow *row;
-  const gchar *id;
-
-  if (g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
-    table = info->layout_rows_by_id;
-  else if (g_str_equal (type, INPUT_SOURCE_TYPE_IBUS))
-    table = info->engine_rows_by_id;
   else
-    return;
-
-  while (list)
     {
-      id = (const gchar *) list->data;
-
-      /* The widget for the default input source lives elsewhere */
-      if (g_strcmp0 (id, default_id))
-        {
-          row = input_source_row_new (self, type, id);
-          gtk_widget_show (GTK_WIDGET (row));
-          if (row)
-            {
-              g_object_set_data (G_OBJECT (row), "locale-info", info);
-              g_hash_table_replace (table, (gpointer) id, g_object_ref_sink (row));
-            }
-        }
-      list = list->next;
+      g_ptr_array_add (info->engine_ids, (gpointer) engine_id);
     }
-}
 
-static void
-add_row (CcInputChooser *self,
-         LocaleInfo     *info,
-         const gchar    *type,
-         const gchar    *id)
-{
-  GList tmp = { 0 };
-  tmp.data = (gpointer) id;
-  add_rows_to_table (self, info, &tmp, type, NULL);
+  owners = g_hash_table_lookup (self->engine_locales, engine_id);
+  if (!owners)
+    {
+      owners = g_ptr_array_new ();
+      g_hash_table_insert (self->engine_locales, (gpointer) engine_id, owners);
+    }
+  g_ptr_array_add (owners, info);
 }
 
 static void
-add_row_other (CcInputChooser *self,
-               const gchar    *type,
-               const gchar    *id)
+add_engine_other (CcInputChooser *self,
+                  const gchar    *engine_id)
 {
   LocaleInfo *info = g_hash_table_lookup (self->locales, "");
-  add_row (self, info, type, id);
-}
-
-#ifdef HAVE_IBUS
-static gboolean
-maybe_set_as_default (CcInputChooser *self,
-                      LocaleInfo     *info,
-                      const gchar    *engine_id)
-{
-  const gchar *type, *id;
-
-  if (!gnome_get_input_source_from_locale (info->id, &type, &id))
-    return FALSE;
-
-  if (g_str_equal (type, INPUT_SOURCE_TYPE_IBUS) &&
-      g_str_equal (id, engine_id) &&
-      info->default_input_source_row == NULL)
-    {
-      add_default_row (self, info, type, id);
-      return TRUE;
-    }
-
-  return FALSE;
+  add_engine (self, info, engine_id);
 }
 
 static void
@@ -757,8 +807,13 @@ get_ibus_locale_infos (CcInputChooser *self)
     {
       g_autofree gchar *lang_code = NULL;
       g_autofree gchar *country_code = NULL;
+      g_autofree gchar *display_name = NULL;
       const gchar *ibus_locale = ibus_engine_desc_get_language (engine);
 
+      display_name = engine_get_display_name (engine);
+      g_hash_table_insert (self->engine_names, (gpointer) engine_id,
+                           cc_util_normalize_casefold_and_unaccent (display_name));
+
       if (gnome_parse_locale (ibus_locale, &lang_code, &country_code, NULL, NULL) &&
           lang_code != NULL &&
           country_code != NULL)
@@ -767,24 +822,9 @@ get_ibus_locale_infos (CcInputChooser *self)
 
           info = g_hash_table_lookup (self->locales, locale);
           if (info)
-            {
-              const gchar *type, *id;
-
-              if (gnome_get_input_source_from_locale (locale, &type, &id) &&
-                  g_str_equal (type, INPUT_SOURCE_TYPE_IBUS) &&
-                  g_str_equal (id, engine_id))
-                {
-                  add_default_row (self, info, type, id);
-                }
-              else
-                {
-                  add_row (self, info, INPUT_SOURCE_TYPE_IBUS, engine_id);
-                }
-            }
+            add_engine (self, info, engine_id);
           else
-            {
-              add_row_other (self, INPUT_SOURCE_TYPE_IBUS, engine_id);
-            }
+            add_engine_other (self, engine_id);
         }
       else if (lang_code != NULL)
         {
@@ -805,17 +845,16 @@ get_ibus_locale_infos (CcInputChooser *self)
             {
               g_hash_table_iter_init (&iter, locales_for_language);
               while (g_hash_table_iter_next (&iter, (gpointer *) &info, NULL))
-                if (!maybe_set_as_default (self, info, engine_id))
-                  add_row (self, info, INPUT_SOURCE_TYPE_IBUS, engine_id);
+                add_engine (self, info, engine_id);
             }
           else
             {
-              add_row_other (self, INPUT_SOURCE_TYPE_IBUS, engine_id);
+              add_engine_other (self, engine_id);
             }
         }
       else
         {
-          add_row_other (self, INPUT_SOURCE_TYPE_IBUS, engine_id);
+          add_engine_other (self, engine_id);
         }
     }
 }
@@ -823,13 +862,10 @@ get_ibus_locale_infos (CcInputChooser *self)
 
 static void
 add_locale_to_table (GHashTable  *table,
-                     const gchar *lang_code,
+                     const gchar *language,
                      LocaleInfo  *info)
 {
   GHashTable *set;
-  g_autofree gchar *language = NULL;
-
-  language = gnome_get_language_from_code (lang_code, NULL);
 
   set = g_hash_table_lookup (table, language);
   if (!set)
@@ -840,108 +876,68 @@ add_locale_to_table (GHashTable  *table,
   g_hash_table_add (set, info);
 }
 
-static void
-add_ids_to_set (GHashTable *set,
-                GList      *list)
-{
-  while (list)
-    {
-      g_hash_table_add (set, list->data);
-      list = list->next;
-    }
-}
-
 static void
 get_locale_infos (CcInputChooser *self)
 {
-  g_autoptr(GHashTable) layouts_with_locale = NULL;
-  LocaleInfo *info;
-  g_auto(GStrv) locale_ids = NULL;
-  gchar **locale;
-  g_autoptr(GList) all_layouts = NULL;
-  GList *l;
+  GPtrArray *entries;
+  guint i;
 
-  self->locales = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                         g_free, locale_info_free);
-  self->locales_by_language = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                     g_free, (GDestroyNotify) g_hash_table_unref);
-
-  layouts_with_locale = g_hash_table_new (g_str_hash, g_str_equal);
-
-  locale_ids = gnome_get_all_locales ();
-  for (locale = locale_ids; *locale; ++locale)
+  entries = cc_input_catalogue_get_locales (self->catalogue);
+  for (i = 0; i < entries->len; i++)
     {
-      g_autofree gchar *lang_code = NULL;
-      g_autofree gchar *country_code = NULL;
-      g_autofree gchar *simple_locale = NULL;
-      g_autofree gchar *tmp = NULL;
-      const gchar *type = NULL;
-      const gchar *id = NULL;
-      g_autoptr(GList) language_layouts = NULL;
-
-      if (!gnome_parse_locale (*locale, &lang_code, &country_code, NULL, NULL))
-        continue;
-
-      if (country_code != NULL)
-	simple_locale = g_strdup_printf ("%s_%s.UTF-8", lang_code, country_code);
-      else
-	simple_locale = g_strdup_printf ("%s.UTF-8", lang_code);
-
-      if (g_hash_table_contains (self->locales, simple_locale))
-          continue;
+      CcInputCatalogueLocale *entry = g_ptr_array_index (entries, i);
+      LocaleInfo *info;
 
       info = g_new0 (LocaleInfo, 1);
-      info->id = g_strdup (simple_locale);
-      info->name = gnome_get_language_from_locale (simple_locale, NULL);
-      info->unaccented_name = cc_util_normalize_casefold_and_unaccent (info->name);
-      tmp = gnome_get_language_from_locale (simple_locale, "C");
-      info->untranslated_name = cc_util_normalize_casefold_and_unaccent (tmp);
+      info->entry = entry;
+      info->engine_ids = g_ptr_array_new ();
 
-      g_hash_table_replace (self->locales, g_strdup (simple_locale), info);
-      add_locale_to_table (self->locales_by_language, lang_code, info);
-
-      if (gnome_get_input_source_from_locale (simple_locale, &type, &id) &&
-          g_str_equal (type, INPUT_SOURCE_TYPE_XKB))
+      if (g_strcmp0 (entry->default_type, INPUT_SOURCE_TYPE_XKB) == 0)
         {
-          add_default_row (self, info, type, id);
-          g_hash_table_add (layouts_with_locale, (gpointer) id);
+          info->default_type = INPUT_SOURCE_TYPE_XKB;
+          info->default_id = entry->default_id;
         }
 
-      /* We don't own these ids */
-      info->layout_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                       NULL, g_object_unref);
-      info->engine_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                       NULL, g_object_unref);
+      g_hash_table_replace (self->locales, entry->id, info);
+      if (entry->language)
+        add_locale_to_table (self->locales_by_language, entry->language, info);
+    }
+}
 
-      language_layouts = gnome_xkb_info_get_layouts_for_language (self->xkb_info, lang_code);
-      add_rows_to_table (self, info, language_layouts, INPUT_SOURCE_TYPE_XKB, id);
-      add_ids_to_set (layouts_with_locale, language_layouts);
+static void
+set_catalogue (CcInputChooser   *self,
+               CcInputCatalogue *catalogue)
+{
+  self->catalogue = g_object_ref (catalogue);
 
-      if (country_code != NULL)
-        {
-          g_autoptr(GList) country_layouts = gnome_xkb_info_get_layouts_for_country (self->xkb_info, country_code);
-          add_rows_to_table (self, info, country_layouts, INPUT_SOURCE_TYPE_XKB, id);
-          add_ids_to_set (layouts_with_locale, country_layouts);
-        }
-    }
+  get_locale_infos (self);
+#ifdef HAVE_IBUS
+  get_ibus_locale_infos (self);
+#endif  /* HAVE_IBUS */
 
-  /* Add a "Other" locale to hold the remaining input sources */
-  info = g_new0 (LocaleInfo, 1);
-  info->id = g_strdup ("");
-  info->name = g_strdup (C_("Input Source", "Other"));
-  info->unaccented_name = g_strdup ("");
-  info->untranslated_name = g_strdup ("");
-  g_hash_table_replace (self->locales, g_strdup (info->id), info);
+  if (self->filter_words)
+    update_matches (self);
 
-  info->layout_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                   NULL, g_object_unref);
-  info->engine_rows_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
-                                                   NULL, g_object_unref);
+  show_locale_rows (self);
+}
+
+static void
+on_catalogue_ready_cb (GObject      *object,
+                       GAsyncResult *result,
+                       gpointer      user_data)
+{
+  g_autoptr(CcInputCatalogue) catalogue = NULL;
+  g_autoptr(GError) error = NULL;
 
-  all_layouts = gnome_xkb_info_get_all_layouts (self->xkb_info);
-  for (l = all_layouts; l; l = l->next)
-    if (!g_hash_table_contains (layouts_with_locale, l->data))
-      add_row_other (self, INPUT_SOURCE_TYPE_XKB, l->data);
+  catalogue = cc_input_catalogue_get_finish (result, &error);
+  if (!catalogue)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_warning ("Failed to load the input sources: %s", error->message);
+      return;
+    }
+
+  set_catalogue (CC_INPUT_CHOOSER (user_data), catalogue);
 }
 
 /*
@@ -965,12 +961,21 @@ cc_input_chooser_dispose (GObject *object)
 {
   CcInputChooser *self = CC_INPUT_CHOOSER (object);
 
+  g_cancellable_cancel (self->cancellable);
+  g_clear_object (&self->cancellable);
   g_clear_object (&self->more_row);
   g_clear_object (&self->no_results);
   g_clear_object (&self->xkb_info);
-  g_clear_pointer (&self->ibus_engines, g_hash_table_unref);
   g_clear_pointer (&self->locales, g_hash_table_unref);
   g_clear_pointer (&self->locales_by_language, g_hash_table_unref);
+  g_clear_pointer (&self->engine_names, g_hash_table_unref);
+  g_clear_pointer (&self->engine_locales, g_hash_table_unref);
+  g_clear_pointer (&self->ibus_engines, g_hash_table_unref);
+  g_clear_pointer (&self->named_locales, g_hash_table_unref);
+  g_clear_pointer (&self->matching_locales, g_hash_table_unref);
+  g_clear_pointer (&self->matching_layouts, g_hash_table_unref);
+  g_clear_pointer (&self->matching_engines, g_hash_table_unref);
+  g_clear_object (&self->catalogue);
   g_clear_pointer (&self->filter_words, g_strfreev);
   g_clear_handle_id (&self->filter_timeout_id, g_source_remove);
 
@@ -1005,6 +1010,25 @@ cc_input_chooser_init (CcInputChooser *self)
   gtk_widget_init_template (GTK_WIDGET (self));
 
   gtk_search_entry_set_key_capture_widget (self->filter_entry, GTK_WIDGET (self));
+
+  self->cancellable = g_cancellable_new ();
+
+  /* Locale ids are owned by the catalogue */
+  self->locales = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         NULL, locale_info_free);
+  self->locales_by_language = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                     g_free, (GDestroyNotify) g_hash_table_unref);
+
+  /* Engine ids are owned by ibus_engines */
+  self->engine_names = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+  self->engine_locales = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                NULL, (GDestroyNotify) g_ptr_array_unref);
+
+  /* So are the matching locale and layout ids */
+  self->named_locales = g_hash_table_new (g_str_hash, g_str_equal);
+  self->matching_locales = g_hash_table_new (g_str_hash, g_str_equal);
+  self->matching_layouts = g_hash_table_new (g_str_hash, g_str_equal);
+  self->matching_engines = g_hash_table_new (g_str_hash, g_str_equal);
 }
 
 CcInputChooser *
@@ -1012,6 +1036,7 @@ cc_input_chooser_new (gboolean      is_login,
                       GnomeXkbInfo *xkb_info,
                       GHashTable   *ibus_engines)
 {
+  CcInputCatalogue *catalogue;
   CcInputChooser *self;
 
   self = g_object_new (CC_TYPE_INPUT_CHOOSER,
@@ -1034,11 +1059,16 @@ cc_input_chooser_new (gboolean      is_login,
   if (self->is_login)
     gtk_widget_show (GTK_WIDGET (self->login_label));
 
-  get_locale_infos (self);
-#ifdef HAVE_IBUS
-  get_ibus_locale_infos (self);
-#endif  /* HAVE_IBUS */
-  show_locale_rows (self);
+  catalogue = cc_input_catalogue_peek ();
+  if (catalogue)
+    {
+      set_catalogue (self, catalogue);
+    }
+  else
+    {
+      show_locale_rows (self);
+      cc_input_catalogue_get_async (self->cancellable, on_catalogue_ready_cb, self);
+    }
 
   return self;
 }
@@ -1047,6 +1077,11 @@ void
 cc_input_chooser_set_ibus_engines (CcInputChooser *self,
                                    GHashTable     *ibus_engines)
 {
+#ifdef HAVE_IBUS
+  GHashTableIter iter;
+  LocaleInfo *info;
+#endif  /* HAVE_IBUS */
+
   g_return_if_fail (CC_IS_INPUT_CHOOSER (self));
 
 #ifdef HAVE_IBUS
@@ -1055,7 +1090,20 @@ cc_input_chooser_set_ibus_engines (CcInputChooser *self,
   g_return_if_fail (self->ibus_engines == NULL);
 
   self->ibus_engines = ibus_engines;
+
+  /* Otherwise this happens once the catalogue is ready */
+  if (!self->catalogue)
+    return;
+
   get_ibus_locale_infos (self);
+
+  g_hash_table_iter_init (&iter, self->locales);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &info))
+    clear_input_source_rows (info);
+
+  if (self->filter_words)
+    update_matches (self);
+
   show_locale_rows (self);
 #endif  /* HAVE_IBUS */
 }
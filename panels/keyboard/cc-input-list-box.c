@@ -26,6 +26,7 @@
 #include <libgnome-desktop/gnome-xkb-info.h>
 
 #include "cc-input-list-box.h"
+#include "cc-input-catalogue.h"
 #include "cc-input-chooser.h"
 #include "cc-input-row.h"
 #include "cc-input-source-ibus.h"
@@ -771,6 +772,9 @@ cc_input_list_box_init (CcInputListBox *self)
 
   self->xkb_info = gnome_xkb_info_new ();
 
+  /* Have the input chooser ready to show by the time it is asked for */
+  cc_input_catalogue_get_async (NULL, NULL, NULL);
+
 #ifdef HAVE_IBUS
   ibus_init ();
   if (!self->ibus) {
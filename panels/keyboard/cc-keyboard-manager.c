@@ -44,6 +44,10 @@ struct _CcKeyboardManager
   GHashTable         *kb_apps_sections;
   GHashTable         *kb_user_sections;
 
+  /* Accelerator index, to find conflicts without walking every section */
+  GHashTable         *combo_index;   /* normalized CcKeyCombo -> GPtrArray of CcKeyboardItem */
+  GHashTable         *item_combos;   /* CcKeyboardItem -> GArray of indexed CcKeyCombo */
+
   GSettings          *binding_settings;
 };
 
@@ -82,84 +86,165 @@ free_key_array (GPtrArray *keys)
     }
 }
 
+static guint
+key_combo_hash (gconstpointer key)
+{
+  const CcKeyCombo *combo = key;
+
+  return (combo->keyval * 31 + combo->keycode) * 31 + combo->mask;
+}
+
 static gboolean
-find_conflict (CcUniquenessData *data,
-               CcKeyboardItem   *item)
+key_combo_equal (gconstpointer a,
+                 gconstpointer b)
 {
-  GList *l;
-  gboolean is_conflict = FALSE;
+  const CcKeyCombo *combo_a = a;
+  const CcKeyCombo *combo_b = b;
 
-  if (data->orig_item && cc_keyboard_item_equal (data->orig_item, item))
+  return combo_a->keyval == combo_b->keyval &&
+         combo_a->keycode == combo_b->keycode &&
+         combo_a->mask == combo_b->mask;
+}
+
+/* Combos with a keyval conflict regardless of their keycode, while
+ * combos without one only conflict through their keycode. Returns
+ * %FALSE for disabled combos, which never conflict.
+ */
+static gboolean
+normalize_key_combo (const CcKeyCombo *combo,
+                     CcKeyCombo       *normalized)
+{
+  if (combo->keyval == 0 && combo->keycode == 0)
     return FALSE;
 
+  normalized->keyval = combo->keyval;
+  normalized->keycode = combo->keyval != 0 ? 0 : combo->keycode;
+  normalized->mask = combo->mask;
+
+  return TRUE;
+}
+
+static void
+index_item_combos (CcKeyboardManager *self,
+                   CcKeyboardItem    *item)
+{
+  GArray *combos;
+  GList *l;
+
+  combos = g_array_new (FALSE, FALSE, sizeof (CcKeyCombo));
+
   for (l = cc_keyboard_item_get_key_combos (item); l; l = l->next)
     {
-      CcKeyCombo *combo = l->data;
+      GPtrArray *items;
+      CcKeyCombo normalized;
 
-      if (data->new_mask != combo->mask)
+      if (!normalize_key_combo (l->data, &normalized))
         continue;
 
-      if (data->new_keyval != 0)
-        is_conflict = data->new_keyval == combo->keyval;
-      else
-        is_conflict = combo->keyval == 0 && data->new_keycode == combo->keycode;
+      items = g_hash_table_lookup (self->combo_index, &normalized);
+      if (!items)
+        {
+          items = g_ptr_array_new ();
+          g_hash_table_insert (self->combo_index, g_memdup2 (&normalized, sizeof (CcKeyCombo)), items);
+        }
 
-      if (is_conflict)
-        break;
-    }
+      if (g_ptr_array_find (items, item, NULL))
+        continue;
 
-  if (is_conflict)
-    data->conflict_item = item;
+      g_ptr_array_add (items, item);
+      g_array_append_val (combos, normalized);
+    }
 
-  return is_conflict;
+  g_hash_table_insert (self->item_combos, item, combos);
 }
 
-static gboolean
-compare_keys_for_uniqueness (CcKeyboardItem   *current_item,
-                             CcUniquenessData *data)
+static void
+unindex_item_combos (CcKeyboardManager *self,
+                     CcKeyboardItem    *item)
 {
-  CcKeyboardItem *reverse_item;
+  GArray *combos;
+  guint i;
 
-  /* No conflict for: blanks or ourselves */
-  if (!current_item || data->orig_item == current_item)
-    return FALSE;
+  combos = g_hash_table_lookup (self->item_combos, item);
+  if (!combos)
+    return;
 
-  reverse_item = cc_keyboard_item_get_reverse_item (current_item);
+  for (i = 0; i < combos->len; i++)
+    {
+      CcKeyCombo *combo = &g_array_index (combos, CcKeyCombo, i);
+      GPtrArray *items;
 
-  /* When the current item is the reversed shortcut of a main item, simply ignore it */
-  if (reverse_item && cc_keyboard_item_is_hidden (current_item))
-    return FALSE;
+      items = g_hash_table_lookup (self->combo_index, combo);
+      g_ptr_array_remove (items, item);
 
-  if (find_conflict (data, current_item))
-    return TRUE;
+      if (items->len == 0)
+        g_hash_table_remove (self->combo_index, combo);
+    }
 
-  /* Also check for the reverse item if any */
-  if (reverse_item && find_conflict (data, reverse_item))
-    return TRUE;
+  g_hash_table_remove (self->item_combos, item);
+}
 
-  return FALSE;
+static void
+on_item_key_combos_changed_cb (CcKeyboardItem    *item,
+                               GParamSpec        *pspec,
+                               CcKeyboardManager *self)
+{
+  unindex_item_combos (self, item);
+  index_item_combos (self, item);
 }
 
-static gboolean
-check_for_uniqueness (gpointer          key,
-                      GPtrArray        *keys_array,
-                      CcUniquenessData *data)
+static void
+index_item (CcKeyboardManager *self,
+            CcKeyboardItem    *item)
 {
-  guint i;
+  if (g_hash_table_contains (self->item_combos, item))
+    return;
 
-  for (i = 0; i < keys_array->len; i++)
-    {
-      CcKeyboardItem *item;
+  index_item_combos (self, item);
 
-      item = keys_array->pdata[i];
+  g_signal_connect_object (item,
+                           "notify::key-combos",
+                           G_CALLBACK (on_item_key_combos_changed_cb),
+                           self,
+                           0);
+}
 
-      if (compare_keys_for_uniqueness (item, data))
-        return TRUE;
-    }
+static void
+unindex_item (CcKeyboardManager *self,
+              CcKeyboardItem    *item)
+{
+  unindex_item_combos (self, item);
+  g_signal_handlers_disconnect_by_func (item, on_item_key_combos_changed_cb, self);
+}
 
-  return FALSE;
+static void
+clear_index (CcKeyboardManager *self)
+{
+  GHashTableIter iter;
+  CcKeyboardItem *item;
+
+  g_hash_table_iter_init (&iter, self->item_combos);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &item, NULL))
+    g_signal_handlers_disconnect_by_func (item, on_item_key_combos_changed_cb, self);
+
+  g_hash_table_remove_all (self->item_combos);
+  g_hash_table_remove_all (self->combo_index);
 }
 
+/* Hidden reversed shortcuts change along with their main shortcut */
+static gboolean
+is_same_shortcut (CcKeyboardItem *orig_item,
+                  CcKeyboardItem *item)
+{
+  if (!orig_item)
+    return FALSE;
+
+  if (orig_item == item || cc_keyboard_item_equal (orig_item, item))
+    return TRUE;
+
+  return cc_keyboard_item_is_hidden (item) &&
+         cc_keyboard_item_get_reverse_item (item) == orig_item;
+}
 
 static GHashTable*
 get_hash_for_group (CcKeyboardManager *self,
@@ -349,6 +434,7 @@ append_section (CcKeyboardManager  *self,
       cc_keyboard_item_set_hidden (item, keys_list[i].hidden);
 
       g_ptr_array_add (keys_array, item);
+      index_item (self, item);
     }
 
   g_hash_table_destroy (reverse_items);
@@ -668,6 +754,7 @@ reload_sections (CcKeyboardManager *self)
 
   /* Clear previous models and hash tables */
   gtk_list_store_clear (GTK_LIST_STORE (self->sections_store));
+  clear_index (self);
 
   g_clear_pointer (&self->kb_system_sections, g_hash_table_destroy);
   self->kb_system_sections = g_hash_table_new_full (g_str_hash,
@@ -742,6 +829,9 @@ cc_keyboard_manager_finalize (GObject *object)
 {
   CcKeyboardManager *self = (CcKeyboardManager *)object;
 
+  clear_index (self);
+  g_clear_pointer (&self->combo_index, g_hash_table_destroy);
+  g_clear_pointer (&self->item_combos, g_hash_table_destroy);
   g_clear_pointer (&self->kb_system_sections, g_hash_table_destroy);
   g_clear_pointer (&self->kb_apps_sections, g_hash_table_destroy);
   g_clear_pointer (&self->kb_user_sections, g_hash_table_destroy);
@@ -832,6 +922,15 @@ cc_keyboard_manager_init (CcKeyboardManager *self)
                                              G_TYPE_STRING,
                                              G_TYPE_STRING,
                                              G_TYPE_INT);
+
+  self->combo_index = g_hash_table_new_full (key_combo_hash,
+                                             key_combo_equal,
+                                             g_free,
+                                             (GDestroyNotify) g_ptr_array_unref);
+  self->item_combos = g_hash_table_new_full (g_direct_hash,
+                                             g_direct_equal,
+                                             NULL,
+                                             (GDestroyNotify) g_array_unref);
 }
 
 
@@ -903,6 +1002,7 @@ cc_keyboard_manager_add_custom_shortcut (CcKeyboardManager *self,
     }
 
   g_ptr_array_add (keys_array, item);
+  index_item (self, item);
 
   settings_paths = g_settings_get_strv (self->binding_settings, "custom-keybindings");
 
@@ -967,10 +1067,51 @@ cc_keyboard_manager_remove_custom_shortcut  (CcKeyboardManager *self,
 
   keys_array = g_hash_table_lookup (get_hash_for_group (self, BINDING_GROUP_USER), CUSTOM_SHORTCUTS_ID);
   g_ptr_array_remove (keys_array, item);
+  unindex_item (self, item);
 
   g_signal_emit (self, signals[SHORTCUT_REMOVED], 0, item);
 }
 
+/**
+ * cc_keyboard_manager_get_collisions:
+ * @self: a #CcKeyboardManager
+ * @item: (nullable): a keyboard shortcut
+ * @combo: a #CcKeyCombo
+ *
+ * Retrieves all the shortcuts other than @item using @combo.
+ *
+ * Returns: (transfer full)(element-type CcKeyboardItem): the collisioned shortcuts
+ */
+GPtrArray*
+cc_keyboard_manager_get_collisions (CcKeyboardManager *self,
+                                    CcKeyboardItem    *item,
+                                    CcKeyCombo        *combo)
+{
+  GPtrArray *collisions;
+  GPtrArray *items;
+  CcKeyCombo normalized;
+  guint i;
+
+  g_return_val_if_fail (CC_IS_KEYBOARD_MANAGER (self), NULL);
+
+  collisions = g_ptr_array_new_with_free_func (g_object_unref);
+
+  /* Any number of shortcuts can be disabled */
+  if (!normalize_key_combo (combo, &normalized))
+    return collisions;
+
+  items = g_hash_table_lookup (self->combo_index, &normalized);
+  for (i = 0; items && i < items->len; i++)
+    {
+      CcKeyboardItem *collision = g_ptr_array_index (items, i);
+
+      if (!is_same_shortcut (item, collision))
+        g_ptr_array_add (collisions, g_object_ref (collision));
+    }
+
+  return collisions;
+}
+
 /**
  * cc_keyboard_manager_get_collision:
  * @self: a #CcKeyboardManager
@@ -986,34 +1127,14 @@ cc_keyboard_manager_get_collision (CcKeyboardManager *self,
                                    CcKeyboardItem    *item,
                                    CcKeyCombo        *combo)
 {
-  CcUniquenessData data;
-  BindingGroupType i;
+  g_autoptr(GPtrArray) collisions = NULL;
 
   g_return_val_if_fail (CC_IS_KEYBOARD_MANAGER (self), NULL);
 
-  data.orig_item = item;
-  data.new_keyval = combo->keyval;
-  data.new_mask = combo->mask;
-  data.new_keycode = combo->keycode;
-  data.conflict_item = NULL;
-
-  if (combo->keyval == 0 && combo->keycode == 0)
-    return NULL;
-
-  /* Any number of shortcuts can be disabled */
-  for (i = BINDING_GROUP_SYSTEM; i <= BINDING_GROUP_USER && !data.conflict_item; i++)
-    {
-      GHashTable *table;
-
-      table = get_hash_for_group (self, i);
-
-      if (!table)
-        continue;
-
-      g_hash_table_find (table, (GHRFunc) check_for_uniqueness, &data);
-    }
+  collisions = cc_keyboard_manager_get_collisions (self, item, combo);
 
-  return data.conflict_item;
+  /* The items are still owned by their sections */
+  return collisions->len > 0 ? g_ptr_array_index (collisions, 0) : NULL;
 }
 
 /**
@@ -1038,11 +1159,12 @@ cc_keyboard_manager_reset_shortcut (CcKeyboardManager *self,
   for (l = cc_keyboard_item_get_default_combos (item); l; l = l->next)
     {
       CcKeyCombo *combo = l->data;
-      CcKeyboardItem *collision;
+      g_autoptr(GPtrArray) collisions = NULL;
+      guint i;
 
-      collision = cc_keyboard_manager_get_collision (self, NULL, combo);
-      if (collision)
-        cc_keyboard_item_remove_key_combo (collision, combo);
+      collisions = cc_keyboard_manager_get_collisions (self, NULL, combo);
+      for (i = 0; i < collisions->len; i++)
+        cc_keyboard_item_remove_key_combo (g_ptr_array_index (collisions, i), combo);
     }
 
   /* Resets the current item */
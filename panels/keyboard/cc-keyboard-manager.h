@@ -47,6 +47,10 @@ CcKeyboardItem*      cc_keyboard_manager_get_collision           (CcKeyboardMana
                                                                   CcKeyboardItem     *item,
                                                                   CcKeyCombo         *combo);
 
+GPtrArray*           cc_keyboard_manager_get_collisions          (CcKeyboardManager  *self,
+                                                                  CcKeyboardItem     *item,
+                                                                  CcKeyCombo         *combo);
+
 void                 cc_keyboard_manager_reset_shortcut          (CcKeyboardManager  *self,
                                                                   CcKeyboardItem     *item);
 
@@ -56,7 +56,7 @@ struct _CcKeyboardShortcutEditor
   CcKeyboardItem     *item;
   GBinding           *reset_item_binding;
 
-  CcKeyboardItem     *collision_item;
+  GPtrArray          *collision_items;
 
   /* Custom shortcuts */
   gboolean            system_shortcuts_inhibited;
@@ -138,6 +138,18 @@ set_shortcut_editor_page (CcKeyboardShortcutEditor *self,
     gtk_widget_set_visible (GTK_WIDGET (self->top_info_label), page != PAGE_CUSTOM);
 }
 
+static void
+disable_collision_items (CcKeyboardShortcutEditor *self)
+{
+  guint i;
+
+  if (!self->collision_items)
+    return;
+
+  for (i = 0; i < self->collision_items->len; i++)
+    cc_keyboard_item_disable (g_ptr_array_index (self->collision_items, i));
+}
+
 static void
 apply_custom_item_fields (CcKeyboardShortcutEditor *self,
                           CcKeyboardItem           *item)
@@ -182,7 +194,7 @@ clear_custom_entries (CcKeyboardShortcutEditor *self)
   self->custom_is_modifier = TRUE;
   self->edited = FALSE;
 
-  self->collision_item = NULL;
+  g_clear_pointer (&self->collision_items, g_ptr_array_unref);
 
   g_signal_handlers_unblock_by_func (self->command_entry, command_entry_changed_cb, self);
   g_signal_handlers_unblock_by_func (self->name_entry, name_entry_changed_cb, self);
@@ -249,9 +261,8 @@ update_shortcut (CcKeyboardShortcutEditor *self)
   /* Setup the binding */
   apply_custom_item_fields (self, self->item);
 
-  /* Eventually disable the conflict shortcut */
-  if (self->collision_item)
-    cc_keyboard_item_disable (self->collision_item);
+  /* Eventually disable the conflicting shortcuts */
+  disable_collision_items (self);
 
   /* Cleanup whatever was set before */
   clear_custom_entries (self);
@@ -305,7 +316,8 @@ static void
 setup_custom_shortcut (CcKeyboardShortcutEditor *self)
 {
   GtkShortcutLabel *shortcut_label;
-  CcKeyboardItem *collision_item;
+  g_autoptr(GPtrArray) collision_items = NULL;
+  gboolean has_collision;
   HeaderMode mode;
   gboolean is_custom, is_accel_empty;
   gboolean valid, accel_valid;
@@ -358,9 +370,10 @@ setup_custom_shortcut (CcKeyboardShortcutEditor *self)
 
   shortcut_label = get_current_shortcut_label (self);
 
-  collision_item = cc_keyboard_manager_get_collision (self->manager,
-                                                      self->item,
-                                                      self->custom_combo);
+  collision_items = cc_keyboard_manager_get_collisions (self->manager,
+                                                        self->item,
+                                                        self->custom_combo);
+  has_collision = collision_items->len > 0;
 
   accel = gtk_accelerator_name (self->custom_combo->keyval, self->custom_combo->mask);
 
@@ -377,23 +390,35 @@ setup_custom_shortcut (CcKeyboardShortcutEditor *self)
    * must warn the user and let it be very clear that adding this
    * shortcut will disable the other.
    */
-  gtk_widget_set_visible (GTK_WIDGET (self->new_shortcut_conflict_label), collision_item != NULL);
+  gtk_widget_set_visible (GTK_WIDGET (self->new_shortcut_conflict_label), has_collision);
 
-  if (collision_item)
+  if (has_collision)
     {
       GtkLabel *label;
+      g_autoptr(GString) descriptions = NULL;
       g_autofree gchar *friendly_accelerator = NULL;
       g_autofree gchar *accelerator_text = NULL;
       g_autofree gchar *collision_text = NULL;
+      guint i;
 
       friendly_accelerator = convert_keysym_state_to_string (self->custom_combo);
 
+      descriptions = g_string_new (NULL);
+      for (i = 0; i < collision_items->len; i++)
+        {
+          /* Translators: separates the names of the shortcuts which
+           * already use the keys, as in "Copy, Open Terminal" */
+          if (i > 0)
+            g_string_append (descriptions, C_("shortcut list separator", ", "));
+          g_string_append (descriptions, cc_keyboard_item_get_description (g_ptr_array_index (collision_items, i)));
+        }
+
       accelerator_text = g_strdup_printf ("<b>%s</b>", friendly_accelerator);
       collision_text = g_strdup_printf (_("%s is already being used for %s. If you "
                                           "replace it, %s will be disabled"),
                                         accelerator_text,
-                                        cc_keyboard_item_get_description (collision_item),
-                                        cc_keyboard_item_get_description (collision_item));
+                                        descriptions->str,
+                                        descriptions->str);
 
       label = is_custom_shortcut (self) ? self->new_shortcut_conflict_label : self->shortcut_conflict_label;
 
@@ -406,7 +431,7 @@ setup_custom_shortcut (CcKeyboardShortcutEditor *self)
    * the headerbar to display "Cancel" and "Replace". Otherwise, make sure to set
    * only the close button again.
    */
-  if (collision_item)
+  if (has_collision)
     {
       mode = HEADER_MODE_REPLACE;
     }
@@ -420,7 +445,9 @@ setup_custom_shortcut (CcKeyboardShortcutEditor *self)
 
   set_header_mode (self, mode);
 
-  self->collision_item = collision_item;
+  g_clear_pointer (&self->collision_items, g_ptr_array_unref);
+  if (has_collision)
+    self->collision_items = g_steal_pointer (&collision_items);
 }
 
 static void
@@ -433,9 +460,8 @@ add_button_clicked_cb (CcKeyboardShortcutEditor *self)
   /* Apply the custom shortcut setup at the new item */
   apply_custom_item_fields (self, item);
 
-  /* Eventually disable the conflict shortcut */
-  if (self->collision_item)
-    cc_keyboard_item_disable (self->collision_item);
+  /* Eventually disable the conflicting shortcuts */
+  disable_collision_items (self);
 
   /* Cleanup everything once we're done */
   clear_custom_entries (self);
@@ -613,6 +639,7 @@ cc_keyboard_shortcut_editor_finalize (GObject *object)
 {
   CcKeyboardShortcutEditor *self = (CcKeyboardShortcutEditor *)object;
 
+  g_clear_pointer (&self->collision_items, g_ptr_array_unref);
   g_clear_object (&self->item);
   g_clear_object (&self->manager);
 
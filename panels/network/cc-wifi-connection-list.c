@@ -18,6 +18,15 @@
 #include "cc-wifi-connection-list.h"
 #include "cc-wifi-connection-row.h"
 
+/* Scan results arrive one AP at a time, batch them up */
+#define PENDING_TIMEOUT 100 /* ms */
+
+typedef struct
+{
+  GBytes    *ssid;  /* hashable SSID, NULL for hidden networks */
+  GPtrArray *rows;  /* rows the AP was added to */
+} ApInfo;
+
 struct _CcWifiConnectionList
 {
   AdwBin         parent_instance;
@@ -35,21 +44,36 @@ struct _CcWifiConnectionList
   NMDeviceWifi  *device;
 
   NMConnection  *last_active;
+  NMConnection  *active_connection;
 
-  GPtrArray     *connections;
-  GPtrArray     *connections_row;
+  /* Connections shown, mapped to their row or NULL if there is none yet.
+   * They are also indexed by SSID, as APs can only match connections for
+   * their SSID. The SSID a connection is indexed by is kept, as the
+   * connection may be edited. */
+  GHashTable    *connections;
+  GHashTable    *connection_ssids;
+  GHashTable    *ssid_to_connections;
 
-  /* AP SSID cache stores the APs SSID used for assigning it to a row.
-   * This is necessary to efficiently remove it when its SSID changes.
-   *
-   * Note that we only group APs that cannot be assigned to a connection
+  /* Connections edited since the last update */
+  GHashTable    *changed_connections;
+
+  /* Every AP that was handled, mapped to its ApInfo, and indexed by SSID
+   * to find the APs a connection change may affect. */
+  GHashTable    *aps;
+  GHashTable    *ssid_to_aps;
+
+  /* Note that we only group APs that cannot be assigned to a connection
    * by the SSID. In principle this is wrong, because other attributes may
    * be different rendering them separate networks.
    * In practice this will almost never happen, and if it does, we just
    * show and select the strongest AP.
    */
-  GHashTable    *ap_ssid_cache;
   GHashTable    *ssid_to_row;
+
+  /* New APs and rows of changed APs, handled on a timeout */
+  GHashTable    *pending_aps;
+  GHashTable    *pending_rows;
+  guint          pending_id;
 };
 
 static void on_device_ap_added_cb   (CcWifiConnectionList *self,
@@ -60,6 +84,11 @@ static void on_device_ap_removed_cb (CcWifiConnectionList *self,
                                      NMDeviceWifi         *device);
 static void on_row_configured_cb    (CcWifiConnectionList *self,
                                      CcWifiConnectionRow  *row);
+static void on_access_point_property_changed (CcWifiConnectionList *self,
+                                              GParamSpec           *pspec,
+                                              NMAccessPoint        *ap);
+static void on_connection_changed_cb (CcWifiConnectionList *self,
+                                      NMConnection         *connection);
 
 G_DEFINE_TYPE (CcWifiConnectionList, cc_wifi_connection_list, ADW_TYPE_BIN)
 
@@ -86,13 +115,68 @@ new_hashable_ssid (GBytes *ssid)
   /* This is what nm_utils_same_ssid does, but returning it so that we can
    * use the result in other ways (i.e. hash table lookups). */
   data = g_bytes_get_data ((GBytes*) ssid, &size);
-  if (data[size-1] == '\0')
+  if (size > 0 && data[size-1] == '\0')
     size -= 1;
   res = g_bytes_new (data, size);
 
   return res;
 }
 
+static GBytes*
+new_connection_ssid (NMConnection *connection)
+{
+  NMSettingWireless *sw;
+  GBytes *ssid;
+
+  sw = nm_connection_get_setting_wireless (connection);
+  ssid = nm_setting_wireless_get_ssid (sw);
+  if (ssid == NULL)
+    return NULL;
+
+  return new_hashable_ssid (ssid);
+}
+
+static void
+ap_info_free (ApInfo *info)
+{
+  g_clear_pointer (&info->ssid, g_bytes_unref);
+  g_ptr_array_unref (info->rows);
+  g_free (info);
+}
+
+static void
+ssid_table_add (GHashTable *table,
+                GBytes     *ssid,
+                gpointer    item)
+{
+  GPtrArray *items;
+
+  items = g_hash_table_lookup (table, ssid);
+  if (!items)
+    {
+      items = g_ptr_array_new ();
+      g_hash_table_insert (table, g_bytes_ref (ssid), items);
+    }
+
+  g_ptr_array_add (items, item);
+}
+
+static void
+ssid_table_remove (GHashTable *table,
+                   GBytes     *ssid,
+                   gpointer    item)
+{
+  GPtrArray *items;
+
+  items = g_hash_table_lookup (table, ssid);
+  if (!items)
+    return;
+
+  g_ptr_array_remove_fast (items, item);
+  if (items->len == 0)
+    g_hash_table_remove (table, ssid);
+}
+
 static gboolean
 connection_ignored (NMConnection *connection)
 {
@@ -141,180 +225,177 @@ cc_wifi_connection_list_row_add (CcWifiConnectionList *self,
 }
 
 static void
-clear_widget (CcWifiConnectionList *self)
+cc_wifi_connection_list_row_remove (CcWifiConnectionList *self,
+                                    CcWifiConnectionRow  *row)
 {
-  const GPtrArray *aps;
-  GHashTableIter iter;
-  CcWifiConnectionRow *row;
-  gint i;
-
-  /* Clear everything; disconnect all AP signals first */
-  aps = nm_device_wifi_get_access_points (self->device);
-  for (i = 0; i < aps->len; i++)
-    g_signal_handlers_disconnect_by_data (g_ptr_array_index (aps, i), self);
-
-  /* Remove all AP only rows */
-  g_hash_table_iter_init (&iter, self->ssid_to_row);
-  while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &row))
-    {
-      g_hash_table_iter_remove (&iter);
-      g_signal_emit_by_name (self, "remove-row", row);
-      gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
-    }
-
-  /* Remove all connection rows */
-  for (i = 0; i < self->connections_row->len; i++)
-    {
-      if (!g_ptr_array_index (self->connections_row, i))
-        continue;
-
-      row = g_ptr_array_index (self->connections_row, i);
-      g_ptr_array_index (self->connections_row, i) = NULL;
-      g_signal_emit_by_name (self, "remove-row", row);
-      gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
-     }
-
-  /* Reset the internal state */
-  g_ptr_array_set_size (self->connections, 0);
-  g_ptr_array_set_size (self->connections_row, 0);
-  g_hash_table_remove_all (self->ssid_to_row);
-  g_hash_table_remove_all (self->ap_ssid_cache);
+  g_hash_table_remove (self->pending_rows, row);
+  g_signal_emit_by_name (self, "remove-row", row);
+  gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
 }
 
 static void
-update_connections (CcWifiConnectionList *self)
+set_connection_row (CcWifiConnectionList *self,
+                    NMConnection         *connection,
+                    CcWifiConnectionRow  *row)
 {
-  const GPtrArray *aps;
-  const GPtrArray *acs_client;
-  g_autoptr(GPtrArray) acs = NULL;
-  NMActiveConnection *ac;
-  NMConnection *ac_con = NULL;
-  gint i;
+  /* The table owns a reference on its keys, and drops one on replace */
+  g_hash_table_insert (self->connections, g_object_ref (connection), row);
+}
 
-  /* We don't want full UI rebuilds during some UI interactions, so allow freezing the list. */
-  if (self->freeze_count > 0)
-    return;
+static void
+index_connection (CcWifiConnectionList *self,
+                  NMConnection         *connection)
+{
+  GBytes *ssid;
 
-  /* Prevent recursion (maybe move this into an idle handler instead?) */
-  if (self->updating)
+  ssid = new_connection_ssid (connection);
+  if (!ssid)
     return;
-  self->updating = TRUE;
 
-  clear_widget (self);
-
-  /* Copy the new connections; also create a row if we show unavailable
-   * connections */
-  acs_client = nm_client_get_connections (self->client);
+  ssid_table_add (self->ssid_to_connections, ssid, connection);
+  g_hash_table_insert (self->connection_ssids, connection, ssid);
+}
 
-  acs = g_ptr_array_new_full (acs_client->len + 1, NULL);
-  for (i = 0; i < acs_client->len; i++)
-    g_ptr_array_add (acs, g_ptr_array_index (acs_client, i));
+static void
+unindex_connection (CcWifiConnectionList *self,
+                    NMConnection         *connection)
+{
+  GBytes *ssid;
 
-  ac = nm_device_get_active_connection (NM_DEVICE (self->device));
-  if (ac)
-    ac_con = NM_CONNECTION (nm_active_connection_get_connection (ac));
+  /* The SSID may have changed since, so use the one it was indexed by */
+  ssid = g_hash_table_lookup (self->connection_ssids, connection);
+  if (!ssid)
+    return;
 
-  if (ac_con && !g_ptr_array_find (acs, ac_con, NULL))
-    {
-      g_debug ("Adding remote connection for active connection");
-      g_ptr_array_add (acs, g_object_ref (ac_con));
-    }
+  ssid_table_remove (self->ssid_to_connections, ssid, connection);
+  g_hash_table_remove (self->connection_ssids, connection);
+}
 
-  for (i = 0; i < acs->len; i++)
-    {
-      NMConnection *con;
+static gboolean
+connection_ssid_changed (CcWifiConnectionList *self,
+                         NMConnection         *connection)
+{
+  g_autoptr(GBytes) ssid = NULL;
+  GBytes *indexed_ssid;
 
-      con = g_ptr_array_index (acs, i);
-      if (connection_ignored (con))
-        continue;
+  ssid = new_connection_ssid (connection);
+  indexed_ssid = g_hash_table_lookup (self->connection_ssids, connection);
+  if (!ssid || !indexed_ssid)
+    return ssid != indexed_ssid;
 
-      g_ptr_array_add (self->connections, g_object_ref (con));
-      if (self->hide_unavailable && con != ac_con)
-        g_ptr_array_add (self->connections_row, NULL);
-      else
-        g_ptr_array_add (self->connections_row,
-                         cc_wifi_connection_list_row_add (self, con,
-                         NULL, TRUE));
-    }
+  return !g_bytes_equal (ssid, indexed_ssid);
+}
 
-  /* Coldplug all known APs again */
-  aps = nm_device_wifi_get_access_points (self->device);
-  for (i = 0; i < aps->len; i++)
-    on_device_ap_added_cb (self, g_ptr_array_index (aps, i), self->device);
+static void
+add_connection (CcWifiConnectionList *self,
+                NMConnection         *connection)
+{
+  g_hash_table_insert (self->connections, g_object_ref (connection), NULL);
+  index_connection (self, connection);
 
-  self->updating = FALSE;
+  g_signal_connect_object (connection, NM_CONNECTION_CHANGED,
+                           G_CALLBACK (on_connection_changed_cb),
+                           self, G_CONNECT_SWAPPED);
 }
 
 static void
-on_row_configured_cb (CcWifiConnectionList *self, CcWifiConnectionRow *row)
+remove_connection (CcWifiConnectionList *self,
+                   NMConnection         *connection)
 {
-  g_signal_emit_by_name (self, "configure", row);
+  CcWifiConnectionRow *row;
+
+  g_signal_handlers_disconnect_by_func (connection, on_connection_changed_cb, self);
+
+  row = g_hash_table_lookup (self->connections, connection);
+  if (row)
+    cc_wifi_connection_list_row_remove (self, row);
+
+  g_hash_table_remove (self->changed_connections, connection);
+  unindex_connection (self, connection);
+  g_hash_table_remove (self->connections, connection);
 }
 
 static void
-on_access_point_property_changed (CcWifiConnectionList *self,
-                                  GParamSpec           *pspec,
-                                  NMAccessPoint        *ap)
+clear_widget (CcWifiConnectionList *self)
 {
+  GHashTableIter iter;
   CcWifiConnectionRow *row;
-  GBytes *ssid;
-  gboolean has_connection = FALSE;
-  gint i;
+  NMConnection *connection;
+  NMAccessPoint *ap;
 
-  /* If the SSID changed then the AP needs to be added/removed from rows.
-   * Do this by simulating an AP addition/removal.  */
-  if (g_str_equal (pspec->name, NM_ACCESS_POINT_SSID))
+  /* Clear everything; disconnect all AP and connection signals first */
+  g_hash_table_iter_init (&iter, self->aps);
+  while (g_hash_table_iter_next (&iter, (gpointer*) &ap, NULL))
+    g_signal_handlers_disconnect_by_data (ap, self);
+
+  g_hash_table_iter_init (&iter, self->connections);
+  while (g_hash_table_iter_next (&iter, (gpointer*) &connection, NULL))
+    g_signal_handlers_disconnect_by_func (connection, on_connection_changed_cb, self);
+
+  /* Remove all AP only rows */
+  g_hash_table_iter_init (&iter, self->ssid_to_row);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &row))
     {
-      g_debug ("Simulating add/remove for SSID change");
-      on_device_ap_removed_cb (self, ap, self->device);
-      on_device_ap_added_cb (self, ap, self->device);
-      return;
+      g_hash_table_iter_remove (&iter);
+      cc_wifi_connection_list_row_remove (self, row);
     }
 
-  /* Otherwise, find all rows that contain the AP and update it. Do this by
-   * first searching all rows with connections, and then looking it up in the
-   * SSID rows if not found. */
-  for (i = 0; i < self->connections_row->len; i++)
+  /* Remove all connection rows */
+  g_hash_table_iter_init (&iter, self->connections);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &row))
     {
-      row = g_ptr_array_index (self->connections_row, i);
-      if (row && cc_wifi_connection_row_has_access_point (row, ap))
-        {
-          cc_wifi_connection_row_update (row);
-          has_connection = TRUE;
-        }
+      if (row)
+        cc_wifi_connection_list_row_remove (self, row);
     }
 
-  if (!self->show_aps || has_connection)
-    return;
-
-  ssid = g_hash_table_lookup (self->ap_ssid_cache, ap);
-  if (!ssid)
-    return;
-
-  row = g_hash_table_lookup (self->ssid_to_row, ssid);
-  if (!row)
-    g_assert_not_reached ();
-  else
-    cc_wifi_connection_row_update (row);
+  /* Reset the internal state */
+  g_hash_table_remove_all (self->connection_ssids);
+  g_hash_table_remove_all (self->changed_connections);
+  g_hash_table_remove_all (self->connections);
+  g_hash_table_remove_all (self->ssid_to_connections);
+  g_hash_table_remove_all (self->ssid_to_row);
+  g_hash_table_remove_all (self->ssid_to_aps);
+  g_hash_table_remove_all (self->aps);
+  g_hash_table_remove_all (self->pending_aps);
+  g_hash_table_remove_all (self->pending_rows);
+  g_clear_object (&self->active_connection);
 }
 
 static void
-on_device_ap_added_cb (CcWifiConnectionList *self,
-                       NMAccessPoint        *ap,
-                       NMDeviceWifi         *device)
+add_access_point (CcWifiConnectionList *self,
+                  NMAccessPoint        *ap)
 {
   g_autoptr(GPtrArray) connections = NULL;
   NM80211ApSecurityFlags rsn_flags;
   CcWifiConnectionRow *row;
+  GPtrArray *candidates = NULL;
   GBytes *ap_ssid;
-  g_autoptr(GBytes) ssid = NULL;
-  guint i, j;
+  ApInfo *info;
+  guint i;
+
+  if (g_hash_table_contains (self->aps, ap))
+    return;
 
   g_signal_connect_object (ap, "notify",
                            G_CALLBACK (on_access_point_property_changed),
                            self, G_CONNECT_SWAPPED);
 
-  connections = nm_access_point_filter_connections (ap, self->connections);
+  info = g_new0 (ApInfo, 1);
+  info->rows = g_ptr_array_new ();
+  g_hash_table_insert (self->aps, g_object_ref (ap), info);
+
+  ap_ssid = nm_access_point_get_ssid (ap);
+  if (ap_ssid != NULL)
+    {
+      info->ssid = new_hashable_ssid (ap_ssid);
+      ssid_table_add (self->ssid_to_aps, info->ssid, ap);
+      candidates = g_hash_table_lookup (self->ssid_to_connections, info->ssid);
+    }
+
+  if (candidates != NULL)
+    connections = nm_access_point_filter_connections (ap, candidates);
+  else
+    connections = g_ptr_array_new_with_free_func (g_object_unref);
 
   /* If this is the active AP, then add the active connection to the list. This
    * is a workaround because nm_access_pointer_filter_connections() will not
@@ -322,7 +403,7 @@ on_device_ap_added_cb (CcWifiConnectionList *self,
    * So it seems like the dummy AP entry that NM creates internally is not actually
    * compatible with the connection that is being activated.
    */
-  if (ap == nm_device_wifi_get_active_access_point (device))
+  if (ap == nm_device_wifi_get_active_access_point (self->device))
     {
       NMActiveConnection *ac;
       NMConnection *ac_con;
@@ -331,12 +412,10 @@ on_device_ap_added_cb (CcWifiConnectionList *self,
 
       if (ac)
         {
-          guint idx;
-
           ac_con = NM_CONNECTION (nm_active_connection_get_connection (ac));
 
           if (!g_ptr_array_find (connections, ac_con, NULL) &&
-              g_ptr_array_find (self->connections, ac_con, &idx))
+              g_hash_table_contains (self->connections, ac_con))
             {
               g_debug ("Adding active connection to list of valid connections for AP");
               g_ptr_array_add (connections, g_object_ref (ac_con));
@@ -347,15 +426,16 @@ on_device_ap_added_cb (CcWifiConnectionList *self,
   /* Add the AP to all connection related rows, creating the row if neccessary. */
   for (i = 0; i < connections->len; i++)
     {
-      gboolean found = g_ptr_array_find (self->connections, g_ptr_array_index (connections, i), &j);
-
-      g_assert (found);
+      NMConnection *connection = g_ptr_array_index (connections, i);
 
-      row = g_ptr_array_index (self->connections_row, j);
+      row = g_hash_table_lookup (self->connections, connection);
       if (!row)
-        row = cc_wifi_connection_list_row_add (self, g_ptr_array_index (connections, i), NULL, TRUE);
+        {
+          row = cc_wifi_connection_list_row_add (self, connection, NULL, TRUE);
+          set_connection_row (self, connection, row);
+        }
       cc_wifi_connection_row_add_access_point (row, ap);
-      g_ptr_array_index (self->connections_row, j) = row;
+      g_ptr_array_add (info->rows, row);
     }
 
   if (connections->len > 0)
@@ -368,8 +448,7 @@ on_device_ap_added_cb (CcWifiConnectionList *self,
    * SSID or add to existing one. However, not for hidden APs that don't have an SSID
    * or a hidden OWE transition network.
    */
-  ap_ssid = nm_access_point_get_ssid (ap);
-  if (ap_ssid == NULL)
+  if (info->ssid == NULL)
     return;
 
   /* Skip OWE-TM network with OWE RSN */
@@ -377,72 +456,368 @@ on_device_ap_added_cb (CcWifiConnectionList *self,
   if (rsn_flags & NM_802_11_AP_SEC_KEY_MGMT_OWE && rsn_flags & NM_802_11_AP_SEC_KEY_MGMT_OWE_TM)
     return;
 
-  ssid = new_hashable_ssid (ap_ssid);
-
-  g_hash_table_insert (self->ap_ssid_cache, ap, g_bytes_ref (ssid));
-
-  row = g_hash_table_lookup (self->ssid_to_row, ssid);
+  row = g_hash_table_lookup (self->ssid_to_row, info->ssid);
   if (!row)
     {
       row = cc_wifi_connection_list_row_add (self, NULL, ap, FALSE);
 
-      g_hash_table_insert (self->ssid_to_row, g_bytes_ref (ssid), row);
+      g_hash_table_insert (self->ssid_to_row, g_bytes_ref (info->ssid), row);
     }
   else
     {
       cc_wifi_connection_row_add_access_point (row, ap);
     }
+  g_ptr_array_add (info->rows, row);
 }
 
 static void
-on_device_ap_removed_cb (CcWifiConnectionList *self,
-                         NMAccessPoint        *ap,
-                         NMDeviceWifi         *device)
+remove_access_point (CcWifiConnectionList *self,
+                     NMAccessPoint        *ap)
 {
-  CcWifiConnectionRow *row;
-  g_autoptr(GBytes) ssid = NULL;
-  gboolean found = FALSE;
-  gint i;
+  gpointer key;
+  ApInfo *info;
+  guint i;
 
   g_signal_handlers_disconnect_by_data (ap, self);
 
-  /* Find any connection related row with the AP and remove the AP from it. Remove the
-   * row if it was the last AP and we are hiding unavailable connections. */
-  for (i = 0; i < self->connections_row->len; i++)
+  if (!g_hash_table_steal_extended (self->aps, ap, &key, (gpointer*) &info))
+    return;
+
+  if (info->ssid)
+    ssid_table_remove (self->ssid_to_aps, info->ssid, ap);
+
+  /* Remove the AP from all rows it was added to. Connection rows are
+   * removed with their last AP if we are hiding unavailable connections,
+   * rows without a connection always are. */
+  for (i = 0; i < info->rows->len; i++)
     {
-      row = g_ptr_array_index (self->connections_row, i);
-      if (row && cc_wifi_connection_row_remove_access_point (row, ap))
+      CcWifiConnectionRow *row = g_ptr_array_index (info->rows, i);
+      NMConnection *connection;
+
+      if (!cc_wifi_connection_row_remove_access_point (row, ap))
+        continue;
+
+      connection = cc_wifi_connection_row_get_connection (row);
+      if (connection)
         {
-          found = TRUE;
+          if (!self->hide_unavailable)
+            continue;
 
-          if (self->hide_unavailable)
-            {
-              g_ptr_array_index (self->connections_row, i) = NULL;
-              g_signal_emit_by_name (self, "remove-row", row);
-              gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
-            }
+          set_connection_row (self, connection, NULL);
         }
+      else
+        {
+          g_hash_table_remove (self->ssid_to_row, info->ssid);
+        }
+
+      cc_wifi_connection_list_row_remove (self, row);
     }
 
-  if (found || !self->show_aps)
+  ap_info_free (info);
+  g_object_unref (key);
+}
+
+static void
+collect_ssid_access_points (CcWifiConnectionList *self,
+                            GBytes               *ssid,
+                            GHashTable           *aps)
+{
+  GPtrArray *ssid_aps;
+  guint i;
+
+  ssid_aps = ssid ? g_hash_table_lookup (self->ssid_to_aps, ssid) : NULL;
+  for (i = 0; ssid_aps && i < ssid_aps->len; i++)
+    g_hash_table_add (aps, g_object_ref (g_ptr_array_index (ssid_aps, i)));
+}
+
+static void
+collect_access_points (CcWifiConnectionList *self,
+                       NMConnection         *connection,
+                       GHashTable           *aps)
+{
+  CcWifiConnectionRow *row;
+  g_autoptr(GBytes) ssid = NULL;
+  const GPtrArray *row_aps;
+  guint i;
+
+  if (!connection)
     return;
 
-  /* If the AP was inserted into a row without a connection, then we will get an
-   * SSID for it here. */
-  g_hash_table_steal_extended (self->ap_ssid_cache, ap, NULL, (gpointer*) &ssid);
-  if (!ssid)
+  row = g_hash_table_lookup (self->connections, connection);
+  if (row)
+    {
+      row_aps = cc_wifi_connection_row_get_access_points (row);
+      for (i = 0; i < row_aps->len; i++)
+        g_hash_table_add (aps, g_object_ref (g_ptr_array_index (row_aps, i)));
+    }
+
+  /* Both the SSID the connection is indexed by and the current one, which
+   * differ if it was edited */
+  collect_ssid_access_points (self, g_hash_table_lookup (self->connection_ssids, connection), aps);
+
+  ssid = new_connection_ssid (connection);
+  collect_ssid_access_points (self, ssid, aps);
+}
+
+static void
+update_connection_row (CcWifiConnectionList *self,
+                       NMConnection         *connection)
+{
+  CcWifiConnectionRow *row;
+
+  if (!connection || !g_hash_table_lookup_extended (self->connections, connection,
+                                                    NULL, (gpointer*) &row))
     return;
 
-  /* And we can update the row (possibly removing it) */
-  row = g_hash_table_lookup (self->ssid_to_row, ssid);
-  g_assert (row != NULL);
+  if (!self->hide_unavailable || connection == self->active_connection)
+    {
+      if (!row)
+        set_connection_row (self, connection,
+                            cc_wifi_connection_list_row_add (self, connection, NULL, TRUE));
+      else
+        cc_wifi_connection_row_update (row);
+    }
+  else if (row && cc_wifi_connection_row_get_access_points (row)->len == 0)
+    {
+      set_connection_row (self, connection, NULL);
+      cc_wifi_connection_list_row_remove (self, row);
+    }
+  else if (row)
+    {
+      cc_wifi_connection_row_update (row);
+    }
+}
+
+static void
+update_connections (CcWifiConnectionList *self)
+{
+  const GPtrArray *aps;
+  const GPtrArray *acs_client;
+  g_autoptr(GHashTable) acs = NULL;
+  g_autoptr(GHashTable) affected_aps = NULL;
+  g_autoptr(GPtrArray) added = NULL;
+  g_autoptr(GPtrArray) removed = NULL;
+  g_autoptr(GPtrArray) edited = NULL;
+  g_autoptr(NMConnection) old_ac_con = NULL;
+  NMActiveConnection *ac;
+  NMConnection *ac_con = NULL;
+  NMAccessPoint *ap;
+  GHashTableIter iter;
+  gpointer connection;
+  gint i;
+
+  /* We don't want full UI rebuilds during some UI interactions, so allow freezing the list. */
+  if (self->freeze_count > 0)
+    return;
+
+  /* Prevent recursion (maybe move this into an idle handler instead?) */
+  if (self->updating)
+    return;
+  self->updating = TRUE;
+
+  /* Find the connections to show; also the active connection, even if it
+   * is not one of the client */
+  acs_client = nm_client_get_connections (self->client);
+
+  acs = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (i = 0; i < acs_client->len; i++)
+    g_hash_table_add (acs, g_ptr_array_index (acs_client, i));
+
+  ac = nm_device_get_active_connection (NM_DEVICE (self->device));
+  if (ac)
+    ac_con = NM_CONNECTION (nm_active_connection_get_connection (ac));
+
+  if (ac_con && !g_hash_table_contains (acs, ac_con))
+    {
+      g_debug ("Adding remote connection for active connection");
+      g_hash_table_add (acs, ac_con);
+    }
+
+  /* Only apply the difference with the connections we have */
+  added = g_ptr_array_new ();
+  g_hash_table_iter_init (&iter, acs);
+  while (g_hash_table_iter_next (&iter, &connection, NULL))
+    {
+      if (connection_ignored (connection))
+        g_hash_table_iter_remove (&iter);
+      else if (!g_hash_table_contains (self->connections, connection))
+        g_ptr_array_add (added, connection);
+    }
+
+  /* Edited connections are matched against the APs again, as any of
+   * their settings may decide which APs they apply to. The ones whose
+   * SSID changed since they were indexed are also moved in the index */
+  removed = g_ptr_array_new_with_free_func (g_object_unref);
+  edited = g_ptr_array_new ();
+  g_hash_table_iter_init (&iter, self->connections);
+  while (g_hash_table_iter_next (&iter, &connection, NULL))
+    {
+      if (!g_hash_table_contains (acs, connection))
+        g_ptr_array_add (removed, g_object_ref (connection));
+      else if (g_hash_table_contains (self->changed_connections, connection) ||
+               connection_ssid_changed (self, connection))
+        g_ptr_array_add (edited, connection);
+    }
 
-  if (cc_wifi_connection_row_remove_access_point (row, ap))
+  g_hash_table_remove_all (self->changed_connections);
+
+  old_ac_con = g_steal_pointer (&self->active_connection);
+  self->active_connection = ac_con ? g_object_ref (ac_con) : NULL;
+
+  /* The APs that may move to other rows: the ones for the SSIDs of the
+   * changed connections, and the active AP */
+  affected_aps = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+  for (i = 0; i < added->len; i++)
+    collect_access_points (self, g_ptr_array_index (added, i), affected_aps);
+  for (i = 0; i < removed->len; i++)
+    collect_access_points (self, g_ptr_array_index (removed, i), affected_aps);
+  for (i = 0; i < edited->len; i++)
+    collect_access_points (self, g_ptr_array_index (edited, i), affected_aps);
+  if (old_ac_con != ac_con)
     {
-      g_hash_table_remove (self->ssid_to_row, ssid);
-      g_signal_emit_by_name (self, "remove-row", row);
-      gtk_list_box_remove (self->listbox, GTK_WIDGET (row));
+      collect_access_points (self, old_ac_con, affected_aps);
+      collect_access_points (self, ac_con, affected_aps);
     }
+
+  ap = nm_device_wifi_get_active_access_point (self->device);
+  if (ap && g_hash_table_contains (self->aps, ap))
+    g_hash_table_add (affected_aps, g_object_ref (ap));
+
+  g_hash_table_iter_init (&iter, affected_aps);
+  while (g_hash_table_iter_next (&iter, (gpointer*) &ap, NULL))
+    remove_access_point (self, ap);
+
+  for (i = 0; i < removed->len; i++)
+    remove_connection (self, g_ptr_array_index (removed, i));
+
+  for (i = 0; i < edited->len; i++)
+    {
+      unindex_connection (self, g_ptr_array_index (edited, i));
+      index_connection (self, g_ptr_array_index (edited, i));
+      update_connection_row (self, g_ptr_array_index (edited, i));
+    }
+
+  for (i = 0; i < added->len; i++)
+    {
+      add_connection (self, g_ptr_array_index (added, i));
+      update_connection_row (self, g_ptr_array_index (added, i));
+    }
+
+  if (old_ac_con != ac_con)
+    {
+      update_connection_row (self, old_ac_con);
+      update_connection_row (self, ac_con);
+    }
+
+  /* Coldplug the affected APs, and any AP we don't have yet */
+  g_hash_table_iter_init (&iter, affected_aps);
+  while (g_hash_table_iter_next (&iter, (gpointer*) &ap, NULL))
+    add_access_point (self, ap);
+
+  aps = nm_device_wifi_get_access_points (self->device);
+  for (i = 0; i < aps->len; i++)
+    add_access_point (self, g_ptr_array_index (aps, i));
+
+  self->updating = FALSE;
+}
+
+static void
+on_row_configured_cb (CcWifiConnectionList *self, CcWifiConnectionRow *row)
+{
+  g_signal_emit_by_name (self, "configure", row);
+}
+
+static gboolean
+on_pending_timeout_cb (gpointer user_data)
+{
+  CcWifiConnectionList *self = CC_WIFI_CONNECTION_LIST (user_data);
+  g_autoptr(GHashTable) pending_aps = NULL;
+  g_autoptr(GHashTable) pending_rows = NULL;
+  GHashTableIter iter;
+  gpointer item;
+
+  self->pending_id = 0;
+
+  pending_aps = g_steal_pointer (&self->pending_aps);
+  self->pending_aps = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
+  g_hash_table_iter_init (&iter, pending_aps);
+  while (g_hash_table_iter_next (&iter, &item, NULL))
+    add_access_point (self, item);
+
+  pending_rows = g_steal_pointer (&self->pending_rows);
+  self->pending_rows = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  g_hash_table_iter_init (&iter, pending_rows);
+  while (g_hash_table_iter_next (&iter, &item, NULL))
+    cc_wifi_connection_row_update (item);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_pending (CcWifiConnectionList *self)
+{
+  if (self->pending_id == 0)
+    self->pending_id = g_timeout_add (PENDING_TIMEOUT, on_pending_timeout_cb, self);
+}
+
+static void
+on_access_point_property_changed (CcWifiConnectionList *self,
+                                  GParamSpec           *pspec,
+                                  NMAccessPoint        *ap)
+{
+  ApInfo *info;
+  guint i;
+
+  /* If the SSID changed then the AP needs to be added/removed from rows.
+   * Do this by simulating an AP addition/removal.  */
+  if (g_str_equal (pspec->name, NM_ACCESS_POINT_SSID))
+    {
+      g_debug ("Simulating add/remove for SSID change");
+      remove_access_point (self, ap);
+      add_access_point (self, ap);
+      return;
+    }
+
+  /* Otherwise, update all rows that contain the AP. Strength changes
+   * come for every AP on each scan, so batch them. */
+  info = g_hash_table_lookup (self->aps, ap);
+  if (!info || info->rows->len == 0)
+    return;
+
+  for (i = 0; i < info->rows->len; i++)
+    g_hash_table_add (self->pending_rows, g_ptr_array_index (info->rows, i));
+
+  queue_pending (self);
+}
+
+static void
+on_connection_changed_cb (CcWifiConnectionList *self,
+                          NMConnection         *connection)
+{
+  /* The edit may change the APs the connection applies to, or make it
+   * ignored, so it is handled like a removal and addition */
+  g_hash_table_add (self->changed_connections, connection);
+  update_connections (self);
+}
+
+static void
+on_device_ap_added_cb (CcWifiConnectionList *self,
+                       NMAccessPoint        *ap,
+                       NMDeviceWifi         *device)
+{
+  g_hash_table_add (self->pending_aps, g_object_ref (ap));
+  queue_pending (self);
+}
+
+static void
+on_device_ap_removed_cb (CcWifiConnectionList *self,
+                         NMAccessPoint        *ap,
+                         NMDeviceWifi         *device)
+{
+  g_hash_table_remove (self->pending_aps, ap);
+  remove_access_point (self, ap);
 }
 
 static void
@@ -456,9 +831,6 @@ on_client_connection_added_cb (CcWifiConnectionList *self,
   if (connection_ignored (connection))
     return;
 
-  /* The approach we take to handle connection changes is to do a full rebuild.
-   * It happens seldom enough to make this feasible.
-   */
   update_connections (self);
 }
 
@@ -467,12 +839,9 @@ on_client_connection_removed_cb (CcWifiConnectionList *self,
                                  NMConnection         *connection,
                                  NMClient             *client)
 {
-  if (!g_ptr_array_find (self->connections, connection, NULL))
+  if (!g_hash_table_contains (self->connections, connection))
     return;
 
-  /* The approach we take to handle connection changes is to do a full rebuild.
-   * It happens seldom enough to make this feasible.
-   */
   update_connections (self);
 }
 
@@ -483,7 +852,7 @@ on_device_state_changed_cb (CcWifiConnectionList *self,
 {
   NMActiveConnection *ac;
   NMConnection *connection = NULL;
-  guint idx;
+  CcWifiConnectionRow *row;
 
   ac = nm_device_get_active_connection (NM_DEVICE (self->device));
   if (ac)
@@ -491,14 +860,14 @@ on_device_state_changed_cb (CcWifiConnectionList *self,
 
   /* Just update the corresponding row if the AC is still the same. */
   if (self->last_active == connection &&
-      g_ptr_array_find (self->connections, connection, &idx) &&
-      g_ptr_array_index (self->connections_row, idx))
+      connection != NULL &&
+      (row = g_hash_table_lookup (self->connections, connection)) != NULL)
     {
-      cc_wifi_connection_row_update (g_ptr_array_index (self->connections_row, idx));
+      cc_wifi_connection_row_update (row);
       return;
     }
 
-  /* Give up and do a full update. */
+  /* Otherwise, move rows and APs around. */
   update_connections (self);
   self->last_active = connection;
 }
@@ -518,8 +887,9 @@ on_device_active_ap_changed_cb (CcWifiConnectionList *self,
   if (ap)
     {
       g_debug ("Simulating add/remove for active AP change");
-      on_device_ap_removed_cb (self, ap, self->device);
-      on_device_ap_added_cb (self, ap, self->device);
+      g_hash_table_remove (self->pending_aps, ap);
+      remove_access_point (self, ap);
+      add_access_point (self, ap);
     }
 }
 
@@ -531,6 +901,7 @@ cc_wifi_connection_list_dispose (GObject *object)
   /* Prevent any further updates; clear_widget must not indirectly recurse
    * through updates_connections */
   self->updating = TRUE;
+  g_clear_handle_id (&self->pending_id, g_source_remove);
 
   /* Drop all external references */
   clear_widget (self);
@@ -546,10 +917,15 @@ cc_wifi_connection_list_finalize (GObject *object)
   g_clear_object (&self->client);
   g_clear_object (&self->device);
 
-  g_clear_pointer (&self->connections, g_ptr_array_unref);
-  g_clear_pointer (&self->connections_row, g_ptr_array_unref);
+  g_clear_pointer (&self->connection_ssids, g_hash_table_unref);
+  g_clear_pointer (&self->changed_connections, g_hash_table_unref);
+  g_clear_pointer (&self->connections, g_hash_table_unref);
+  g_clear_pointer (&self->ssid_to_connections, g_hash_table_unref);
+  g_clear_pointer (&self->aps, g_hash_table_unref);
+  g_clear_pointer (&self->ssid_to_aps, g_hash_table_unref);
   g_clear_pointer (&self->ssid_to_row, g_hash_table_unref);
-  g_clear_pointer (&self->ap_ssid_cache, g_hash_table_unref);
+  g_clear_pointer (&self->pending_aps, g_hash_table_unref);
+  g_clear_pointer (&self->pending_rows, g_hash_table_unref);
 
   G_OBJECT_CLASS (cc_wifi_connection_list_parent_class)->finalize (object);
 }
@@ -589,9 +965,8 @@ cc_wifi_connection_list_constructed (GObject *object)
                            self, G_CONNECT_SWAPPED);
   on_device_state_changed_cb (self, NULL, self->device);
 
-  /* Simulate a change notification on the available connections.
-   * This uses the implementation detail that the list is rebuild
-   * completely in this case. */
+  /* Simulate a change notification on the available connections,
+   * which also coldplugs all APs. */
   update_connections (self);
 }
 
@@ -739,12 +1114,24 @@ cc_wifi_connection_list_init (CcWifiConnectionList *self)
   self->hide_unavailable = TRUE;
   self->show_aps = TRUE;
 
-  self->connections = g_ptr_array_new_with_free_func (g_object_unref);
-  self->connections_row = g_ptr_array_new ();
+  self->connections = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                             g_object_unref, NULL);
+  self->connection_ssids = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                                  NULL, (GDestroyNotify) g_bytes_unref);
+  self->changed_connections = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->ssid_to_connections = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+                                                     (GDestroyNotify) g_bytes_unref,
+                                                     (GDestroyNotify) g_ptr_array_unref);
+  self->aps = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                     g_object_unref, (GDestroyNotify) ap_info_free);
+  self->ssid_to_aps = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
+                                             (GDestroyNotify) g_bytes_unref,
+                                             (GDestroyNotify) g_ptr_array_unref);
   self->ssid_to_row = g_hash_table_new_full (g_bytes_hash, g_bytes_equal,
                                              (GDestroyNotify) g_bytes_unref, NULL);
-  self->ap_ssid_cache = g_hash_table_new_full (g_direct_hash, g_direct_equal,
-                                               NULL, (GDestroyNotify) g_bytes_unref);
+  self->pending_aps = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                             g_object_unref, NULL);
+  self->pending_rows = g_hash_table_new (g_direct_hash, g_direct_equal);
 }
 
 CcWifiConnectionList *
@@ -33,6 +33,10 @@ struct _CcWifiConnectionRow
   NMConnection    *connection;
   gboolean         known_connection;
 
+  /* Sort keys, refreshed with the UI */
+  gboolean         active;
+  guint8           strength;
+
   GtkLabel        *active_label;
   GtkCheckButton  *checkbutton;
   GtkSpinner      *connecting_spinner;
@@ -251,6 +255,9 @@ update_ui (CcWifiConnectionRow *self)
       strength = nm_access_point_get_strength (best_ap);
     }
 
+  self->active = active_connection != NULL;
+  self->strength = strength;
+
   gtk_widget_set_visible (GTK_WIDGET (self->connecting_spinner), connecting);
   if (connecting)
     {
@@ -658,6 +665,25 @@ cc_wifi_connection_row_remove_access_point (CcWifiConnectionRow *self,
   return self->aps->len == 0;
 }
 
+/* Whether the connection of the row is the active one of the device,
+ * as of the last update of the row */
+gboolean
+cc_wifi_connection_row_get_active (CcWifiConnectionRow *self)
+{
+  g_return_val_if_fail (CC_WIFI_CONNECTION_ROW (self), FALSE);
+
+  return self->active;
+}
+
+/* The strength of the best access point, as of the last update of the row */
+guint8
+cc_wifi_connection_row_get_strength (CcWifiConnectionRow *self)
+{
+  g_return_val_if_fail (CC_WIFI_CONNECTION_ROW (self), 0);
+
+  return self->strength;
+}
+
 gboolean
 cc_wifi_connection_row_has_access_point (CcWifiConnectionRow *self,
                                          NMAccessPoint       *ap)
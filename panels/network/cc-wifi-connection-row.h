@@ -49,6 +49,8 @@ gboolean             cc_wifi_connection_row_remove_access_point (CcWifiConnectio
                                                                  NMAccessPoint         *ap);
 gboolean             cc_wifi_connection_row_has_access_point    (CcWifiConnectionRow   *row,
                                                                  NMAccessPoint         *ap);
+gboolean             cc_wifi_connection_row_get_active          (CcWifiConnectionRow   *row);
+guint8               cc_wifi_connection_row_get_strength        (CcWifiConnectionRow   *row);
 
 void                 cc_wifi_connection_row_update              (CcWifiConnectionRow   *row);
 G_END_DECLS
@@ -927,23 +927,18 @@ history_sort (gconstpointer a, gconstpointer b, gpointer data)
 static gint
 ap_sort (gconstpointer a, gconstpointer b, gpointer data)
 {
-        NetDeviceWifi *self = data;
         CcWifiConnectionRow *a_row = CC_WIFI_CONNECTION_ROW ((gpointer) a);
         CcWifiConnectionRow *b_row = CC_WIFI_CONNECTION_ROW ((gpointer) b);
-        NMActiveConnection *active_connection;
         gboolean a_configured, b_configured;
-        NMAccessPoint *apa, *apb;
         guint sa, sb;
 
+        /* The rows cache their sort keys, this runs for every comparison */
+
         /* Show the connected AP first */
-        active_connection = nm_device_get_active_connection (NM_DEVICE (self->device));
-        if (active_connection != NULL) {
-                NMConnection *connection = NM_CONNECTION (nm_active_connection_get_connection (active_connection));
-                if (connection == cc_wifi_connection_row_get_connection (a_row))
-                        return -1;
-                else if (connection == cc_wifi_connection_row_get_connection (b_row))
-                        return 1;
-        }
+        if (cc_wifi_connection_row_get_active (a_row))
+                return -1;
+        else if (cc_wifi_connection_row_get_active (b_row))
+                return 1;
 
         /* Show configured networks before non-configured */
         a_configured = cc_wifi_connection_row_get_connection (a_row) != NULL;
@@ -954,19 +949,8 @@ ap_sort (gconstpointer a, gconstpointer b, gpointer data)
         }
 
         /* Show higher strength networks above lower strength ones */
-
-        apa = cc_wifi_connection_row_best_access_point (a_row);
-        apb = cc_wifi_connection_row_best_access_point (b_row);
-
-        if (apa)
-                sa = nm_access_point_get_strength (apa);
-        else
-                sa = 0;
-
-        if (apb)
-                sb = nm_access_point_get_strength (apb);
-        else
-                sb = 0;
+        sa = cc_wifi_connection_row_get_strength (a_row);
+        sb = cc_wifi_connection_row_get_strength (b_row);
 
         if (sa > sb) return -1;
         if (sb > sa) return 1;
@@ -55,6 +55,12 @@
 
 #define CUPS_STATUS_CHECK_INTERVAL 5
 
+/* Printer notifications arriving within this many milliseconds are
+ * handled together */
+#define PRINTER_UPDATE_INTERVAL 250
+/* Above this many changed printers, fetching all of them at once is cheaper */
+#define MAX_PRINTER_UPDATES 16
+
 #if (CUPS_VERSION_MAJOR > 1) || (CUPS_VERSION_MINOR > 5)
 #define HAVE_CUPS_1_6 1
 #endif
@@ -105,6 +111,10 @@ struct _CcPrintersPanel
 
   GHashTable *printer_entries;
   gboolean    entries_filled;
+
+  GHashTable *pending_printer_updates;
+  gboolean    pending_full_update;
+  guint       printer_update_id;
   GVariant   *action;
 
   GtkSizeGroup *size_group;
@@ -124,6 +134,9 @@ enum {
 };
 
 static void actualize_printers_list (CcPrintersPanel *self);
+static void queue_printer_update (CcPrintersPanel *self,
+                                  const gchar     *printer_name,
+                                  gboolean         deleted);
 static void update_sensitivity (gpointer user_data);
 static void detach_from_cups_notifier (gpointer data);
 static void free_dests (CcPrintersPanel *self);
@@ -302,6 +315,8 @@ cc_printers_panel_dispose (GObject *object)
   g_clear_object (&self->permission);
   g_clear_handle_id (&self->cups_status_check_id, g_source_remove);
   g_clear_handle_id (&self->remove_printer_timeout_id, g_source_remove);
+  g_clear_handle_id (&self->printer_update_id, g_source_remove);
+  g_clear_pointer (&self->pending_printer_updates, g_hash_table_destroy);
   g_clear_pointer (&self->deleted_printer_name, g_free);
   g_clear_pointer (&self->action, g_variant_unref);
   g_clear_pointer (&self->printer_entries, g_hash_table_destroy);
@@ -448,7 +463,7 @@ on_cups_notification (GDBusConnection *connection,
       g_strcmp0 (signal_name, "PrinterDeleted") == 0 ||
       g_strcmp0 (signal_name, "PrinterStateChanged") == 0 ||
       g_strcmp0 (signal_name, "PrinterStopped") == 0)
-    actualize_printers_list (self);
+    queue_printer_update (self, printer_name, g_strcmp0 (signal_name, "PrinterDeleted") == 0);
   else if (g_strcmp0 (signal_name, "JobCreated") == 0 ||
            g_strcmp0 (signal_name, "JobCompleted") == 0)
     {
@@ -797,6 +812,58 @@ remove_nonexisting_entry (CcPrintersPanel *self,
   return !exists;
 }
 
+/* Whether no printer is left once the pending deletions are done */
+static gboolean
+printers_list_is_empty (CcPrintersPanel *self)
+{
+  return (self->num_dests == 0 && self->new_printer_name == NULL) ||
+         (self->num_dests == 1 + g_list_length (self->deleted_printers) &&
+          self->deleted_printer_name != NULL);
+}
+
+/* Whether the target of a pending rename already shows up in the dests */
+static gboolean
+renamed_printer_available (CcPrintersPanel *self)
+{
+  gint i;
+
+  for (i = 0; i < self->num_dests; i++)
+    {
+      if (g_strcmp0 (self->dests[i].name, self->renamed_printer_name) == 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+scroll_to_new_printer (CcPrintersPanel *self)
+{
+  GtkScrolledWindow      *scrolled_window;
+  GtkAllocation           allocation;
+  GtkAdjustment          *adjustment;
+  GtkWidget              *printer_entry;
+
+  if (self->new_printer_name == NULL)
+    return;
+
+  /* Scroll the view to show the newly added printer-entry. */
+  scrolled_window = GTK_SCROLLED_WINDOW (gtk_builder_get_object (self->builder,
+                                                                 "scrolled-window"));
+  adjustment = gtk_scrolled_window_get_vadjustment (scrolled_window);
+
+  printer_entry = GTK_WIDGET (g_hash_table_lookup (self->printer_entries,
+                                                   self->new_printer_name));
+  if (printer_entry != NULL)
+    {
+      gtk_widget_get_allocation (printer_entry, &allocation);
+      g_clear_pointer (&self->new_printer_name, g_free);
+
+      gtk_adjustment_set_value (adjustment,
+                                allocation.y - gtk_widget_get_margin_top (printer_entry));
+    }
+}
+
 static void
 actualize_printers_list_cb (GObject      *source_object,
                             GAsyncResult *result,
@@ -806,7 +873,7 @@ actualize_printers_list_cb (GObject      *source_object,
   GtkWidget              *widget;
   PpCupsDests            *cups_dests;
   GtkWidget              *child;
-  gboolean                new_printer_available = FALSE;
+  gboolean                new_printer_available;
   g_autoptr(GError)       error = NULL;
   gpointer                item;
   int                     i;
@@ -829,9 +896,7 @@ actualize_printers_list_cb (GObject      *source_object,
   g_free (cups_dests);
 
   widget = (GtkWidget*) gtk_builder_get_object (self->builder, "main-vbox");
-  if ((self->num_dests == 0 && self->new_printer_name == NULL) ||
-      (self->num_dests == 1 + g_list_length (self->deleted_printers) &&
-       self->deleted_printer_name != NULL))
+  if (printers_list_is_empty (self))
     pp_cups_connection_test_async (PP_CUPS (source_object), NULL, set_current_page, self);
   else
     gtk_stack_set_visible_child_name (GTK_STACK (widget), "printers-list");
@@ -848,13 +913,7 @@ actualize_printers_list_cb (GObject      *source_object,
       child = next;
     }
 
-  for (i = 0; i < self->num_dests; i++)
-    {
-      new_printer_available = g_strcmp0 (self->dests[i].name, self->renamed_printer_name) == 0;
-      if (new_printer_available)
-        break;
-    }
-
+  new_printer_available = renamed_printer_available (self);
   for (i = 0; i < self->num_dests; i++)
     {
       if (new_printer_available && g_strcmp0 (self->dests[i].name, self->old_printer_name) == 0)
@@ -881,29 +940,7 @@ actualize_printers_list_cb (GObject      *source_object,
 
   update_sensitivity (user_data);
 
-  if (self->new_printer_name != NULL)
-    {
-      GtkScrolledWindow      *scrolled_window;
-      GtkAllocation           allocation;
-      GtkAdjustment          *adjustment;
-      GtkWidget              *printer_entry;
-
-      /* Scroll the view to show the newly added printer-entry. */
-      scrolled_window = GTK_SCROLLED_WINDOW (gtk_builder_get_object (self->builder,
-                                                                     "scrolled-window"));
-      adjustment = gtk_scrolled_window_get_vadjustment (scrolled_window);
-
-      printer_entry = GTK_WIDGET (g_hash_table_lookup (self->printer_entries,
-                                                       self->new_printer_name));
-      if (printer_entry != NULL)
-        {
-          gtk_widget_get_allocation (printer_entry, &allocation);
-          g_clear_pointer (&self->new_printer_name, g_free);
-
-          gtk_adjustment_set_value (adjustment,
-                                    allocation.y - gtk_widget_get_margin_top (printer_entry));
-        }
-    }
+  scroll_to_new_printer (self);
 }
 
 static void
@@ -915,6 +952,173 @@ actualize_printers_list (CcPrintersPanel *self)
                            self);
 }
 
+#ifdef HAVE_CUPS_1_6
+typedef struct
+{
+  GObject *reference;
+  gchar   *printer_name;
+} PrinterUpdateData;
+
+static void
+printer_update_data_free (PrinterUpdateData *data)
+{
+  g_object_unref (data->reference);
+  g_free (data->printer_name);
+  g_free (data);
+}
+
+static void
+update_printers_page (CcPrintersPanel *self)
+{
+  GtkWidget *widget;
+
+  widget = (GtkWidget*) gtk_builder_get_object (self->builder, "main-vbox");
+  if (printers_list_is_empty (self))
+    pp_cups_connection_test_async (self->cups, NULL, set_current_page, self);
+  else
+    gtk_stack_set_visible_child_name (GTK_STACK (widget), "printers-list");
+
+  update_sensitivity (self);
+}
+
+static void
+remove_deleted_printer (CcPrintersPanel *self,
+                        const gchar     *printer_name)
+{
+  PpPrinterEntry *entry;
+  GtkWidget      *widget;
+
+  self->num_dests = cupsRemoveDest (printer_name, NULL, self->num_dests, &self->dests);
+
+  entry = g_hash_table_lookup (self->printer_entries, printer_name);
+  if (entry != NULL)
+    {
+      widget = (GtkWidget*) gtk_builder_get_object (self->builder, "content");
+      g_hash_table_remove (self->printer_entries, printer_name);
+      gtk_list_box_remove (GTK_LIST_BOX (widget), GTK_WIDGET (entry));
+    }
+}
+
+static void
+printer_updated_cb (cups_dest_t *dest,
+                    gpointer     user_data)
+{
+  PrinterUpdateData *data = user_data;
+  CcPrintersPanel   *self;
+  PpPrinterEntry    *entry;
+
+  self = g_object_get_data (data->reference, "self");
+  if (self == NULL)
+    {
+      /* The panel is gone */
+      if (dest != NULL)
+        cupsFreeDests (1, dest);
+      printer_update_data_free (data);
+      return;
+    }
+
+  if (dest == NULL)
+    {
+      /* The lookup may fail for reasons other than the printer being
+       * gone, only a PrinterDeleted notification removes an entry */
+      actualize_printers_list (self);
+      printer_update_data_free (data);
+      return;
+    }
+
+  self->num_dests = cupsCopyDest (dest, self->num_dests, &self->dests);
+
+  /* Like the full refresh, keep the old entry of a renamed printer
+   * until the new one replaces it */
+  if (!renamed_printer_available (self) ||
+      g_strcmp0 (dest->name, self->old_printer_name) != 0)
+    {
+      entry = g_hash_table_lookup (self->printer_entries, dest->name);
+      if (entry != NULL)
+        pp_printer_entry_update (entry, *dest, self->is_authorized);
+      else
+        add_printer_entry (self, *dest);
+    }
+
+  cupsFreeDests (1, dest);
+
+  update_printers_page (self);
+  scroll_to_new_printer (self);
+
+  printer_update_data_free (data);
+}
+#endif
+
+static gboolean
+flush_printer_updates (CcPrintersPanel *self)
+{
+  self->printer_update_id = 0;
+
+#ifdef HAVE_CUPS_1_6
+  /* Patch only the printers that changed, unless the list isn't there
+   * yet or so many changed that one request is cheaper */
+  if (!self->pending_full_update &&
+      self->entries_filled &&
+      g_hash_table_size (self->pending_printer_updates) <= MAX_PRINTER_UPDATES)
+    {
+      GHashTableIter iter;
+      gpointer       key, value;
+      gboolean       removed = FALSE;
+
+      g_hash_table_iter_init (&iter, self->pending_printer_updates);
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        {
+          PrinterUpdateData *data;
+
+          if (GPOINTER_TO_INT (value))
+            {
+              remove_deleted_printer (self, key);
+              removed = TRUE;
+              continue;
+            }
+
+          data = g_new0 (PrinterUpdateData, 1);
+          data->reference = g_object_ref (self->reference);
+          data->printer_name = g_strdup (key);
+
+          get_named_dest_async (data->printer_name, printer_updated_cb, data);
+        }
+
+      if (removed)
+        update_printers_page (self);
+    }
+  else
+#endif
+    {
+      actualize_printers_list (self);
+    }
+
+  g_hash_table_remove_all (self->pending_printer_updates);
+  self->pending_full_update = FALSE;
+
+  return G_SOURCE_REMOVE;
+}
+
+/* The last notification about a printer wins, so a printer deleted
+ * and added back again is looked up rather than removed */
+static void
+queue_printer_update (CcPrintersPanel *self,
+                      const gchar     *printer_name,
+                      gboolean         deleted)
+{
+  if (printer_name != NULL && printer_name[0] != '\0')
+    g_hash_table_insert (self->pending_printer_updates,
+                         g_strdup (printer_name),
+                         GINT_TO_POINTER (deleted));
+  else
+    self->pending_full_update = TRUE;
+
+  if (self->printer_update_id == 0)
+    self->printer_update_id = g_timeout_add (PRINTER_UPDATE_INTERVAL,
+                                             G_SOURCE_FUNC (flush_printer_updates),
+                                             self);
+}
+
 static void
 printer_add_async_cb (GObject      *source_object,
                       GAsyncResult *res,
@@ -1233,6 +1437,11 @@ cc_printers_panel_init (CcPrintersPanel *self)
                                                  g_free,
                                                  NULL);
 
+  self->pending_printer_updates = g_hash_table_new_full (g_str_hash,
+                                                         g_str_equal,
+                                                         g_free,
+                                                         NULL);
+
   g_type_ensure (CC_TYPE_PERMISSION_INFOBAR);
 
   g_object_set_data_full (self->reference, "self", self, NULL);
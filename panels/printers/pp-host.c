@@ -28,8 +28,9 @@
 
 typedef struct
 {
-  gchar *hostname;
-  gint   port;
+  gchar  *hostname;
+  gint    port;
+  gint64  deadline;
 } PpHostPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (PpHost, pp_host, G_TYPE_OBJECT);
@@ -38,6 +39,7 @@ enum {
   PROP_0 = 0,
   PROP_HOSTNAME,
   PROP_PORT,
+  PROP_DEADLINE,
 };
 
 enum {
@@ -75,6 +77,9 @@ pp_host_get_property (GObject    *object,
       case PROP_PORT:
         g_value_set_int (value, priv->port);
         break;
+      case PROP_DEADLINE:
+        g_value_set_int64 (value, priv->deadline);
+        break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object,
                                            prop_id,
@@ -101,6 +106,9 @@ pp_host_set_property (GObject      *object,
       case PROP_PORT:
         priv->port = g_value_get_int (value);
         break;
+      case PROP_DEADLINE:
+        priv->deadline = g_value_get_int64 (value);
+        break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object,
                                            prop_id,
@@ -132,6 +140,15 @@ pp_host_class_init (PpHostClass *klass)
                       -1, G_MAXINT32, PP_HOST_UNSET_PORT,
                       G_PARAM_READWRITE));
 
+  /* Monotonic time at which the SNMP, JetDirect and LPD probes give up
+   * and return what they found so far, or 0 for no deadline. */
+  g_object_class_install_property (gobject_class, PROP_DEADLINE,
+    g_param_spec_int64 ("deadline",
+                        "Deadline",
+                        "The monotonic time at which probes give up",
+                        0, G_MAXINT64, 0,
+                        G_PARAM_READWRITE));
+
   signals[AUTHENTICATION_REQUIRED] =
     g_signal_new ("authentication-required",
                   G_TYPE_FROM_CLASS (klass),
@@ -239,73 +256,149 @@ line_split (gchar *line)
   return result;
 }
 
+/*
+ * Probes are cut short when the host's deadline passes, so that the
+ * slowest probe can't hold up the search. Their own cancellable is
+ * cancelled either by the caller or at the deadline; in the latter case
+ * the probe still returns whatever it found so far.
+ */
+typedef struct
+{
+  GCancellable *cancellable;
+  GCancellable *parent;
+  gulong        cancelled_id;
+  guint         timeout_id;
+} ProbeDeadline;
+
 static void
-_pp_host_get_snmp_devices_thread (GTask        *task,
-                                  gpointer      source_object,
-                                  gpointer      task_data,
-                                  GCancellable *cancellable)
+probe_deadline_parent_cancelled (GCancellable *parent,
+                                 gpointer      user_data)
 {
-  PpHost           *self = source_object;
-  PpHostPrivate    *priv = pp_host_get_instance_private (self);
-  g_autoptr(GPtrArray) devices = NULL;
-  g_autoptr(GError) error = NULL;
-  g_auto(GStrv)     argv = NULL;
-  g_autofree gchar *stdout_string = NULL;
-  gint              exit_status;
+  g_cancellable_cancel (G_CANCELLABLE (user_data));
+}
 
-  devices = g_ptr_array_new_with_free_func (g_object_unref);
+static gboolean
+probe_deadline_reached (gpointer user_data)
+{
+  ProbeDeadline *deadline = user_data;
 
-  argv = g_new0 (gchar *, 3);
-  argv[0] = g_strdup ("/usr/lib/cups/backend/snmp");
-  argv[1] = g_strdup (priv->hostname);
+  deadline->timeout_id = 0;
+  g_cancellable_cancel (deadline->cancellable);
 
-  /* Use SNMP to get printer's informations */
-  g_spawn_sync (NULL,
-                argv,
-                NULL,
-                G_SPAWN_STDERR_TO_DEV_NULL,
-                NULL,
-                NULL,
-                &stdout_string,
-                NULL,
-                &exit_status,
-                &error);
-
-  if (exit_status == 0 && stdout_string)
+  return G_SOURCE_REMOVE;
+}
+
+static ProbeDeadline *
+probe_deadline_new (PpHost       *self,
+                    GCancellable *parent)
+{
+  PpHostPrivate *priv = pp_host_get_instance_private (self);
+  ProbeDeadline *deadline;
+
+  deadline = g_new0 (ProbeDeadline, 1);
+  deadline->cancellable = g_cancellable_new ();
+
+  if (parent != NULL)
     {
-      g_auto(GStrv)     printer_informations = NULL;
-      gint              length;
+      deadline->parent = g_object_ref (parent);
+      deadline->cancelled_id = g_cancellable_connect (parent,
+                                                      G_CALLBACK (probe_deadline_parent_cancelled),
+                                                      deadline->cancellable,
+                                                      NULL);
+    }
 
-      printer_informations = line_split (stdout_string);
-      length = g_strv_length (printer_informations);
+  if (priv->deadline > 0)
+    {
+      gint64 remaining = priv->deadline - g_get_monotonic_time ();
 
-      if (length >= 4)
-        {
-          g_autofree gchar *device_name = NULL;
-          gboolean is_network_device;
-          PpPrintDevice *device;
-
-          device_name = g_strdup (printer_informations[3]);
-          g_strcanon (device_name, ALLOWED_CHARACTERS, '-');
-          is_network_device = g_strcmp0 (printer_informations[0], "network") == 0;
-
-          device = g_object_new (PP_TYPE_PRINT_DEVICE,
-                                 "is-network-device", is_network_device,
-                                 "device-uri", printer_informations[1],
-                                 "device-make-and-model", printer_informations[2],
-                                 "device-info", printer_informations[3],
-                                 "acquisition-method", ACQUISITION_METHOD_SNMP,
-                                 "device-name", device_name,
-                                 NULL);
-
-          if (length >= 5 && printer_informations[4][0] != '\0')
-            g_object_set (device, "device-id", printer_informations[4], NULL);
-
-          if (length >= 6 && printer_informations[5][0] != '\0')
-            g_object_set (device, "device-location", printer_informations[5], NULL);
-
-          g_ptr_array_add (devices, device);
-        }
+      deadline->timeout_id = g_timeout_add (MAX (remaining, 0) / 1000,
+                                            probe_deadline_reached,
+                                            deadline);
+    }
+
+  return deadline;
+}
+
+static void
+probe_deadline_free (ProbeDeadline *deadline)
+{
+  if (deadline != NULL)
+    {
+      if (deadline->parent != NULL)
+        g_cancellable_disconnect (deadline->parent, deadline->cancelled_id);
+      g_clear_handle_id (&deadline->timeout_id, g_source_remove);
+      g_clear_object (&deadline->parent);
+      g_clear_object (&deadline->cancellable);
+      g_free (deadline);
+    }
+}
+
+static void
+add_snmp_device (GPtrArray *devices,
+                 gchar     *output)
+{
+  g_auto(GStrv)     printer_informations = NULL;
+  g_autofree gchar *device_name = NULL;
+  gboolean          is_network_device;
+  PpPrintDevice    *device;
+  gint              length;
+
+  printer_informations = line_split (output);
+  length = g_strv_length (printer_informations);
+
+  if (length < 4)
+    return;
+
+  device_name = g_strdup (printer_informations[3]);
+  g_strcanon (device_name, ALLOWED_CHARACTERS, '-');
+  is_network_device = g_strcmp0 (printer_informations[0], "network") == 0;
+
+  device = g_object_new (PP_TYPE_PRINT_DEVICE,
+                         "is-network-device", is_network_device,
+                         "device-uri", printer_informations[1],
+                         "device-make-and-model", printer_informations[2],
+                         "device-info", printer_informations[3],
+                         "acquisition-method", ACQUISITION_METHOD_SNMP,
+                         "device-name", device_name,
+                         NULL);
+
+  if (length >= 5 && printer_informations[4][0] != '\0')
+    g_object_set (device, "device-id", printer_informations[4], NULL);
+
+  if (length >= 6 && printer_informations[5][0] != '\0')
+    g_object_set (device, "device-location", printer_informations[5], NULL);
+
+  g_ptr_array_add (devices, device);
+}
+
+static void
+snmp_communicate_cb (GObject      *source_object,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+  GSubprocess          *subprocess = G_SUBPROCESS (source_object);
+  g_autoptr(GTask)      task = G_TASK (user_data);
+  g_autoptr(GPtrArray)  devices = NULL;
+  g_autoptr(GBytes)     stdout_bytes = NULL;
+  g_autoptr(GError)     error = NULL;
+
+  devices = g_ptr_array_new_with_free_func (g_object_unref);
+
+  if (!g_subprocess_communicate_finish (subprocess, res, &stdout_bytes, NULL, &error))
+    {
+      /* Interrupted by the deadline or by the caller */
+      g_subprocess_force_exit (subprocess);
+    }
+  else if (g_subprocess_get_successful (subprocess) && stdout_bytes != NULL)
+    {
+      g_autofree gchar *stdout_string = NULL;
+      gsize             size;
+      gconstpointer     stdout_data;
+
+      stdout_data = g_bytes_get_data (stdout_bytes, &size);
+      stdout_string = g_strndup (stdout_data, size);
+
+      add_snmp_device (devices, stdout_string);
     }
 
   g_task_return_pointer (task, g_ptr_array_ref (devices), (GDestroyNotify) g_ptr_array_unref);
@@ -317,10 +410,34 @@ pp_host_get_snmp_devices_async (PpHost              *self,
                                 GAsyncReadyCallback  callback,
                                 gpointer             user_data)
 {
-  g_autoptr(GTask) task = NULL;
+  PpHostPrivate          *priv = pp_host_get_instance_private (self);
+  ProbeDeadline          *deadline;
+  g_autoptr(GSubprocess)  subprocess = NULL;
+  g_autoptr(GTask)        task = NULL;
+  const gchar            *argv[] = { "/usr/lib/cups/backend/snmp", priv->hostname, NULL };
 
   task = g_task_new (self, cancellable, callback, user_data);
-  g_task_run_in_thread (task, _pp_host_get_snmp_devices_thread);
+
+  /* Use SNMP to get printer's informations */
+  subprocess = g_subprocess_newv (argv,
+                                  G_SUBPROCESS_FLAGS_STDOUT_PIPE |
+                                  G_SUBPROCESS_FLAGS_STDERR_SILENCE,
+                                  NULL);
+  if (subprocess == NULL)
+    {
+      GPtrArray *devices = g_ptr_array_new_with_free_func (g_object_unref);
+      g_task_return_pointer (task, devices, (GDestroyNotify) g_ptr_array_unref);
+      return;
+    }
+
+  deadline = probe_deadline_new (self, cancellable);
+  g_task_set_task_data (task, deadline, (GDestroyNotify) probe_deadline_free);
+
+  g_subprocess_communicate_async (subprocess,
+                                  NULL,
+                                  deadline->cancellable,
+                                  snmp_communicate_cb,
+                                  g_steal_pointer (&task));
 }
 
 GPtrArray *
@@ -425,8 +542,9 @@ pp_host_get_remote_cups_devices_finish (PpHost        *self,
 
 typedef struct
 {
-  PpHost *host;
-  gint    port;
+  PpHost        *host;
+  ProbeDeadline *deadline;
+  gint           port;
 } JetDirectData;
 
 static void
@@ -435,6 +553,7 @@ jetdirect_data_free (JetDirectData *data)
   if (data != NULL)
     {
       g_clear_object (&data->host);
+      g_clear_pointer (&data->deadline, probe_deadline_free);
       g_free (data);
     }
 }
@@ -502,6 +621,7 @@ pp_host_get_jetdirect_devices_async (PpHost              *self,
 
   data = g_new0 (JetDirectData, 1);
   data->host = g_object_ref (self);
+  data->deadline = probe_deadline_new (self, cancellable);
 
   if (priv->port == PP_HOST_UNSET_PORT)
     data->port = PP_HOST_DEFAULT_JETDIRECT_PORT;
@@ -521,7 +641,7 @@ pp_host_get_jetdirect_devices_async (PpHost              *self,
       g_socket_client_connect_to_host_async (client,
                                              address,
                                              data->port,
-                                             cancellable,
+                                             data->deadline->cancellable,
                                              jetdirect_connection_test_cb,
                                              g_steal_pointer (&task));
     }
@@ -542,186 +662,351 @@ pp_host_get_jetdirect_devices_finish (PpHost        *self,
   return g_task_propagate_pointer (G_TASK (res), error);
 }
 
-static gboolean
-test_lpd_queue (GSocketClient *client,
-                gchar         *address,
-                gint           port,
-                GCancellable  *cancellable,
-                gchar         *queue_name)
+/*
+ * The LPD protocol has no way to list the queues of a server, so the
+ * usual queue names are tried one after another. Each attempt needs its
+ * own connection, so up to MAX_LPD_PROBES of them run at the same time.
+ * The first probe runs alone until the host accepts a connection, so
+ * that a refused connection means the host can't be reached, rather
+ * than that it refuses parallel connections.
+ * Candidates are ordered by preference: once a queue is accepted, only
+ * the probes for the more preferred candidates still running are waited
+ * for, and the rest are cancelled.
+ */
+#define MAX_LPD_PROBES 8
+#define MAX_LPD_ATTEMPTS 3
+
+static const gchar lpd_abort_command[] = "\1\n";
+
+typedef struct
 {
-  g_autoptr(GSocketConnection) connection = NULL;
-  gboolean                     result = FALSE;
-  g_autoptr(GError)            error = NULL;
+  PpHost        *host;
+  ProbeDeadline *deadline;
+  GSocketClient *client;
+  gchar         *address;
+  gint           port;
 
-  connection = g_socket_client_connect_to_host (client,
-                                                address,
-                                                port,
-                                                cancellable,
-                                                &error);
+  GPtrArray     *candidates;
+  guint8        *attempts;
+  gboolean      *probed;
+  GQueue         pending;    /* indexes of the candidates left to probe */
+  guint          n_running;
+  guint          max_running;
+  guint          found;      /* index of the best queue found so far */
+  gboolean       connected;  /* the host accepted a connection at least once */
+  gboolean       unreachable;
+  gboolean       returned;
+} LpdData;
 
-  if (connection != NULL)
+typedef struct
+{
+  GTask             *task;
+  guint              index;
+  GSocketConnection *connection;
+  gchar              buffer[BUFFER_LENGTH];
+} LpdProbe;
+
+static void lpd_probe_next (GTask *task);
+
+static void
+lpd_data_free (LpdData *data)
+{
+  if (data != NULL)
     {
-      if (G_IS_TCP_CONNECTION (connection))
-        {
-          GOutputStream *output;
-          GInputStream  *input;
-          gssize         bytes_read, bytes_written;
-          gchar          buffer[BUFFER_LENGTH];
-          gint           length;
+      g_clear_object (&data->host);
+      g_clear_pointer (&data->deadline, probe_deadline_free);
+      g_clear_object (&data->client);
+      g_clear_pointer (&data->address, g_free);
+      g_clear_pointer (&data->candidates, g_ptr_array_unref);
+      g_clear_pointer (&data->attempts, g_free);
+      g_clear_pointer (&data->probed, g_free);
+      g_queue_clear (&data->pending);
+      g_free (data);
+    }
+}
 
-          output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
-          input = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+static GPtrArray *
+lpd_candidates_new (void)
+{
+  GPtrArray *candidates;
+  gint       i;
+
+  candidates = g_ptr_array_new_with_free_func (g_free);
+
+  /* Most of this list is taken from system-config-printer */
+  g_ptr_array_add (candidates, g_strdup ("PASSTHRU"));
+  g_ptr_array_add (candidates, g_strdup ("AUTO"));
+  g_ptr_array_add (candidates, g_strdup ("BINPS"));
+  g_ptr_array_add (candidates, g_strdup ("RAW"));
+  g_ptr_array_add (candidates, g_strdup ("TEXT"));
+  g_ptr_array_add (candidates, g_strdup ("ps"));
+  g_ptr_array_add (candidates, g_strdup ("lp"));
+  g_ptr_array_add (candidates, g_strdup ("PORT1"));
+
+  for (i = 0; i < 8; i++)
+    {
+      g_ptr_array_add (candidates, g_strdup_printf ("LPT%d", i));
+      g_ptr_array_add (candidates, g_strdup_printf ("LPT%d_PASSTHRU", i));
+      g_ptr_array_add (candidates, g_strdup_printf ("COM%d", i));
+      g_ptr_array_add (candidates, g_strdup_printf ("COM%d_PASSTHRU", i));
+    }
 
-          /* This LPD command is explained in RFC 1179, section 5.2 */
-          length = g_snprintf (buffer, BUFFER_LENGTH, "\2%s\n", queue_name);
+  for (i = 0; i < 50; i++)
+    g_ptr_array_add (candidates, g_strdup_printf ("pr%d", i));
 
-          bytes_written = g_output_stream_write (output,
-                                                 buffer,
-                                                 length,
-                                                 NULL,
-                                                 &error);
+  return candidates;
+}
 
-          if (bytes_written != -1)
-            {
-              bytes_read = g_input_stream_read (input,
-                                                buffer,
-                                                BUFFER_LENGTH,
-                                                NULL,
-                                                &error);
+static void
+lpd_return_devices (GTask *task)
+{
+  LpdData              *data = g_task_get_task_data (task);
+  PpHostPrivate        *priv = pp_host_get_instance_private (data->host);
+  g_autoptr(GPtrArray)  devices = NULL;
 
-              if (bytes_read != -1)
-                {
-                  if (bytes_read > 0 && buffer[0] == 0)
-                    {
-                      /* This LPD command is explained in RFC 1179, section 6.1 */
-                      length = g_snprintf (buffer, BUFFER_LENGTH, "\1\n");
-
-                      bytes_written = g_output_stream_write (output,
-                                                             buffer,
-                                                             length,
-                                                             NULL,
-                                                             &error);
-
-                      result = TRUE;
-                    }
-                }
-            }
-        }
+  data->returned = TRUE;
 
-      g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+  /* Stop the probes which can't find anything better */
+  g_cancellable_cancel (data->deadline->cancellable);
+
+  devices = g_ptr_array_new_with_free_func (g_object_unref);
+
+  if (data->found < data->candidates->len)
+    {
+      g_autofree gchar *device_uri = NULL;
+      PpPrintDevice *device;
+
+      device_uri = g_strdup_printf ("lpd://%s:%d/%s",
+                                    priv->hostname,
+                                    data->port,
+                                    (gchar *) g_ptr_array_index (data->candidates, data->found));
+
+      device = g_object_new (PP_TYPE_PRINT_DEVICE,
+                             "is-network-device", TRUE,
+                             "device-uri", device_uri,
+                             /* Translators: The found device is a Line Printer Daemon printer */
+                             "device-name", _("LPD Printer"),
+                             "host-name", priv->hostname,
+                             "host-port", data->port,
+                             "acquisition-method", ACQUISITION_METHOD_LPD,
+                             NULL);
+      g_ptr_array_add (devices, device);
     }
 
-  return result;
+  g_task_return_pointer (task, g_steal_pointer (&devices), (GDestroyNotify) g_ptr_array_unref);
 }
 
 static void
-_pp_host_get_lpd_devices_thread (GTask        *task,
-                                 gpointer      source_object,
-                                 gpointer      task_data,
-                                 GCancellable *cancellable)
+lpd_probe_finish (LpdProbe *probe,
+                  gboolean  accepted)
 {
-  g_autoptr(GSocketConnection) connection = NULL;
-  PpHost                      *self = source_object;
-  PpHostPrivate               *priv = pp_host_get_instance_private (self);
-  g_autoptr(GPtrArray)         devices = NULL;
-  g_autoptr(GSocketClient)     client = NULL;
-  g_autoptr(GError)            error = NULL;
-  GList                       *candidates = NULL;
-  GList                       *iter;
-  gchar                       *found_queue = NULL;
-  gchar                       *candidate;
-  g_autofree gchar            *address = NULL;
-  gint                         port;
-  gint                         i;
+  g_autoptr(GTask) task = probe->task;
+  LpdData *data = g_task_get_task_data (task);
 
-  if (priv->port == PP_HOST_UNSET_PORT)
-    port = PP_HOST_DEFAULT_LPD_PORT;
-  else
-    port = priv->port;
+  data->n_running--;
+  data->probed[probe->index] = TRUE;
 
-  devices = g_ptr_array_new_with_free_func (g_object_unref);
+  if (accepted && probe->index < data->found)
+    data->found = probe->index;
 
-  address = g_strdup_printf ("%s:%d", priv->hostname, port);
-  if (address == NULL || address[0] == '/')
+  if (probe->connection != NULL)
     {
-      g_task_return_pointer (task, g_ptr_array_ref (devices), (GDestroyNotify) g_ptr_array_unref);
+      g_io_stream_close (G_IO_STREAM (probe->connection), NULL, NULL);
+      g_object_unref (probe->connection);
+    }
+  g_free (probe);
+
+  lpd_probe_next (task);
+}
+
+static void
+lpd_abort_cb (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+  g_output_stream_write_all_finish (G_OUTPUT_STREAM (source_object), res, NULL, NULL);
+  lpd_probe_finish (user_data, TRUE);
+}
+
+static void
+lpd_read_cb (GObject      *source_object,
+             GAsyncResult *res,
+             gpointer      user_data)
+{
+  LpdProbe *probe = user_data;
+  gssize    bytes_read;
+
+  bytes_read = g_input_stream_read_finish (G_INPUT_STREAM (source_object), res, NULL);
+
+  if (bytes_read > 0 && probe->buffer[0] == 0)
+    {
+      GOutputStream *output = g_io_stream_get_output_stream (G_IO_STREAM (probe->connection));
+
+      /* This LPD command is explained in RFC 1179, section 6.1 */
+      g_output_stream_write_all_async (output,
+                                       lpd_abort_command,
+                                       strlen (lpd_abort_command),
+                                       G_PRIORITY_DEFAULT,
+                                       NULL,
+                                       lpd_abort_cb,
+                                       probe);
       return;
     }
 
-  client = g_socket_client_new ();
+  lpd_probe_finish (probe, FALSE);
+}
 
-  connection = g_socket_client_connect_to_host (client,
-                                                address,
-                                                port,
-                                                cancellable,
-                                                &error);
+static void
+lpd_write_cb (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+  LpdProbe     *probe = user_data;
+  LpdData      *data = g_task_get_task_data (probe->task);
+  GInputStream *input;
 
-  if (connection != NULL)
+  if (!g_output_stream_write_all_finish (G_OUTPUT_STREAM (source_object), res, NULL, NULL))
     {
-      g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+      lpd_probe_finish (probe, FALSE);
+      return;
+    }
 
-      /* Most of this list is taken from system-config-printer */
-      candidates = g_list_append (candidates, g_strdup ("PASSTHRU"));
-      candidates = g_list_append (candidates, g_strdup ("AUTO"));
-      candidates = g_list_append (candidates, g_strdup ("BINPS"));
-      candidates = g_list_append (candidates, g_strdup ("RAW"));
-      candidates = g_list_append (candidates, g_strdup ("TEXT"));
-      candidates = g_list_append (candidates, g_strdup ("ps"));
-      candidates = g_list_append (candidates, g_strdup ("lp"));
-      candidates = g_list_append (candidates, g_strdup ("PORT1"));
-
-      for (i = 0; i < 8; i++)
-        {
-          candidates = g_list_append (candidates, g_strdup_printf ("LPT%d", i));
-          candidates = g_list_append (candidates, g_strdup_printf ("LPT%d_PASSTHRU", i));
-          candidates = g_list_append (candidates, g_strdup_printf ("COM%d", i));
-          candidates = g_list_append (candidates, g_strdup_printf ("COM%d_PASSTHRU", i));
-        }
+  input = g_io_stream_get_input_stream (G_IO_STREAM (probe->connection));
+  g_input_stream_read_async (input,
+                             probe->buffer,
+                             BUFFER_LENGTH,
+                             G_PRIORITY_DEFAULT,
+                             data->deadline->cancellable,
+                             lpd_read_cb,
+                             probe);
+}
 
-      for (i = 0; i < 50; i++)
-        candidates = g_list_append (candidates, g_strdup_printf ("pr%d", i));
+static void
+lpd_connect_cb (GObject      *source_object,
+                GAsyncResult *res,
+                gpointer      user_data)
+{
+  LpdProbe          *probe = user_data;
+  LpdData           *data = g_task_get_task_data (probe->task);
+  g_autoptr(GError)  error = NULL;
+  GOutputStream     *output;
+  gint               length;
 
-      for (iter = candidates; iter != NULL; iter = iter->next)
-        {
-          candidate = (gchar *) iter->data;
+  probe->connection = g_socket_client_connect_to_host_finish (G_SOCKET_CLIENT (source_object),
+                                                              res,
+                                                              &error);
 
-          if (test_lpd_queue (client,
-                              address,
-                              port,
-                              cancellable,
-                              candidate))
+  if (probe->connection == NULL)
+    {
+      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+          if (!data->connected)
+            {
+              data->unreachable = TRUE;
+            }
+          else if (++data->attempts[probe->index] < MAX_LPD_ATTEMPTS)
             {
-              found_queue = g_strdup (candidate);
-              break;
+              /* The server accepts fewer parallel connections than we
+               * tried, so retry with fewer of them. */
+              g_autoptr(GTask) task = probe->task;
+
+              data->max_running = MAX (1, data->max_running / 2);
+              g_queue_push_head (&data->pending, GUINT_TO_POINTER (probe->index));
+              data->n_running--;
+              g_free (probe);
+
+              lpd_probe_next (task);
+              return;
             }
         }
 
-      if (found_queue != NULL)
+      lpd_probe_finish (probe, FALSE);
+      return;
+    }
+
+  if (!data->connected)
+    {
+      data->connected = TRUE;
+      data->max_running = MAX_LPD_PROBES;
+      lpd_probe_next (probe->task);
+    }
+
+  if (!G_IS_TCP_CONNECTION (probe->connection))
+    {
+      lpd_probe_finish (probe, FALSE);
+      return;
+    }
+
+  output = g_io_stream_get_output_stream (G_IO_STREAM (probe->connection));
+
+  /* This LPD command is explained in RFC 1179, section 5.2 */
+  length = g_snprintf (probe->buffer, BUFFER_LENGTH, "\2%s\n",
+                       (gchar *) g_ptr_array_index (data->candidates, probe->index));
+
+  g_output_stream_write_all_async (output,
+                                   probe->buffer,
+                                   MIN (length, BUFFER_LENGTH - 1),
+                                   G_PRIORITY_DEFAULT,
+                                   data->deadline->cancellable,
+                                   lpd_write_cb,
+                                   probe);
+}
+
+static gboolean
+lpd_search_done (LpdData *data)
+{
+  guint i;
+
+  if (data->unreachable || g_cancellable_is_cancelled (data->deadline->cancellable))
+    return TRUE;
+
+  /* Done once no more preferred candidate can still be accepted */
+  for (i = 0; i < data->found && i < data->candidates->len; i++)
+    if (!data->probed[i])
+      return FALSE;
+
+  return TRUE;
+}
+
+static void
+lpd_probe_next (GTask *task)
+{
+  LpdData *data = g_task_get_task_data (task);
+
+  if (data->returned)
+    return;
+
+  if (lpd_search_done (data))
+    {
+      lpd_return_devices (task);
+      return;
+    }
+
+  while (data->n_running < data->max_running && !g_queue_is_empty (&data->pending))
+    {
+      guint     index = GPOINTER_TO_UINT (g_queue_pop_head (&data->pending));
+      LpdProbe *probe;
+
+      /* A better queue has been found already */
+      if (index >= data->found)
         {
-          g_autofree gchar *device_uri = NULL;
-          PpPrintDevice *device;
-
-          device_uri = g_strdup_printf ("lpd://%s:%d/%s",
-                                        priv->hostname,
-                                        port,
-                                        found_queue);
-
-          device = g_object_new (PP_TYPE_PRINT_DEVICE,
-                                 "is-network-device", TRUE,
-                                 "device-uri", device_uri,
-                                 /* Translators: The found device is a Line Printer Daemon printer */
-                                 "device-name", _("LPD Printer"),
-                                 "host-name", priv->hostname,
-                                 "host-port", port,
-                                 "acquisition-method", ACQUISITION_METHOD_LPD,
-                                 NULL);
-          g_ptr_array_add (devices, device);
+          data->probed[index] = TRUE;
+          continue;
         }
 
-      g_list_free_full (candidates, g_free);
-    }
+      probe = g_new0 (LpdProbe, 1);
+      probe->task = g_object_ref (task);
+      probe->index = index;
 
-  g_task_return_pointer (task, g_ptr_array_ref (devices), (GDestroyNotify) g_ptr_array_unref);
+      data->n_running++;
+
+      g_socket_client_connect_to_host_async (data->client,
+                                             data->address,
+                                             data->port,
+                                             data->deadline->cancellable,
+                                             lpd_connect_cb,
+                                             probe);
+    }
 }
 
 void
@@ -730,10 +1015,43 @@ pp_host_get_lpd_devices_async (PpHost              *self,
                                GAsyncReadyCallback  callback,
                                gpointer             user_data)
 {
-  g_autoptr(GTask) task = NULL;
+  PpHostPrivate    *priv = pp_host_get_instance_private (self);
+  g_autoptr(GTask)  task = NULL;
+  LpdData          *data;
+  guint             i;
 
   task = g_task_new (G_OBJECT (self), cancellable, callback, user_data);
-  g_task_run_in_thread (task, _pp_host_get_lpd_devices_thread);
+
+  data = g_new0 (LpdData, 1);
+  data->host = g_object_ref (self);
+  g_queue_init (&data->pending);
+  g_task_set_task_data (task, data, (GDestroyNotify) lpd_data_free);
+
+  if (priv->port == PP_HOST_UNSET_PORT)
+    data->port = PP_HOST_DEFAULT_LPD_PORT;
+  else
+    data->port = priv->port;
+
+  data->address = g_strdup_printf ("%s:%d", priv->hostname, data->port);
+  if (data->address == NULL || data->address[0] == '/')
+    {
+      GPtrArray *devices = g_ptr_array_new_with_free_func (g_object_unref);
+      g_task_return_pointer (task, devices, (GDestroyNotify) g_ptr_array_unref);
+      return;
+    }
+
+  data->deadline = probe_deadline_new (self, cancellable);
+  data->client = g_socket_client_new ();
+  data->candidates = lpd_candidates_new ();
+  data->attempts = g_new0 (guint8, data->candidates->len);
+  data->probed = g_new0 (gboolean, data->candidates->len);
+  data->found = G_MAXUINT;
+  data->max_running = 1;
+
+  for (i = 0; i < data->candidates->len; i++)
+    g_queue_push_tail (&data->pending, GUINT_TO_POINTER (i));
+
+  lpd_probe_next (task);
 }
 
 GPtrArray *
@@ -51,6 +51,9 @@
  */
 #define HOST_SEARCH_DELAY (500 - 150)
 
+/* Probes of a remote host which don't answer by then are given up */
+#define HOST_PROBE_TIMEOUT (10 * G_TIME_SPAN_SECOND)
+
 #define AUTHENTICATION_PAGE "authentication-page"
 #define ADDPRINTER_PAGE "addprinter-page"
 
@@ -1115,6 +1118,7 @@ static gboolean
 search_for_remote_printers (THostSearchData *data)
 {
   PpNewPrinterDialog *self = data->dialog;
+  gint64              deadline;
 
   g_cancellable_cancel (self->remote_host_cancellable);
   g_clear_object (&self->remote_host_cancellable);
@@ -1126,6 +1130,14 @@ search_for_remote_printers (THostSearchData *data)
   self->socket_host = pp_host_new (data->host_name);
   self->lpd_host = pp_host_new (data->host_name);
 
+  /* The probes run in parallel and share one deadline, so that each of
+   * them reports its devices as soon as it has them but none of them
+   * keeps the search going for long. */
+  deadline = g_get_monotonic_time () + HOST_PROBE_TIMEOUT;
+  g_object_set (self->snmp_host, "deadline", deadline, NULL);
+  g_object_set (self->socket_host, "deadline", deadline, NULL);
+  g_object_set (self->lpd_host, "deadline", deadline, NULL);
+
   if (data->host_port != PP_HOST_UNSET_PORT)
     {
       g_object_set (self->remote_cups_host, "port", data->host_port, NULL);
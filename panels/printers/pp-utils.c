@@ -23,10 +23,12 @@
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
 #include <gtk/gtk.h>
+#include <dirent.h>
 #include <cups/cups.h>
 #include <cups/ppd.h>
 
 #include "pp-utils.h"
+#include "cc-util.h"
 
 #define DBUS_TIMEOUT      120000
 #define DBUS_TIMEOUT_LONG 600000
@@ -1801,6 +1803,7 @@ G_DEFINE_AUTOPTR_CLEANUP_FUNC (GDAData, gda_data_free)
 typedef struct
 {
   gchar         *printer_name;
+  gchar         *device_id;
   gint           count;
   PPDName      **result;
   GCancellable  *cancellable;
@@ -1828,6 +1831,7 @@ static void
 gpn_data_free (GPNData *data)
 {
   g_free (data->printer_name);
+  g_free (data->device_id);
   if (data->result != NULL)
     {
       for (int i = 0; data->result[i]; i++)
@@ -1863,7 +1867,10 @@ get_ppd_names_async_cb (gchar    **attribute_values,
   if (attribute_values)
     {
       for (i = 0; attribute_values[i]; i++)
-        data->result[i]->ppd_display_name = g_strdup (attribute_values[i]);
+        {
+          g_free (data->result[i]->ppd_display_name);
+          data->result[i]->ppd_display_name = g_strdup (attribute_values[i]);
+        }
     }
 
   data->callback (data->result,
@@ -1937,10 +1944,24 @@ get_ppd_names_async_dbus_scb (GObject      *source_object,
             }
         }
     }
-  else
+  else if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
     {
-      if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
-        g_warning ("%s", error->message);
+      g_auto(GStrv) cached_ppds = NULL;
+
+      g_warning ("%s", error->message);
+
+      /* Fall back to the PPDs whose device ID matches exactly */
+      cached_ppds = ppd_cache_get_ppds_for_device_id (data->device_id);
+      for (i = 0; cached_ppds != NULL && cached_ppds[i] != NULL && n < data->count; i++)
+        {
+          ppd_item = g_new0 (PPDName, 1);
+          ppd_item->ppd_name = g_strdup (cached_ppds[i]);
+          ppd_item->ppd_match_level = PPD_EXACT_MATCH;
+
+          driver_list = g_list_append (driver_list, ppd_item);
+
+          n++;
+        }
     }
 
   if (n > 0)
@@ -1954,12 +1975,38 @@ get_ppd_names_async_dbus_scb (GObject      *source_object,
         }
     }
 
+  g_list_free (driver_list);
+
   if (result)
     {
       g_auto(GStrv) ppds_names = NULL;
+      gboolean      all_cached = TRUE;
 
       data->result = result;
 
+      /* Display names of installed PPDs are in the cache already */
+      for (i = 0; i < n; i++)
+        {
+          result[i]->ppd_display_name = ppd_cache_get_display_name (result[i]->ppd_name);
+          all_cached = all_cached && result[i]->ppd_display_name != NULL;
+        }
+
+      if (all_cached)
+        {
+          /* Nothing else would notice the cancellation on this path */
+          if (g_cancellable_is_cancelled (data->cancellable))
+            data->callback (NULL,
+                            data->printer_name,
+                            TRUE,
+                            data->user_data);
+          else
+            data->callback (data->result,
+                            data->printer_name,
+                            FALSE,
+                            data->user_data);
+          return;
+        }
+
       ppds_names = g_new0 (gchar *, n + 1);
       for (i = 0; i < n; i++)
         ppds_names[i] = g_strdup (result[i]->ppd_name);
@@ -2007,6 +2054,8 @@ get_device_attributes_cb (gchar    *device_id,
       return;
     }
 
+  data->device_id = g_strdup (device_id);
+
   bus = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, &error);
   if (!bus)
     {
@@ -2492,20 +2541,468 @@ static const struct {
   { "zebra", "Zebra" },
 };
 
+/*
+ * On-disk cache of the list of installed PPDs, so that the CUPS_GET_PPDS
+ * request which makes cupsd read every driver doesn't need to be repeated
+ * each time the panel is opened. Next to the list of manufacturers and
+ * their PPDs, the cache holds two indexes sorted for binary search:
+ * display names by PPD name, and PPD names by normalized
+ * "manufacturer;model" pairs as found in IEEE 1284 device IDs.
+ * The cache is dropped when cupsd, its PPD database or any directory
+ * of the driver trees changes. The stamps are only checked when the
+ * cache is loaded, lookups reuse the cache validated last.
+ */
+
+#define PPD_CACHE_VERSION 2
+#define PPD_CACHE_MAX_DEPTH 16
+#define PPD_CACHE_TYPE "(usa(sx)a(ssa(ss))a(ss)a(sas))"
+
+enum
+{
+  PPD_CACHE_VERSION_FIELD = 0,
+  PPD_CACHE_SERVER_FIELD,
+  PPD_CACHE_STAMPS_FIELD,
+  PPD_CACHE_MANUFACTURERS_FIELD,
+  PPD_CACHE_NAMES_FIELD,
+  PPD_CACHE_DEVICE_IDS_FIELD
+};
+
+static const gchar * const ppd_cache_stamp_paths[] = {
+  "/usr/sbin/cupsd",
+  "/var/cache/cups/ppds.dat",
+  "/usr/lib/cups/driver",
+  "/usr/libexec/cups/driver",
+  "/usr/share/cups/drv",
+  "/usr/share/cups/model",
+  "/usr/share/ppd",
+  "/usr/local/share/ppd",
+  "/opt/share/ppd",
+};
+
+G_LOCK_DEFINE_STATIC (ppd_cache);
+static GVariant *ppd_cache = NULL;
+static gboolean  ppd_cache_loaded = FALSE;
+
+static gboolean
+ppd_cache_enabled (void)
+{
+  const gchar *server = cupsServer ();
+
+  /* The stamps only say something about a local cupsd */
+  return server == NULL ||
+         server[0] == '/' ||
+         g_ascii_strncasecmp (server, "localhost", 9) == 0 ||
+         g_ascii_strncasecmp (server, "127.0.0.1", 9) == 0 ||
+         g_ascii_strncasecmp (server, "::1", 3) == 0;
+}
+
+static gchar *
+get_ppd_cache_filename (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gnome-control-center", "ppds.cache", NULL);
+}
+
+/*
+ * Returns the newest modification time of @path and of the directories
+ * below it. Adding or removing a PPD only touches the directory it is in,
+ * which can be anywhere in a driver tree. Regular files aren't stat()ed.
+ */
+static gint64
+get_tree_mtime (const gchar *path,
+                gint         depth)
+{
+  struct dirent *entry;
+  GStatBuf       buf;
+  DIR           *dir;
+  gint64         mtime;
+
+  if (g_stat (path, &buf) != 0)
+    return -1;
+
+  mtime = buf.st_mtime;
+
+  if (!S_ISDIR (buf.st_mode) || depth >= PPD_CACHE_MAX_DEPTH)
+    return mtime;
+
+  dir = opendir (path);
+  if (dir == NULL)
+    return mtime;
+
+  while ((entry = readdir (dir)) != NULL)
+    {
+      g_autofree gchar *child = NULL;
+
+      if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      if (entry->d_type != DT_DIR && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN)
+        continue;
+
+      child = g_build_filename (path, entry->d_name, NULL);
+      mtime = MAX (mtime, get_tree_mtime (child, depth + 1));
+    }
+
+  closedir (dir);
+
+  return mtime;
+}
+
+static GVariant *
+get_ppd_cache_stamps (void)
+{
+  GVariantBuilder builder;
+  gint            i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sx)"));
+  for (i = 0; i < G_N_ELEMENTS (ppd_cache_stamp_paths); i++)
+    {
+      g_variant_builder_add (&builder, "(sx)",
+                             ppd_cache_stamp_paths[i],
+                             get_tree_mtime (ppd_cache_stamp_paths[i], 0));
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+static gboolean
+ppd_cache_is_valid (GVariant *cache)
+{
+  g_autoptr(GVariant) stamps = NULL;
+  g_autoptr(GVariant) current_stamps = NULL;
+  const gchar        *server;
+  guint32             version;
+
+  g_variant_get_child (cache, PPD_CACHE_VERSION_FIELD, "u", &version);
+  if (version != PPD_CACHE_VERSION)
+    return FALSE;
+
+  g_variant_get_child (cache, PPD_CACHE_SERVER_FIELD, "&s", &server);
+  if (g_strcmp0 (server, cupsServer ()) != 0)
+    return FALSE;
+
+  stamps = g_variant_get_child_value (cache, PPD_CACHE_STAMPS_FIELD);
+  current_stamps = g_variant_ref_sink (get_ppd_cache_stamps ());
+
+  return g_variant_equal (stamps, current_stamps);
+}
+
+/*
+ * Returns a new reference to the cache if it is up to date. The stamps
+ * are only checked when @reload is %TRUE or the cache wasn't loaded
+ * yet, otherwise the result of the last check is reused.
+ */
+static GVariant *
+get_ppd_cache (gboolean reload)
+{
+  GVariant *result = NULL;
+
+  if (!ppd_cache_enabled ())
+    return NULL;
+
+  G_LOCK (ppd_cache);
+
+  if (reload || !ppd_cache_loaded)
+    {
+      g_autofree gchar *filename = get_ppd_cache_filename ();
+      g_autoptr(GMappedFile) mapped_file = NULL;
+
+      g_clear_pointer (&ppd_cache, g_variant_unref);
+      ppd_cache_loaded = TRUE;
+
+      mapped_file = g_mapped_file_new (filename, FALSE, NULL);
+      if (mapped_file != NULL)
+        {
+          g_autoptr(GBytes) bytes = g_mapped_file_get_bytes (mapped_file);
+          g_autoptr(GVariant) cache = NULL;
+
+          cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (PPD_CACHE_TYPE), bytes, FALSE));
+          if (ppd_cache_is_valid (cache))
+            ppd_cache = g_steal_pointer (&cache);
+        }
+    }
+
+  if (ppd_cache != NULL)
+    result = g_variant_ref (ppd_cache);
+
+  G_UNLOCK (ppd_cache);
+
+  return result;
+}
+
+/* Binary search in an array of tuples sorted by their first string */
+static GVariant *
+ppd_cache_index_lookup (GVariant    *cache,
+                        gint         field,
+                        const gchar *key)
+{
+  g_autoptr(GVariant) index = g_variant_get_child_value (cache, field);
+  gsize               low = 0;
+  gsize               high = g_variant_n_children (index);
+
+  while (low < high)
+    {
+      g_autoptr(GVariant) child = NULL;
+      const gchar        *child_key;
+      gsize               mid = low + (high - low) / 2;
+      gint                cmp;
+
+      child = g_variant_get_child_value (index, mid);
+      g_variant_get_child (child, 0, "&s", &child_key);
+
+      cmp = strcmp (key, child_key);
+      if (cmp == 0)
+        return g_steal_pointer (&child);
+      else if (cmp < 0)
+        high = mid;
+      else
+        low = mid + 1;
+    }
+
+  return NULL;
+}
+
+static gchar *
+get_device_id_key (const gchar *device_id)
+{
+  g_autofree gchar *mfg = NULL;
+  g_autofree gchar *mdl = NULL;
+  g_autofree gchar *mfg_normalized = NULL;
+  g_autofree gchar *mdl_normalized = NULL;
+
+  if (device_id == NULL || device_id[0] == '\0')
+    return NULL;
+
+  mfg = get_tag_value (device_id, "mfg");
+  if (!mfg)
+    mfg = get_tag_value (device_id, "manufacturer");
+
+  mdl = get_tag_value (device_id, "mdl");
+  if (!mdl)
+    mdl = get_tag_value (device_id, "model");
+
+  if (!mfg || !mdl)
+    return NULL;
+
+  mfg_normalized = normalize (mfg);
+  mdl_normalized = normalize (mdl);
+
+  return g_strdup_printf ("%s;%s", mfg_normalized, mdl_normalized);
+}
+
+/*
+ * Returns the display name of the given PPD if it is in the cache.
+ */
+gchar *
+ppd_cache_get_display_name (const gchar *ppd_name)
+{
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GVariant) entry = NULL;
+  gchar              *display_name = NULL;
+
+  if (ppd_name == NULL || (cache = get_ppd_cache (FALSE)) == NULL)
+    return NULL;
+
+  entry = ppd_cache_index_lookup (cache, PPD_CACHE_NAMES_FIELD, ppd_name);
+  if (entry != NULL)
+    g_variant_get_child (entry, 1, "s", &display_name);
+
+  return display_name;
+}
+
+/*
+ * Returns names of the cached PPDs whose IEEE 1284 device ID has
+ * the same manufacturer and model as the given one.
+ */
+gchar **
+ppd_cache_get_ppds_for_device_id (const gchar *device_id)
+{
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GVariant) entry = NULL;
+  g_autofree gchar   *key = NULL;
+  gchar             **ppd_names = NULL;
+
+  key = get_device_id_key (device_id);
+  if (key == NULL || (cache = get_ppd_cache (FALSE)) == NULL)
+    return NULL;
+
+  entry = ppd_cache_index_lookup (cache, PPD_CACHE_DEVICE_IDS_FIELD, key);
+  if (entry != NULL)
+    g_variant_get_child (entry, 1, "^as", &ppd_names);
+
+  return ppd_names;
+}
+
+static PPDList *
+ppd_list_new_from_cache (GVariant *cache)
+{
+  g_autoptr(GVariant) manufacturers = NULL;
+  PPDList            *list;
+  gsize               i, j;
+
+  manufacturers = g_variant_get_child_value (cache, PPD_CACHE_MANUFACTURERS_FIELD);
+
+  list = g_new0 (PPDList, 1);
+  list->num_of_manufacturers = g_variant_n_children (manufacturers);
+  list->manufacturers = g_new0 (PPDManufacturerItem *, list->num_of_manufacturers);
+
+  for (i = 0; i < list->num_of_manufacturers; i++)
+    {
+      g_autoptr(GVariant) ppds = NULL;
+      PPDManufacturerItem *item;
+
+      item = g_new0 (PPDManufacturerItem, 1);
+      g_variant_get_child (manufacturers, i, "(ss@a(ss))",
+                           &item->manufacturer_name,
+                           &item->manufacturer_display_name,
+                           &ppds);
+
+      item->num_of_ppds = g_variant_n_children (ppds);
+      item->ppds = g_new0 (PPDName *, item->num_of_ppds);
+
+      for (j = 0; j < item->num_of_ppds; j++)
+        {
+          item->ppds[j] = g_new0 (PPDName, 1);
+          g_variant_get_child (ppds, j, "(ss)",
+                               &item->ppds[j]->ppd_name,
+                               &item->ppds[j]->ppd_display_name);
+          item->ppds[j]->ppd_match_level = -1;
+        }
+
+      list->manufacturers[i] = item;
+    }
+
+  return list;
+}
+
+static gint
+compare_ppd_names (gconstpointer a,
+                   gconstpointer b)
+{
+  const PPDName *name_a = *(PPDName **) a;
+  const PPDName *name_b = *(PPDName **) b;
+
+  return strcmp (name_a->ppd_name, name_b->ppd_name);
+}
+
+/* @device_ids maps device ID keys to GPtrArrays of PPD names */
+static void
+save_ppd_cache (GVariant   *stamps,
+                PPDList    *list,
+                GHashTable *device_ids)
+{
+  g_autofree gchar    *filename = NULL;
+  g_autoptr(GVariant)  cache = NULL;
+  g_autoptr(GPtrArray) names = NULL;
+  g_autoptr(GList)     keys = NULL;
+  g_autoptr(GError)    error = NULL;
+  GVariantBuilder      builder;
+  GList               *l;
+  gsize                i, j;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (PPD_CACHE_TYPE));
+  g_variant_builder_add (&builder, "u", PPD_CACHE_VERSION);
+  g_variant_builder_add (&builder, "s", cupsServer ());
+  g_variant_builder_add_value (&builder, stamps);
+
+  names = g_ptr_array_new ();
+
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ssa(ss))"));
+  for (i = 0; i < list->num_of_manufacturers; i++)
+    {
+      PPDManufacturerItem *item = list->manufacturers[i];
+
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("(ssa(ss))"));
+      g_variant_builder_add (&builder, "s", item->manufacturer_name);
+      g_variant_builder_add (&builder, "s", item->manufacturer_display_name);
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ss)"));
+      for (j = 0; j < item->num_of_ppds; j++)
+        {
+          g_variant_builder_add (&builder, "(ss)", item->ppds[j]->ppd_name, item->ppds[j]->ppd_display_name);
+          g_ptr_array_add (names, item->ppds[j]);
+        }
+      g_variant_builder_close (&builder);
+      g_variant_builder_close (&builder);
+    }
+  g_variant_builder_close (&builder);
+
+  g_ptr_array_sort (names, compare_ppd_names);
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ss)"));
+  for (i = 0; i < names->len; i++)
+    {
+      PPDName *name = g_ptr_array_index (names, i);
+
+      if (i > 0 && g_strcmp0 (name->ppd_name, ((PPDName *) g_ptr_array_index (names, i - 1))->ppd_name) == 0)
+        continue;
+
+      g_variant_builder_add (&builder, "(ss)", name->ppd_name, name->ppd_display_name);
+    }
+  g_variant_builder_close (&builder);
+
+  keys = g_list_sort (g_hash_table_get_keys (device_ids), (GCompareFunc) strcmp);
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(sas)"));
+  for (l = keys; l != NULL; l = l->next)
+    {
+      GPtrArray *ppd_names = g_hash_table_lookup (device_ids, l->data);
+
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("(sas)"));
+      g_variant_builder_add (&builder, "s", l->data);
+      g_variant_builder_open (&builder, G_VARIANT_TYPE ("as"));
+      for (i = 0; i < ppd_names->len; i++)
+        g_variant_builder_add (&builder, "s", g_ptr_array_index (ppd_names, i));
+      g_variant_builder_close (&builder);
+      g_variant_builder_close (&builder);
+    }
+  g_variant_builder_close (&builder);
+
+  cache = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+  filename = get_ppd_cache_filename ();
+  if (!cc_util_write_cache_file (filename,
+                                 g_variant_get_data (cache),
+                                 g_variant_get_size (cache),
+                                 &error))
+    {
+      g_debug ("Could not save PPD cache: %s", error->message);
+      return;
+    }
+
+  G_LOCK (ppd_cache);
+  g_clear_pointer (&ppd_cache, g_variant_unref);
+  ppd_cache = g_steal_pointer (&cache);
+  ppd_cache_loaded = TRUE;
+  G_UNLOCK (ppd_cache);
+}
+
 static gpointer
 get_all_ppds_func (gpointer user_data)
 {
   ipp_attribute_t *attr;
   GHashTable      *ppds_hash = NULL;
   GHashTable      *manufacturers_hash = NULL;
+  GHashTable      *device_ids = NULL;
   GAPData         *data = user_data;
   PPDName         *item;
   ipp_t           *request;
   ipp_t           *response;
   GList           *list;
   gchar           *manufacturer_display_name;
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GVariant) stamps = NULL;
   gint             i, j;
 
+  cache = get_ppd_cache (TRUE);
+  if (cache != NULL)
+    {
+      data->result = ppd_list_new_from_cache (cache);
+      get_all_ppds_cb (data);
+
+      return NULL;
+    }
+
+  /* Taken before the request, so that drivers installed meanwhile
+   * invalidate the cache */
+  stamps = g_variant_ref_sink (get_ppd_cache_stamps ());
+
   request = ippNewRequest (CUPS_GET_PPDS);
   response = cupsDoRequest (CUPS_HTTP_DEFAULT, request, "/");
 
@@ -2526,6 +3023,9 @@ get_all_ppds_func (gpointer user_data)
        */
       manufacturers_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
+      /* Device ID keys -> PPD names, for the cache */
+      device_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_ptr_array_unref);
+
       for (i = 0; i < G_N_ELEMENTS (manufacturers_names); i++)
         {
           g_hash_table_insert (manufacturers_hash,
@@ -2641,6 +3141,23 @@ get_all_ppds_func (gpointer user_data)
                   list = g_list_append (list, item);
                   g_hash_table_insert (ppds_hash, g_strdup (mfg_normalized), list);
                 }
+
+              if (ppd_device_id && ppd_device_id[0] != '\0')
+                {
+                  g_autofree gchar *key = get_device_id_key (ppd_device_id);
+                  GPtrArray        *names;
+
+                  if (key != NULL)
+                    {
+                      names = g_hash_table_lookup (device_ids, key);
+                      if (names == NULL)
+                        {
+                          names = g_ptr_array_new_with_free_func (g_free);
+                          g_hash_table_insert (device_ids, g_steal_pointer (&key), names);
+                        }
+                      g_ptr_array_add (names, g_strdup (ppd_name));
+                    }
+                }
             }
 
           if (attr == NULL)
@@ -2704,8 +3221,13 @@ get_all_ppds_func (gpointer user_data)
       g_list_free_full (sort_list, g_free);
       g_hash_table_destroy (ppds_hash);
       g_hash_table_destroy (manufacturers_hash);
+
+      if (ppd_cache_enabled ())
+        save_ppd_cache (stamps, data->result, device_ids);
     }
 
+  g_clear_pointer (&device_ids, g_hash_table_destroy);
+
   get_all_ppds_cb (data);
 
   return NULL;
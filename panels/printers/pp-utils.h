@@ -170,6 +170,10 @@ void        get_all_ppds_async (GCancellable *cancellable,
 PPDList    *ppd_list_copy (PPDList *list);
 void        ppd_list_free (PPDList *list);
 
+gchar      *ppd_cache_get_display_name       (const gchar *ppd_name);
+
+gchar     **ppd_cache_get_ppds_for_device_id (const gchar *device_id);
+
 enum
 {
   IPP_ATTRIBUTE_TYPE_INTEGER = 0,
@@ -31,6 +31,7 @@
 #include <gtk/gtk.h>
 #include <act/act.h>
 
+#include "cc-login-history.h"
 #include "cc-login-history-dialog.h"
 #include "cc-user-accounts-resources.h"
 #include "cc-util.h"
@@ -38,28 +39,23 @@
 
 struct _CcLoginHistoryDialog
 {
-        GtkDialog     parent_instance;
+        GtkDialog       parent_instance;
 
-        GtkHeaderBar *header_bar;
-        GtkLabel     *title_label;
-        GtkListBox   *history_box;
-        GtkButton    *next_button;
-        GtkButton    *previous_button;
+        GtkHeaderBar   *header_bar;
+        GtkLabel       *title_label;
+        GtkListBox     *history_box;
+        GtkButton      *next_button;
+        GtkButton      *previous_button;
 
-        GDateTime    *week;
-        GDateTime    *current_week;
+        GDateTime      *week;
+        GDateTime      *current_week;
 
-        ActUser      *user;
+        ActUser        *user;
+        CcLoginHistory *history;
 };
 
 G_DEFINE_TYPE (CcLoginHistoryDialog, cc_login_history_dialog, GTK_TYPE_DIALOG)
 
-typedef struct {
-	gint64 login_time;
-	gint64 logout_time;
-	const gchar *type;
-} CcLoginHistory;
-
 static void
 show_week_label (CcLoginHistoryDialog *self)
 {
@@ -117,48 +113,14 @@ clear_history (CcLoginHistoryDialog *self)
         }
 }
 
-static GArray *
-get_login_history (ActUser *user)
-{
-	GArray *login_history;
-	GVariantIter *iter, *iter2;
-	GVariant *variant;
-	const GVariant *value;
-	const gchar *key;
-	CcLoginHistory history;
-
-	login_history = NULL;
-	value = act_user_get_login_history (user);
-	g_variant_get ((GVariant *) value, "a(xxa{sv})", &iter);
-	while (g_variant_iter_loop (iter, "(xxa{sv})", &history.login_time, &history.logout_time, &iter2)) {
-		while (g_variant_iter_loop (iter2, "{&sv}", &key, &variant)) {
-			if (g_strcmp0 (key, "type") == 0) {
-				history.type = g_variant_get_string (variant, NULL);
-			}
-		}
-
-		if (login_history == NULL) {
-			login_history = g_array_new (FALSE, TRUE, sizeof (CcLoginHistory));
-		}
-
-		g_array_append_val (login_history, history);
-	}
-
-	return login_history;
-}
-
 static void
 set_sensitivity (CcLoginHistoryDialog *self)
 {
-        g_autoptr(GArray) login_history = NULL;
-        CcLoginHistory history;
+        gint64 first_login;
         gboolean sensitive = FALSE;
 
-        login_history = get_login_history (self->user);
-        if (login_history != NULL) {
-                history = g_array_index (login_history, CcLoginHistory, 0);
-                sensitive = g_date_time_to_unix (self->week) > history.login_time;
-        }
+        if (cc_login_history_get_first_login (self->history, &first_login))
+                sensitive = g_date_time_to_unix (self->week) > first_login;
         gtk_widget_set_sensitive (GTK_WIDGET (self->previous_button), sensitive);
 
         sensitive = (g_date_time_compare (self->current_week, self->week) == 1);
@@ -166,7 +128,7 @@ set_sensitivity (CcLoginHistoryDialog *self)
 }
 
 static void
-add_record (CcLoginHistoryDialog *self, GDateTime *datetime, gchar *record_string, gint line)
+add_record (CcLoginHistoryDialog *self, GDateTime *datetime, const gchar *record_string)
 {
         g_autofree gchar *date = NULL;
         g_autofree gchar *time = NULL;
@@ -185,66 +147,49 @@ add_record (CcLoginHistoryDialog *self, GDateTime *datetime, gchar *record_strin
         adw_preferences_row_set_title (ADW_PREFERENCES_ROW (row), record_string);
         adw_action_row_set_subtitle (ADW_ACTION_ROW (row), str);
 
-        gtk_list_box_insert (self->history_box, row, line);
+        gtk_list_box_append (self->history_box, row);
 }
 
+/* Only the rows of the shown week are created, from the sessions found
+ * around it in the parsed history */
 static void
 show_week (CcLoginHistoryDialog *self)
 {
-        g_autoptr(GArray) login_history = NULL;
-        g_autoptr(GDateTime) datetime = NULL;
+        g_autoptr(GArray) events = NULL;
         g_autoptr(GDateTime) temp = NULL;
         gint64 from, to;
-        gint i, line;
-        CcLoginHistory history;
+        guint i;
 
         show_week_label (self);
         clear_history (self);
         set_sensitivity (self);
 
-        login_history = get_login_history (self->user);
-        if (login_history == NULL) {
-                return;
-        }
-
-        /* Find first record for week */
         from = g_date_time_to_unix (self->week);
         temp = g_date_time_add_weeks (self->week, 1);
         to = g_date_time_to_unix (temp);
-        for (i = login_history->len - 1; i >= 0; i--) {
-                history = g_array_index (login_history, CcLoginHistory, i);
-                if (history.login_time < to) {
-                        break;
-                }
-        }
 
-        /* Add new session records */
-        line = 0;
-        for (;i >= 0; i--) {
-                history = g_array_index (login_history, CcLoginHistory, i);
+        events = cc_login_history_get_events (self->history, from, to);
+        for (i = 0; i < events->len; i++) {
+                CcLoginHistoryEvent *event = &g_array_index (events, CcLoginHistoryEvent, i);
+                g_autoptr(GDateTime) datetime = NULL;
 
-                /* Display only x-session and tty records */
-                if (!g_str_has_prefix (history.type, ":") &&
-                    !g_str_has_prefix (history.type, "tty")) {
-                        continue;
-                }
-
-                if (history.logout_time > 0 && history.logout_time < from) {
-                        break;
-                }
+                datetime = g_date_time_new_from_unix_local (event->time);
+                add_record (self, datetime, event->is_login ? _("Session Started") : _("Session Ended"));
+        }
+}
 
-                if (history.logout_time > 0 && history.logout_time < to) {
-                        datetime = g_date_time_new_from_unix_local (history.logout_time);
-                        add_record (self, datetime, _("Session Ended"), line);
-                        line++;
-                }
+static void
+load_history (CcLoginHistoryDialog *self)
+{
+        g_clear_pointer (&self->history, cc_login_history_free);
+        self->history = cc_login_history_new ((GVariant *) act_user_get_login_history (self->user));
+}
 
-                if (history.login_time >= from) {
-                        datetime = g_date_time_new_from_unix_local (history.login_time);
-                        add_record (self, datetime, _("Session Started"), line);
-                        line++;
-                }
-        }
+static void
+user_changed_cb (CcLoginHistoryDialog *self)
+{
+        load_history (self);
+        show_week (self);
 }
 
 static void
@@ -275,6 +220,7 @@ cc_login_history_dialog_dispose (GObject *object)
         CcLoginHistoryDialog *self = CC_LOGIN_HISTORY_DIALOG (object);
 
         g_clear_object (&self->user);
+        g_clear_pointer (&self->history, cc_login_history_free);
         g_clear_pointer (&self->week, g_date_time_unref);
         g_clear_pointer (&self->current_week, g_date_time_unref);
 
@@ -324,6 +270,8 @@ cc_login_history_dialog_new (ActUser *user)
                              NULL);
 
         self->user = g_object_ref (user);
+        load_history (self);
+        g_signal_connect_object (user, "changed", G_CALLBACK (user_changed_cb), self, G_CONNECT_SWAPPED);
 
         /* Set the first day of this week */
         local = g_date_time_new_now_local ();
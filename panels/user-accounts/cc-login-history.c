@@ -0,0 +1,213 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2026 The GNOME Settings authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "cc-login-history.h"
+
+typedef struct {
+        gint64 login_time;
+        gint64 logout_time;
+} Session;
+
+struct _CcLoginHistory {
+        /* Graphical and tty sessions, sorted by login time */
+        GArray  *sessions;
+
+        /* Earliest login of any kind */
+        gint64   first_login;
+        gboolean has_first_login;
+};
+
+static gint
+compare_sessions (gconstpointer a,
+                  gconstpointer b)
+{
+        const Session *session_a = a;
+        const Session *session_b = b;
+
+        if (session_a->login_time < session_b->login_time)
+                return -1;
+
+        return session_a->login_time > session_b->login_time;
+}
+
+static gboolean
+is_displayed_type (const gchar *type)
+{
+        return type != NULL &&
+               (g_str_has_prefix (type, ":") || g_str_has_prefix (type, "tty"));
+}
+
+/**
+ * cc_login_history_new:
+ * @login_history: the "a(xxa{sv})" login history of an #ActUser
+ *
+ * Parses @login_history once, so that weeks can be looked up without
+ * going through the variant again.
+ *
+ * Returns: (transfer full): a new #CcLoginHistory
+ */
+CcLoginHistory *
+cc_login_history_new (GVariant *login_history)
+{
+        CcLoginHistory *history;
+        GVariantIter iter;
+        GVariant *details;
+        gint64 login_time;
+        gint64 logout_time;
+        gboolean sorted = TRUE;
+
+        history = g_new0 (CcLoginHistory, 1);
+
+        if (login_history == NULL ||
+            !g_variant_is_of_type (login_history, G_VARIANT_TYPE ("a(xxa{sv})"))) {
+                history->sessions = g_array_new (FALSE, FALSE, sizeof (Session));
+                return history;
+        }
+
+        history->sessions = g_array_sized_new (FALSE, FALSE, sizeof (Session),
+                                               g_variant_n_children (login_history));
+
+        g_variant_iter_init (&iter, login_history);
+        while (g_variant_iter_next (&iter, "(xx@a{sv})", &login_time, &logout_time, &details)) {
+                const gchar *type = NULL;
+                Session session;
+
+                if (!history->has_first_login || login_time < history->first_login) {
+                        history->first_login = login_time;
+                        history->has_first_login = TRUE;
+                }
+
+                g_variant_lookup (details, "type", "&s", &type);
+                if (is_displayed_type (type)) {
+                        if (history->sessions->len > 0 &&
+                            g_array_index (history->sessions, Session, history->sessions->len - 1).login_time > login_time)
+                                sorted = FALSE;
+
+                        session.login_time = login_time;
+                        session.logout_time = logout_time;
+                        g_array_append_val (history->sessions, session);
+                }
+
+                g_variant_unref (details);
+        }
+
+        /* AccountsService reports sessions in order; the stable sort keeps
+         * the order of sessions which started at the same time */
+        if (!sorted)
+                g_array_sort (history->sessions, compare_sessions);
+
+        return history;
+}
+
+void
+cc_login_history_free (CcLoginHistory *history)
+{
+        g_return_if_fail (history != NULL);
+
+        g_array_unref (history->sessions);
+        g_free (history);
+}
+
+/**
+ * cc_login_history_get_first_login:
+ * @history: a #CcLoginHistory
+ * @login_time: (out): return location for the earliest login time
+ *
+ * Returns: %TRUE if the history isn't empty
+ */
+gboolean
+cc_login_history_get_first_login (CcLoginHistory *history,
+                                  gint64         *login_time)
+{
+        g_return_val_if_fail (history != NULL, FALSE);
+
+        if (history->has_first_login)
+                *login_time = history->first_login;
+
+        return history->has_first_login;
+}
+
+/* Index of the first session started at or after @time */
+static guint
+find_session (CcLoginHistory *history,
+              gint64          time)
+{
+        guint low = 0;
+        guint high = history->sessions->len;
+
+        while (low < high) {
+                guint middle = low + (high - low) / 2;
+
+                if (g_array_index (history->sessions, Session, middle).login_time < time)
+                        low = middle + 1;
+                else
+                        high = middle;
+        }
+
+        return low;
+}
+
+/**
+ * cc_login_history_get_events:
+ * @history: a #CcLoginHistory
+ * @from: start of the window, as a UNIX time
+ * @to: end of the window, excluded
+ *
+ * Lists the sessions starting and ending in [@from, @to), most recent
+ * first. The latest session started before @to is found by a binary search,
+ * then sessions are walked back until one ended before @from, so only the
+ * sessions around the window are visited.
+ *
+ * Returns: (transfer full) (element-type CcLoginHistoryEvent): the events
+ */
+GArray *
+cc_login_history_get_events (CcLoginHistory *history,
+                             gint64          from,
+                             gint64          to)
+{
+        GArray *events;
+        guint i;
+
+        g_return_val_if_fail (history != NULL, NULL);
+
+        events = g_array_new (FALSE, FALSE, sizeof (CcLoginHistoryEvent));
+
+        for (i = find_session (history, to); i > 0; i--) {
+                const Session *session = &g_array_index (history->sessions, Session, i - 1);
+                CcLoginHistoryEvent event;
+
+                if (session->logout_time > 0 && session->logout_time < from)
+                        break;
+
+                if (session->logout_time > 0 && session->logout_time < to) {
+                        event.time = session->logout_time;
+                        event.is_login = FALSE;
+                        g_array_append_val (events, event);
+                }
+
+                if (session->login_time >= from) {
+                        event.time = session->login_time;
+                        event.is_login = TRUE;
+                        g_array_append_val (events, event);
+                }
+        }
+
+        return events;
+}
@@ -0,0 +1,43 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: nil; c-basic-offset: 8 -*-
+ *
+ * Copyright 2026 The GNOME Settings authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _CcLoginHistory CcLoginHistory;
+
+typedef struct {
+        gint64   time;
+        gboolean is_login;
+} CcLoginHistoryEvent;
+
+CcLoginHistory *cc_login_history_new             (GVariant       *login_history);
+void            cc_login_history_free            (CcLoginHistory *history);
+
+gboolean        cc_login_history_get_first_login (CcLoginHistory *history,
+                                                  gint64         *login_time);
+GArray         *cc_login_history_get_events      (CcLoginHistory *history,
+                                                  gint64          from,
+                                                  gint64          to);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (CcLoginHistory, cc_login_history_free)
+
+G_END_DECLS
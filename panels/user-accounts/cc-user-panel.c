@@ -106,6 +106,8 @@ struct _CcUserPanel {
         GPermission *permission;
         CcLanguageChooser *language_chooser;
         GListStore *other_users_model;
+        /* Unlocked administrators, kept up to date with the user signals */
+        GHashTable *active_admins;
 
         CcAvatarChooser *avatar_chooser;
 
@@ -255,6 +257,54 @@ create_user_row (gpointer item,
         return row;
 }
 
+typedef struct {
+        gchar *name;
+        gchar *collation_key;
+} UserSortKey;
+
+static void
+user_sort_key_free (UserSortKey *sort_key)
+{
+        g_free (sort_key->name);
+        g_free (sort_key->collation_key);
+        g_free (sort_key);
+}
+
+static GQuark
+user_sort_key_quark (void)
+{
+        return g_quark_from_static_string ("cc-user-panel-sort-key");
+}
+
+/* Whether the user was renamed since its collation key was computed */
+static gboolean
+user_sort_key_is_stale (ActUser *user)
+{
+        UserSortKey *sort_key;
+
+        sort_key = g_object_get_qdata (G_OBJECT (user), user_sort_key_quark ());
+
+        return sort_key == NULL || g_strcmp0 (sort_key->name, get_real_or_user_name (user)) != 0;
+}
+
+static const gchar *
+get_user_collation_key (ActUser *user)
+{
+        UserSortKey *sort_key;
+
+        if (user_sort_key_is_stale (user)) {
+                sort_key = g_new0 (UserSortKey, 1);
+                sort_key->name = g_strdup (get_real_or_user_name (user));
+                sort_key->collation_key = g_utf8_collate_key (sort_key->name, -1);
+                g_object_set_qdata_full (G_OBJECT (user), user_sort_key_quark (),
+                                         sort_key, (GDestroyNotify) user_sort_key_free);
+        } else {
+                sort_key = g_object_get_qdata (G_OBJECT (user), user_sort_key_quark ());
+        }
+
+        return sort_key->collation_key;
+}
+
 static gint
 sort_users (gconstpointer a, gconstpointer b, gpointer user_data)
 {
@@ -271,37 +321,90 @@ sort_users (gconstpointer a, gconstpointer b, gpointer user_data)
                 return G_MAXINT32;
         }
         else {
-                g_autofree gchar *name1 = NULL;
-                g_autofree gchar *name2 = NULL;
+                return strcmp (get_user_collation_key (ua), get_user_collation_key (ub));
+        }
+}
 
-                name1 = g_utf8_collate_key (get_real_or_user_name (ua), -1);
-                name2 = g_utf8_collate_key (get_real_or_user_name (ub), -1);
+static gint
+sort_users_array (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+        return sort_users (*(ActUser **) a, *(ActUser **) b, user_data);
+}
 
-                return strcmp (name1, name2);
-        }
+static gboolean
+is_other_user (ActUser *user)
+{
+        return !act_user_is_system_account (user) && act_user_get_uid (user) != getuid ();
 }
 
 static void
-user_changed (CcUserPanel *self, ActUser *user)
+update_active_admin (CcUserPanel *self, ActUser *user)
+{
+        if (act_user_get_account_type (user) == ACT_USER_ACCOUNT_TYPE_ADMINISTRATOR && !act_user_get_locked (user))
+                g_hash_table_add (self->active_admins, g_object_ref (user));
+        else
+                g_hash_table_remove (self->active_admins, user);
+}
+
+static void
+update_other_users_row (CcUserPanel *self)
 {
-        GSList *user_list, *l;
         gboolean show;
 
-        g_list_store_remove_all (self->other_users_model);
+        show = g_list_model_get_n_items (G_LIST_MODEL (self->other_users_model)) > 0;
+        gtk_widget_set_visible (GTK_WIDGET (self->other_users_row), show);
+}
+
+static void
+reload_users (CcUserPanel *self)
+{
+        g_autoptr(GPtrArray) other_users = NULL;
+        GSList *user_list, *l;
+
+        g_hash_table_remove_all (self->active_admins);
+
+        other_users = g_ptr_array_new ();
         user_list = act_user_manager_list_users (self->um);
         for (l = user_list; l; l = l->next) {
-                ActUser *other_user = ACT_USER (l->data);
+                ActUser *user = ACT_USER (l->data);
 
-                if (act_user_is_system_account (other_user)) {
-                        continue;
-                }
+                update_active_admin (self, user);
 
-                if (act_user_get_uid (other_user) == getuid ()) {
-                        continue;
-                }
+                if (is_other_user (user))
+                        g_ptr_array_add (other_users, user);
+        }
+        g_slist_free (user_list);
 
+        g_ptr_array_sort_with_data (other_users, sort_users_array, self);
+        g_list_store_splice (self->other_users_model,
+                             0,
+                             g_list_model_get_n_items (G_LIST_MODEL (self->other_users_model)),
+                             other_users->pdata,
+                             other_users->len);
+
+        update_other_users_row (self);
+}
+
+static void
+user_changed (CcUserPanel *self, ActUser *user)
+{
+        gboolean listed;
+        guint position;
+
+        update_active_admin (self, user);
+
+        listed = g_list_store_find (self->other_users_model, user, &position);
+        if (!is_other_user (user)) {
+                if (listed)
+                        g_list_store_remove (self->other_users_model, position);
+        } else if (listed && !user_sort_key_is_stale (user)) {
+                /* Still in place, only recreate its row */
+                g_list_store_splice (self->other_users_model, position, 1, (gpointer *) &user, 1);
+        } else {
+                if (listed)
+                        g_list_store_remove (self->other_users_model, position);
                 g_list_store_insert_sorted (self->other_users_model,
-                                            other_user,
+                                            user,
                                             sort_users,
                                             self);
         }
@@ -309,8 +412,23 @@ user_changed (CcUserPanel *self, ActUser *user)
         if (self->selected_user == user)
                 show_user (user, self);
 
-        show = g_list_model_get_n_items (G_LIST_MODEL (self->other_users_model)) > 0;
-        gtk_widget_set_visible (GTK_WIDGET (self->other_users_row), show);
+        update_other_users_row (self);
+}
+
+static void
+user_removed (CcUserPanel *self, ActUser *user)
+{
+        guint position;
+
+        g_hash_table_remove (self->active_admins, user);
+
+        if (g_list_store_find (self->other_users_model, user, &position))
+                g_list_store_remove (self->other_users_model, position);
+
+        if (self->selected_user == user)
+                show_user (user, self);
+
+        update_other_users_row (self);
 }
 
 static void
@@ -1221,6 +1339,10 @@ users_loaded (CcUserPanel *self)
 {
         GtkWidget *dialog;
 
+        /* Before showing the current user, whose account type row depends
+         * on the number of administrators */
+        reload_users (self);
+
         if (act_user_manager_no_service (self->um)) {
                 GtkWidget *toplevel;
 
@@ -1246,7 +1368,7 @@ users_loaded (CcUserPanel *self)
         g_signal_connect_object (self->um, "user-changed", G_CALLBACK (user_changed), self, G_CONNECT_SWAPPED);
         g_signal_connect_object (self->um, "user-is-logged-in-changed", G_CALLBACK (user_changed), self, G_CONNECT_SWAPPED);
         g_signal_connect_object (self->um, "user-added", G_CALLBACK (user_changed), self, G_CONNECT_SWAPPED);
-        g_signal_connect_object (self->um, "user-removed", G_CALLBACK (user_changed), self, G_CONNECT_SWAPPED);
+        g_signal_connect_object (self->um, "user-removed", G_CALLBACK (user_removed), self, G_CONNECT_SWAPPED);
 }
 
 static void
@@ -1262,30 +1384,9 @@ remove_unlock_tooltip (GtkWidget *widget)
         gtk_widget_set_tooltip_text (widget, NULL);
 }
 
-static guint
-get_num_active_admin (ActUserManager *um)
-{
-        GSList *list;
-        GSList *l;
-        guint num_admin = 0;
-
-        list = act_user_manager_list_users (um);
-        for (l = list; l != NULL; l = l->next) {
-                ActUser *u = l->data;
-                if (act_user_get_account_type (u) == ACT_USER_ACCOUNT_TYPE_ADMINISTRATOR && !act_user_get_locked (u)) {
-                        num_admin++;
-                }
-        }
-        g_slist_free (list);
-
-        return num_admin;
-}
-
 static gboolean
-would_demote_only_admin (ActUser *user)
+would_demote_only_admin (CcUserPanel *self, ActUser *user)
 {
-        ActUserManager *um = act_user_manager_get_default ();
-
         /* Prevent the user from demoting the only admin account.
          * Returns TRUE when user is an administrator and there is only
          * one enabled administrator. */
@@ -1294,7 +1395,7 @@ would_demote_only_admin (ActUser *user)
             act_user_get_locked (user))
                 return FALSE;
 
-        if (get_num_active_admin (um) > 1)
+        if (g_hash_table_size (self->active_admins) > 1)
                 return FALSE;
 
         return TRUE;
@@ -1318,7 +1419,7 @@ on_permission_changed (CcUserPanel *self)
 
         self_selected = act_user_get_uid (user) == geteuid ();
         gtk_widget_set_sensitive (GTK_WIDGET (self->remove_user_button), is_authorized && !self_selected
-                                  && !would_demote_only_admin (user));
+                                  && !would_demote_only_admin (self, user));
         if (is_authorized) {
                 gtk_widget_set_tooltip_text (GTK_WIDGET (self->remove_user_button), _("Delete the selected user account"));
         }
@@ -1331,7 +1432,7 @@ on_permission_changed (CcUserPanel *self)
                 gtk_widget_set_visible (GTK_WIDGET (self->account_type_row), FALSE);
                 gtk_widget_set_visible (GTK_WIDGET (self->autologin_row), FALSE);
         } else if (is_authorized && act_user_is_local_account (user)) {
-                if (would_demote_only_admin (user)) {
+                if (would_demote_only_admin (self, user)) {
                         gtk_widget_set_visible (GTK_WIDGET (self->account_type_row), FALSE);
                 } else {
                         gtk_widget_set_visible (GTK_WIDGET (self->account_type_row), TRUE);
@@ -1344,7 +1445,7 @@ on_permission_changed (CcUserPanel *self)
         }
         else {
                 gtk_widget_set_visible (GTK_WIDGET (self->account_type_row), FALSE);
-                if (would_demote_only_admin (user)) {
+                if (would_demote_only_admin (self, user)) {
                         gtk_widget_set_visible (GTK_WIDGET (self->account_type_row), FALSE);
                 } else {
                         gtk_widget_set_visible (GTK_WIDGET (self->account_type_row), TRUE);
@@ -1414,6 +1515,7 @@ setup_main_window (CcUserPanel *self)
         gboolean loaded;
 
         self->other_users_model = g_list_store_new (ACT_TYPE_USER);
+        self->active_admins = g_hash_table_new_full (NULL, NULL, g_object_unref, NULL);
         gtk_list_box_bind_model (self->other_users_listbox,
                                  G_LIST_MODEL (self->other_users_model),
                                  (GtkListBoxCreateWidgetFunc)create_user_row,
@@ -1445,7 +1547,6 @@ setup_main_window (CcUserPanel *self)
         g_object_get (self->um, "is-loaded", &loaded, NULL);
         if (loaded) {
                 users_loaded (self);
-                user_changed (self, NULL);
         } else {
                 g_signal_connect_object (self->um, "notify::is-loaded", G_CALLBACK (users_loaded), self, G_CONNECT_SWAPPED);
         }
@@ -1526,6 +1627,8 @@ cc_user_panel_dispose (GObject *object)
         g_clear_object (&self->login_screen_settings);
         g_clear_pointer ((GtkWindow **)&self->language_chooser, gtk_window_destroy);
         g_clear_object (&self->permission);
+        g_clear_object (&self->other_users_model);
+        g_clear_pointer (&self->active_admins, g_hash_table_unref);
 
         G_OBJECT_CLASS (cc_user_panel_parent_class)->dispose (object);
 }
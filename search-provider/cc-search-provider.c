@@ -41,6 +41,10 @@ struct _CcSearchProvider
   CcShellSearchProvider2 *skeleton;
 
   GHashTable *iter_table; /* COL_ID -> GtkTreeIter */
+
+  /* The last search, to answer repeated requests without searching */
+  GStrv last_terms;
+  GStrv last_results;
 };
 
 typedef enum {
@@ -67,24 +71,6 @@ get_casefolded_terms (char **terms)
   return casefolded_terms;
 }
 
-static gboolean
-matches_all_terms (GtkTreeModel  *model,
-                   GtkTreeIter   *iter,
-                   char         **terms)
-{
-  int i;
-
-  for (i = 0; terms[i]; i++)
-    {
-      if (!cc_shell_model_iter_matches_search (CC_SHELL_MODEL (model),
-                                               iter,
-                                               terms[i]))
-        return FALSE;
-    }
-
-  return TRUE;
-}
-
 static GtkTreeModel *
 get_model (void)
 {
@@ -94,35 +80,46 @@ get_model (void)
   return GTK_TREE_MODEL (cc_search_provider_app_get_model (app));
 }
 
+/* When @previous_results is not %NULL, only those panels are matched
+ * against @terms. This is valid for subsearches, where @terms are always
+ * more specific than the terms that produced @previous_results.
+ */
 static gchar **
-get_results (gchar **terms)
+get_results (CcSearchProvider  *self,
+             gchar            **previous_results,
+             gchar            **terms)
 {
   g_auto(GStrv) casefolded_terms = NULL;
-  GtkTreeModel *model = get_model ();
-  GtkTreeIter iter;
+  g_autoptr(GPtrArray) matches = NULL;
+  CcSearchIndex *search_index;
   GPtrArray *results;
-  gboolean ok;
+  guint i;
 
   casefolded_terms = get_casefolded_terms (terms);
-  results = g_ptr_array_new ();
 
-  cc_shell_model_set_sort_terms (CC_SHELL_MODEL (model), casefolded_terms);
+  if (self->last_terms && g_strv_equal ((const gchar * const *) self->last_terms,
+                                        (const gchar * const *) casefolded_terms))
+    return g_strdupv (self->last_results);
 
-  ok = gtk_tree_model_get_iter_first (model, &iter);
-  while (ok)
-    {
-      if (matches_all_terms (model, &iter, casefolded_terms))
-        {
-          gchar *id;
-          gtk_tree_model_get (model, &iter, COL_ID, &id, -1);
-          g_ptr_array_add (results, id);
-        }
+  search_index = cc_shell_model_get_search_index (CC_SHELL_MODEL (get_model ()));
 
-      ok = gtk_tree_model_iter_next (model, &iter);
-    }
+  if (previous_results)
+    matches = cc_search_index_search_within (search_index,
+                                             (const gchar * const *) previous_results,
+                                             (const gchar * const *) casefolded_terms);
+  else
+    matches = cc_search_index_search (search_index, (const gchar * const *) casefolded_terms);
 
+  results = g_ptr_array_new ();
+  for (i = 0; i < matches->len; i++)
+    g_ptr_array_add (results, g_strdup (g_ptr_array_index (matches, i)));
   g_ptr_array_add (results, NULL);
 
+  g_clear_pointer (&self->last_terms, g_strfreev);
+  g_clear_pointer (&self->last_results, g_strfreev);
+  self->last_terms = g_steal_pointer (&casefolded_terms);
+  self->last_results = g_strdupv ((gchar **) results->pdata);
+
   return (char**) g_ptr_array_free (results, FALSE);
 }
 
@@ -132,7 +129,7 @@ handle_get_initial_result_set (CcShellSearchProvider2  *skeleton,
                                char                   **terms,
                                CcSearchProvider        *self)
 {
-  g_auto(GStrv) results = get_results (terms);
+  g_auto(GStrv) results = get_results (self, NULL, terms);
   cc_shell_search_provider2_complete_get_initial_result_set (skeleton,
                                                              invocation,
                                                              (const char* const*) results);
@@ -146,14 +143,7 @@ handle_get_subsearch_result_set (CcShellSearchProvider2  *skeleton,
                                  char                   **terms,
                                  CcSearchProvider        *self)
 {
-  /* We ignore the previous results here since the model re-sorts for
-   * the new terms. This means that we're not really doing a subsearch
-   * but, on the other hand, the results are consistent with the
-   * control center's own search. In any case, the number of elements
-   * in the model is always small enough that we don't need to worry
-   * about this taking too long.
-   */
-  g_auto(GStrv) results = get_results (terms);
+  g_auto(GStrv) results = get_results (self, previous_results, terms);
   cc_shell_search_provider2_complete_get_subsearch_result_set (skeleton,
                                                                invocation,
                                                                (const char* const*) results);
@@ -204,7 +194,6 @@ handle_get_result_metas (CcShellSearchProvider2  *skeleton,
   GtkTreeIter *iter;
   int i;
   GVariantBuilder builder;
-  const char *id;
 
   g_variant_builder_init (&builder, G_VARIANT_TYPE ("aa{sv}"));
 
@@ -212,7 +201,7 @@ handle_get_result_metas (CcShellSearchProvider2  *skeleton,
     {
       g_autofree gchar *description = NULL;
       g_autofree gchar *name = NULL;
-      g_autoptr(GAppInfo) app = NULL;
+      g_autofree gchar *id = NULL;
       g_autoptr(GIcon) icon = NULL;
 
       iter = get_iter_for_result (self, results[i]);
@@ -220,12 +209,11 @@ handle_get_result_metas (CcShellSearchProvider2  *skeleton,
         continue;
 
       gtk_tree_model_get (model, iter,
-                          COL_APP, &app,
+                          COL_APP_ID, &id,
                           COL_NAME, &name,
                           COL_GICON, &icon,
                           COL_DESCRIPTION, &description,
                           -1);
-      id = g_app_info_get_id (app);
 
       g_variant_builder_open (&builder, G_VARIANT_TYPE ("a{sv}"));
       g_variant_builder_add (&builder, "{sv}",
@@ -357,6 +345,8 @@ cc_search_provider_dispose (GObject *object)
 
   g_clear_object (&self->skeleton);
   g_clear_pointer (&self->iter_table, g_hash_table_destroy);
+  g_clear_pointer (&self->last_terms, g_strfreev);
+  g_clear_pointer (&self->last_results, g_strfreev);
 
   G_OBJECT_CLASS (cc_search_provider_parent_class)->dispose (object);
 }
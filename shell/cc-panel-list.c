@@ -57,6 +57,9 @@ struct _CcPanelList
   gchar              *current_panel_id;
   gchar              *search_query;
 
+  CcSearchIndex      *search_index;
+  GHashTable         *search_ranks;
+
   CcPanelListView     previous_view;
   CcPanelListView     view;
   GHashTable         *id_to_data;
@@ -349,39 +352,20 @@ filter_func (GtkListBoxRow *row,
 {
   CcPanelList *self;
   RowData *data;
-  g_autofree gchar *search_text = NULL;
-  g_autofree gchar *panel_text = NULL;
-  g_autofree gchar *panel_description = NULL;
-  gboolean retval = FALSE;
-  gint i;
 
   self = CC_PANEL_LIST (user_data);
   data = g_object_get_data (G_OBJECT (row), "data");
 
-  if (!self->search_query)
+  if (!self->search_query || !self->search_ranks)
     return TRUE;
 
-  panel_text = cc_util_normalize_casefold_and_unaccent (data->name);
-  search_text = cc_util_normalize_casefold_and_unaccent (self->search_query);
-  panel_description = cc_util_normalize_casefold_and_unaccent (data->description);
-
-  g_strstrip (panel_text);
-  g_strstrip (search_text);
-  g_strstrip (panel_description);
-
   /*
    * The description label is only visible when the search is
    * happening.
    */
   gtk_widget_set_visible (data->description_label, self->view == CC_PANEL_LIST_SEARCH);
 
-  for (i = 0; !retval && data->keywords[i] != NULL; i++)
-      retval = (strstr (data->keywords[i], search_text) == data->keywords[i]);
-
-  retval = retval || g_strstr_len (panel_text, -1, search_text) != NULL ||
-           g_strstr_len (panel_description, -1, search_text) != NULL;
-
-  return retval;
+  return g_hash_table_contains (self->search_ranks, data->id);
 }
 
 static const gchar * const panel_order[] = {
@@ -467,44 +451,50 @@ search_sort_function (GtkListBoxRow *a,
 {
   CcPanelList *self;
   RowData *a_data, *b_data;
-  g_autofree gchar *a_name = NULL;
-  g_autofree gchar *b_name = NULL;
-  g_autofree gchar *search = NULL;
-  gchar *a_strstr, *b_strstr;
-  gint a_distance, b_distance;
+  gint a_rank, b_rank;
 
   self = CC_PANEL_LIST (user_data);
-  search = NULL;
   a_data = g_object_get_data (G_OBJECT (a), "data");
   b_data = g_object_get_data (G_OBJECT (b), "data");
 
-  a_distance = b_distance = G_MAXINT;
+  if (!self->search_ranks)
+    return g_utf8_collate (a_data->name, b_data->name);
 
-  a_name = cc_util_normalize_casefold_and_unaccent (a_data->name);
-  b_name = cc_util_normalize_casefold_and_unaccent (b_data->name);
-  g_strstrip (a_name);
-  g_strstrip (b_name);
+  /* Rows that don't match are filtered out, so their position doesn't matter */
+  a_rank = GPOINTER_TO_INT (g_hash_table_lookup (self->search_ranks, a_data->id));
+  b_rank = GPOINTER_TO_INT (g_hash_table_lookup (self->search_ranks, b_data->id));
 
-  if (self->search_query)
-    {
-      search = cc_util_normalize_casefold_and_unaccent (self->search_query);
-      g_strstrip (search);
-    }
+  return a_rank - b_rank;
+}
 
-  /* Default result for empty search */
-  if (!search || g_utf8_strlen (search, -1) == 0)
-    return g_strcmp0 (a_name, b_name);
+/* Queries the search index once per search query change, so that filtering
+ * and sorting the rows only needs hash table lookups.
+ */
+static void
+update_search_ranks (CcPanelList *self)
+{
+  g_autoptr(GPtrArray) results = NULL;
+  g_autofree gchar *search_text = NULL;
+  const gchar *terms[2] = { NULL, NULL };
+  guint i;
 
-  a_strstr = g_strstr_len (a_name, -1, search);
-  b_strstr = g_strstr_len (b_name, -1, search);
+  g_clear_pointer (&self->search_ranks, g_hash_table_destroy);
 
-  if (a_strstr)
-    a_distance = g_strstr_len (a_name, -1, search) - a_name;
+  if (!self->search_index)
+    return;
 
-  if (b_strstr)
-    b_distance = g_strstr_len (b_name, -1, search) - b_name;
+  if (self->search_query)
+    {
+      search_text = cc_util_normalize_casefold_and_unaccent (self->search_query);
+      g_strstrip (search_text);
+    }
 
-  return a_distance - b_distance;
+  terms[0] = search_text ? search_text : "";
+  results = cc_search_index_search (self->search_index, terms);
+
+  self->search_ranks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (i = 0; i < results->len; i++)
+    g_hash_table_insert (self->search_ranks, g_strdup (g_ptr_array_index (results, i)), GINT_TO_POINTER (i + 1));
 }
 
 static void
@@ -664,6 +654,8 @@ cc_panel_list_finalize (GObject *object)
   g_clear_pointer (&self->current_panel_id, g_free);
   g_clear_pointer (&self->id_to_data, g_hash_table_destroy);
   g_clear_pointer (&self->id_to_search_data, g_hash_table_destroy);
+  g_clear_pointer (&self->search_ranks, g_hash_table_destroy);
+  g_clear_object (&self->search_index);
 
   G_OBJECT_CLASS (cc_panel_list_parent_class)->finalize (object);
 }
@@ -887,6 +879,7 @@ cc_panel_list_set_search_query (CcPanelList *self,
       g_clear_pointer (&self->search_query, g_free);
       self->search_query = g_strdup (search);
 
+      update_search_ranks (self);
       update_search (self);
 
       g_object_notify_by_pspec (G_OBJECT (self), properties[PROP_SEARCH_QUERY]);
@@ -896,6 +889,28 @@ cc_panel_list_set_search_query (CcPanelList *self,
     }
 }
 
+/**
+ * cc_panel_list_set_search_index:
+ * @self: a #CcPanelList
+ * @search_index: the #CcSearchIndex of the panels
+ *
+ * Sets the index used to filter and sort the panels when searching.
+ */
+void
+cc_panel_list_set_search_index (CcPanelList   *self,
+                                CcSearchIndex *search_index)
+{
+  g_return_if_fail (CC_IS_PANEL_LIST (self));
+  g_return_if_fail (CC_IS_SEARCH_INDEX (search_index));
+
+  g_set_object (&self->search_index, search_index);
+
+  update_search_ranks (self);
+
+  gtk_list_box_invalidate_filter (GTK_LIST_BOX (self->search_listbox));
+  gtk_list_box_invalidate_sort (GTK_LIST_BOX (self->search_listbox));
+}
+
 CcPanelListView
 cc_panel_list_get_view (CcPanelList *self)
 {
@@ -48,6 +48,9 @@ const gchar*         cc_panel_list_get_search_query              (CcPanelList
 void                 cc_panel_list_set_search_query              (CcPanelList        *self,
                                                                   const gchar        *search);
 
+void                 cc_panel_list_set_search_index              (CcPanelList        *self,
+                                                                  CcSearchIndex      *search_index);
+
 CcPanelListView      cc_panel_list_get_view                      (CcPanelList        *self);
 
 void                 cc_panel_list_go_previous                   (CcPanelList        *self);
@@ -24,9 +24,11 @@
 #include <string.h>
 #include <gio/gdesktopappinfo.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #include "cc-panel.h"
 #include "cc-panel-loader.h"
+#include "cc-util.h"
 
 #ifndef CC_PANEL_LOADER_NO_GTYPES
 
@@ -155,6 +157,19 @@ static CcPanelLoaderVtable default_panels[] =
 static CcPanelLoaderVtable *panels_vtable = default_panels;
 static gsize panels_vtable_len = G_N_ELEMENTS (default_panels);
 
+/* Panel metadata cache
+ *
+ * Parsing every panel's desktop file, splitting its categories and
+ * normalizing its name, description and keywords dominates startup on
+ * slow machines. The result is stored as a serialized GVariant that is
+ * mapped back into memory on the next run. It is invalidated when the
+ * language, the panel list, any "applications" data directory or any
+ * of the desktop files change.
+ */
+#define PANEL_CACHE_VERSION    2
+#define PANEL_CACHE_ENTRY_TYPE "(sssxussmsmsmvasb)"
+#define PANEL_CACHE_TYPE       "(usasa(sx)a" PANEL_CACHE_ENTRY_TYPE ")"
+
 
 static int
 parse_categories (GDesktopAppInfo *app)
@@ -244,17 +259,287 @@ cc_panel_loader_load_by_name (CcShell     *shell,
 
 #endif /* CC_PANEL_LOADER_NO_GTYPES */
 
-/**
- * cc_panel_loader_fill_model:
- * @model: a #CcShellModel
- *
- * Fills @model with information from the available panels. It
- * iterates over the panel vtable, gathering the panel names,
- * build the desktop filename from it, and retrieves additional
- * information from it.
+static gint64
+get_mtime (const gchar *path)
+{
+  GStatBuf buf;
+
+  if (g_stat (path, &buf) != 0)
+    return 0;
+
+  return buf.st_mtime;
+}
+
+static gchar *
+get_cache_filename (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "gnome-control-center", "panels.cache", NULL);
+}
+
+static gchar *
+get_languages_key (void)
+{
+  return g_strjoinv (":", (gchar **) g_get_language_names ());
+}
+
+/* Desktop files can be added to, or shadowed in, any of the XDG data
+ * directories, so track the modification time of each of them.
  */
-void
-cc_panel_loader_fill_model (CcShellModel *model)
+static GVariant *
+build_applications_dirs (void)
+{
+  const gchar * const *system_dirs;
+  GVariantBuilder builder;
+  g_autofree gchar *user_dir = NULL;
+  guint i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sx)"));
+
+  user_dir = g_build_filename (g_get_user_data_dir (), "applications", NULL);
+  g_variant_builder_add (&builder, "(sx)", user_dir, get_mtime (user_dir));
+
+  system_dirs = g_get_system_data_dirs ();
+  for (i = 0; system_dirs[i]; i++)
+    {
+      g_autofree gchar *dir = g_build_filename (system_dirs[i], "applications", NULL);
+      g_variant_builder_add (&builder, "(sx)", dir, get_mtime (dir));
+    }
+
+  return g_variant_builder_end (&builder);
+}
+
+static gboolean
+cache_is_valid (GVariant *cache)
+{
+  g_autoptr(GVariant) current_dirs = NULL;
+  g_autoptr(GVariant) vtable_names = NULL;
+  g_autoptr(GVariant) entries = NULL;
+  g_autoptr(GVariant) dirs = NULL;
+  g_autofree gchar *languages = NULL;
+  const gchar *cached_languages;
+  guint32 version;
+  gsize i;
+
+  g_variant_get (cache, "(u&s@as@a(sx)@a" PANEL_CACHE_ENTRY_TYPE ")",
+                 &version,
+                 &cached_languages,
+                 &vtable_names,
+                 &dirs,
+                 &entries);
+
+  if (version != PANEL_CACHE_VERSION)
+    return FALSE;
+
+  languages = get_languages_key ();
+  if (g_strcmp0 (languages, cached_languages) != 0)
+    return FALSE;
+
+  if (g_variant_n_children (vtable_names) != panels_vtable_len)
+    return FALSE;
+
+  for (i = 0; i < panels_vtable_len; i++)
+    {
+      const gchar *name;
+
+      g_variant_get_child (vtable_names, i, "&s", &name);
+      if (g_strcmp0 (name, panels_vtable[i].name) != 0)
+        return FALSE;
+    }
+
+  current_dirs = g_variant_ref_sink (build_applications_dirs ());
+  if (!g_variant_equal (dirs, current_dirs))
+    return FALSE;
+
+  for (i = 0; i < g_variant_n_children (entries); i++)
+    {
+      g_autoptr(GVariant) entry = NULL;
+      const gchar *filename;
+      gint64 mtime;
+
+      entry = g_variant_get_child_value (entries, i);
+      g_variant_get_child (entry, 1, "&s", &filename);
+      g_variant_get_child (entry, 2, "x", &mtime);
+
+      if (get_mtime (filename) != mtime)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+fill_model_from_cache (CcShellModel *model)
+{
+  g_autoptr(GMappedFile) mapped_file = NULL;
+  g_autoptr(GVariant) entries = NULL;
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autofree gchar *filename = NULL;
+  GVariantIter iter;
+  GVariant *entry;
+
+  filename = get_cache_filename ();
+  mapped_file = g_mapped_file_new (filename, FALSE, NULL);
+  if (!mapped_file)
+    return FALSE;
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (PANEL_CACHE_TYPE), bytes, FALSE));
+
+  if (!cache_is_valid (cache))
+    {
+      g_debug ("Panel cache %s is outdated", filename);
+      return FALSE;
+    }
+
+  entries = g_variant_get_child_value (cache, 4);
+
+  g_variant_iter_init (&iter, entries);
+  while ((entry = g_variant_iter_next_value (&iter)) != NULL)
+    {
+      g_autoptr(GVariant) serialized_icon = NULL;
+      g_autoptr(GVariant) owned_entry = entry;
+      g_autoptr(GIcon) icon = NULL;
+      g_autofree const gchar **keywords = NULL;
+      const gchar *casefolded_description;
+      const gchar *casefolded_name;
+      const gchar *description;
+      const gchar *app_id;
+      const gchar *name;
+      const gchar *id;
+      gboolean has_sidebar;
+      guint32 category;
+
+      g_variant_get (owned_entry, "(&s&s&sxu&s&sm&sm&smv^a&sb)",
+                     &id,
+                     &app_id,
+                     NULL,
+                     NULL,
+                     &category,
+                     &name,
+                     &casefolded_name,
+                     &description,
+                     &casefolded_description,
+                     &serialized_icon,
+                     &keywords,
+                     &has_sidebar);
+
+      if (serialized_icon)
+        icon = g_icon_deserialize (serialized_icon);
+
+      cc_shell_model_add_cached_item (model,
+                                      category,
+                                      id,
+                                      app_id,
+                                      name,
+                                      casefolded_name,
+                                      description,
+                                      casefolded_description,
+                                      icon,
+                                      (GStrv) keywords,
+                                      has_sidebar);
+    }
+
+  g_debug ("Loaded %" G_GSIZE_FORMAT " panels from cache", g_variant_n_children (entries));
+
+  return TRUE;
+}
+
+static void
+save_cache (CcShellModel *model)
+{
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GError) error = NULL;
+  g_autofree gchar *languages = NULL;
+  g_autofree gchar *filename = NULL;
+  GVariantBuilder vtable_builder;
+  GVariantBuilder builder;
+  GtkTreeIter iter;
+  gboolean valid;
+  guint i;
+
+  g_variant_builder_init (&vtable_builder, G_VARIANT_TYPE ("as"));
+  for (i = 0; i < panels_vtable_len; i++)
+    g_variant_builder_add (&vtable_builder, "s", panels_vtable[i].name);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" PANEL_CACHE_ENTRY_TYPE));
+
+  valid = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (model), &iter);
+  while (valid)
+    {
+      g_autofree gchar *casefolded_description = NULL;
+      g_autofree gchar *casefolded_name = NULL;
+      g_autofree gchar *description = NULL;
+      g_autofree gchar *name = NULL;
+      g_autofree gchar *id = NULL;
+      g_autoptr(GVariant) serialized_icon = NULL;
+      g_autoptr(GAppInfo) app = NULL;
+      g_autoptr(GIcon) icon = NULL;
+      g_auto(GStrv) keywords = NULL;
+      CcPanelCategory category;
+      gboolean has_sidebar;
+      const gchar *desktop_filename;
+
+      gtk_tree_model_get (GTK_TREE_MODEL (model), &iter,
+                          COL_APP, &app,
+                          COL_ID, &id,
+                          COL_CATEGORY, &category,
+                          COL_NAME, &name,
+                          COL_CASEFOLDED_NAME, &casefolded_name,
+                          COL_DESCRIPTION, &description,
+                          COL_CASEFOLDED_DESCRIPTION, &casefolded_description,
+                          COL_GICON, &icon,
+                          COL_KEYWORDS, &keywords,
+                          COL_HAS_SIDEBAR, &has_sidebar,
+                          -1);
+
+      valid = gtk_tree_model_iter_next (GTK_TREE_MODEL (model), &iter);
+
+      desktop_filename = app ? g_desktop_app_info_get_filename (G_DESKTOP_APP_INFO (app)) : NULL;
+      if (!desktop_filename)
+        {
+          g_variant_builder_clear (&vtable_builder);
+          g_variant_builder_clear (&builder);
+          return;
+        }
+
+      if (icon)
+        serialized_icon = g_icon_serialize (icon);
+
+      g_variant_builder_add (&builder, "(sssxussmsmsmv^asb)",
+                             id,
+                             g_app_info_get_id (app),
+                             desktop_filename,
+                             get_mtime (desktop_filename),
+                             category,
+                             name,
+                             casefolded_name,
+                             description,
+                             casefolded_description,
+                             serialized_icon,
+                             keywords,
+                             has_sidebar);
+    }
+
+  languages = get_languages_key ();
+  cache = g_variant_ref_sink (g_variant_new ("(us@as@a(sx)@a" PANEL_CACHE_ENTRY_TYPE ")",
+                                             PANEL_CACHE_VERSION,
+                                             languages,
+                                             g_variant_builder_end (&vtable_builder),
+                                             build_applications_dirs (),
+                                             g_variant_builder_end (&builder)));
+
+  filename = get_cache_filename ();
+
+  if (!cc_util_write_cache_file (filename,
+                                 g_variant_get_data (cache),
+                                 g_variant_get_size (cache),
+                                 &error))
+    g_debug ("Failed to save panel cache %s: %s", filename, error->message);
+}
+
+static void
+fill_model_from_desktop_files (CcShellModel *model)
 {
   guint i;
 
@@ -279,17 +564,83 @@ cc_panel_loader_fill_model (CcShellModel *model)
 
       cc_shell_model_add_item (model, category, G_APP_INFO (app), panels_vtable[i].name);
     }
+}
 
-  /* If there's an static init function, execute it after adding all panels to
-   * the model. This will allow the panels to show or hide themselves without
-   * having an instance running.
-   */
 #ifndef CC_PANEL_LOADER_NO_GTYPES
+
+static guint static_init_id;
+
+static gboolean
+run_static_init_funcs_cb (gpointer user_data)
+{
+  guint i;
+
+  static_init_id = 0;
+
   for (i = 0; i < panels_vtable_len; i++)
     {
       if (panels_vtable[i].static_init_func)
         panels_vtable[i].static_init_func ();
     }
+
+  return G_SOURCE_REMOVE;
+}
+
+/**
+ * cc_panel_loader_ensure_static_init:
+ *
+ * Runs the static init functions of the panels right away if they are
+ * still waiting for their idle callback. This must be called before a
+ * panel is activated, so that panels hidden by their static init
+ * function can't be opened before it had a chance to run.
+ */
+void
+cc_panel_loader_ensure_static_init (void)
+{
+  if (static_init_id == 0)
+    return;
+
+  g_clear_handle_id (&static_init_id, g_source_remove);
+  run_static_init_funcs_cb (NULL);
+}
+
+#endif /* CC_PANEL_LOADER_NO_GTYPES */
+
+/**
+ * cc_panel_loader_fill_model:
+ * @model: a #CcShellModel
+ *
+ * Fills @model with information from the available panels. It
+ * iterates over the panel vtable, gathering the panel names,
+ * build the desktop filename from it, and retrieves additional
+ * information from it.
+ *
+ * When the default vtable is in use, the panel metadata is read
+ * from an on-disk cache if it is still up to date, and the cache
+ * is refreshed otherwise.
+ */
+void
+cc_panel_loader_fill_model (CcShellModel *model)
+{
+  gboolean use_cache;
+
+  use_cache = panels_vtable == default_panels;
+
+  if (!use_cache || !fill_model_from_cache (model))
+    {
+      fill_model_from_desktop_files (model);
+
+      if (use_cache)
+        save_cache (model);
+    }
+
+  /* If there's an static init function, execute it after adding all panels to
+   * the model. This will allow the panels to show or hide themselves without
+   * having an instance running. They are run from an idle callback, so that
+   * the sidebar can be drawn before any of them does potentially slow work.
+   */
+#ifndef CC_PANEL_LOADER_NO_GTYPES
+  static_init_id = g_idle_add (run_static_init_funcs_cb, NULL);
 #endif
 }
 
@@ -45,6 +45,7 @@ CcPanel *cc_panel_loader_load_by_name   (CcShell       *shell,
                                          const char    *name,
                                          const gchar   *title,
                                          GVariant      *parameters);
+void     cc_panel_loader_ensure_static_init (void);
 
 void    cc_panel_loader_override_vtable (CcPanelLoaderVtable *override_vtable,
                                          gsize                n_elements);
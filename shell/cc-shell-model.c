@@ -20,6 +20,7 @@
  */
 
 #include "cc-shell-model.h"
+#include "cc-search-index.h"
 #include "cc-util.h"
 
 #include <string.h>
@@ -32,17 +33,18 @@
 
 struct _CcShellModel
 {
-  GtkListStore parent;
+  GtkListStore   parent;
 
-  GStrv        sort_terms;
+  CcSearchIndex *search_index;
 };
 
 G_DEFINE_TYPE (CcShellModel, cc_shell_model, GTK_TYPE_LIST_STORE)
 
 static gint
-sort_by_name (GtkTreeModel *model,
-              GtkTreeIter  *a,
-              GtkTreeIter  *b)
+cc_shell_model_sort_func (GtkTreeModel *model,
+                          GtkTreeIter  *a,
+                          GtkTreeIter  *b,
+                          gpointer      data)
 {
   g_autofree gchar *a_name = NULL;
   g_autofree gchar *b_name = NULL;
@@ -53,156 +55,12 @@ sort_by_name (GtkTreeModel *model,
   return g_strcmp0 (a_name, b_name);
 }
 
-static gint
-sort_by_name_with_terms (GtkTreeModel  *model,
-                         GtkTreeIter   *a,
-                         GtkTreeIter   *b,
-                         gchar        **terms)
-{
-  gboolean a_match, b_match;
-  g_autofree gchar *a_name = NULL;
-  g_autofree gchar *b_name = NULL;
-  gint i;
-
-  gtk_tree_model_get (model, a, COL_CASEFOLDED_NAME, &a_name, -1);
-  gtk_tree_model_get (model, b, COL_CASEFOLDED_NAME, &b_name, -1);
-
-  for (i = 0; terms[i]; ++i)
-    {
-      a_match = strstr (a_name, terms[i]) != NULL;
-      b_match = strstr (b_name, terms[i]) != NULL;
-
-      if (a_match && !b_match)
-        return -1;
-      else if (!a_match && b_match)
-        return 1;
-    }
-
-  return 0;
-}
-
-static gint
-count_matches (gchar **keywords,
-               gchar **terms)
-{
-  gint i, j, c;
-
-  if (!keywords || !terms)
-    return 0;
-
-  c = 0;
-
-  for (i = 0; terms[i]; ++i)
-    for (j = 0; keywords[j]; ++j)
-      if (strstr (keywords[j], terms[i]))
-        c += 1;
-
-  return c;
-}
-
-static gint
-sort_by_keywords_with_terms (GtkTreeModel  *model,
-                             GtkTreeIter   *a,
-                             GtkTreeIter   *b,
-                             gchar        **terms)
-{
-  gint a_matches, b_matches;
-  g_auto(GStrv) a_keywords = NULL;
-  g_auto(GStrv) b_keywords = NULL;
-
-  gtk_tree_model_get (model, a, COL_KEYWORDS, &a_keywords, -1);
-  gtk_tree_model_get (model, b, COL_KEYWORDS, &b_keywords, -1);
-
-  a_matches = count_matches (a_keywords, terms);
-  b_matches = count_matches (b_keywords, terms);
-
-  if (a_matches > b_matches)
-    return -1;
-  else if (a_matches < b_matches)
-    return 1;
-
-  return 0;
-}
-
-static gint
-sort_by_description_with_terms (GtkTreeModel  *model,
-                                GtkTreeIter   *a,
-                                GtkTreeIter   *b,
-                                gchar        **terms)
-{
-  gint a_matches, b_matches;
-  g_autofree gchar *a_description = NULL;
-  g_autofree gchar *b_description = NULL;
-  g_auto(GStrv) a_description_split = NULL;
-  g_auto(GStrv) b_description_split = NULL;
-
-  gtk_tree_model_get (model, a, COL_DESCRIPTION, &a_description, -1);
-  gtk_tree_model_get (model, b, COL_DESCRIPTION, &b_description, -1);
-
-  if (a_description && !b_description)
-    return -1;
-  else if (!a_description && b_description)
-    return 1;
-  else if (!a_description && !b_description)
-    return 0;
-
-  a_description_split = g_strsplit (a_description, " ", -1);
-  b_description_split = g_strsplit (b_description, " ", -1);
-
-  a_matches = count_matches (a_description_split, terms);
-  b_matches = count_matches (b_description_split, terms);
-
-  if (a_matches > b_matches)
-    return -1;
-  else if (a_matches < b_matches)
-    return 1;
-
-  return 0;
-}
-
-static gint
-sort_with_terms (GtkTreeModel  *model,
-                 GtkTreeIter   *a,
-                 GtkTreeIter   *b,
-                 gchar        **terms)
-{
-  gint rval;
-
-  rval = sort_by_name_with_terms (model, a, b, terms);
-  if (rval)
-    return rval;
-
-  rval = sort_by_keywords_with_terms (model, a, b, terms);
-  if (rval)
-    return rval;
-
-  rval = sort_by_description_with_terms (model, a, b, terms);
-  if (rval)
-    return rval;
-
-  return sort_by_name (model, a, b);
-}
-
-static gint
-cc_shell_model_sort_func (GtkTreeModel *model,
-                          GtkTreeIter  *a,
-                          GtkTreeIter  *b,
-                          gpointer      data)
-{
-  CcShellModel *self = data;
-
-  if (!self->sort_terms || !self->sort_terms[0])
-    return sort_by_name (model, a, b);
-  else
-    return sort_with_terms (model, a, b, self->sort_terms);
-}
-
 static void
 cc_shell_model_finalize (GObject *object)
 {
   CcShellModel *self = CC_SHELL_MODEL (object);
 
-  g_clear_pointer (&self->sort_terms, g_strfreev);
+  g_clear_object (&self->search_index);
 
   G_OBJECT_CLASS (cc_shell_model_parent_class)->finalize (object);
 }
@@ -219,11 +77,14 @@ static void
 cc_shell_model_init (CcShellModel *self)
 {
   GType types[] = {G_TYPE_STRING, G_TYPE_STRING, G_TYPE_APP_INFO, G_TYPE_STRING, G_TYPE_UINT,
-                   G_TYPE_STRING, G_TYPE_STRING, G_TYPE_ICON, G_TYPE_STRV, G_TYPE_UINT, G_TYPE_BOOLEAN };
+                   G_TYPE_STRING, G_TYPE_STRING, G_TYPE_ICON, G_TYPE_STRV, G_TYPE_UINT, G_TYPE_BOOLEAN,
+                   G_TYPE_STRING };
 
   gtk_list_store_set_column_types (GTK_LIST_STORE (self),
                                    N_COLS, types);
 
+  self->search_index = cc_search_index_new ();
+
   gtk_tree_sortable_set_default_sort_func (GTK_TREE_SORTABLE (self),
                                            cc_shell_model_sort_func,
                                            self, NULL);
@@ -274,6 +135,42 @@ symbolicize_g_icon (GIcon *gicon)
   return g_themed_icon_new_with_default_fallbacks (new_name);
 }
 
+static void
+insert_item (CcShellModel     *model,
+             CcPanelCategory   category,
+             GAppInfo         *appinfo,
+             const char       *id,
+             const char       *app_id,
+             const char       *name,
+             const char       *casefolded_name,
+             const char       *description,
+             const char       *casefolded_description,
+             GIcon            *icon,
+             GStrv             keywords,
+             gboolean          has_sidebar)
+{
+  gtk_list_store_insert_with_values (GTK_LIST_STORE (model), NULL, 0,
+                                     COL_NAME, name,
+                                     COL_CASEFOLDED_NAME, casefolded_name,
+                                     COL_APP, appinfo,
+                                     COL_ID, id,
+                                     COL_CATEGORY, category,
+                                     COL_DESCRIPTION, description,
+                                     COL_CASEFOLDED_DESCRIPTION, casefolded_description,
+                                     COL_GICON, icon,
+                                     COL_KEYWORDS, keywords,
+                                     COL_VISIBILITY, CC_PANEL_VISIBLE,
+                                     COL_HAS_SIDEBAR, has_sidebar,
+                                     COL_APP_ID, app_id,
+                                     -1);
+
+  cc_search_index_add (model->search_index,
+                       id,
+                       casefolded_name,
+                       casefolded_description,
+                       (const gchar * const *) keywords);
+}
+
 void
 cc_shell_model_add_item (CcShellModel    *model,
                          CcPanelCategory  category,
@@ -294,19 +191,40 @@ cc_shell_model_add_item (CcShellModel    *model,
   icon = symbolicize_g_icon (g_app_info_get_icon (appinfo));
   has_sidebar = g_desktop_app_info_get_boolean (G_DESKTOP_APP_INFO (appinfo), "X-GNOME-ControlCenter-HasSidebar");
 
-  gtk_list_store_insert_with_values (GTK_LIST_STORE (model), NULL, 0,
-                                     COL_NAME, name,
-                                     COL_CASEFOLDED_NAME, casefolded_name,
-                                     COL_APP, appinfo,
-                                     COL_ID, id,
-                                     COL_CATEGORY, category,
-                                     COL_DESCRIPTION, comment,
-                                     COL_CASEFOLDED_DESCRIPTION, casefolded_description,
-                                     COL_GICON, icon,
-                                     COL_KEYWORDS, keywords,
-                                     COL_VISIBILITY, CC_PANEL_VISIBLE,
-                                     COL_HAS_SIDEBAR, has_sidebar,
-                                     -1);
+  insert_item (model, category, appinfo, id, g_app_info_get_id (appinfo),
+               name, casefolded_name,
+               comment, casefolded_description,
+               icon, keywords, has_sidebar);
+}
+
+/**
+ * cc_shell_model_add_cached_item:
+ *
+ * Adds a panel row from previously computed data, without a #GAppInfo
+ * backing it. @app_id is the id of the panel's desktop file. The
+ * casefolded strings, @keywords and @icon are expected to be in the
+ * same form cc_shell_model_add_item() would produce.
+ */
+void
+cc_shell_model_add_cached_item (CcShellModel    *model,
+                                CcPanelCategory  category,
+                                const char      *id,
+                                const char      *app_id,
+                                const char      *name,
+                                const char      *casefolded_name,
+                                const char      *description,
+                                const char      *casefolded_description,
+                                GIcon           *icon,
+                                GStrv            keywords,
+                                gboolean         has_sidebar)
+{
+  g_return_if_fail (CC_IS_SHELL_MODEL (model));
+  g_return_if_fail (id != NULL);
+
+  insert_item (model, category, NULL, id, app_id,
+               name, casefolded_name,
+               description, casefolded_description,
+               icon, keywords, has_sidebar);
 }
 
 gboolean
@@ -338,47 +256,19 @@ cc_shell_model_iter_matches_search (CcShellModel *model,
                                     GtkTreeIter  *iter,
                                     const char   *term)
 {
-  g_autofree gchar *name = NULL;
-  g_autofree gchar *description = NULL;
-  gboolean result;
-  g_auto(GStrv) keywords = NULL;
-
-  gtk_tree_model_get (GTK_TREE_MODEL (model), iter,
-                      COL_CASEFOLDED_NAME, &name,
-                      COL_CASEFOLDED_DESCRIPTION, &description,
-                      COL_KEYWORDS, &keywords,
-                      -1);
-
-  result = (strstr (name, term) != NULL);
+  g_autofree gchar *id = NULL;
 
-  if (!result && description)
-    result = (strstr (description, term) != NULL);
+  gtk_tree_model_get (GTK_TREE_MODEL (model), iter, COL_ID, &id, -1);
 
-  if (!result && keywords)
-    {
-      gint i;
-
-      for (i = 0; !result && keywords[i]; i++)
-        result = (strstr (keywords[i], term) == keywords[i]);
-    }
-
-  return result;
+  return cc_search_index_matches (model->search_index, id, term);
 }
 
-void
-cc_shell_model_set_sort_terms (CcShellModel  *self,
-                               gchar        **terms)
+CcSearchIndex *
+cc_shell_model_get_search_index (CcShellModel *model)
 {
-  g_return_if_fail (CC_IS_SHELL_MODEL (self));
+  g_return_val_if_fail (CC_IS_SHELL_MODEL (model), NULL);
 
-  g_clear_pointer (&self->sort_terms, g_strfreev);
-  self->sort_terms = g_strdupv (terms);
-
-  /* trigger a re-sort */
-  gtk_tree_sortable_set_default_sort_func (GTK_TREE_SORTABLE (self),
-                                           cc_shell_model_sort_func,
-                                           self,
-                                           NULL);
+  return model->search_index;
 }
 
 void
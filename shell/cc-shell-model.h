@@ -21,6 +21,7 @@
 #pragma once
 
 #include "cc-panel.h"
+#include "cc-search-index.h"
 
 #include <gtk/gtk.h>
 
@@ -55,6 +56,7 @@ enum
   COL_KEYWORDS,
   COL_VISIBILITY,
   COL_HAS_SIDEBAR,
+  COL_APP_ID,
 
   N_COLS
 };
@@ -67,6 +69,18 @@ void          cc_shell_model_add_item            (CcShellModel       *model,
                                                   GAppInfo           *appinfo,
                                                   const char         *id);
 
+void          cc_shell_model_add_cached_item     (CcShellModel       *model,
+                                                  CcPanelCategory     category,
+                                                  const char         *id,
+                                                  const char         *app_id,
+                                                  const char         *name,
+                                                  const char         *casefolded_name,
+                                                  const char         *description,
+                                                  const char         *casefolded_description,
+                                                  GIcon              *icon,
+                                                  GStrv               keywords,
+                                                  gboolean            has_sidebar);
+
 gboolean      cc_shell_model_has_panel           (CcShellModel       *model,
                                                   const char         *id);
 
@@ -74,8 +88,7 @@ gboolean      cc_shell_model_iter_matches_search (CcShellModel       *model,
                                                   GtkTreeIter        *iter,
                                                   const char         *term);
 
-void          cc_shell_model_set_sort_terms       (CcShellModel      *model,
-                                                   GStrv              terms);
+CcSearchIndex *cc_shell_model_get_search_index   (CcShellModel       *model);
 
 void          cc_shell_model_set_panel_visibility (CcShellModel      *self,
                                                    const gchar       *id,
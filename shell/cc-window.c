@@ -338,6 +338,8 @@ setup_model (CcWindow *self)
       valid = gtk_tree_model_iter_next (model, &iter);
     }
 
+  cc_panel_list_set_search_index (self->panel_list, cc_shell_model_get_search_index (self->store));
+
   /* React to visibility changes */
   g_signal_connect_object (model, "row-changed", G_CALLBACK (on_row_changed_cb), self, G_CONNECT_SWAPPED);
 }
@@ -390,6 +392,9 @@ set_active_panel_from_id (CcWindow     *self,
       CC_RETURN (TRUE);
     }
 
+  /* Panels may hide themselves from their static init function */
+  cc_panel_loader_ensure_static_init ();
+
   found = find_iter_for_panel_id (self, start_id, &iter);
   if (!found)
     {
@@ -0,0 +1,221 @@
+/* -*- mode: C; c-file-style: "gnu"; indent-tabs-mode: nil; -*-
+ *
+ * Copyright (C) 2026 The GNOME Settings authors
+ *
+ * Licensed under the GNU General Public License Version 2
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <gio/gio.h>
+#include "cc-color-profile-catalogue.h"
+
+#define PROFILE_PATH "/org/freedesktop/ColorManager/profiles/icc_test"
+#define OTHER_PROFILE_PATH "/org/freedesktop/ColorManager/profiles/icc_other"
+
+/* The catalogue follows the client's signals, which the tests emit
+ * themselves. colord doesn't run on the test bus, connecting a profile
+ * only creates its proxy. */
+typedef struct
+{
+  CdClient                *client;
+  CcColorProfileCatalogue *catalogue;
+  GPtrArray               *added;
+  GPtrArray               *removed;
+} Fixture;
+
+static void
+on_profile_added_cb (CcColorProfileCatalogue *catalogue,
+                     CdProfile               *profile,
+                     Fixture                 *fixture)
+{
+  g_ptr_array_add (fixture->added, g_object_ref (profile));
+}
+
+static void
+on_profile_removed_cb (CcColorProfileCatalogue *catalogue,
+                       CdProfile               *profile,
+                       Fixture                 *fixture)
+{
+  g_ptr_array_add (fixture->removed, g_object_ref (profile));
+}
+
+static void
+fixture_setup (Fixture       *fixture,
+               gconstpointer  user_data)
+{
+  fixture->client = cd_client_new ();
+  fixture->catalogue = cc_color_profile_catalogue_new (fixture->client);
+  fixture->added = g_ptr_array_new_with_free_func (g_object_unref);
+  fixture->removed = g_ptr_array_new_with_free_func (g_object_unref);
+
+  g_signal_connect (fixture->catalogue, "profile-added",
+                    G_CALLBACK (on_profile_added_cb), fixture);
+  g_signal_connect (fixture->catalogue, "profile-removed",
+                    G_CALLBACK (on_profile_removed_cb), fixture);
+}
+
+static void
+fixture_teardown (Fixture       *fixture,
+                  gconstpointer  user_data)
+{
+  g_signal_handlers_disconnect_by_data (fixture->catalogue, fixture);
+  g_clear_object (&fixture->catalogue);
+  g_clear_object (&fixture->client);
+  g_clear_pointer (&fixture->added, g_ptr_array_unref);
+  g_clear_pointer (&fixture->removed, g_ptr_array_unref);
+
+  /* Don't leave callbacks of this test to the next one */
+  while (g_main_context_iteration (NULL, FALSE));
+}
+
+static void
+wait_for_added (Fixture *fixture,
+                guint    n_added)
+{
+  while (fixture->added->len < n_added)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+store_result_cb (GObject      *source,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+  GAsyncResult **result = user_data;
+
+  *result = g_object_ref (res);
+}
+
+static void
+test_add_remove (Fixture       *fixture,
+                 gconstpointer  user_data)
+{
+  g_autoptr(CdProfile) profile = cd_profile_new_with_object_path (PROFILE_PATH);
+  g_autoptr(GPtrArray) profiles = NULL;
+
+  g_signal_emit_by_name (fixture->client, "profile-added", profile);
+  wait_for_added (fixture, 1);
+
+  g_assert_true (g_ptr_array_index (fixture->added, 0) == profile);
+  g_assert_true (cc_color_profile_catalogue_lookup (fixture->catalogue, PROFILE_PATH) == profile);
+
+  /* Adding it again is a no-op */
+  g_signal_emit_by_name (fixture->client, "profile-added", profile);
+  profiles = cc_color_profile_catalogue_get_profiles (fixture->catalogue);
+  g_assert_cmpuint (profiles->len, ==, 1);
+
+  g_signal_emit_by_name (fixture->client, "profile-removed", profile);
+  g_assert_cmpuint (fixture->removed->len, ==, 1);
+  g_assert_true (g_ptr_array_index (fixture->removed, 0) == profile);
+  g_assert_null (cc_color_profile_catalogue_lookup (fixture->catalogue, PROFILE_PATH));
+}
+
+static void
+test_removed_while_connecting (Fixture       *fixture,
+                               gconstpointer  user_data)
+{
+  g_autoptr(CdProfile) profile = cd_profile_new_with_object_path (PROFILE_PATH);
+  g_autoptr(CdProfile) other = cd_profile_new_with_object_path (OTHER_PROFILE_PATH);
+  g_autoptr(GAsyncResult) result = NULL;
+  g_autoptr(CdProfile) connected = NULL;
+  g_autoptr(GError) error = NULL;
+
+  g_signal_emit_by_name (fixture->client, "profile-added", profile);
+  cc_color_profile_catalogue_connect_profile (fixture->catalogue, profile, NULL,
+                                              store_result_cb, &result);
+
+  g_signal_emit_by_name (fixture->client, "profile-removed", profile);
+
+  /* The waiting task is told right away */
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  connected = cc_color_profile_catalogue_connect_profile_finish (fixture->catalogue, result, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+  g_assert_null (connected);
+
+  /* Connections complete in order, so the removed profile is done once
+   * the other one is added */
+  g_signal_emit_by_name (fixture->client, "profile-added", other);
+  wait_for_added (fixture, 1);
+
+  g_assert_true (g_ptr_array_index (fixture->added, 0) == other);
+  g_assert_null (cc_color_profile_catalogue_lookup (fixture->catalogue, PROFILE_PATH));
+  g_assert_cmpuint (fixture->removed->len, ==, 0);
+}
+
+static void
+test_readded_while_connecting (Fixture       *fixture,
+                               gconstpointer  user_data)
+{
+  g_autoptr(CdProfile) profile = cd_profile_new_with_object_path (PROFILE_PATH);
+  g_autoptr(CdProfile) readded = cd_profile_new_with_object_path (PROFILE_PATH);
+  g_autoptr(CdProfile) other = cd_profile_new_with_object_path (OTHER_PROFILE_PATH);
+  g_autoptr(GAsyncResult) result = NULL;
+  g_autoptr(CdProfile) connected = NULL;
+  g_autoptr(GError) error = NULL;
+
+  g_signal_emit_by_name (fixture->client, "profile-added", profile);
+  g_signal_emit_by_name (fixture->client, "profile-removed", profile);
+  g_signal_emit_by_name (fixture->client, "profile-added", readded);
+  cc_color_profile_catalogue_connect_profile (fixture->catalogue, readded, NULL,
+                                              store_result_cb, &result);
+
+  g_signal_emit_by_name (fixture->client, "profile-added", other);
+  wait_for_added (fixture, 2);
+
+  /* The connection of the removed profile doesn't take the place of the
+   * one added again */
+  g_assert_true (g_ptr_array_index (fixture->added, 0) == readded);
+  g_assert_true (g_ptr_array_index (fixture->added, 1) == other);
+  g_assert_true (cc_color_profile_catalogue_lookup (fixture->catalogue, PROFILE_PATH) == readded);
+
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  connected = cc_color_profile_catalogue_connect_profile_finish (fixture->catalogue, result, &error);
+  g_assert_no_error (error);
+  g_assert_true (connected == readded);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr(GTestDBus) bus = NULL;
+  int ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  /* Profiles are on the system bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+
+  g_test_add ("/color/profile-catalogue/add-remove", Fixture, NULL,
+              fixture_setup, test_add_remove, fixture_teardown);
+  g_test_add ("/color/profile-catalogue/removed-while-connecting", Fixture, NULL,
+              fixture_setup, test_removed_while_connecting, fixture_teardown);
+  g_test_add ("/color/profile-catalogue/readded-while-connecting", Fixture, NULL,
+              fixture_setup, test_readded_while_connecting, fixture_teardown);
+
+  ret = g_test_run ();
+
+  g_test_dbus_down (bus);
+
+  return ret;
+}
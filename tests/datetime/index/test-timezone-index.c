@@ -0,0 +1,268 @@
+#include <locale.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include "cc-datetime-resources.h"
+#include "tz.h"
+
+#define N_LOOKUPS 100000
+
+#define CACHED_COMMENT "From the cache"
+
+static void
+project_location (TzLocation *loc,
+                  gdouble    *x,
+                  gdouble    *y)
+{
+  *x = (loc->longitude + 180.0) / 360.0;
+  *y = (90.0 - loc->latitude) / 180.0;
+}
+
+static gdouble
+get_distance (TzLocation *loc,
+              gdouble     x,
+              gdouble     y,
+              gdouble     width,
+              gdouble     height)
+{
+  gdouble locx, locy, dx, dy;
+
+  project_location (loc, &locx, &locy);
+  dx = locx * width - x;
+  dy = locy * height - y;
+
+  return dx * dx + dy * dy;
+}
+
+static TzLocation *
+get_nearest_linear (GPtrArray *locations,
+                    gdouble    x,
+                    gdouble    y,
+                    gdouble    width,
+                    gdouble    height)
+{
+  TzLocation *best = NULL;
+  gdouble best_dist = G_MAXDOUBLE;
+  guint i;
+
+  for (i = 0; i < locations->len; i++)
+    {
+      TzLocation *loc = locations->pdata[i];
+      gdouble dist = get_distance (loc, x, y, width, height);
+
+      if (dist < best_dist)
+        {
+          best = loc;
+          best_dist = dist;
+        }
+    }
+
+  return best;
+}
+
+static void
+test_timezone_index_nearest (void)
+{
+  g_autoptr(TzDB) tz_db = NULL;
+  g_autoptr(TzIndex) index = NULL;
+  const gdouble width = 800, height = 400;
+  guint i;
+
+  tz_db = tz_load_db ();
+  if (tz_db == NULL)
+    {
+      g_test_skip ("No timezone database");
+      return;
+    }
+
+  index = tz_index_new (tz_db->locations, project_location);
+
+  /* Every location is its own nearest one */
+  for (i = 0; i < tz_db->locations->len; i++)
+    {
+      TzLocation *loc = tz_db->locations->pdata[i];
+      TzLocation *nearest;
+      gdouble x, y;
+
+      project_location (loc, &x, &y);
+      nearest = tz_index_get_nearest (index, x * width, y * height, width, height);
+
+      g_assert_cmpfloat (get_distance (nearest, x * width, y * height, width, height), ==, 0.0);
+    }
+
+  for (i = 0; i < 1000; i++)
+    {
+      TzLocation *expected, *nearest;
+      gdouble x, y;
+
+      x = g_test_rand_double_range (0, width);
+      y = g_test_rand_double_range (0, height);
+
+      expected = get_nearest_linear (tz_db->locations, x, y, width, height);
+      nearest = tz_index_get_nearest (index, x, y, width, height);
+
+      g_assert_cmpfloat (get_distance (nearest, x, y, width, height), ==,
+                         get_distance (expected, x, y, width, height));
+    }
+
+  g_assert_null (tz_index_get_nearest (index, 0, 0, 0, 0));
+}
+
+/* Replaces the comments of the cached locations, so that locations loaded
+ * from the cache can be told from parsed ones */
+static void
+mark_cached_locations (const gchar *cache_file)
+{
+  g_autoptr(GMappedFile) mapped_file = NULL;
+  g_autoptr(GBytes) bytes = NULL;
+  g_autoptr(GVariant) cache = NULL;
+  g_autoptr(GVariant) entries = NULL;
+  g_autoptr(GVariant) marked = NULL;
+  g_autoptr(GError) error = NULL;
+  GVariantBuilder builder;
+  GVariantIter iter;
+  const gchar *country, *zone;
+  gdouble latitude, longitude;
+  guint32 version;
+  gint64 mtime;
+  guint64 size;
+
+  mapped_file = g_mapped_file_new (cache_file, FALSE, &error);
+  g_assert_no_error (error);
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("(uxta(sddsms))"), bytes, FALSE));
+  g_variant_get (cache, "(uxt@a(sddsms))", &version, &mtime, &size, &entries);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(sddsms)"));
+  g_variant_iter_init (&iter, entries);
+  while (g_variant_iter_next (&iter, "(&sdd&sms)", &country, &latitude, &longitude, &zone, NULL))
+    g_variant_builder_add (&builder, "(sddsms)", country, latitude, longitude, zone, CACHED_COMMENT);
+
+  marked = g_variant_ref_sink (g_variant_new ("(uxt@a(sddsms))",
+                                              version,
+                                              mtime,
+                                              size,
+                                              g_variant_builder_end (&builder)));
+
+  g_file_set_contents (cache_file,
+                       g_variant_get_data (marked),
+                       g_variant_get_size (marked),
+                       &error);
+  g_assert_no_error (error);
+}
+
+static void
+test_timezone_cache (void)
+{
+  g_autoptr(TzDB) parsed_db = NULL;
+  g_autoptr(TzDB) cached_db = NULL;
+  g_autoptr(TzDB) marked_db = NULL;
+  g_autofree gchar *cache_file = NULL;
+  guint i;
+
+  cache_file = g_build_filename (g_get_user_cache_dir (), "gnome-control-center", "timezones.cache", NULL);
+  g_remove (cache_file);
+
+  parsed_db = tz_load_db ();
+  if (parsed_db == NULL)
+    {
+      g_test_skip ("No timezone database");
+      return;
+    }
+
+  g_assert_true (g_file_test (cache_file, G_FILE_TEST_IS_REGULAR));
+
+  cached_db = tz_load_db ();
+  g_assert_nonnull (cached_db);
+  g_assert_cmpuint (cached_db->locations->len, ==, parsed_db->locations->len);
+
+  for (i = 0; i < parsed_db->locations->len; i++)
+    {
+      TzLocation *parsed = parsed_db->locations->pdata[i];
+      TzLocation *cached = cached_db->locations->pdata[i];
+
+      g_assert_cmpstr (cached->country, ==, parsed->country);
+      g_assert_cmpstr (cached->zone, ==, parsed->zone);
+      g_assert_cmpstr (cached->comment, ==, parsed->comment);
+      g_assert_cmpfloat (cached->latitude, ==, parsed->latitude);
+      g_assert_cmpfloat (cached->longitude, ==, parsed->longitude);
+    }
+
+  /* The locations come from the cache, not from zone.tab */
+  mark_cached_locations (cache_file);
+  marked_db = tz_load_db ();
+  g_assert_nonnull (marked_db);
+  g_assert_cmpuint (marked_db->locations->len, ==, parsed_db->locations->len);
+
+  for (i = 0; i < marked_db->locations->len; i++)
+    {
+      TzLocation *marked = marked_db->locations->pdata[i];
+
+      g_assert_cmpstr (marked->comment, ==, CACHED_COMMENT);
+    }
+}
+
+static void
+test_timezone_index_benchmark (void)
+{
+  g_autoptr(TzDB) tz_db = NULL;
+  g_autoptr(TzIndex) index = NULL;
+  const gdouble width = 800, height = 400;
+  gdouble linear_time, index_time, load_time;
+  guint i;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Only run in performance mode");
+      return;
+    }
+
+  /* All but the first load use the cache */
+  g_test_timer_start ();
+  for (i = 0; i < 100; i++)
+    {
+      g_clear_pointer (&tz_db, tz_db_free);
+      tz_db = tz_load_db ();
+    }
+  load_time = g_test_timer_elapsed () / 100;
+
+  if (tz_db == NULL)
+    {
+      g_test_skip ("No timezone database");
+      return;
+    }
+
+  index = tz_index_new (tz_db->locations, project_location);
+
+  g_test_timer_start ();
+  for (i = 0; i < N_LOOKUPS; i++)
+    get_nearest_linear (tz_db->locations, i % 800, i % 400, width, height);
+  linear_time = g_test_timer_elapsed ();
+
+  g_test_timer_start ();
+  for (i = 0; i < N_LOOKUPS; i++)
+    tz_index_get_nearest (index, i % 800, i % 400, width, height);
+  index_time = g_test_timer_elapsed ();
+
+  g_test_message ("Loading %u locations: %.3f ms",
+                  tz_db->locations->len, load_time * 1000);
+  g_test_message ("%d lookups: %.3f ms linear, %.3f ms indexed",
+                  N_LOOKUPS, linear_time * 1000, index_time * 1000);
+  g_test_minimized_result (index_time, "%d indexed lookups: %.3f s", N_LOOKUPS, index_time);
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  setlocale (LC_ALL, "");
+  g_test_init (&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+  g_resources_register (cc_datetime_get_resource ());
+
+  g_test_add_func ("/datetime/timezone-index/nearest", test_timezone_index_nearest);
+  g_test_add_func ("/datetime/timezone-index/cache", test_timezone_cache);
+  g_test_add_func ("/datetime/timezone-index/benchmark", test_timezone_index_benchmark);
+
+  return g_test_run ();
+}
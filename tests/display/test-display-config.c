@@ -0,0 +1,550 @@
+/*
+ * Copyright 2026 The GNOME Settings authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <config.h>
+
+#include <gio/gio.h>
+#include "cc-display-config-dbus.h"
+
+#define N_MONITORS 4
+#define N_MODES 64
+#define N_ROUNDS 100
+
+static GDBusConnection *connection;
+
+/* A fake Mutter answering the verifications, served from its own thread so
+ * that the proxy of the config can be created synchronously */
+typedef enum
+{
+  VERIFY_ACCEPT,
+  VERIFY_REJECT,
+  VERIFY_FAIL,
+} VerifyReply;
+
+static const gchar mutter_introspection[] =
+  "<node>"
+  "  <interface name='org.gnome.Mutter.DisplayConfig'>"
+  "    <method name='ApplyMonitorsConfig'>"
+  "      <arg name='serial' direction='in' type='u'/>"
+  "      <arg name='method' direction='in' type='u'/>"
+  "      <arg name='logical_monitors' direction='in' type='a(iiduba(ssa{sv}))'/>"
+  "      <arg name='properties' direction='in' type='a{sv}'/>"
+  "    </method>"
+  "  </interface>"
+  "</node>";
+
+static struct
+{
+  GThread      *thread;
+  GMainLoop    *loop;
+  GMutex        mutex;
+  GCond         cond;
+  gboolean      ready;
+  const gchar  *address;
+  gint          reply;
+  gint          n_calls;
+} mutter;
+
+typedef struct
+{
+  int    width;
+  int    height;
+  double refresh_rate;
+} TestMode;
+
+static void
+add_monitor (GVariantBuilder *monitors,
+             GVariantBuilder *specs,
+             guint            number,
+             const TestMode  *modes,
+             guint            n_modes)
+{
+  g_autofree gchar *connector = g_strdup_printf ("DP-%u", number);
+  GVariantBuilder modes_builder;
+  guint i;
+
+  g_variant_builder_init (&modes_builder, G_VARIANT_TYPE ("a(siiddada{sv})"));
+  for (i = 0; i < n_modes; i++)
+    {
+      g_autofree gchar *id = NULL;
+      GVariantBuilder scales;
+      GVariantBuilder props;
+
+      id = g_strdup_printf ("%dx%d@%.3f", modes[i].width, modes[i].height, modes[i].refresh_rate);
+
+      g_variant_builder_init (&scales, G_VARIANT_TYPE ("ad"));
+      g_variant_builder_add (&scales, "d", 1.0);
+      g_variant_builder_add (&scales, "d", 2.0);
+
+      g_variant_builder_init (&props, G_VARIANT_TYPE ("a{sv}"));
+      if (i == 0)
+        {
+          g_variant_builder_add (&props, "{sv}", "is-current", g_variant_new_boolean (TRUE));
+          g_variant_builder_add (&props, "{sv}", "is-preferred", g_variant_new_boolean (TRUE));
+        }
+
+      g_variant_builder_add (&modes_builder, "(siiddada{sv})",
+                             id,
+                             modes[i].width,
+                             modes[i].height,
+                             modes[i].refresh_rate,
+                             1.0,
+                             &scales,
+                             &props);
+    }
+
+  g_variant_builder_add (monitors, "((ssss)a(siiddada{sv})a{sv})",
+                         connector, "ACME", "Monitor", "0",
+                         &modes_builder,
+                         NULL);
+  g_variant_builder_add (specs, "(ssss)", connector, "ACME", "Monitor", "0");
+}
+
+/* Every monitor is mirrored in a single logical monitor */
+static CcDisplayConfig *
+new_config (const TestMode * const *modes,
+            const guint            *n_modes,
+            guint                   n_monitors)
+{
+  GVariantBuilder monitors;
+  GVariantBuilder logical_monitors;
+  GVariantBuilder specs;
+  GVariant *state;
+  guint i;
+
+  g_variant_builder_init (&monitors, G_VARIANT_TYPE ("a((ssss)a(siiddada{sv})a{sv})"));
+  g_variant_builder_init (&specs, G_VARIANT_TYPE ("a(ssss)"));
+
+  for (i = 0; i < n_monitors; i++)
+    add_monitor (&monitors, &specs, i, modes[i], n_modes[i]);
+
+  g_variant_builder_init (&logical_monitors, G_VARIANT_TYPE ("a(iiduba(ssss)a{sv})"));
+  g_variant_builder_add (&logical_monitors, "(iiduba(ssss)a{sv})",
+                         0, 0, 1.0, 0, TRUE, &specs, NULL);
+
+  state = g_variant_new ("(ua((ssss)a(siiddada{sv})a{sv})a(iiduba(ssss)a{sv})a{sv})",
+                         1, &monitors, &logical_monitors, NULL);
+
+  return g_object_new (CC_TYPE_DISPLAY_CONFIG_DBUS,
+                       "state", state,
+                       "connection", connection,
+                       NULL);
+}
+
+static void
+mutter_method_call_cb (GDBusConnection       *bus_connection,
+                       const gchar           *sender,
+                       const gchar           *object_path,
+                       const gchar           *interface_name,
+                       const gchar           *method_name,
+                       GVariant              *parameters,
+                       GDBusMethodInvocation *invocation,
+                       gpointer               user_data)
+{
+  g_atomic_int_inc (&mutter.n_calls);
+
+  switch (g_atomic_int_get (&mutter.reply))
+    {
+    case VERIFY_ACCEPT:
+      g_dbus_method_invocation_return_value (invocation, NULL);
+      break;
+
+    case VERIFY_REJECT:
+      g_dbus_method_invocation_return_error_literal (invocation, G_DBUS_ERROR,
+                                                     G_DBUS_ERROR_INVALID_ARGS,
+                                                     "Invalid configuration");
+      break;
+
+    case VERIFY_FAIL:
+      g_dbus_method_invocation_return_error_literal (invocation, G_DBUS_ERROR,
+                                                     G_DBUS_ERROR_ACCESS_DENIED,
+                                                     "The requested configuration is based on stale information");
+      break;
+
+    default:
+      g_assert_not_reached ();
+    }
+}
+
+static const GDBusInterfaceVTable mutter_vtable = {
+  mutter_method_call_cb,
+};
+
+static void
+mutter_name_acquired_cb (GDBusConnection *bus_connection,
+                         const gchar     *name,
+                         gpointer         user_data)
+{
+  g_mutex_lock (&mutter.mutex);
+  mutter.ready = TRUE;
+  g_cond_signal (&mutter.cond);
+  g_mutex_unlock (&mutter.mutex);
+}
+
+static gpointer
+mutter_thread_func (gpointer user_data)
+{
+  g_autoptr(GMainContext) context = g_main_context_new ();
+  g_autoptr(GDBusConnection) bus_connection = NULL;
+  g_autoptr(GDBusNodeInfo) info = NULL;
+  g_autoptr(GError) error = NULL;
+  guint owner_id;
+
+  g_main_context_push_thread_default (context);
+  mutter.loop = g_main_loop_new (context, FALSE);
+
+  bus_connection = g_dbus_connection_new_for_address_sync (mutter.address,
+                                                           G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                           G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                           NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  info = g_dbus_node_info_new_for_xml (mutter_introspection, &error);
+  g_assert_no_error (error);
+
+  g_dbus_connection_register_object (bus_connection,
+                                     "/org/gnome/Mutter/DisplayConfig",
+                                     info->interfaces[0],
+                                     &mutter_vtable,
+                                     NULL, NULL, &error);
+  g_assert_no_error (error);
+
+  owner_id = g_bus_own_name_on_connection (bus_connection,
+                                           "org.gnome.Mutter.DisplayConfig",
+                                           G_BUS_NAME_OWNER_FLAGS_NONE,
+                                           mutter_name_acquired_cb,
+                                           NULL, NULL, NULL);
+
+  g_main_loop_run (mutter.loop);
+
+  g_bus_unown_name (owner_id);
+  g_clear_pointer (&mutter.loop, g_main_loop_unref);
+  g_main_context_pop_thread_default (context);
+
+  return NULL;
+}
+
+static void
+mutter_start (const gchar *address)
+{
+  mutter.address = address;
+  mutter.thread = g_thread_new ("mutter", mutter_thread_func, NULL);
+
+  g_mutex_lock (&mutter.mutex);
+  while (!mutter.ready)
+    g_cond_wait (&mutter.cond, &mutter.mutex);
+  g_mutex_unlock (&mutter.mutex);
+}
+
+static void
+mutter_stop (void)
+{
+  g_main_loop_quit (mutter.loop);
+  g_clear_pointer (&mutter.thread, g_thread_join);
+}
+
+static void
+mutter_reset (VerifyReply reply)
+{
+  g_atomic_int_set (&mutter.reply, reply);
+  g_atomic_int_set (&mutter.n_calls, 0);
+}
+
+static void
+store_result_cb (GObject      *source,
+                 GAsyncResult *res,
+                 gpointer      user_data)
+{
+  GAsyncResult **result = user_data;
+
+  *result = g_object_ref (res);
+}
+
+static gboolean
+verify (CcDisplayConfig *config)
+{
+  g_autoptr(GAsyncResult) result = NULL;
+  g_autoptr(GError) error = NULL;
+  gboolean is_applicable;
+
+  cc_display_config_is_applicable_async (config, NULL, store_result_cb, &result);
+  while (result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  is_applicable = cc_display_config_is_applicable_finish (config, result, &error);
+  g_assert_no_error (error);
+
+  return is_applicable;
+}
+
+static void
+expect_not_applicable (void)
+{
+  g_test_expect_message ("display-cc-panel", G_LOG_LEVEL_WARNING, "Config not applicable*");
+}
+
+static void
+test_cloning_modes (void)
+{
+  const TestMode first[] = {
+    { 1920, 1080, 60.0 },
+    { 1280, 720, 60.0 },
+    { 1280, 720, 50.0 },
+    { 800, 600, 60.0 },
+  };
+  const TestMode second[] = {
+    { 1280, 720, 30.0 },
+    { 1024, 768, 60.0 },
+    { 800, 600, 75.0 },
+  };
+  const TestMode * const modes[] = { first, second };
+  const guint n_modes[] = { G_N_ELEMENTS (first), G_N_ELEMENTS (second) };
+  g_autoptr(CcDisplayConfig) config = NULL;
+  GList *clone_modes;
+  int width, height;
+
+  config = new_config (modes, n_modes, G_N_ELEMENTS (modes));
+  g_assert_true (cc_display_config_is_cloning (config));
+
+  /* Modes of the first monitor with a resolution every monitor supports,
+   * in order, whatever their refresh rate */
+  clone_modes = cc_display_config_generate_cloning_modes (config);
+  g_assert_cmpuint (g_list_length (clone_modes), ==, 3);
+
+  cc_display_mode_get_resolution (g_list_nth_data (clone_modes, 0), &width, &height);
+  g_assert_cmpint (width, ==, 1280);
+  g_assert_cmpint (height, ==, 720);
+  g_assert_true (cc_display_mode_is_preferred (g_list_nth_data (clone_modes, 0)));
+
+  cc_display_mode_get_resolution (g_list_nth_data (clone_modes, 1), &width, &height);
+  g_assert_cmpint (width, ==, 1280);
+  g_assert_cmpint (height, ==, 720);
+  g_assert_false (cc_display_mode_is_preferred (g_list_nth_data (clone_modes, 1)));
+
+  cc_display_mode_get_resolution (g_list_nth_data (clone_modes, 2), &width, &height);
+  g_assert_cmpint (width, ==, 800);
+  g_assert_cmpint (height, ==, 600);
+
+  g_list_free_full (clone_modes, g_object_unref);
+}
+
+static void
+test_verdict_cache (void)
+{
+  const TestMode first[] = {
+    { 1920, 1080, 60.0 },
+    { 1280, 720, 60.0 },
+  };
+  const TestMode * const modes[] = { first };
+  const guint n_modes[] = { G_N_ELEMENTS (first) };
+  g_autoptr(CcDisplayConfig) config = NULL;
+  CcDisplayMonitor *monitor;
+
+  config = new_config (modes, n_modes, G_N_ELEMENTS (modes));
+  monitor = cc_display_config_get_monitors (config)->data;
+  mutter_reset (VERIFY_REJECT);
+
+  expect_not_applicable ();
+  g_assert_false (verify (config));
+  g_test_assert_expected_messages ();
+  g_assert_cmpint (g_atomic_int_get (&mutter.n_calls), ==, 1);
+
+  /* A rejection is a verdict on the configuration, so it isn't asked again,
+   * also not by the synchronous check */
+  g_atomic_int_set (&mutter.reply, VERIFY_ACCEPT);
+  g_assert_false (verify (config));
+  g_assert_false (cc_display_config_is_applicable (config));
+  g_assert_cmpint (g_atomic_int_get (&mutter.n_calls), ==, 1);
+
+  /* Another arrangement is verified, and acceptance is cached as well */
+  cc_display_monitor_set_mode (monitor, g_list_nth_data (cc_display_monitor_get_modes (monitor), 1));
+  g_assert_true (verify (config));
+  g_assert_true (verify (config));
+  g_assert_cmpint (g_atomic_int_get (&mutter.n_calls), ==, 2);
+}
+
+static void
+test_verdict_cache_errors (void)
+{
+  const TestMode first[] = {
+    { 1920, 1080, 60.0 },
+  };
+  const TestMode * const modes[] = { first };
+  const guint n_modes[] = { G_N_ELEMENTS (first) };
+  g_autoptr(CcDisplayConfig) config = NULL;
+
+  config = new_config (modes, n_modes, G_N_ELEMENTS (modes));
+  mutter_reset (VERIFY_FAIL);
+
+  expect_not_applicable ();
+  g_assert_false (verify (config));
+  g_test_assert_expected_messages ();
+
+  /* Failing to ask says nothing about the configuration */
+  g_atomic_int_set (&mutter.reply, VERIFY_ACCEPT);
+  g_assert_true (verify (config));
+  g_assert_cmpint (g_atomic_int_get (&mutter.n_calls), ==, 2);
+}
+
+static void
+test_verify_debounce (void)
+{
+  const TestMode first[] = {
+    { 1920, 1080, 60.0 },
+    { 1280, 720, 60.0 },
+    { 1024, 768, 60.0 },
+    { 800, 600, 60.0 },
+  };
+  const TestMode * const modes[] = { first };
+  const guint n_modes[] = { G_N_ELEMENTS (first) };
+  g_autoptr(CcDisplayConfig) config = NULL;
+  g_autoptr(GCancellable) cancellable = NULL;
+  GAsyncResult *results[G_N_ELEMENTS (first)] = { NULL, };
+  CcDisplayMonitor *monitor;
+  GList *monitor_modes;
+  guint i;
+
+  config = new_config (modes, n_modes, G_N_ELEMENTS (modes));
+  monitor = cc_display_config_get_monitors (config)->data;
+  monitor_modes = cc_display_monitor_get_modes (monitor);
+  mutter_reset (VERIFY_ACCEPT);
+
+  /* As in the panel, each edit of a burst supersedes the verification
+   * of the previous one */
+  for (i = 0; i < G_N_ELEMENTS (first); i++)
+    {
+      g_cancellable_cancel (cancellable);
+      g_clear_object (&cancellable);
+
+      cc_display_monitor_set_mode (monitor, g_list_nth_data (monitor_modes, i));
+
+      cancellable = g_cancellable_new ();
+      cc_display_config_is_applicable_async (config, cancellable, store_result_cb, &results[i]);
+    }
+
+  for (i = 0; i < G_N_ELEMENTS (first); i++)
+    {
+      g_autoptr(GError) error = NULL;
+      gboolean is_applicable;
+
+      while (results[i] == NULL)
+        g_main_context_iteration (NULL, TRUE);
+
+      is_applicable = cc_display_config_is_applicable_finish (config, results[i], &error);
+      if (i < G_N_ELEMENTS (first) - 1)
+        {
+          g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+          g_assert_false (is_applicable);
+        }
+      else
+        {
+          g_assert_no_error (error);
+          g_assert_true (is_applicable);
+        }
+
+      g_clear_object (&results[i]);
+    }
+
+  /* Only the last verification left a verdict, the superseded ones are
+   * asked again */
+  g_atomic_int_set (&mutter.reply, VERIFY_REJECT);
+  g_assert_true (verify (config));
+
+  cc_display_monitor_set_mode (monitor, g_list_nth_data (monitor_modes, 0));
+  expect_not_applicable ();
+  g_assert_false (verify (config));
+  g_test_assert_expected_messages ();
+}
+
+static void
+test_cloning_modes_benchmark (void)
+{
+  const TestMode *modes[N_MONITORS];
+  guint n_modes[N_MONITORS];
+  g_autoptr(CcDisplayConfig) config = NULL;
+  gdouble elapsed;
+  guint i, j;
+
+  if (!g_test_perf ())
+    {
+      g_test_skip ("Only run in performance mode");
+      return;
+    }
+
+  /* Modes come in pairs of refresh rates, and each monitor starts a few
+   * resolutions above the previous one, so most of them are shared */
+  for (i = 0; i < N_MONITORS; i++)
+    {
+      TestMode *monitor_modes = g_new (TestMode, N_MODES);
+
+      for (j = 0; j < N_MODES; j++)
+        {
+          guint step = j + i * N_MODES / 8;
+
+          monitor_modes[j].width = 640 + 16 * (step / 2);
+          monitor_modes[j].height = 480 + 9 * (step / 2);
+          monitor_modes[j].refresh_rate = step % 2 ? 59.94 : 60.0;
+        }
+
+      modes[i] = monitor_modes;
+      n_modes[i] = N_MODES;
+    }
+
+  config = new_config (modes, n_modes, N_MONITORS);
+
+  g_test_timer_start ();
+  for (i = 0; i < N_ROUNDS; i++)
+    g_list_free_full (cc_display_config_generate_cloning_modes (config), g_object_unref);
+  elapsed = g_test_timer_elapsed ();
+
+  g_test_message ("%d monitors with %d modes cloned %d times: %.3f ms, %.3f ms per round",
+                  N_MONITORS, N_MODES, N_ROUNDS, elapsed * 1000, elapsed * 1000 / N_ROUNDS);
+  g_test_minimized_result (elapsed, "%d rounds: %.3f s", N_ROUNDS, elapsed);
+
+  for (i = 0; i < N_MONITORS; i++)
+    g_free ((TestMode *) modes[i]);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_autoptr(GTestDBus) bus = NULL;
+  int ret;
+
+  g_test_init (&argc, &argv, NULL);
+
+  /* The config talks to a fake Mutter on the test bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  connection = g_bus_get_sync (G_BUS_TYPE_SESSION, NULL, NULL);
+  mutter_start (g_test_dbus_get_bus_address (bus));
+
+  g_test_add_func ("/display/cloning-modes", test_cloning_modes);
+  g_test_add_func ("/display/verdict-cache", test_verdict_cache);
+  g_test_add_func ("/display/verdict-cache-errors", test_verdict_cache_errors);
+  g_test_add_func ("/display/verify-debounce", test_verify_debounce);
+  g_test_add_func ("/display/cloning-modes-benchmark", test_cloning_modes_benchmark);
+
+  ret = g_test_run ();
+
+  mutter_stop ();
+  g_clear_object (&connection);
+  g_test_dbus_down (bus);
+
+  return ret;
+}
@@ -22,6 +22,7 @@
 
 #include <glib.h>
 #include <locale.h>
+#include <string.h>
 #include "info-cleanup.h"
 
 static void
@@ -68,6 +69,52 @@ test_info (void)
 	}
 }
 
+#define N_ROUNDS 1000
+
+static void
+test_info_benchmark (void)
+{
+	g_autofree gchar *contents = NULL;
+	g_autoptr(GPtrArray) inputs = NULL;
+	g_auto(GStrv) lines = NULL;
+	gdouble elapsed;
+	guint i, j;
+
+	if (!g_test_perf ()) {
+		g_test_skip ("Only run in performance mode");
+		return;
+	}
+
+	if (g_file_get_contents (TEST_SRCDIR "/info-cleanup-test.txt", &contents, NULL, NULL) == FALSE) {
+		g_warning ("Failed to load '%s'", TEST_SRCDIR "/info-cleanup-test.txt");
+		g_test_fail ();
+		return;
+	}
+
+	lines = g_strsplit (contents, "\n", -1);
+	inputs = g_ptr_array_new_with_free_func (g_free);
+	for (i = 0; lines[i] != NULL; i++) {
+		if (*lines[i] == '#')
+			continue;
+		if (*lines[i] == '\0')
+			break;
+
+		g_ptr_array_add (inputs, g_strndup (lines[i], strcspn (lines[i], "\t")));
+	}
+
+	g_test_timer_start ();
+	for (i = 0; i < N_ROUNDS; i++) {
+		for (j = 0; j < inputs->len; j++)
+			g_free (info_cleanup (g_ptr_array_index (inputs, j)));
+	}
+	elapsed = g_test_timer_elapsed ();
+
+	g_test_message ("%u strings cleaned up %d times: %.3f ms, %.3f µs per string",
+			inputs->len, N_ROUNDS, elapsed * 1000,
+			elapsed * 1000000 / (inputs->len * N_ROUNDS));
+	g_test_minimized_result (elapsed, "%u cleanups: %.3f s", inputs->len * N_ROUNDS, elapsed);
+}
+
 int main (int argc, char **argv)
 {
 	setlocale (LC_ALL, "");
@@ -76,6 +123,7 @@ int main (int argc, char **argv)
 	g_setenv ("G_DEBUG", "fatal_warnings", FALSE);
 
 	g_test_add_func ("/info/info", test_info);
+	g_test_add_func ("/info/benchmark", test_info_benchmark);
 
 	return g_test_run ();
 }
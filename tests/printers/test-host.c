@@ -0,0 +1,353 @@
+#include "config.h"
+
+#include <glib.h>
+#include <gio/gio.h>
+#include <string.h>
+
+#include "pp-host.h"
+
+/* Number of queue names tried by the LPD probe */
+#define N_LPD_CANDIDATES 90
+#define MAX_LPD_PROBES 8
+
+typedef struct
+{
+  GSocketService      *service;
+  guint16              port;
+  const gchar * const *queues;    /* accepted by the fake LPD server */
+  gboolean             silent;    /* never answer LPD requests */
+  gint                 n_connections;
+  gint                 n_running;
+  gint                 max_running;
+} FakeServer;
+
+static gboolean
+fake_server_run_cb (GThreadedSocketService *service,
+                    GSocketConnection      *connection,
+                    GObject                *source_object,
+                    gpointer                user_data)
+{
+  FakeServer    *server = user_data;
+  GInputStream  *input;
+  GOutputStream *output;
+  gchar          buffer[1024];
+  gsize          length = 0;
+  gssize         bytes_read;
+  gint           running;
+  gint           max_running;
+
+  g_atomic_int_inc (&server->n_connections);
+  running = g_atomic_int_add (&server->n_running, 1) + 1;
+  do
+    max_running = g_atomic_int_get (&server->max_running);
+  while (running > max_running &&
+         !g_atomic_int_compare_and_exchange (&server->max_running, max_running, running));
+
+  input = g_io_stream_get_input_stream (G_IO_STREAM (connection));
+  output = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+  /* Read a whole "\2queue\n" request */
+  while (length < sizeof (buffer) - 1 &&
+         (length == 0 || buffer[length - 1] != '\n'))
+    {
+      bytes_read = g_input_stream_read (input, buffer + length, sizeof (buffer) - 1 - length, NULL, NULL);
+      if (bytes_read <= 0)
+        break;
+      length += bytes_read;
+    }
+  buffer[length] = '\0';
+
+  if (server->silent)
+    {
+      /* Wait for the client to give up */
+      while (g_input_stream_read (input, buffer, sizeof (buffer), NULL, NULL) > 0)
+        ;
+    }
+  else if (length > 2 && buffer[0] == '\2' && buffer[length - 1] == '\n')
+    {
+      const gchar accepted[] = { 0 };
+      const gchar rejected[] = { 1 };
+      gboolean    found = FALSE;
+
+      buffer[length - 1] = '\0';
+      if (server->queues != NULL)
+        found = g_strv_contains (server->queues, buffer + 1);
+
+      g_output_stream_write_all (output, found ? accepted : rejected, 1, NULL, NULL, NULL);
+
+      /* Wait for the abort command of accepted queues */
+      if (found)
+        g_input_stream_read (input, buffer, sizeof (buffer), NULL, NULL);
+    }
+
+  g_atomic_int_add (&server->n_running, -1);
+
+  return TRUE;
+}
+
+static FakeServer *
+fake_server_new (const gchar * const *queues,
+                 gboolean             silent)
+{
+  g_autoptr(GInetAddress)   loopback = NULL;
+  g_autoptr(GSocketAddress) address = NULL;
+  g_autoptr(GSocketAddress) effective_address = NULL;
+  g_autoptr(GError)         error = NULL;
+  FakeServer               *server;
+
+  server = g_rc_box_new0 (FakeServer);
+  server->queues = queues;
+  server->silent = silent;
+  server->service = g_threaded_socket_service_new (2 * MAX_LPD_PROBES);
+
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  address = g_inet_socket_address_new (loopback, 0);
+  g_socket_listener_add_address (G_SOCKET_LISTENER (server->service),
+                                 address,
+                                 G_SOCKET_TYPE_STREAM,
+                                 G_SOCKET_PROTOCOL_TCP,
+                                 NULL,
+                                 &effective_address,
+                                 &error);
+  g_assert_no_error (error);
+
+  server->port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (effective_address));
+
+  /* Connections still being served keep the server alive */
+  g_signal_connect_data (server->service, "run",
+                         G_CALLBACK (fake_server_run_cb),
+                         g_rc_box_acquire (server),
+                         (GClosureNotify) g_rc_box_release,
+                         0);
+  g_socket_service_start (server->service);
+
+  return server;
+}
+
+static void
+fake_server_free (FakeServer *server)
+{
+  g_socket_service_stop (server->service);
+  g_socket_listener_close (G_SOCKET_LISTENER (server->service));
+  g_object_unref (server->service);
+  g_rc_box_release (server);
+}
+
+/* Returns a port nobody listens on */
+static guint16
+get_closed_port (void)
+{
+  FakeServer *server;
+  guint16     port;
+
+  server = fake_server_new (NULL, FALSE);
+  port = server->port;
+  fake_server_free (server);
+
+  return port;
+}
+
+static void
+devices_cb (GObject      *source_object,
+            GAsyncResult *res,
+            gpointer      user_data)
+{
+  GAsyncResult **result = user_data;
+
+  *result = g_object_ref (res);
+}
+
+static GAsyncResult *
+wait_for_result (GAsyncResult **result)
+{
+  while (*result == NULL)
+    g_main_context_iteration (NULL, TRUE);
+
+  return *result;
+}
+
+static PpHost *
+host_new (guint16 port)
+{
+  PpHost *host;
+
+  host = pp_host_new ("127.0.0.1");
+  g_object_set (host, "port", (gint) port, NULL);
+
+  return host;
+}
+
+static GPtrArray *
+get_lpd_devices (PpHost        *host,
+                 GCancellable  *cancellable,
+                 GError       **error)
+{
+  g_autoptr(GAsyncResult) result = NULL;
+
+  pp_host_get_lpd_devices_async (host, cancellable, devices_cb, &result);
+
+  return pp_host_get_lpd_devices_finish (host, wait_for_result (&result), error);
+}
+
+static void
+test_lpd_preferred_queue (void)
+{
+  const gchar * const  queues[] = { "pr3", "RAW", NULL };
+  g_autoptr(PpHost)    host = NULL;
+  g_autoptr(GPtrArray) devices = NULL;
+  g_autoptr(GError)    error = NULL;
+  g_autofree gchar    *expected_uri = NULL;
+  FakeServer          *server;
+
+  server = fake_server_new (queues, FALSE);
+  host = host_new (server->port);
+
+  devices = get_lpd_devices (host, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (devices->len, ==, 1);
+
+  /* "RAW" comes first in the list of candidates */
+  expected_uri = g_strdup_printf ("lpd://127.0.0.1:%u/RAW", server->port);
+  g_assert_cmpstr (pp_print_device_get_device_uri (g_ptr_array_index (devices, 0)), ==, expected_uri);
+
+  /* Candidates after the first wave of probes aren't tried */
+  g_assert_cmpint (g_atomic_int_get (&server->n_connections), <, N_LPD_CANDIDATES);
+
+  fake_server_free (server);
+}
+
+static void
+test_lpd_no_queue (void)
+{
+  g_autoptr(PpHost)    host = NULL;
+  g_autoptr(GPtrArray) devices = NULL;
+  g_autoptr(GError)    error = NULL;
+  FakeServer          *server;
+
+  server = fake_server_new (NULL, FALSE);
+  host = host_new (server->port);
+
+  devices = get_lpd_devices (host, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (devices->len, ==, 0);
+
+  g_assert_cmpint (g_atomic_int_get (&server->n_connections), ==, N_LPD_CANDIDATES);
+  g_assert_cmpint (g_atomic_int_get (&server->max_running), <=, MAX_LPD_PROBES);
+
+  fake_server_free (server);
+}
+
+static void
+test_lpd_closed_port (void)
+{
+  g_autoptr(PpHost)    host = NULL;
+  g_autoptr(GPtrArray) devices = NULL;
+  g_autoptr(GError)    error = NULL;
+
+  host = host_new (get_closed_port ());
+
+  devices = get_lpd_devices (host, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (devices->len, ==, 0);
+}
+
+static void
+test_lpd_deadline (void)
+{
+  g_autoptr(PpHost)    host = NULL;
+  g_autoptr(GPtrArray) devices = NULL;
+  g_autoptr(GError)    error = NULL;
+  FakeServer          *server;
+  gint64               start;
+
+  server = fake_server_new (NULL, TRUE);
+  host = host_new (server->port);
+
+  start = g_get_monotonic_time ();
+  g_object_set (host, "deadline", start + 200 * G_TIME_SPAN_MILLISECOND, NULL);
+
+  devices = get_lpd_devices (host, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (devices->len, ==, 0);
+  g_assert_cmpint (g_get_monotonic_time () - start, <, 5 * G_TIME_SPAN_SECOND);
+
+  fake_server_free (server);
+}
+
+static void
+test_lpd_cancel (void)
+{
+  g_autoptr(PpHost)       host = NULL;
+  g_autoptr(GPtrArray)    devices = NULL;
+  g_autoptr(GCancellable) cancellable = NULL;
+  g_autoptr(GError)       error = NULL;
+  FakeServer             *server;
+
+  server = fake_server_new (NULL, TRUE);
+  host = host_new (server->port);
+
+  cancellable = g_cancellable_new ();
+  g_cancellable_cancel (cancellable);
+
+  devices = get_lpd_devices (host, cancellable, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_null (devices);
+
+  fake_server_free (server);
+}
+
+static void
+test_jetdirect (void)
+{
+  g_autoptr(PpHost)       host = NULL;
+  g_autoptr(GPtrArray)    devices = NULL;
+  g_autoptr(GAsyncResult) result = NULL;
+  g_autoptr(GError)       error = NULL;
+  g_autofree gchar       *expected_uri = NULL;
+  FakeServer             *server;
+
+  server = fake_server_new (NULL, FALSE);
+  host = host_new (server->port);
+
+  pp_host_get_jetdirect_devices_async (host, NULL, devices_cb, &result);
+  devices = pp_host_get_jetdirect_devices_finish (host, wait_for_result (&result), &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (devices->len, ==, 1);
+
+  expected_uri = g_strdup_printf ("socket://127.0.0.1:%u", server->port);
+  g_assert_cmpstr (pp_print_device_get_device_uri (g_ptr_array_index (devices, 0)), ==, expected_uri);
+
+  fake_server_free (server);
+}
+
+static void
+test_jetdirect_closed_port (void)
+{
+  g_autoptr(PpHost)       host = NULL;
+  g_autoptr(GPtrArray)    devices = NULL;
+  g_autoptr(GAsyncResult) result = NULL;
+  g_autoptr(GError)       error = NULL;
+
+  host = host_new (get_closed_port ());
+
+  pp_host_get_jetdirect_devices_async (host, NULL, devices_cb, &result);
+  devices = pp_host_get_jetdirect_devices_finish (host, wait_for_result (&result), &error);
+  g_assert_no_error (error);
+  g_assert_cmpuint (devices->len, ==, 0);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/printers/host/lpd/preferred-queue", test_lpd_preferred_queue);
+  g_test_add_func ("/printers/host/lpd/no-queue", test_lpd_no_queue);
+  g_test_add_func ("/printers/host/lpd/closed-port", test_lpd_closed_port);
+  g_test_add_func ("/printers/host/lpd/deadline", test_lpd_deadline);
+  g_test_add_func ("/printers/host/lpd/cancel", test_lpd_cancel);
+  g_test_add_func ("/printers/host/jetdirect", test_jetdirect);
+  g_test_add_func ("/printers/host/jetdirect/closed-port", test_jetdirect_closed_port);
+
+  return g_test_run ();
+}
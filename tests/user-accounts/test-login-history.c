@@ -0,0 +1,186 @@
+/*
+ * Copyright 2026 The GNOME Settings authors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <config.h>
+
+#include <glib.h>
+#include "cc-login-history.h"
+
+#define WEEK (7 * 24 * 60 * 60)
+#define FROM ((gint64) 1700000000)
+#define TO (FROM + WEEK)
+
+typedef struct
+{
+  gint64       login_time;
+  gint64       logout_time;
+  const gchar *type;
+} TestSession;
+
+static GVariant *
+new_login_history (const TestSession *sessions,
+                   guint              n_sessions)
+{
+  GVariantBuilder builder;
+  guint i;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(xxa{sv})"));
+  for (i = 0; i < n_sessions; i++)
+    {
+      GVariantBuilder details;
+
+      g_variant_builder_init (&details, G_VARIANT_TYPE ("a{sv}"));
+      if (sessions[i].type != NULL)
+        g_variant_builder_add (&details, "{sv}", "type", g_variant_new_string (sessions[i].type));
+
+      g_variant_builder_add (&builder, "(xxa{sv})",
+                             sessions[i].login_time,
+                             sessions[i].logout_time,
+                             &details);
+    }
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static void
+assert_events (GArray                    *events,
+               const CcLoginHistoryEvent *expected,
+               guint                      n_expected)
+{
+  guint i;
+
+  g_assert_cmpuint (events->len, ==, n_expected);
+  for (i = 0; i < n_expected; i++)
+    {
+      CcLoginHistoryEvent *event = &g_array_index (events, CcLoginHistoryEvent, i);
+
+      g_assert_cmpint (event->time, ==, expected[i].time);
+      g_assert_cmpint (event->is_login, ==, expected[i].is_login);
+    }
+}
+
+static void
+test_week_boundaries (void)
+{
+  const TestSession sessions[] = {
+    { FROM - 100, FROM - 50, ":0" },
+    { FROM - 10, FROM + 10, ":0" },    /* spans the start of the week */
+    { FROM, FROM + 100, "tty2" },      /* starts with the week */
+    { FROM + 200, 0, "pts/1" },        /* not displayed */
+    { TO - 1, TO, ":1" },              /* ends with the week */
+    { TO, TO + 5, ":0" },              /* starts with the next week */
+  };
+  const CcLoginHistoryEvent this_week[] = {
+    { TO - 1, TRUE },
+    { FROM + 100, FALSE },
+    { FROM, TRUE },
+    { FROM + 10, FALSE },
+  };
+  const CcLoginHistoryEvent next_week[] = {
+    { TO + 5, FALSE },
+    { TO, TRUE },
+    { TO, FALSE },
+  };
+  const CcLoginHistoryEvent last_week[] = {
+    { FROM - 10, TRUE },
+    { FROM - 50, FALSE },
+    { FROM - 100, TRUE },
+  };
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(CcLoginHistory) history = NULL;
+  g_autoptr(GArray) events = NULL;
+
+  variant = new_login_history (sessions, G_N_ELEMENTS (sessions));
+  history = cc_login_history_new (variant);
+
+  events = cc_login_history_get_events (history, FROM, TO);
+  assert_events (events, this_week, G_N_ELEMENTS (this_week));
+  g_clear_pointer (&events, g_array_unref);
+
+  events = cc_login_history_get_events (history, TO, TO + WEEK);
+  assert_events (events, next_week, G_N_ELEMENTS (next_week));
+  g_clear_pointer (&events, g_array_unref);
+
+  events = cc_login_history_get_events (history, FROM - WEEK, FROM);
+  assert_events (events, last_week, G_N_ELEMENTS (last_week));
+  g_clear_pointer (&events, g_array_unref);
+
+  /* Nothing before the first session */
+  events = cc_login_history_get_events (history, FROM - 2 * WEEK, FROM - WEEK);
+  g_assert_cmpuint (events->len, ==, 0);
+}
+
+static void
+test_unsorted (void)
+{
+  const TestSession sessions[] = {
+    { FROM + 300, FROM + 400, ":0" },
+    { FROM - WEEK, FROM - WEEK + 1, "pts/0" },
+    { FROM + 100, FROM + 200, ":0" },
+    { FROM + 500, 0, "tty3" },
+  };
+  const CcLoginHistoryEvent expected[] = {
+    { FROM + 500, TRUE },
+    { FROM + 400, FALSE },
+    { FROM + 300, TRUE },
+    { FROM + 200, FALSE },
+    { FROM + 100, TRUE },
+  };
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(CcLoginHistory) history = NULL;
+  g_autoptr(GArray) events = NULL;
+  gint64 first_login;
+
+  variant = new_login_history (sessions, G_N_ELEMENTS (sessions));
+  history = cc_login_history_new (variant);
+
+  events = cc_login_history_get_events (history, FROM, TO);
+  assert_events (events, expected, G_N_ELEMENTS (expected));
+
+  /* Sessions which aren't displayed still count as the first login */
+  g_assert_true (cc_login_history_get_first_login (history, &first_login));
+  g_assert_cmpint (first_login, ==, FROM - WEEK);
+}
+
+static void
+test_empty (void)
+{
+  g_autoptr(GVariant) variant = NULL;
+  g_autoptr(CcLoginHistory) history = NULL;
+  g_autoptr(GArray) events = NULL;
+  gint64 first_login;
+
+  variant = new_login_history (NULL, 0);
+  history = cc_login_history_new (variant);
+
+  g_assert_false (cc_login_history_get_first_login (history, &first_login));
+
+  events = cc_login_history_get_events (history, FROM, TO);
+  g_assert_cmpuint (events->len, ==, 0);
+}
+
+int
+main (int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/user-accounts/login-history/week-boundaries", test_week_boundaries);
+  g_test_add_func ("/user-accounts/login-history/unsorted", test_unsorted);
+  g_test_add_func ("/user-accounts/login-history/empty", test_empty);
+
+  return g_test_run ();
+}